@@ -89,6 +89,17 @@ class ConfigState:
         self._state["max_display_items"] = min(max(value, 100), 5000)  # Clamp between 100-5000
         self._save_state()
     
+    @property
+    def rfid_filter(self) -> dict:
+        """Get the reader's inventory filter (EPC prefixes, suppression)"""
+        return self._state.get("rfid_filter", {"prefixes": [], "suppress": False})
+    
+    @rfid_filter.setter
+    def rfid_filter(self, value: dict):
+        """Set the reader's inventory filter"""
+        self._state["rfid_filter"] = value
+        self._save_state()
+    
     @property
     def simulation_running(self) -> bool:
         """Check if simulation is running"""
@@ -3,8 +3,9 @@ from fastapi import APIRouter, Depends, HTTPException
 from sqlalchemy.orm import Session
 from pydantic import BaseModel
 import paho.mqtt.publish as publish
-from typing import Optional
+from typing import List, Optional
 import os
+import re
 
 from ..database import get_db, get_db_simulation, get_db_production
 from ..models import Configuration, Anchor
@@ -206,6 +207,69 @@ def validate_anchors(db: Session = Depends(get_db)):
         "message": "All anchors validated successfully" if is_valid else "Anchor configuration mismatch detected"
     }
 
+class RfidFilter(BaseModel):
+    prefixes: List[str] = []   # Hex EPC prefixes, 1-24 digits
+    suppress: bool = False     # Silence recently read tags between full refresh cycles
+
+RFID_FILTER_TOPIC = "store/production/filter"
+RFID_FILTER_MAX_PREFIXES = 8  # Firmware limit (INVENTORY_FILTER.h)
+_HEX_PREFIX = re.compile(r"^[0-9a-fA-F]{1,24}$")
+
+def rfid_filter_payload(rfid_filter: RfidFilter) -> str:
+    """Firmware payload: prefixes and SUPPRESS as space separated tokens, OFF for no filter"""
+    tokens = [prefix.lower() for prefix in rfid_filter.prefixes]
+    if rfid_filter.suppress:
+        tokens.append("SUPPRESS")
+    return " ".join(tokens) or "OFF"
+
+@router.get("/rfid-filter", response_model=RfidFilter)
+def get_rfid_filter():
+    """Get the inventory filter last pushed to the reader"""
+    return config_state.rfid_filter
+
+@router.put("/rfid-filter", response_model=RfidFilter)
+def set_rfid_filter(rfid_filter: RfidFilter):
+    """
+    Push an inventory filter to the production reader (retained, so it is
+    replayed whenever the reader reconnects).
+    - prefixes: only tags whose EPC starts with one of these are inventoried
+    - suppress: tags that were just read sit out the next rounds, so the
+      reader spends its slots on tags it has not seen yet
+    An empty filter restores normal inventory.
+    """
+    if len(rfid_filter.prefixes) > RFID_FILTER_MAX_PREFIXES:
+        raise HTTPException(
+            status_code=400,
+            detail=f"At most {RFID_FILTER_MAX_PREFIXES} prefixes are supported"
+        )
+    invalid = [p for p in rfid_filter.prefixes if not _HEX_PREFIX.match(p)]
+    if invalid:
+        raise HTTPException(
+            status_code=400,
+            detail=f"Prefixes must be 1-24 hex digits: {', '.join(invalid)}"
+        )
+    
+    payload = rfid_filter_payload(rfid_filter)
+    try:
+        publish.single(
+            topic=RFID_FILTER_TOPIC,
+            payload=payload,
+            hostname=os.environ["MQTT_BROKER"],
+            port=int(os.environ["MQTT_PORT"]),
+            qos=1,
+            retain=True
+        )
+    except Exception as e:
+        logger.error(f"Failed to publish RFID filter: {str(e)}")
+        raise HTTPException(
+            status_code=500,
+            detail=f"Failed to publish RFID filter: {str(e)}"
+        )
+    
+    config_state.rfid_filter = rfid_filter.model_dump()
+    logger.info(f"RFID inventory filter set: {payload}")
+    return config_state.rfid_filter
+
 class MQTTControlResponse(BaseModel):
     success: bool
     message: str
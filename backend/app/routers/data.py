@@ -12,7 +12,7 @@ from ..models import (
     InventoryItem, Product, PurchaseEvent, ProductLocationHistory, StockLevel
 )
 from ..schemas import (
-    DataPacket, DetectionResponse, UWBMeasurementResponse, LatestDataResponse
+    DataPacket, UWBSamplePacket, PresencePacket, DetectionResponse, UWBMeasurementResponse, LatestDataResponse
 )
 from ..triangulation import TriangulationService
 from ..config import config_state, ConfigMode
@@ -47,6 +47,63 @@ async def websocket_endpoint(websocket: WebSocket):
         logger.error(f"WebSocket error: {e}")
         ws_manager.disconnect(websocket)
 
+def _create_production_item(db: Session, rfid_tag: str, timestamp: datetime):
+    """
+    Create the inventory item (and its product, if new) for a tag first seen in PRODUCTION mode.
+    Returns None for tags without product metadata (demo items), which are not created.
+    """
+    # Look up product metadata from epc_translation.csv
+    # NOTE: At scale, this would be replaced by API calls to Decathlon's product database
+    metadata = epc_lookup.lookup(rfid_tag)
+
+    if metadata:
+        # Use metadata from CSV
+        product_sku = metadata.gtin  # Use GTIN as SKU
+        product_name = epc_lookup.get_product_name(rfid_tag, include_details=False)
+        product_category = metadata.category
+        product_size = metadata.size
+        product_color = metadata.color
+        product_price = metadata.price_chf
+        logger.info(f"[PRODUCTION] Found metadata for EPC {rfid_tag}: {product_name}")
+    else:
+        # Skip items that can't be translated (demo items)
+        logger.warning(f"[PRODUCTION] No metadata found for EPC {rfid_tag} - skipping demo item")
+        return None  # Don't create demo items
+
+    # Check if product already exists (by SKU)
+    product = db.query(Product).filter(Product.sku == product_sku).first()
+    if not product:
+        product = Product(
+            sku=product_sku,
+            name=product_name,
+            category=product_category,
+            size=product_size,
+            color=product_color,
+            unit_price=product_price
+        )
+        db.add(product)
+        db.flush()
+        logger.info(f"[PRODUCTION] Created new product: {product.name} (SKU: {product_sku}) - CHF {product_price}")
+
+    # Create the inventory item with full display name (includes size/color)
+    display_name = epc_lookup.get_product_name(rfid_tag, include_details=True) if metadata else product_name
+
+    inventory_item = InventoryItem(
+        rfid_tag=rfid_tag,
+        product_id=product.id,
+        status='present',
+        # Position is set by the caller once the employee location is known
+        x_position=None,
+        y_position=None,
+        last_seen_at=timestamp,
+        consecutive_misses=0,
+        first_miss_at=None
+    )
+    db.add(inventory_item)
+    db.flush()
+    logger.info(f"[PRODUCTION] Created inventory item: {display_name} (RFID: {rfid_tag})")
+    return inventory_item
+
 @router.post("/data", status_code=201)
 async def receive_data(packet: DataPacket, db: Session = Depends(get_db)):
     """
@@ -95,56 +152,9 @@ async def receive_data(packet: DataPacket, db: Session = Depends(get_db)):
                 # In SIMULATION mode: Skip (simulation should have pre-generated inventory)
                 if config_state.mode == ConfigMode.PRODUCTION:
                     # Auto-create a product and inventory item for this new tag
-                    # Look up product metadata from epc_translation.csv
-                    # NOTE: At scale, this would be replaced by API calls to Decathlon's product database
-                    metadata = epc_lookup.lookup(detection.product_id)
-                    
-                    if metadata:
-                        # Use metadata from CSV
-                        product_sku = metadata.gtin  # Use GTIN as SKU
-                        product_name = epc_lookup.get_product_name(detection.product_id, include_details=False)
-                        product_category = metadata.category
-                        product_size = metadata.size
-                        product_color = metadata.color
-                        product_price = metadata.price_chf
-                        logger.info(f"[PRODUCTION] Found metadata for EPC {detection.product_id}: {product_name}")
-                    else:
-                        # Skip items that can't be translated (demo items)
-                        logger.warning(f"[PRODUCTION] No metadata found for EPC {detection.product_id} - skipping demo item")
+                    inventory_item = _create_production_item(db, detection.product_id, timestamp)
+                    if inventory_item is None:
                         continue  # Skip this detection, don't create demo items
-                    
-                    # Check if product already exists (by SKU)
-                    product = db.query(Product).filter(Product.sku == product_sku).first()
-                    if not product:
-                        product = Product(
-                            sku=product_sku,
-                            name=product_name,
-                            category=product_category,
-                            size=product_size,
-                            color=product_color,
-                            unit_price=product_price
-                        )
-                        db.add(product)
-                        db.flush()
-                        logger.info(f"[PRODUCTION] Created new product: {product.name} (SKU: {product_sku}) - CHF {product_price}")
-                    
-                    # Create the inventory item with full display name (includes size/color)
-                    display_name = epc_lookup.get_product_name(detection.product_id, include_details=True) if metadata else product_name
-                    
-                    inventory_item = InventoryItem(
-                        rfid_tag=detection.product_id,
-                        product_id=product.id,
-                        status='present',
-                        # Position will be set below when we have employee location
-                        x_position=None,
-                        y_position=None,
-                        last_seen_at=timestamp,
-                        consecutive_misses=0,
-                        first_miss_at=None
-                    )
-                    db.add(inventory_item)
-                    db.flush()
-                    logger.info(f"[PRODUCTION] Created inventory item: {display_name} (RFID: {detection.product_id})")
                 else:
                     # SIMULATION mode - skip unknown tags
                     logger.warning(f"Unknown RFID tag detected: {detection.product_id} - skipping (not in inventory)")
@@ -176,8 +186,16 @@ async def receive_data(packet: DataPacket, db: Session = Depends(get_db)):
             anchors = db.query(Anchor).filter(Anchor.is_active == True).all()
             logger.info(f"Position calculation: {len(anchors)} anchors configured, {len(packet.uwb_measurements)} UWB measurements received")
             
-            if len(anchors) >= 2 and len(packet.uwb_measurements) >= 2:
+            result = None
+            num_anchors = 0
+            if packet.position is not None:
+                # Solved on the device (firmware POSITION_SOLVER); no server-side trilateration
+                result = (packet.position.x, packet.position.y, packet.position.confidence)
+                num_anchors = packet.position.num_anchors
+                logger.info(f"Device position: ({result[0]:.1f}, {result[1]:.1f}) from {num_anchors} anchors")
+            elif len(anchors) >= 2 and len(packet.uwb_measurements) >= 2:
                 measurements = []
+                weights = []
                 configured_macs = {a.mac_address for a in anchors}
                 received_macs = {uwb.mac_address for uwb in packet.uwb_measurements}
                 logger.info(f"Configured anchor MACs: {configured_macs}")
@@ -191,179 +209,174 @@ async def receive_data(packet: DataPacket, db: Session = Depends(get_db)):
                             anchor.y_position,
                             uwb.distance_cm
                         ))
+                        weights.append(TriangulationService.range_weight(uwb.variance_cm2))
                         logger.info(f"Matched anchor {uwb.mac_address} at ({anchor.x_position}, {anchor.y_position})")
                     else:
                         logger.warning(f"No anchor configured for MAC: {uwb.mac_address}")
                 
                 if len(measurements) >= 2:
-                    result = TriangulationService.calculate_position(measurements)
-                    if result:
-                        x, y, confidence = result
-                        
-                        # Store the employee/tag position
-                        position = TagPosition(
-                            timestamp=timestamp,
-                            tag_id="employee",
-                            x_position=x,
-                            y_position=y,
-                            confidence=confidence,
-                            num_anchors=len(measurements)
-                        )
-                        db.add(position)
-                        position_calculated = True
-                        logger.info(f"✅ Employee position calculated: ({x:.1f}, {y:.1f}) confidence={confidence:.2f}")
+                    result = TriangulationService.calculate_position(measurements, weights)
+                    num_anchors = len(measurements)
+            
+            if result:
+                x, y, confidence = result
+                
+                # Store the employee/tag position
+                position = TagPosition(
+                    timestamp=timestamp,
+                    tag_id="employee",
+                    x_position=x,
+                    y_position=y,
+                    confidence=confidence,
+                    num_anchors=num_anchors
+                )
+                db.add(position)
+                position_calculated = True
+                logger.info(f"✅ Employee position calculated: ({x:.1f}, {y:.1f}) confidence={confidence:.2f}")
+                
+                # Build mapping of detected tags to RSSI for the detection service
+                detected_rfid_with_rssi: Dict[str, float] = {}
+                for detection in packet.detections:
+                    if detection.status == 'present':
+                        # Use RSSI from packet, default to -50 if not provided
+                        rssi = detection.rssi_dbm if detection.rssi_dbm is not None else -50.0
+                        detected_rfid_with_rssi[detection.product_id] = rssi
+                
+                # Update detected items' positions and RSSI based on mode
+                for detection in packet.detections:
+                    inventory_item = db.query(InventoryItem).filter(
+                        InventoryItem.rfid_tag == detection.product_id
+                    ).first()
+                    
+                    if inventory_item and detection.status == 'present':
+                        rssi = detection.rssi_dbm if detection.rssi_dbm is not None else -50.0
                         
-                        # Build mapping of detected tags to RSSI for the detection service
-                        detected_rfid_with_rssi: Dict[str, float] = {}
-                        for detection in packet.detections:
-                            if detection.status == 'present':
-                                # Use RSSI from packet, default to -50 if not provided
-                                rssi = detection.rssi_dbm if detection.rssi_dbm is not None else -50.0
-                                detected_rfid_with_rssi[detection.product_id] = rssi
+                        # PRODUCTION MODE: Restore missing items when detected again
+                        # In production, if you physically place a tag back and scan it, it should become present
+                        # SIMULATION MODE: Keep missing items as missing (they need explicit restock)
+                        # EDGE PRESENCE: only the reader's 'appeared' event restores an item
+                        was_restored = False
+                        if inventory_item.status == 'not present' and config_state.mode == ConfigMode.PRODUCTION \
+                                and not packet.edge_presence:
+                            logger.info(f"   🔄 [PRODUCTION] Item {detection.product_id[-8:]} was MISSING, now detected - restoring to PRESENT")
+                            inventory_item.status = 'present'
+                            was_restored = True
                         
-                        # Update detected items' positions and RSSI based on mode
-                        for detection in packet.detections:
-                            inventory_item = db.query(InventoryItem).filter(
-                                InventoryItem.rfid_tag == detection.product_id
-                            ).first()
+                        # Update items that are 'present' or were just restored
+                        if inventory_item.status == 'present':
+                            # Always update RSSI and last_seen when detected
+                            inventory_item.last_detection_rssi = rssi
+                            inventory_item.last_seen_at = timestamp
+                            # Reset miss tracking since item was detected
+                            inventory_item.consecutive_misses = 0
+                            inventory_item.first_miss_at = None
                             
-                            if inventory_item and detection.status == 'present':
-                                rssi = detection.rssi_dbm if detection.rssi_dbm is not None else -50.0
-                                
-                                # PRODUCTION MODE: Restore missing items when detected again
-                                # In production, if you physically place a tag back and scan it, it should become present
-                                # SIMULATION MODE: Keep missing items as missing (they need explicit restock)
-                                was_restored = False
-                                if inventory_item.status == 'not present' and config_state.mode == ConfigMode.PRODUCTION:
-                                    logger.info(f"   🔄 [PRODUCTION] Item {detection.product_id[-8:]} was MISSING, now detected - restoring to PRESENT")
-                                    inventory_item.status = 'present'
-                                    was_restored = True
-                                
-                                # Update items that are 'present' or were just restored
-                                if inventory_item.status == 'present':
-                                    # Always update RSSI and last_seen when detected
-                                    inventory_item.last_detection_rssi = rssi
-                                    inventory_item.last_seen_at = timestamp
-                                    # Reset miss tracking since item was detected
-                                    inventory_item.consecutive_misses = 0
-                                    inventory_item.first_miss_at = None
-                                    
-                                    # SIMULATION MODE: Items already have shelf positions in database
-                                    # Just mark them as detected, don't override their positions
-                                    # The simulation generated items with shelf positions
-                                    
-                                    # PRODUCTION MODE: Set position to where employee detected it
-                                    # (real hardware - item found at employee's location)
-                                    if config_state.mode == ConfigMode.PRODUCTION:
-                                        inventory_item.x_position = x
-                                        inventory_item.y_position = y
-                                        if was_restored:
-                                            logger.info(f"   ✅ [PRODUCTION] Item {detection.product_id[-8:]} restored at position ({x:.1f}, {y:.1f}), RSSI={rssi}")
-                                        else:
-                                            logger.debug(f"   [PRODUCTION] Updated item {detection.product_id[-8:]} to employee position ({x:.1f}, {y:.1f}), RSSI={rssi}")
-                                    elif inventory_item.x_position is None:
-                                        # SIMULATION: Only set position if item has none (shouldn't happen if inventory was generated properly)
-                                        inventory_item.x_position = x
-                                        inventory_item.y_position = y
-                                        logger.warning(f"   [SIMULATION] Item {detection.product_id} had no position, set to ({x:.1f}, {y:.1f})")
-                                    # else: SIMULATION mode and item has position - keep the shelf position!
-                                # else: Item is 'not present' in SIMULATION mode - don't change anything
-                                # Simulation missing items can only be restored via explicit restock action
-                        
-                        db.commit()
-                        position_calculated = True
-                        
-                        # === UNIFIED MISSING ITEM DETECTION ===
-                        # Uses the SAME MissingItemDetector algorithm for BOTH simulation and production
-                        # This ensures consistent behavior regardless of mode
-                        #
-                        # Algorithm (3 safety checks):
-                        # 1. Item was detected → Reset miss counter
-                        # 2. Item within RFID range (50cm) → Count as miss
-                        # 3. Consecutive misses >= 4 → Mark as missing
-                        # 
-                        # The consecutive miss threshold accounts for RFID read failures
-                        # No time-based check needed - miss count alone is sufficient
-                        
-                        logger.info(f"\n{'='*60}")
-                        logger.info(f"🔍 MISSING DETECTION CHECK")
-                        logger.info(f"   Employee at: ({x:.1f}, {y:.1f})")
-                        logger.info(f"   Detected {len(detected_rfid_with_rssi)} RFID tags in packet")
-                        
-                        newly_missing_items = MissingItemDetector.process_detections(
-                            db=db,
-                            detected_rfid_tags=detected_rfid_with_rssi,
-                            employee_x=x,
-                            employee_y=y,
-                            timestamp=timestamp
-                        )
-                        
-                        if newly_missing_items:
-                            logger.info(f"   🧮 Total newly missing: {len(newly_missing_items)} item(s)")
-                        logger.info(f"{'='*60}\n")
-                        
-                        # Broadcast real-time updates to WebSocket clients
-                        await ws_manager.broadcast_position_update({
-                            "timestamp": timestamp.isoformat(),
-                            "tag_id": "employee",
-                            "x": x,
-                            "y": y,
-                            "confidence": confidence,
-                            "num_anchors": len(measurements)
+                            # SIMULATION MODE: Items already have shelf positions in database
+                            # Just mark them as detected, don't override their positions
+                            # The simulation generated items with shelf positions
+                            
+                            # PRODUCTION MODE: Set position to where employee detected it
+                            # (real hardware - item found at employee's location)
+                            if config_state.mode == ConfigMode.PRODUCTION:
+                                inventory_item.x_position = x
+                                inventory_item.y_position = y
+                                if was_restored:
+                                    logger.info(f"   ✅ [PRODUCTION] Item {detection.product_id[-8:]} restored at position ({x:.1f}, {y:.1f}), RSSI={rssi}")
+                                else:
+                                    logger.debug(f"   [PRODUCTION] Updated item {detection.product_id[-8:]} to employee position ({x:.1f}, {y:.1f}), RSSI={rssi}")
+                            elif inventory_item.x_position is None:
+                                # SIMULATION: Only set position if item has none (shouldn't happen if inventory was generated properly)
+                                inventory_item.x_position = x
+                                inventory_item.y_position = y
+                                logger.warning(f"   [SIMULATION] Item {detection.product_id} had no position, set to ({x:.1f}, {y:.1f})")
+                            # else: SIMULATION mode and item has position - keep the shelf position!
+                        # else: Item is 'not present' in SIMULATION mode - don't change anything
+                        # Simulation missing items can only be restored via explicit restock action
+                
+                db.commit()
+                position_calculated = True
+                
+                # === UNIFIED MISSING ITEM DETECTION ===
+                # Uses the SAME MissingItemDetector algorithm for BOTH simulation and production
+                # This ensures consistent behavior regardless of mode
+                #
+                # Algorithm (3 safety checks):
+                # 1. Item was detected → Reset miss counter
+                # 2. Item within RFID range (50cm) → Count as miss
+                # 3. Consecutive misses >= 4 → Mark as missing
+                # 
+                # The consecutive miss threshold accounts for RFID read failures
+                # No time-based check needed - miss count alone is sufficient
+                
+                logger.info(f"\n{'='*60}")
+                logger.info(f"🔍 MISSING DETECTION CHECK")
+                logger.info(f"   Employee at: ({x:.1f}, {y:.1f})")
+                logger.info(f"   Detected {len(detected_rfid_with_rssi)} RFID tags in packet")
+                
+                if packet.edge_presence:
+                    # The reader decides missing items itself and reports them on /data/presence
+                    logger.info("   ⏭️  Skipped: the reader reports presence events")
+                    newly_missing_items = []
+                else:
+                    newly_missing_items = MissingItemDetector.process_detections(
+                        db=db,
+                        detected_rfid_tags=detected_rfid_with_rssi,
+                        employee_x=x,
+                        employee_y=y,
+                        timestamp=timestamp
+                    )
+                
+                if newly_missing_items:
+                    logger.info(f"   🧮 Total newly missing: {len(newly_missing_items)} item(s)")
+                logger.info(f"{'='*60}\n")
+                
+                # Broadcast real-time updates to WebSocket clients
+                await ws_manager.broadcast_position_update({
+                    "timestamp": timestamp.isoformat(),
+                    "tag_id": "employee",
+                    "x": x,
+                    "y": y,
+                    "confidence": confidence,
+                    "num_anchors": num_anchors
+                })
+                
+                # Broadcast updated items (detected + newly missing)
+                updated_items = []
+                for detection in packet.detections:
+                    inv_item = db.query(InventoryItem).filter(
+                        InventoryItem.rfid_tag == detection.product_id
+                    ).first()
+                    if inv_item and inv_item.x_position is not None:
+                        prod = db.query(Product).filter(Product.id == inv_item.product_id).first()
+                        updated_items.append({
+                            "rfid_tag": inv_item.rfid_tag,
+                            "product_name": prod.name if prod else "Unknown",
+                            "x": inv_item.x_position,
+                            "y": inv_item.y_position,
+                            "status": inv_item.status
                         })
-                        
-                        # Broadcast updated items (detected + newly missing)
-                        updated_items = []
-                        for detection in packet.detections:
-                            inv_item = db.query(InventoryItem).filter(
-                                InventoryItem.rfid_tag == detection.product_id
-                            ).first()
-                            if inv_item and inv_item.x_position is not None:
-                                prod = db.query(Product).filter(Product.id == inv_item.product_id).first()
-                                updated_items.append({
-                                    "rfid_tag": inv_item.rfid_tag,
-                                    "product_name": prod.name if prod else "Unknown",
-                                    "x": inv_item.x_position,
-                                    "y": inv_item.y_position,
-                                    "status": inv_item.status
-                                })
-                        
-                        # Also include newly missing items in the broadcast
-                        for item in newly_missing_items:
-                            prod = db.query(Product).filter(Product.id == item.product_id).first()
-                            updated_items.append({
-                                "rfid_tag": item.rfid_tag,
-                                "product_name": prod.name if prod else "Unknown",
-                                "x": item.x_position,
-                                "y": item.y_position,
-                                "status": item.status
-                            })
-                        
-                        if updated_items:
-                            await ws_manager.broadcast_item_update(updated_items)
-                        
-                        # Broadcast updated missing items list for the sidebar
-                        # This needs to happen when:
-                        # 1. Items are newly marked missing
-                        # 2. Items are restored from missing to present
-                        # Always broadcast the current missing list to keep UI in sync
-                        missing_items_list = db.query(InventoryItem, Product)\
-                            .join(Product, InventoryItem.product_id == Product.id)\
-                            .filter(InventoryItem.status == 'not present')\
-                            .filter(InventoryItem.last_seen_at.isnot(None))\
-                            .all()
-                        
-                        missing_data = [{
-                            "rfid_tag": item.rfid_tag,
-                            "product_name": product.name,
-                            "x": item.x_position,
-                            "y": item.y_position,
-                            "status": item.status
-                        } for item, product in missing_items_list]
-                        
-                        # Always broadcast the missing list to keep it in sync
-                        await ws_manager.broadcast_missing_update(missing_data)
-                        
+                
+                # Also include newly missing items in the broadcast
+                for item in newly_missing_items:
+                    prod = db.query(Product).filter(Product.id == item.product_id).first()
+                    updated_items.append({
+                        "rfid_tag": item.rfid_tag,
+                        "product_name": prod.name if prod else "Unknown",
+                        "x": item.x_position,
+                        "y": item.y_position,
+                        "status": item.status
+                    })
+                
+                if updated_items:
+                    await ws_manager.broadcast_item_update(updated_items)
+                
+                # Broadcast updated missing items list for the sidebar
+                # This needs to happen when:
+                # 1. Items are newly marked missing
+                # 2. Items are restored from missing to present
+                # Always broadcast the current missing list to keep UI in sync
+                await ws_manager.broadcast_missing_update(_missing_items_payload(db))
+                
         except Exception as pos_error:
             logger.warning(f"Position calculation failed: {pos_error}")
         
@@ -378,6 +391,133 @@ async def receive_data(packet: DataPacket, db: Session = Depends(get_db)):
         db.rollback()
         raise HTTPException(status_code=500, detail=f"Error storing data: {str(e)}")
 
+@router.post("/data/uwb")
+async def receive_uwb_sample(packet: UWBSamplePacket, db: Session = Depends(get_db)):
+    """
+    Receive one session of the high-rate UWB stream (store/production/uwb, 5-10 Hz)
+    
+    Only drives the live map: the position is broadcast to WebSocket clients and
+    not stored. Stored positions, detections and missing-item checks stay on the
+    RFID cycle path (/data), whose timestamps are on the same device clock.
+    """
+    result = None
+    num_anchors = 0
+    if packet.position is not None:
+        result = (packet.position.x, packet.position.y, packet.position.confidence)
+        num_anchors = packet.position.num_anchors
+    else:
+        anchors = {a.mac_address: a for a in db.query(Anchor).filter(Anchor.is_active == True).all()}
+        measurements = [
+            (anchors[uwb.mac_address].x_position, anchors[uwb.mac_address].y_position, uwb.distance_cm)
+            for uwb in packet.uwb_measurements
+            if uwb.mac_address in anchors
+        ]
+        if len(measurements) >= 2:
+            result = TriangulationService.calculate_position(measurements)
+            num_anchors = len(measurements)
+    
+    if result:
+        x, y, confidence = result
+        await ws_manager.broadcast_position_update({
+            "timestamp": packet.timestamp,
+            "tag_id": "employee",
+            "x": x,
+            "y": y,
+            "confidence": confidence,
+            "num_anchors": num_anchors,
+            "source": "uwb_stream"
+        })
+    
+    return {
+        "status": "success",
+        "position_calculated": result is not None
+    }
+
+@router.post("/data/presence")
+async def receive_presence_events(packet: PresencePacket, db: Session = Depends(get_db)):
+    """
+    Receive presence events from a reader built with PRESENCE_EVENTS (store/production/presence)
+    
+    The reader keeps the presence state of its zone and reports only changes:
+    'appeared' (read again, or new) and 'missing' (not read while the cart was
+    in range). They are applied as they are; MissingItemDetector does not run
+    for these readers (their cycles arrive with edge_presence set).
+    """
+    if packet.dropped:
+        logger.warning(f"[PRESENCE] Reader dropped {packet.dropped} events since boot (queue full)")
+    
+    updated_items = []
+    counts = {"appeared": 0, "missing": 0, "ignored": 0}
+    try:
+        for event in packet.events:
+            timestamp = datetime.fromisoformat(event.timestamp.replace('Z', '+00:00'))
+            item = db.query(InventoryItem).filter(InventoryItem.rfid_tag == event.product_id).first()
+            
+            if event.event == 'appeared':
+                if not item and config_state.mode == ConfigMode.PRODUCTION:
+                    item = _create_production_item(db, event.product_id, timestamp)
+                if not item:
+                    counts["ignored"] += 1
+                    continue
+                if item.status == 'not present':
+                    logger.info(f"   🔄 [PRESENCE] Item {event.product_id[-8:]} reappeared - restoring to PRESENT")
+                item.status = 'present'
+                item.last_seen_at = timestamp
+                item.consecutive_misses = 0
+                item.first_miss_at = None
+                if event.x_position is not None:
+                    item.x_position = event.x_position
+                    item.y_position = event.y_position
+            elif event.event == 'missing':
+                if not item or item.status == 'not present':
+                    counts["ignored"] += 1
+                    continue
+                logger.info(f"   ❌ [PRESENCE] Item {event.product_id[-8:]} reported MISSING by the reader")
+                item.status = 'not present'
+                item.first_miss_at = timestamp
+            else:
+                counts["ignored"] += 1
+                continue
+            
+            counts[event.event] += 1
+            if item.x_position is not None:
+                prod = db.query(Product).filter(Product.id == item.product_id).first()
+                updated_items.append({
+                    "rfid_tag": item.rfid_tag,
+                    "product_name": prod.name if prod else "Unknown",
+                    "x": item.x_position,
+                    "y": item.y_position,
+                    "status": item.status
+                })
+        
+        db.commit()
+    except Exception as e:
+        db.rollback()
+        raise HTTPException(status_code=500, detail=f"Error applying presence events: {str(e)}")
+    
+    if updated_items:
+        await ws_manager.broadcast_item_update(updated_items)
+    if counts["appeared"] or counts["missing"]:
+        await ws_manager.broadcast_missing_update(_missing_items_payload(db))
+    
+    return {"status": "success", **counts}
+
+def _missing_items_payload(db: Session) -> List[dict]:
+    """Current missing items for the sidebar (broadcast_missing_update)"""
+    missing_items_list = db.query(InventoryItem, Product)\
+        .join(Product, InventoryItem.product_id == Product.id)\
+        .filter(InventoryItem.status == 'not present')\
+        .filter(InventoryItem.last_seen_at.isnot(None))\
+        .all()
+    
+    return [{
+        "rfid_tag": item.rfid_tag,
+        "product_name": product.name,
+        "x": item.x_position,
+        "y": item.y_position,
+        "status": item.status
+    } for item, product in missing_items_list]
+
 @router.get("/data/latest", response_model=LatestDataResponse)
 def get_latest_data(limit: int = 50, db: Session = Depends(get_db)):
     """Get the most recent detections and UWB measurements"""
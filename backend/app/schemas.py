@@ -6,6 +6,7 @@ class UWBMeasurementInput(BaseModel):
     mac_address: str
     distance_cm: float
     status: Optional[str] = None
+    variance_cm2: Optional[float] = None  # Spread of the readings behind distance_cm, weights trilateration
 
 class DetectionInput(BaseModel):
     product_id: str
@@ -14,11 +15,37 @@ class DetectionInput(BaseModel):
     y_position: Optional[float] = None
     status: Optional[str] = "present"  # "present", "missing", "unknown"
     rssi_dbm: Optional[float] = None  # RFID signal strength in dBm (negative values, e.g. -45)
+    first_seen: Optional[str] = None  # ISO times of the first/last read in the cycle (firmware read times)
+    last_seen: Optional[str] = None
+
+class PositionInput(BaseModel):
+    x: float  # cm, store coordinates (same frame as the anchors)
+    y: float
+    confidence: float  # 0-1
+    num_anchors: int
 
 class DataPacket(BaseModel):
     timestamp: str
     detections: List[DetectionInput]
     uwb_measurements: List[UWBMeasurementInput]
+    position: Optional[PositionInput] = None  # Solved on the device; skips server-side trilateration
+    edge_presence: bool = False  # The reader publishes presence events (/data/presence); skips missing detection
+
+class PresenceEventInput(BaseModel):
+    product_id: str  # EPC
+    event: str  # 'appeared' or 'missing'
+    timestamp: str
+    x_position: Optional[float] = None  # Cell the tag was last read in, if the reader had a fix
+    y_position: Optional[float] = None
+
+class PresencePacket(BaseModel):
+    events: List[PresenceEventInput]
+    dropped: int = 0  # Events the reader lost to a full queue since boot
+
+class UWBSamplePacket(BaseModel):
+    timestamp: str  # Session time, on the same clock as the cycle packets
+    uwb_measurements: List[UWBMeasurementInput]
+    position: Optional[PositionInput] = None
 
 class DetectionResponse(BaseModel):
     id: int
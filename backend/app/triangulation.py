@@ -5,21 +5,37 @@ import math
 from typing import List, Tuple, Optional
 from datetime import datetime
 
+# Range noise of a clean UWB link (cm); same as the firmware's POSITION_RANGE_SIGMA_CM
+RANGE_SIGMA_CM = 10.0
+
+
 class TriangulationService:
     """
     Calculates 2D position of a tag based on distance measurements from multiple anchors
     Uses trilateration algorithm (geometric intersection of circles)
     """
     
+    @staticmethod
+    def range_weight(variance_cm2: Optional[float]) -> float:
+        """
+        Least-squares weight of one distance from its variance over the cycle
+        (firmware anchor statistics): 1 for a clean link, smaller as it gets noisier.
+        """
+        if variance_cm2 is None:
+            return 1.0
+        return RANGE_SIGMA_CM ** 2 / (RANGE_SIGMA_CM ** 2 + max(0.0, variance_cm2))
+    
     @staticmethod
     def calculate_position(
-        measurements: List[Tuple[float, float, float]]
+        measurements: List[Tuple[float, float, float]],
+        weights: Optional[List[float]] = None
     ) -> Optional[Tuple[float, float, float]]:
         """
         Calculate tag position using trilateration
         
         Args:
             measurements: List of (anchor_x, anchor_y, distance) tuples
+            weights: Optional per-measurement weights (see range_weight), used with 3+ anchors
             
         Returns:
             Tuple of (x, y, confidence) or None if calculation fails
@@ -36,7 +52,7 @@ class TriangulationService:
             return TriangulationService._two_anchor_position(measurements)
         
         # With 3+ anchors, use proper trilateration
-        return TriangulationService._multilateration(measurements)
+        return TriangulationService._multilateration(measurements, weights)
     
     @staticmethod
     def _two_anchor_position(
@@ -76,23 +92,30 @@ class TriangulationService:
     
     @staticmethod
     def _multilateration(
-        measurements: List[Tuple[float, float, float]]
+        measurements: List[Tuple[float, float, float]],
+        weights: Optional[List[float]] = None
     ) -> Tuple[float, float, float]:
         """
         Calculate position using 3+ anchors with least-squares method
         More accurate and provides better confidence scores
         """
         n = len(measurements)
+        if weights is None:
+            weights = [1.0] * n
         
         # Set up matrices for least squares: Ax = b
         # We'll solve for (x, y) position
         A = []
         b = []
+        row_weights = []
         
-        # Use first anchor as reference point
-        x1, y1, r1 = measurements[0]
+        # Use the most reliable anchor as reference point
+        ref = max(range(n), key=lambda i: weights[i])
+        x1, y1, r1 = measurements[ref]
         
-        for i in range(1, n):
+        for i in range(n):
+            if i == ref:
+                continue
             xi, yi, ri = measurements[i]
             
             # Linear equation derived from:
@@ -101,10 +124,13 @@ class TriangulationService:
             b.append(
                 xi**2 - x1**2 + yi**2 - y1**2 - ri**2 + r1**2
             )
+            # Each row differences two ranges, so its noise is that of both
+            wi, w1 = weights[i], weights[ref]
+            row_weights.append(wi * w1 / (wi + w1) if wi + w1 > 0 else 0.0)
         
         # Solve using least squares
         try:
-            x, y = TriangulationService._least_squares(A, b)
+            x, y = TriangulationService._least_squares(A, b, row_weights)
             
             # Calculate confidence based on residual error
             confidence = TriangulationService._calculate_confidence(x, y, measurements)
@@ -119,29 +145,33 @@ class TriangulationService:
             return (x, y, 0.2)  # Very low confidence
     
     @staticmethod
-    def _least_squares(A: List[List[float]], b: List[float]) -> Tuple[float, float]:
+    def _least_squares(
+        A: List[List[float]], b: List[float], w: Optional[List[float]] = None
+    ) -> Tuple[float, float]:
         """
-        Solve Ax = b using least squares method
+        Solve Ax = b using (weighted) least squares method
         For 2D position: x = [x_pos, y_pos]
         """
         # Convert to numpy-like calculations without numpy
         # For 2x2 case, we can solve directly
         
-        # A^T * A
+        # A^T * W * A
         n = len(A)
         m = len(A[0])  # Should be 2
+        if w is None:
+            w = [1.0] * n
         
         ATA = [[0.0] * m for _ in range(m)]
         for i in range(m):
             for j in range(m):
                 for k in range(n):
-                    ATA[i][j] += A[k][i] * A[k][j]
+                    ATA[i][j] += w[k] * A[k][i] * A[k][j]
         
-        # A^T * b
+        # A^T * W * b
         ATb = [0.0] * m
         for i in range(m):
             for k in range(n):
-                ATb[i] += A[k][i] * b[k]
+                ATb[i] += w[k] * A[k][i] * b[k]
         
         # Solve 2x2 system: ATA * x = ATb
         det = ATA[0][0] * ATA[1][1] - ATA[0][1] * ATA[1][0]
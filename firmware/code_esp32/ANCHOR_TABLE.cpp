@@ -0,0 +1,127 @@
+#include "ANCHOR_TABLE.h"
+
+#include <string.h>
+
+void AnchorStats::addDistance(int distanceCm) {
+    uint16_t d = distanceCm <= 0 ? 0 : distanceCm >= 0xffff ? 0xffff : (uint16_t)distanceCm;
+
+    // Welford, with the mean taken from the running sum
+    float previousMean = successCount ? totalDistance / successCount : (float)d;
+    successCount++;
+    totalDistance += d;
+    m2 += (d - previousMean) * (d - totalDistance / successCount);
+
+    if (successCount == 1 || d < minDistance) minDistance = d;
+    if (successCount == 1 || d > maxDistance) maxDistance = d;
+
+    // Sliding window: drop the oldest value from the sorted copy, then insert the new one
+    uint8_t count = windowCount;
+    if (count == UWB_DISTANCE_WINDOW) {
+        uint16_t oldest = recent[recentHead];
+        uint8_t i = 0;
+        while (sorted[i] != oldest) i++;
+        memmove(&sorted[i], &sorted[i + 1], (count - 1 - i) * sizeof(sorted[0]));
+        count--;
+        recent[recentHead] = d;
+        recentHead = (recentHead + 1) % UWB_DISTANCE_WINDOW;
+    } else {
+        recent[(recentHead + count) % UWB_DISTANCE_WINDOW] = d;
+    }
+    uint8_t at = count;
+    while (at > 0 && sorted[at - 1] > d) {
+        sorted[at] = sorted[at - 1];
+        at--;
+    }
+    sorted[at] = d;
+    windowCount = count + 1;
+}
+
+volatile uint16_t AnchorTable::_freshnessMs = UWB_FRESHNESS_MS;
+
+AnchorTable::AnchorTable() {
+    clear();
+}
+
+void AnchorTable::clear() {
+    _count = 0;
+    memset(_index, EMPTY, sizeof(_index));
+}
+
+uint8_t AnchorTable::lookup(uint16_t mac) const {
+    uint8_t slot = slotFor(mac);
+    for (uint8_t probes = 0; probes < UWB_ANCHOR_INDEX_SIZE; probes++) {
+        uint8_t entry = _index[slot];
+        if (entry == EMPTY) {
+            return EMPTY;
+        }
+        if (_entries[entry].macAddress == mac) {
+            return entry;
+        }
+        slot = (slot + 1) & (UWB_ANCHOR_INDEX_SIZE - 1);
+    }
+    return EMPTY;
+}
+
+void AnchorTable::indexInsert(uint16_t mac, uint8_t entry) {
+    uint8_t slot = slotFor(mac);
+    while (_index[slot] != EMPTY) {
+        slot = (slot + 1) & (UWB_ANCHOR_INDEX_SIZE - 1);
+    }
+    _index[slot] = entry;
+}
+
+void AnchorTable::rebuildIndex() {
+    memset(_index, EMPTY, sizeof(_index));
+    for (uint8_t i = 0; i < _count; i++) {
+        indexInsert(_entries[i].macAddress, i);
+    }
+}
+
+/*! @brief Drop the least recently updated entry (only runs when the table is full).*/
+void AnchorTable::evictOldest() {
+    uint8_t oldest = 0;
+    for (uint8_t i = 1; i < _count; i++) {
+        if ((long)(_entries[i].timestamp - _entries[oldest].timestamp) < 0) {
+            oldest = i;
+        }
+    }
+    _entries[oldest] = _entries[--_count];
+    // Entries moved, and linear probing has no cheap delete: rebuild the small index
+    rebuildIndex();
+}
+
+const AnchorStats *AnchorTable::find(uint16_t mac) const {
+    uint8_t entry = lookup(mac);
+    return entry == EMPTY ? NULL : &_entries[entry];
+}
+
+void AnchorTable::record(uint16_t mac, bool success, int distanceCm, unsigned long now) {
+    uint8_t entry = lookup(mac);
+
+    if (entry == EMPTY) {
+        if (_count >= UWB_MAX_ANCHORS) {
+            evictOldest();
+        }
+        entry = _count++;
+        indexInsert(mac, entry);
+        _entries[entry].macAddress = mac;
+        _entries[entry].totalCount = 0;
+    }
+
+    AnchorStats &stats = _entries[entry];
+    if (stats.totalCount == 0 || !isFresh(stats, now)) {
+        // New or stale entry: restart the sums
+        stats.totalDistance = 0;
+        stats.m2            = 0;
+        stats.successCount  = 0;
+        stats.totalCount    = 0;
+        stats.recentHead    = 0;
+        stats.windowCount   = 0;
+    }
+
+    stats.totalCount++;
+    stats.timestamp = now;
+    if (success) {
+        stats.addDistance(distanceCm);
+    }
+}
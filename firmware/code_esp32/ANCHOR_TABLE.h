@@ -0,0 +1,138 @@
+#ifndef _ANCHOR_TABLE_H_
+#define _ANCHOR_TABLE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifndef UWB_MAX_ANCHORS
+#define UWB_MAX_ANCHORS 30  // Table size. When full, the oldest entry is replaced.
+#endif
+
+#ifndef UWB_FRESHNESS_MS
+#define UWB_FRESHNESS_MS 3000  // Entries not updated for this long are stale (default of freshnessMs())
+#endif
+
+#ifndef UWB_DISTANCE_WINDOW
+#define UWB_DISTANCE_WINDOW 7  // Recent distances per anchor kept for the median (odd)
+#endif
+
+// Index slots: power of two, at least 2x UWB_MAX_ANCHORS
+#define UWB_ANCHOR_INDEX_BITS 6
+#define UWB_ANCHOR_INDEX_SIZE (1 << UWB_ANCHOR_INDEX_BITS)
+
+static_assert(UWB_MAX_ANCHORS < 0xff, "Anchor indices are stored as uint8_t");
+static_assert(UWB_ANCHOR_INDEX_SIZE >= 2 * UWB_MAX_ANCHORS, "Anchor index too small for UWB_MAX_ANCHORS");
+static_assert(UWB_DISTANCE_WINDOW > 0 && UWB_DISTANCE_WINDOW < 0xff, "Window positions are stored as uint8_t");
+
+/*
+ Distance statistics of one anchor over the freshness window, in constant
+ memory: sum and Welford M2 over all successful readings (mean, variance),
+ min/max, and the last UWB_DISTANCE_WINDOW readings kept both in arrival order
+ and sorted, so the median costs nothing to read and one multipath reflection
+ cannot drag it the way it drags the mean.
+*/
+struct AnchorStats {
+    uint16_t macAddress;
+    float totalDistance;
+    float m2;                       // Welford: sum of squared deviations from the mean (cm^2)
+    uint32_t successCount;
+    uint32_t totalCount;
+    uint16_t minDistance;           // cm, over all successful readings
+    uint16_t maxDistance;
+    uint16_t recent[UWB_DISTANCE_WINDOW];  // Ring, oldest at recentHead once full
+    uint16_t sorted[UWB_DISTANCE_WINDOW];  // Same values, ascending
+    uint8_t recentHead;
+    uint8_t windowCount;
+    unsigned long timestamp;        // When this entry was last updated
+
+    float meanDistance() const {
+        return successCount ? totalDistance / successCount : 0;
+    }
+
+    /*! @brief Median of the last UWB_DISTANCE_WINDOW readings.*/
+    float medianDistance() const {
+        if (windowCount == 0) return 0;
+        uint8_t mid = windowCount / 2;
+        return windowCount & 1 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) * 0.5f;
+    }
+
+    /*! @brief Sample variance of all readings (cm^2), 0 below two readings.*/
+    float variance() const {
+        return successCount > 1 ? m2 / (successCount - 1) : 0;
+    }
+
+    /*! @brief Fold in one successful reading.*/
+    void addDistance(int distanceCm);
+};
+
+/*
+ Per-cycle UWB statistics for up to UWB_MAX_ANCHORS anchors keyed by the
+ 16-bit short MAC. Entries are stored densely (iterate 0..size()-1) and found
+ through a small open-addressing index, so a lookup is a hash and usually one
+ probe. No heap: the whole table lives inside the object.
+
+ Aging is done in place: an entry that has not been updated for
+ freshnessMs() restarts its sums on the next measurement, and readers skip
+ stale entries with isFresh(). Only eviction (table full) removes an entry.
+*/
+class AnchorTable {
+   public:
+    AnchorTable();
+
+    /*! @brief Remove all entries.*/
+    void clear();
+
+    bool empty() const {
+        return _count == 0;
+    }
+
+    uint8_t size() const {
+        return _count;
+    }
+
+    const AnchorStats &at(uint8_t i) const {
+        return _entries[i];
+    }
+
+    /*! @brief Fold one UWB measurement into the anchor's entry, creating it if needed.
+        @param success True if the measurement produced a distance.*/
+    void record(uint16_t mac, bool success, int distanceCm, unsigned long now);
+
+    /*! @brief Look up an anchor.
+        @return The entry or NULL.*/
+    const AnchorStats *find(uint16_t mac) const;
+
+    static bool isFresh(const AnchorStats &stats, unsigned long now) {
+        return now - stats.timestamp <= _freshnessMs;
+    }
+
+    /*! @brief Age (ms) past which entries and fixes are stale, for every table; UWB_FRESHNESS_MS until set.*/
+    static uint16_t freshnessMs() {
+        return _freshnessMs;
+    }
+
+    /*! @brief Change the age limit (between cycles; a 16-bit store, read by the other tasks as is).*/
+    static void setFreshnessMs(uint16_t ms) {
+        _freshnessMs = ms;
+    }
+
+   private:
+    static const uint8_t EMPTY = 0xff;
+
+    static uint8_t slotFor(uint16_t mac) {
+        return (uint8_t)(((uint32_t)mac * 0x9e3779b1u) >> (32 - UWB_ANCHOR_INDEX_BITS));
+    }
+
+    uint8_t lookup(uint16_t mac) const;
+    void indexInsert(uint16_t mac, uint8_t entry);
+    void evictOldest();
+    void rebuildIndex();
+
+    AnchorStats _entries[UWB_MAX_ANCHORS];
+    uint8_t _index[UWB_ANCHOR_INDEX_SIZE];
+    uint8_t _count;
+
+    static volatile uint16_t _freshnessMs;
+};
+
+#endif
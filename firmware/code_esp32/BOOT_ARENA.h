@@ -0,0 +1,68 @@
+#ifndef _BOOT_ARENA_H_
+#define _BOOT_ARENA_H_
+
+#include <Arduino.h>
+#include <new>
+
+/*
+ One block taken from the heap at boot and carved into the long-lived
+ buffers of the data path. Nothing is ever freed, so those buffers cannot
+ fragment the heap, and the block goes to PSRAM when the board has it,
+ leaving internal RAM to WiFi and the task stacks.
+
+ Allocate in setup(), before the tasks start; the arena is not thread safe.
+*/
+class BootArena {
+   public:
+    BootArena() : _block(NULL), _capacity(0), _used(0), _psram(false) {}
+
+    /*! @brief Take the block (PSRAM if found, else internal RAM).
+        @return False if it could not be allocated.*/
+    bool begin(size_t bytes) {
+        _psram    = psramFound();
+        _block    = (uint8_t *)(_psram ? ps_malloc(bytes) : malloc(bytes));
+        _capacity = _block ? bytes : 0;
+        _used     = 0;
+        return _block != NULL;
+    }
+
+    /*! @brief Carve size bytes at the given alignment.
+        @return NULL if the arena is exhausted.*/
+    void *allocate(size_t size, size_t align) {
+        size_t at = (_used + align - 1) & ~(align - 1);
+        if (!_block || at + size > _capacity) return NULL;
+        _used = at + size;
+        return _block + at;
+    }
+
+    /*! @brief Carve and default-construct count objects of T.*/
+    template <typename T>
+    T *create(size_t count = 1) {
+        T *items = (T *)allocate(sizeof(T) * count, alignof(T));
+        if (!items) return NULL;
+        for (size_t i = 0; i < count; i++) {
+            new (&items[i]) T();
+        }
+        return items;
+    }
+
+    size_t capacity() const {
+        return _capacity;
+    }
+
+    size_t used() const {
+        return _used;
+    }
+
+    bool inPsram() const {
+        return _psram;
+    }
+
+   private:
+    uint8_t *_block;
+    size_t _capacity;
+    size_t _used;
+    bool _psram;
+};
+
+#endif
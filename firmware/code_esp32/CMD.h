@@ -5,6 +5,8 @@ const uint8_t HARDWARE_VERSION_CMD[] = {0xBB, 0x00, 0x03, 0x00, 0x01, 0x00, 0x04
 const uint8_t POLLING_ONCE_CMD[] = {0xBB, 0x00, 0x22, 0x00, 0x00, 0x22, 0x7E};
 // Multiple polling instructions 多次轮询指令
 const uint8_t POLLING_MULTIPLE_CMD[] = {0xBB, 0x00, 0x27, 0x00, 0x03, 0x22, 0x27, 0x10, 0x83, 0x7E};
+// Stop multiple polling instructions 停止多次轮询指令
+const uint8_t STOP_MULTIPLE_POLLING_CMD[] = {0xBB, 0x00, 0x28, 0x00, 0x00, 0x28, 0x7E};
 // Set the SELECT mode 设置Select模式
 const uint8_t SET_SELECT_MODE_CMD[] = {0xBB, 0x00, 0x12, 0x00, 0x01, 0x01, 0x14, 0x7E};
 // Set the SELECT parameter instruction 设置Select参数指令
@@ -20,8 +22,12 @@ const uint8_t READ_STORAGE_ERROR[]       = {0xBB, 0x01, 0xFF, 0x00, 0x01, 0x09,
 const uint8_t WRITE_STORAGE_CMD[]        = {0xBB, 0x00, 0x49, 0x00, 0x0D, 0x00, 0x00, 0xFF, 0xFF, 0x03,
                                             0x00, 0x00, 0x00, 0x02, 0x12, 0x34, 0x56, 0x78, 0x6D, 0x7E};
 const uint8_t WRITE_STORAGE_ERROR[]      = {0xBB, 0x01, 0xFF, 0x00, 0x01, 0x10, 0x0A, 0x7E};
+// Set the Query parameters 设置Query参数
+const uint8_t SET_QUERY_PARAMETER_CMD[] = {0xBB, 0x00, 0x0E, 0x00, 0x02, 0x10, 0x20, 0x40, 0x7E};
 // Set the transmitting power 设置发射功率
 const uint8_t SET_TX_POWER[] = {0xBB, 0x00, 0xB6, 0x00, 0x02, 0x07, 0xD0, 0x8F, 0x7E};
+// Module hibernation 模块休眠 (any byte on its RX line wakes it; that command is lost)
+const uint8_t SLEEP_CMD[] = {0xBB, 0x00, 0x17, 0x00, 0x00, 0x17, 0x7E};
 
 //   {0xBB, 0x00, 0x28, 0x00, 0x00, 0x28, 0x7E,},             //5. Stop multiple
 //   polling instructions 5.停止多次轮询指令 { 0xBB, 0x00, 0x0C, 0x00, 0x13,
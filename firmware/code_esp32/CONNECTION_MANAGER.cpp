@@ -0,0 +1,145 @@
+#include "CONNECTION_MANAGER.h"
+
+ConnectionManager *ConnectionManager::_instance = NULL;
+
+ConnectionManager::ConnectionManager(PubSubClient &mqtt)
+    : _mqtt(mqtt),
+      _ssid(NULL),
+      _password(NULL),
+      _clientId(NULL),
+      _onConnected(NULL),
+      _context(NULL),
+      _state(WIFI_IDLE),
+      _wifiUp(false),
+      _wifiFailed(false),
+      _task(NULL),
+      _wifiBackoff(WIFI_BACKOFF_MIN_MS, WIFI_BACKOFF_MAX_MS),
+      _mqttBackoff(MQTT_BACKOFF_MIN_MS, MQTT_BACKOFF_MAX_MS),
+      _nextAttempt(0),
+      _attemptStart(0),
+      _connects(0) {}
+
+void ConnectionManager::begin(const char *ssid, const char *password, const char *clientId,
+                              ConnectedCallback onConnected, void *context) {
+    _ssid        = ssid;
+    _password    = password;
+    _clientId    = clientId;
+    _onConnected = onConnected;
+    _context     = context;
+    _instance    = this;
+
+    WiFi.mode(WIFI_STA);
+    WiFi.setAutoReconnect(false);  // Retries are paced by the backoff instead
+    WiFi.onEvent(onWiFiEvent);
+}
+
+void ConnectionManager::run() {
+    _task = xTaskGetCurrentTaskHandle();
+    while (true) {
+        uint32_t waitMs = step(millis());
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(waitMs));  // WiFi events cut the wait short
+    }
+}
+
+uint32_t ConnectionManager::step(unsigned long now) {
+    switch (state()) {
+        case WIFI_IDLE:
+            if ((long)(now - _nextAttempt) < 0) break;
+            _wifiFailed   = false;
+            _attemptStart = now;
+            setState(WIFI_CONNECTING);
+            WiFi.begin(_ssid, _password);
+            break;
+
+        case WIFI_CONNECTING:
+            if (_wifiUp) {
+                _wifiBackoff.reset();
+                _nextAttempt = now;
+                setState(MQTT_IDLE);
+            } else if (_wifiFailed || now - _attemptStart >= WIFI_CONNECT_TIMEOUT_MS) {
+                WiFi.disconnect();  // Its DISCONNECTED event lands during the backoff, not the next attempt
+                _nextAttempt = now + _wifiBackoff.next();
+                setState(WIFI_IDLE);
+            }
+            break;
+
+        case MQTT_IDLE:
+            if (!_wifiUp) {
+                _nextAttempt = now + _wifiBackoff.next();
+                setState(WIFI_IDLE);
+                break;
+            }
+            if ((long)(now - _nextAttempt) < 0) break;
+
+            // Blocks for the TCP connect and CONNACK; only this task waits
+            if (_mqtt.connect(_clientId)) {
+                _mqttBackoff.reset();
+                _connects++;
+                if (_onConnected) {
+                    _onConnected(_context);
+                }
+                setState(ONLINE);
+            } else {
+                _nextAttempt = millis() + _mqttBackoff.next();
+            }
+            break;
+
+        case ONLINE:
+            break;  // The output task owns the client
+    }
+    return CONNECTION_POLL_MS;
+}
+
+bool ConnectionManager::service() {
+    if (!online()) {
+        return false;
+    }
+    if (_wifiUp && _mqtt.loop()) {
+        return true;
+    }
+
+    // Session dropped: hand the client back to the connection task
+    _mqtt.disconnect();
+    if (_wifiUp) {
+        _nextAttempt = millis() + _mqttBackoff.next();
+        setState(MQTT_IDLE);
+    } else {
+        _nextAttempt = millis() + _wifiBackoff.next();
+        setState(WIFI_IDLE);
+    }
+
+    TaskHandle_t task = _task;
+    if (task) {
+        xTaskNotifyGive(task);
+    }
+    return false;
+}
+
+void ConnectionManager::setState(State state) {
+    _state.store(state, std::memory_order_release);
+}
+
+void ConnectionManager::onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info) {
+    ConnectionManager *self = _instance;
+    if (self == NULL) {
+        return;
+    }
+
+    switch (event) {
+        case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+            self->_wifiUp = true;
+            break;
+        case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+        case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+            self->_wifiUp     = false;
+            self->_wifiFailed = true;
+            break;
+        default:
+            return;
+    }
+
+    TaskHandle_t task = self->_task;
+    if (task) {
+        xTaskNotifyGive(task);
+    }
+}
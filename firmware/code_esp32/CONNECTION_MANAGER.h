@@ -0,0 +1,147 @@
+#ifndef _CONNECTION_MANAGER_H_
+#define _CONNECTION_MANAGER_H_
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <atomic>
+#include "PubSubClient.h"
+
+#ifndef WIFI_CONNECT_TIMEOUT_MS
+#define WIFI_CONNECT_TIMEOUT_MS 20000  // Give up on one association attempt after this
+#endif
+
+#ifndef WIFI_BACKOFF_MIN_MS
+#define WIFI_BACKOFF_MIN_MS 1000
+#endif
+
+#ifndef WIFI_BACKOFF_MAX_MS
+#define WIFI_BACKOFF_MAX_MS 60000
+#endif
+
+#ifndef MQTT_BACKOFF_MIN_MS
+#define MQTT_BACKOFF_MIN_MS 1000
+#endif
+
+#ifndef MQTT_BACKOFF_MAX_MS
+#define MQTT_BACKOFF_MAX_MS 30000
+#endif
+
+#ifndef CONNECTION_POLL_MS
+#define CONNECTION_POLL_MS 100  // Max sleep of the connection task between steps
+#endif
+
+/*
+ Exponential backoff with jitter: after the n-th consecutive failure the wait
+ is drawn from [d/2, d) with d = min(max, min * 2^n), so a fleet of readers
+ that lost the same AP does not retry in lockstep.
+*/
+class Backoff {
+   public:
+    Backoff(uint32_t minMs, uint32_t maxMs) : _min(minMs), _max(maxMs), _failures(0) {}
+
+    void reset() {
+        _failures = 0;
+    }
+
+    /*! @brief Record a failure and return the wait before the next attempt.*/
+    uint32_t next() {
+        uint32_t delayMs = _min;
+        for (uint8_t i = 0; i < _failures && delayMs < _max; i++) {
+            delayMs *= 2;
+        }
+        if (delayMs > _max) {
+            delayMs = _max;
+        }
+        if (_failures < 31) {
+            _failures++;
+        }
+        return delayMs / 2 + esp_random() % (delayMs / 2 + 1);
+    }
+
+   private:
+    uint32_t _min;
+    uint32_t _max;
+    uint8_t _failures;
+};
+
+/*
+ Owns the WiFi and MQTT connections so the output task never waits on them.
+
+ A dedicated task runs step(): WiFi association is driven by WiFi events
+ (GOT_IP / DISCONNECTED) and a timeout, MQTT connects are attempted once
+ WiFi has an IP. Failures on either level retry with their own Backoff.
+ PubSubClient::connect() still blocks for the TCP connect and CONNACK, but
+ only this task waits on it.
+
+ The state is also the ownership token for the PubSubClient: while ONLINE
+ only the output task touches it (service(), publishes); otherwise only the
+ connection task does. The output task hands the client back from service()
+ when the session drops.
+*/
+class ConnectionManager {
+   public:
+    enum State : uint8_t {
+        WIFI_IDLE,        // Waiting for the next association attempt
+        WIFI_CONNECTING,  // WiFi.begin() issued, waiting for an IP
+        MQTT_IDLE,        // WiFi up, waiting for the next MQTT attempt
+        ONLINE            // MQTT session up, client owned by the output task
+    };
+
+    typedef void (*ConnectedCallback)(void *context);
+
+    ConnectionManager(PubSubClient &mqtt);
+
+    /*! @brief Register WiFi events. Call once from setup(), before the tasks start.
+        @param onConnected Runs in the connection task right after an MQTT connect, before
+               the client is handed over (subscribe here).*/
+    void begin(const char *ssid, const char *password, const char *clientId, ConnectedCallback onConnected,
+               void *context);
+
+    /*! @brief Connection task body; never returns.*/
+    void run();
+
+    /*! @brief Output task: keep the session alive.
+        @return True if the MQTT client may be used for publishing now.*/
+    bool service();
+
+    /*! @brief True while the output task owns a connected client.*/
+    bool online() const {
+        return _state.load(std::memory_order_acquire) == ONLINE;
+    }
+
+    State state() const {
+        return (State)_state.load(std::memory_order_acquire);
+    }
+
+    /*! @brief Successful MQTT connects since boot.*/
+    uint32_t connects() const {
+        return _connects;
+    }
+
+   private:
+    uint32_t step(unsigned long now);
+    void setState(State state);
+    static void onWiFiEvent(arduino_event_id_t event, arduino_event_info_t info);
+
+    static ConnectionManager *_instance;  // WiFi event callbacks carry no context
+
+    PubSubClient &_mqtt;
+    const char *_ssid;
+    const char *_password;
+    const char *_clientId;
+    ConnectedCallback _onConnected;
+    void *_context;
+
+    std::atomic<uint8_t> _state;
+    volatile bool _wifiUp;
+    volatile bool _wifiFailed;  // DISCONNECTED while associating
+    volatile TaskHandle_t _task;
+
+    Backoff _wifiBackoff;
+    Backoff _mqttBackoff;
+    unsigned long _nextAttempt;
+    unsigned long _attemptStart;
+    volatile uint32_t _connects;
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "CYCLE_BACKLOG.h"
+
+#include <string.h>
+
+static_assert(CYCLE_FRAME_MAX_SIZE <= 0xffff, "Backlog frame lengths are u16");
+
+CycleBacklog::CycleBacklog() : _staging(NULL), _flashEnabled(false), _batchFromFlash(false), _dropped(0) {}
+
+bool CycleBacklog::begin(uint32_t ramBytes, uint32_t flashBytes) {
+    bool psram = psramFound();
+    if (!psram && ramBytes > BACKLOG_FALLBACK_BYTES) {
+        ramBytes = BACKLOG_FALLBACK_BYTES;
+    }
+
+    size_t total    = (size_t)ramBytes + CYCLE_FRAME_MAX_SIZE;
+    uint8_t *memory = (uint8_t *)(psram ? ps_malloc(total) : malloc(total));
+    if (memory == NULL) {
+        return false;
+    }
+    _staging = memory;
+    _ram.store().attach(memory + CYCLE_FRAME_MAX_SIZE);
+    _ram.reset(ramBytes);
+
+    // Timestamps do not survive a reboot, so the spill file always starts empty
+    if (flashBytes > 0 && LittleFS.begin(true)) {
+        LittleFS.remove(BACKLOG_FLASH_PATH);
+        if (_flash.store().open(BACKLOG_FLASH_PATH)) {
+            _flash.reset(flashBytes);
+            _flashEnabled = true;
+        }
+    }
+    return true;
+}
+
+bool CycleBacklog::push(const CycleRecord &record) {
+    if (!enabled()) {
+        return false;
+    }
+
+    size_t length = CycleSerializer::binaryLength(record);
+    if (!_ram.fits(length)) {
+        _dropped++;
+        return false;
+    }
+
+    BufferPrint out(_staging, CYCLE_FRAME_MAX_SIZE);
+    CycleSerializer::writeBinary(out, record);
+    return pushFrame(_staging, (uint16_t)length);
+}
+
+bool CycleBacklog::pushFrame(const uint8_t *frame, uint16_t length) {
+    if (!enabled()) {
+        return false;
+    }
+    if (!_ram.fits(length)) {
+        _dropped++;
+        return false;
+    }
+
+    while (!_ram.push(frame, length)) {
+        spillOldest();
+    }
+    return true;
+}
+
+void CycleBacklog::spillOldest() {
+    uint32_t offset = _ram.head();
+    uint16_t length = _ram.lengthAt(offset);
+
+    if (_flashEnabled) {
+        // Flash holds the older frames, so RAM's oldest goes to its tail
+        while (!_flash.push(_ram.store().at(offset + 2), length)) {
+            if (_flash.count() == 0) {
+                _flashEnabled = false;  // Frame never fits, or the file cannot be written
+                break;
+            }
+            _flash.pop(1);
+            _dropped++;
+        }
+        if (_flashEnabled) {
+            _ram.pop(1);
+            return;
+        }
+    }
+
+    _ram.pop(1);
+    _dropped++;
+}
+
+template <typename Store>
+static uint16_t planFrames(FrameRing<Store> &ring, size_t maxBytes, uint16_t maxFrames, size_t &length) {
+    uint16_t frames = 0;
+    uint32_t offset = ring.head();
+    length          = CYCLE_BATCH_HEADER_SIZE;
+
+    while (frames < ring.count() && frames < maxFrames) {
+        uint16_t frame = ring.lengthAt(offset);
+        size_t entry   = CYCLE_BATCH_ENTRY_SIZE + frame;
+        if (frames > 0 && length + entry > maxBytes) break;
+        length += entry;
+        frames++;
+        offset = FrameRing<Store>::next(offset, frame);
+    }
+    return frames;
+}
+
+uint16_t CycleBacklog::planBatch(size_t maxBytes, uint16_t maxFrames, size_t &length) {
+    _batchFromFlash = _flash.count() > 0;
+    uint16_t frames = _batchFromFlash ? planFrames(_flash, maxBytes, maxFrames, length)
+                                      : planFrames(_ram, maxBytes, maxFrames, length);
+    if (frames == 0) {
+        length = 0;
+    }
+    return frames;
+}
+
+template <typename Store>
+static size_t writeFrames(Print &out, FrameRing<Store> &ring, uint16_t frames, uint8_t *staging) {
+    size_t n        = 0;
+    uint32_t offset = ring.head();
+
+    for (uint16_t i = 0; i < frames; i++) {
+        uint16_t frame    = ring.lengthAt(offset);
+        uint8_t entry[2] = {(uint8_t)frame, (uint8_t)(frame >> 8)};
+        if (!ring.read(offset, staging, frame)) {
+            memset(staging, 0, frame);  // Keep the announced length; the receiver rejects the frame
+        }
+        n += out.write(entry, sizeof(entry));
+        n += out.write(staging, frame);
+        offset = FrameRing<Store>::next(offset, frame);
+    }
+    return n;
+}
+
+size_t CycleBacklog::writeBatch(Print &out, uint16_t frames, uint32_t sentAt) {
+    uint8_t header[CYCLE_BATCH_HEADER_SIZE];
+    CycleBatcher::writeHeader(header, frames, sentAt, 0);
+    size_t n = out.write(header, sizeof(header));
+
+    n += _batchFromFlash ? writeFrames(out, _flash, frames, _staging) : writeFrames(out, _ram, frames, _staging);
+    return n;
+}
+
+uint8_t CycleBacklog::batchSpans(MQTTPayloadSpan *spans, uint16_t frames, uint32_t sentAt) {
+    if (_batchFromFlash || frames == 0) {
+        return 0;
+    }
+
+    CycleBatcher::writeHeader(_batchHeader, frames, sentAt, 0);
+    spans[0].data   = _batchHeader;
+    spans[0].length = sizeof(_batchHeader);
+    uint8_t count   = 1;
+
+    // Frames are contiguous except where the ring wrapped to offset 0
+    uint32_t offset = _ram.head();
+    uint32_t start  = offset;
+    size_t run      = 0;
+    for (uint16_t i = 0; i < frames; i++) {
+        uint16_t frame = _ram.lengthAt(offset);
+        if (run > 0 && offset != start + run) {
+            spans[count].data   = _ram.store().at(start);
+            spans[count].length = run;
+            count++;
+            run = 0;
+        }
+        if (run == 0) {
+            start = offset;
+        }
+        run += CYCLE_BATCH_ENTRY_SIZE + frame;
+        offset = FrameRing<RamFrameStore>::next(offset, frame);
+    }
+    spans[count].data   = _ram.store().at(start);
+    spans[count].length = run;
+    return count + 1;
+}
+
+void CycleBacklog::pop(uint16_t frames) {
+    if (_batchFromFlash) {
+        _flash.pop(frames);
+    } else {
+        _ram.pop(frames);
+    }
+}
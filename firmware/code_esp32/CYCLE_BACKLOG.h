@@ -0,0 +1,123 @@
+#ifndef _CYCLE_BACKLOG_H_
+#define _CYCLE_BACKLOG_H_
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "CYCLE_BATCHER.h"
+#include "CYCLE_RECORD.h"
+#include "CYCLE_SERIALIZER.h"
+#include "FRAME_RING.h"
+#include "PubSubClient.h"
+
+#ifndef BACKLOG_FALLBACK_BYTES
+#define BACKLOG_FALLBACK_BYTES (32UL * 1024UL)  // RAM ring size when the board has no PSRAM
+#endif
+
+#define BACKLOG_FLASH_PATH "/backlog.bin"
+
+#define CYCLE_BATCH_MAX_SPANS   3   // Header and the RAM ring on either side of a wrap
+
+/*
+ Frame store in a LittleFS file; the ring bounds its size.
+*/
+class FlashFrameStore {
+   public:
+    bool open(const char *path) {
+        _file = LittleFS.open(path, "w+");
+        return (bool)_file;
+    }
+
+    bool read(uint32_t offset, uint8_t *buffer, size_t size) {
+        return _file.seek(offset, SeekSet) && _file.read(buffer, size) == size;
+    }
+
+    bool write(uint32_t offset, const uint8_t *data, size_t size) {
+        return _file.seek(offset, SeekSet) && _file.write(data, size) == size;
+    }
+
+   private:
+    File _file;
+};
+
+/*
+ Store-and-forward queue for cycles that could not be published.
+
+ Cycles are kept as binary cycle frames (always full tag sets, never deltas),
+ so a 200-tag cycle costs ~4.8KB instead of a ~7KB CycleRecord. New frames go
+ to a RAM ring; when it is full the oldest frames spill to a LittleFS ring
+ file, and when that is full too (or disabled) the oldest frame is dropped.
+ Frames are drained oldest first - flash, then RAM - as batches: one MQTT
+ publish carries many frames behind a small header with the device time at
+ send, from which the receiver recovers each cycle's original wall time.
+
+ The spill file is an extension of RAM, not a journal: timestamps are
+ millis() since boot, so it is recreated empty at every boot.
+
+ Not thread safe; owned by the output task.
+*/
+class CycleBacklog {
+   public:
+    CycleBacklog();
+
+    /*! @brief Allocate the RAM ring (PSRAM if found) and create the flash spill file.
+        @param ramBytes RAM ring size; capped at BACKLOG_FALLBACK_BYTES without PSRAM.
+        @param flashBytes Spill file size, 0 to keep the backlog in RAM only.
+        @return False if no RAM could be allocated; the backlog then stays disabled.*/
+    bool begin(uint32_t ramBytes, uint32_t flashBytes);
+
+    bool enabled() const {
+        return _staging != NULL;
+    }
+
+    /*! @brief Queue a cycle. May spill or drop older frames to make room.*/
+    bool push(const CycleRecord &record);
+
+    /*! @brief Queue a cycle already encoded as a full binary frame (a live batch that failed).*/
+    bool pushFrame(const uint8_t *frame, uint16_t length);
+
+    uint32_t count() {
+        return _ram.count() + _flash.count();
+    }
+
+    bool empty() {
+        return count() == 0;
+    }
+
+    /*! @brief Frames dropped because both stores were full.*/
+    uint32_t dropped() const {
+        return _dropped;
+    }
+
+    /*! @brief Choose the next batch from the oldest frames.
+        @param maxBytes Upper bound on the batch payload; at least one frame is always taken.
+        @param maxFrames Upper bound on frames per batch.
+        @param length Out: exact payload length writeBatch() will produce.
+        @return Number of frames in the batch, 0 if the backlog is empty.*/
+    uint16_t planBatch(size_t maxBytes, uint16_t maxFrames, size_t &length);
+
+    /*! @brief Write the batch chosen by planBatch().
+        @param sentAt Device time (millis()) at send, for timestamp recovery.*/
+    size_t writeBatch(Print &out, uint16_t frames, uint32_t sentAt);
+
+    /*! @brief Describe the batch chosen by planBatch() as spans over the RAM ring, whose
+               length-prefixed frames already are batch entries. Spans stay valid until pop().
+        @param spans CYCLE_BATCH_MAX_SPANS entries.
+        @return Number of spans, 0 if the batch comes from flash (use writeBatch()).*/
+    uint8_t batchSpans(MQTTPayloadSpan *spans, uint16_t frames, uint32_t sentAt);
+
+    /*! @brief Remove a batch after it was published.*/
+    void pop(uint16_t frames);
+
+   private:
+    void spillOldest();
+
+    FrameRing<RamFrameStore> _ram;
+    FrameRing<FlashFrameStore> _flash;
+    uint8_t *_staging;  // One encoded frame (CYCLE_FRAME_MAX_SIZE)
+    bool _flashEnabled;
+    bool _batchFromFlash;
+    uint32_t _dropped;
+    uint8_t _batchHeader[CYCLE_BATCH_HEADER_SIZE];  // Header span of batchSpans()
+};
+
+#endif
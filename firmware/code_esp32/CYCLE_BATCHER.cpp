@@ -0,0 +1,116 @@
+#include "CYCLE_BATCHER.h"
+
+#include <string.h>
+
+static_assert(CYCLE_FRAME_MAX_SIZE + CYCLE_BATCH_ENTRY_SIZE <= LZ4_MAX_INPUT, "A batch holds at least one frame");
+
+CycleBatcher::CycleBatcher()
+    : _entries(NULL), _packed(NULL), _table(NULL), _payload(NULL), _capacity(0), _used(CYCLE_BATCH_HEADER_SIZE),
+      _count(0), _oldest(0) {}
+
+bool CycleBatcher::begin(size_t maxBytes, bool compress) {
+    if (maxBytes < CYCLE_FRAME_MAX_SIZE + CYCLE_BATCH_ENTRY_SIZE) {
+        maxBytes = CYCLE_FRAME_MAX_SIZE + CYCLE_BATCH_ENTRY_SIZE;
+    }
+    if (maxBytes > LZ4_MAX_INPUT) {
+        maxBytes = LZ4_MAX_INPUT;
+    }
+
+    // Entries, then the compressed copy (kept only if smaller than the entries) and the match table
+    size_t entries = CYCLE_BATCH_HEADER_SIZE + maxBytes;
+    size_t total   = entries + (compress ? entries + LZ4_HASH_SIZE * sizeof(uint16_t) : 0);
+    uint8_t *memory = (uint8_t *)(psramFound() ? ps_malloc(total) : malloc(total));
+    if (memory == NULL) {
+        return false;
+    }
+
+    _entries  = memory;
+    _capacity = entries;
+    if (compress) {
+        _packed = memory + entries;
+        _table  = (uint16_t *)(_packed + entries);  // 2 * entries from the start: u16 aligned
+    }
+    clear();
+    return true;
+}
+
+bool CycleBatcher::push(const CycleRecord &record) {
+    if (!enabled()) {
+        return false;
+    }
+
+    size_t length = CycleSerializer::binaryLength(record);
+    if (_used + CYCLE_BATCH_ENTRY_SIZE + length > _capacity) {
+        return false;
+    }
+
+    uint8_t *entry = _entries + _used;
+    entry[0]       = (uint8_t)length;
+    entry[1]       = (uint8_t)(length >> 8);
+    BufferPrint out(entry + CYCLE_BATCH_ENTRY_SIZE, length);
+    CycleSerializer::writeBinary(out, record);
+
+    if (_count == 0) {
+        _oldest = record.timestamp;
+    }
+    _used += CYCLE_BATCH_ENTRY_SIZE + length;
+    _count++;
+    _payload = NULL;
+    return true;
+}
+
+size_t CycleBatcher::seal(uint32_t sentAt) {
+    size_t raw = rawBytes();
+
+    if (_packed != NULL && raw > CYCLE_BATCH_RAW_SIZE) {
+        // Only worth sending if smaller than the entries as they are
+        uint8_t *body   = _packed + CYCLE_BATCH_HEADER_SIZE + CYCLE_BATCH_RAW_SIZE;
+        size_t capacity = raw - CYCLE_BATCH_RAW_SIZE - 1;
+        size_t block    = Lz4Block::compress(_entries + CYCLE_BATCH_HEADER_SIZE, raw, body, capacity, _table);
+        if (block > 0) {
+            writeHeader(_packed, _count, sentAt, CYCLE_BATCH_FLAG_LZ4);
+            uint8_t *rawLength = _packed + CYCLE_BATCH_HEADER_SIZE;
+            rawLength[0]       = (uint8_t)raw;
+            rawLength[1]       = (uint8_t)(raw >> 8);
+            rawLength[2]       = (uint8_t)(raw >> 16);
+            rawLength[3]       = (uint8_t)(raw >> 24);
+            _payload           = _packed;
+            return CYCLE_BATCH_HEADER_SIZE + CYCLE_BATCH_RAW_SIZE + block;
+        }
+    }
+
+    writeHeader(_entries, _count, sentAt, 0);
+    _payload = _entries;
+    return _used;
+}
+
+const uint8_t *CycleBatcher::nextFrame(size_t &offset, uint16_t &length) const {
+    size_t at = CYCLE_BATCH_HEADER_SIZE + offset;
+    if (at >= _used) {
+        return NULL;
+    }
+    length = (uint16_t)(_entries[at] | (_entries[at + 1] << 8));
+    offset += CYCLE_BATCH_ENTRY_SIZE + length;
+    return _entries + at + CYCLE_BATCH_ENTRY_SIZE;
+}
+
+void CycleBatcher::clear() {
+    _used    = CYCLE_BATCH_HEADER_SIZE;
+    _count   = 0;
+    _payload = NULL;
+}
+
+void CycleBatcher::writeHeader(uint8_t *header, uint16_t frames, uint32_t sentAt, uint8_t flags) {
+    header[0]  = CYCLE_BATCH_MAGIC0;
+    header[1]  = CYCLE_BATCH_MAGIC1;
+    header[2]  = CYCLE_BATCH_VERSION;
+    header[3]  = flags;
+    header[4]  = (uint8_t)frames;
+    header[5]  = (uint8_t)(frames >> 8);
+    header[6]  = 0;  // reserved
+    header[7]  = 0;
+    header[8]  = (uint8_t)sentAt;
+    header[9]  = (uint8_t)(sentAt >> 8);
+    header[10] = (uint8_t)(sentAt >> 16);
+    header[11] = (uint8_t)(sentAt >> 24);
+}
@@ -0,0 +1,104 @@
+#ifndef _CYCLE_BATCHER_H_
+#define _CYCLE_BATCHER_H_
+
+#include <Arduino.h>
+#include "CYCLE_RECORD.h"
+#include "CYCLE_SERIALIZER.h"
+#include "LZ4_BLOCK.h"
+
+// Batch of cycle frames (little-endian), see FIRMWARE_ARCHITECTURE.md
+#define CYCLE_BATCH_MAGIC0     'O'
+#define CYCLE_BATCH_MAGIC1     'B'
+#define CYCLE_BATCH_VERSION    1
+#define CYCLE_BATCH_HEADER_SIZE 12  // magic, version, flags, frame_count u16, reserved u16, sent_at u32
+#define CYCLE_BATCH_ENTRY_SIZE  2   // u16 frame length ahead of every frame
+#define CYCLE_BATCH_RAW_SIZE    4   // u32 entry bytes ahead of a compressed body
+#define CYCLE_BATCH_FLAG_LZ4    0x01  // Entries are one LZ4 block behind their raw length
+
+/*
+ Several live cycles in one MQTT publish, so a reader with short cycles
+ pays for one PUBLISH (and one PUBACK at QoS 1) per batch instead of per
+ cycle, optionally LZ4-compressed.
+
+ Cycles are appended as full binary frames (never deltas: a lost batch
+ must not break the tag baseline), in the same batch format as the
+ backlog. A batch is due once it holds enough cycles or its oldest cycle
+ closed long enough ago; the caller bounds both, which bounds the latency
+ batching adds. seal() builds the payload: the LZ4 block of the entries if
+ that comes out smaller, else the entries as they are.
+
+ Buffers (PSRAM when found): the entries, the compressed copy and the
+ match table are allocated once in begin().
+
+ Not thread safe; owned by the output task.
+*/
+class CycleBatcher {
+   public:
+    CycleBatcher();
+
+    /*! @brief Allocate for maxBytes of entries (clamped to one largest frame .. LZ4_MAX_INPUT).
+        @param compress Also allocate the compressed copy and try LZ4 in seal().
+        @return False if the buffers could not be allocated; batching then stays disabled.*/
+    bool begin(size_t maxBytes, bool compress);
+
+    bool enabled() const {
+        return _entries != NULL;
+    }
+
+    /*! @brief Append a cycle as a full binary frame.
+        @return False if the batch is full: publish it (or move it to the backlog) and push again.*/
+    bool push(const CycleRecord &record);
+
+    uint16_t count() const {
+        return _count;
+    }
+
+    bool empty() const {
+        return _count == 0;
+    }
+
+    /*! @brief True once maxCycles are waiting or the oldest closed maxAgeMs before now.*/
+    bool due(unsigned long now, uint16_t maxCycles, uint32_t maxAgeMs) const {
+        return _count > 0 && (_count >= maxCycles || now - _oldest >= maxAgeMs);
+    }
+
+    /*! @brief Build the payload of the cycles held.
+        @param sentAt Device time (millis()) at send, for timestamp recovery.
+        @return Payload length; the bytes are at payload() until the next push() or clear().*/
+    size_t seal(uint32_t sentAt);
+
+    const uint8_t *payload() const {
+        return _payload;
+    }
+
+    /*! @brief True if the last seal() compressed.*/
+    bool compressed() const {
+        return _payload == _packed;
+    }
+
+    /*! @brief Frame entries held, uncompressed.*/
+    size_t rawBytes() const {
+        return _used - CYCLE_BATCH_HEADER_SIZE;
+    }
+
+    /*! @brief Walk the frames held, oldest first: start with offset 0.
+        @return The next frame, NULL after the last one.*/
+    const uint8_t *nextFrame(size_t &offset, uint16_t &length) const;
+
+    /*! @brief Drop every cycle held (published, or moved to the backlog).*/
+    void clear();
+
+    static void writeHeader(uint8_t *header, uint16_t frames, uint32_t sentAt, uint8_t flags);
+
+   private:
+    uint8_t *_entries;  // Header, then frame entries
+    uint8_t *_packed;   // Header, raw length, LZ4 block; NULL without compression
+    uint16_t *_table;   // LZ4_HASH_SIZE match slots
+    const uint8_t *_payload;
+    size_t _capacity;
+    size_t _used;
+    uint16_t _count;
+    unsigned long _oldest;  // timestamp of the first cycle held
+};
+
+#endif
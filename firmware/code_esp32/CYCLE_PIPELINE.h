@@ -0,0 +1,176 @@
+#ifndef _CYCLE_PIPELINE_H_
+#define _CYCLE_PIPELINE_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/*
+ Lock-free handoff of preallocated records from one producer task to one
+ consumer task.
+
+ The pool holds PoolSize records, provided once through begin() (e.g. from
+ the BootArena) and recycled for good: nothing is allocated per cycle. Ownership moves by index through two rings:
+
+   free ring:    consumer -> producer   (records ready to be refilled)
+   pending ring: producer -> consumer   (completed records, oldest first)
+
+ The producer always owns exactly one record (record()) and fills it in
+ place. publish() pushes it to the pending ring and takes a new one from the
+ free ring. When the free ring is empty the consumer has fallen behind and
+ the drop policy applies:
+
+   DROP_OLDEST - the producer reclaims the oldest pending record, so the
+                 consumer always sees the most recent cycles.
+   DROP_NEWEST - the just-completed record is discarded and refilled.
+
+ Reclaiming races with the consumer's acquire(); both pop the pending ring
+ with a CAS on its tail, so each record has exactly one owner at a time.
+ Counters only ever grow, so a stale tail makes the CAS fail instead of
+ popping twice.
+
+ No locks and no blocking: waking the consumer (e.g. xTaskNotifyGive) is up
+ to the caller.
+*/
+template <typename Record, uint8_t PoolSize>
+class CyclePipeline {
+    static_assert(PoolSize >= 3, "Producer and consumer each hold a record; at least one must be queued");
+    static_assert(PoolSize <= 128, "Ring capacity is derived from PoolSize");
+
+   public:
+    enum Policy : uint8_t { DROP_OLDEST, DROP_NEWEST };
+
+    explicit CyclePipeline(Policy policy = DROP_OLDEST) : _records(NULL), _policy(policy), _fill(0), _dropped(0) {
+        _pendingHead.store(0);
+        _pendingTail.store(0);
+        _freeHead.store(0);
+        _freeTail.store(0);
+        for (uint8_t i = 1; i < PoolSize; i++) {
+            pushFree(i);
+        }
+    }
+
+    /*! @brief Hand over the pool: PoolSize records. Call before either task starts.*/
+    void begin(Record *records) {
+        _records = records;
+    }
+
+    bool ready() const {
+        return _records != NULL;
+    }
+
+    // ---- Producer side ----
+
+    /*! @brief The record currently owned by the producer.*/
+    Record &record() {
+        return _records[_fill];
+    }
+
+    /*! @brief Hand the filled record to the consumer and take a fresh one.
+        @return False if a record was dropped to make room.*/
+    bool publish() {
+        uint8_t next;
+        if (popFree(&next)) {
+            pushPending(_fill);
+            _fill = next;
+            return true;
+        }
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+        if (_policy == DROP_OLDEST && popPending(&next)) {
+            pushPending(_fill);
+            _fill = next;
+        }
+        // DROP_NEWEST (or the consumer holds everything): refill the same record
+        return false;
+    }
+
+    // ---- Consumer side ----
+
+    /*! @brief Take the oldest completed record.
+        @return NULL if nothing is pending. Must be passed to release() when done.*/
+    Record *acquire() {
+        uint8_t index;
+        return popPending(&index) ? &_records[index] : NULL;
+    }
+
+    /*! @brief Return a record obtained from acquire() to the pool.*/
+    void release(Record *record) {
+        pushFree((uint8_t)(record - _records));
+    }
+
+    // ---- Either side ----
+
+    /*! @brief Completed records waiting for the consumer.*/
+    uint8_t pending() const {
+        return (uint8_t)(_pendingHead.load(std::memory_order_acquire) - _pendingTail.load(std::memory_order_acquire));
+    }
+
+    /*! @brief Records dropped since boot because the consumer was behind.*/
+    uint32_t dropped() const {
+        return _dropped.load(std::memory_order_relaxed);
+    }
+
+    static uint8_t poolSize() {
+        return PoolSize;
+    }
+
+   private:
+    // Power of two >= PoolSize: a ring can never hold more than PoolSize indices
+    static const uint32_t RING_SIZE = PoolSize <= 4 ? 4 : PoolSize <= 8 ? 8 : PoolSize <= 16 ? 16
+                                    : PoolSize <= 32 ? 32 : PoolSize <= 64 ? 64 : 128;
+    static const uint32_t RING_MASK = RING_SIZE - 1;
+
+    // Single writer: the producer
+    void pushPending(uint8_t index) {
+        uint32_t head = _pendingHead.load(std::memory_order_relaxed);
+        _pendingRing[head & RING_MASK] = index;
+        _pendingHead.store(head + 1, std::memory_order_release);
+    }
+
+    // Two readers: the consumer (acquire) and the producer (DROP_OLDEST)
+    bool popPending(uint8_t *index) {
+        uint32_t tail = _pendingTail.load(std::memory_order_acquire);
+        while (tail != _pendingHead.load(std::memory_order_acquire)) {
+            uint8_t candidate = _pendingRing[tail & RING_MASK];
+            if (_pendingTail.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel,
+                                                   std::memory_order_acquire)) {
+                *index = candidate;
+                return true;
+            }
+            // tail was reloaded by the failed CAS
+        }
+        return false;
+    }
+
+    // Single writer: the consumer (plus the constructor)
+    void pushFree(uint8_t index) {
+        uint32_t head = _freeHead.load(std::memory_order_relaxed);
+        _freeRing[head & RING_MASK] = index;
+        _freeHead.store(head + 1, std::memory_order_release);
+    }
+
+    // Single reader: the producer
+    bool popFree(uint8_t *index) {
+        uint32_t tail = _freeTail.load(std::memory_order_relaxed);
+        if (tail == _freeHead.load(std::memory_order_acquire)) {
+            return false;
+        }
+        *index = _freeRing[tail & RING_MASK];
+        _freeTail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    Record *_records;
+    const Policy _policy;
+    uint8_t _fill;  // Producer-owned record
+
+    volatile uint8_t _pendingRing[RING_SIZE];
+    volatile uint8_t _freeRing[RING_SIZE];
+    std::atomic<uint32_t> _pendingHead;
+    std::atomic<uint32_t> _pendingTail;
+    std::atomic<uint32_t> _freeHead;
+    std::atomic<uint32_t> _freeTail;
+    std::atomic<uint32_t> _dropped;
+};
+
+#endif
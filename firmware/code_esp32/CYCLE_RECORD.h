@@ -0,0 +1,56 @@
+#ifndef _CYCLE_RECORD_H_
+#define _CYCLE_RECORD_H_
+
+#include <stdint.h>
+#include "UNIT_UHF_RFID.h"
+#include "ANCHOR_TABLE.h"
+#include "POSITION_SOLVER.h"
+#include "UWB_SESSION_PARSER.h"
+
+#ifndef RFID_MAX_TAGS
+#define RFID_MAX_TAGS RFID_MAX_CARDS  // Maximum tags per polling cycle (driver limit, default 200)
+#endif
+
+struct RFIDTagData {
+    uint8_t epc[RFID_EPC_SIZE];
+    int8_t rssi;                    // Mean RSSI over all reads in the cycle
+    int8_t rssiMin;
+    int8_t rssiMax;
+    uint16_t reads;                 // Number of reads folded into this entry
+    unsigned long firstSeen;        // millis() of first/last read, published relative to CycleRecord::timestamp
+    unsigned long lastSeen;
+    unsigned long timestamp;
+    uint8_t sources;                // Bit per reader/antenna that read the tag (RFID_READERS.h); not published
+};
+
+/*
+ Everything the output side needs to publish one polling cycle: the
+ aggregated tag set and the anchor statistics accumulated while it ran.
+ Records are preallocated in the CyclePipeline pool and filled in place.
+*/
+struct CycleRecord {
+    uint32_t cycle;
+    unsigned long timestamp;        // millis() when the cycle closed: the base of every time in the record
+    uint64_t epochUs;               // Wall time at timestamp (EPOCH_CLOCK.h), 0 until SNTP has synced
+    uint16_t tagCount;
+    bool suppressed;                // Run with session suppression (INVENTORY_FILTER.h): absent tags may be present
+    RFIDTagData tags[RFID_MAX_TAGS];
+    AnchorTable anchors;
+    PositionEstimate position;      // Latest on-device fix when the cycle closed
+};
+
+/*
+ One UWB session for the high-rate stream, published independently of the
+ RFID cycle. Stamped with the session time on the same millis() clock as
+ CycleRecord::timestamp, so the receiver can line the two streams up.
+*/
+struct UwbSample {
+    uint32_t session;               // Session counter since boot
+    unsigned long timestamp;        // millis() of the session
+    uint8_t rangeCount;             // Successful ranges only
+    uint16_t macAddress[UWB_MAX_MEASUREMENTS];
+    int distanceCm[UWB_MAX_MEASUREMENTS];
+    PositionEstimate position;      // Valid only if solved from this session
+};
+
+#endif
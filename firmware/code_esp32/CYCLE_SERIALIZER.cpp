@@ -0,0 +1,327 @@
+#include "CYCLE_SERIALIZER.h"
+#include "UWB_SESSION_PARSER.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// Largest single fragment is one anchor object with its statistics (~200 bytes)
+#define JSON_FRAGMENT_SIZE 256
+
+static size_t emit(Print &out, const char *text, int length) {
+    if (length <= 0) {
+        return 0;
+    }
+    if (length >= JSON_FRAGMENT_SIZE) {
+        length = JSON_FRAGMENT_SIZE - 1;  // snprintf truncated; keep the count consistent with the bytes
+    }
+    return out.write((const uint8_t *)text, (size_t)length);
+}
+
+// Times are published as ms before the cycle's timestamp, saturating at 65535
+static inline uint16_t msBefore(const CycleRecord &record, unsigned long time) {
+    unsigned long age = record.timestamp - time;
+    return (long)age < 0 ? 0 : age > 0xffff ? 0xffff : (uint16_t)age;
+}
+
+uint8_t CycleSerializer::countReportableAnchors(const CycleRecord &record) {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < record.anchors.size(); i++) {
+        if (isReportableAnchor(record.anchors.at(i), record.timestamp)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static size_t writeTagJson(Print &out, char *fragment, const CycleRecord &record, const RFIDTagData &tag,
+                           bool first) {
+    char epcHex[RFID_EPC_HEX_SIZE];
+    Unit_UHF_RFID::formatHex(tag.epc, RFID_EPC_SIZE, epcHex);
+    return emit(out, fragment,
+                snprintf(fragment, JSON_FRAGMENT_SIZE,
+                         "%s{\"epc\":\"%s\",\"rssi_dbm\":%d,\"rssi_min\":%d,\"rssi_max\":%d,\"reads\":%u,"
+                         "\"seen_ms\":[%u,%u]}",
+                         first ? "" : ",", epcHex, tag.rssi, tag.rssiMin, tag.rssiMax, tag.reads,
+                         msBefore(record, tag.firstSeen), msBefore(record, tag.lastSeen)));
+}
+
+static size_t writeDeltaJson(Print &out, char *fragment, const CycleRecord &record, const TagDeltaTracker &delta) {
+    size_t n = emit(out, fragment,
+                    snprintf(fragment, JSON_FRAGMENT_SIZE, "\"delta\":{\"base_cycle\":%lu,\"added\":[",
+                             (unsigned long)delta.baseCycle()));
+    for (uint16_t i = 0; i < delta.addedCount(); i++) {
+        n += writeTagJson(out, fragment, record, record.tags[delta.added(i)], i == 0);
+    }
+
+    n += out.write((const uint8_t *)"],\"changed\":[", 13);
+    for (uint16_t i = 0; i < delta.changedCount(); i++) {
+        n += writeTagJson(out, fragment, record, record.tags[delta.changed(i)], i == 0);
+    }
+
+    n += out.write((const uint8_t *)"],\"removed\":[", 13);
+    char epcHex[RFID_EPC_HEX_SIZE];
+    for (uint16_t i = 0; i < delta.removedCount(); i++) {
+        Unit_UHF_RFID::formatHex(delta.removedEpc(i), RFID_EPC_SIZE, epcHex);
+        n += emit(out, fragment, snprintf(fragment, JSON_FRAGMENT_SIZE, "%s\"%s\"", i ? "," : "", epcHex));
+    }
+
+    n += out.write((const uint8_t *)"]}", 2);
+    return n;
+}
+
+size_t CycleSerializer::writeJson(Print &out, const CycleRecord &record, const TagDeltaTracker *delta) {
+    char fragment[JSON_FRAGMENT_SIZE];
+    size_t n = 0;
+
+    n += emit(out, fragment,
+              snprintf(fragment, sizeof(fragment), "{\"polling_cycle\":%lu,\"timestamp\":%lu,",
+                       (unsigned long)record.cycle, record.timestamp));
+    if (record.epochUs) {
+        n += emit(out, fragment,
+                  snprintf(fragment, sizeof(fragment), "\"epoch_us\":%llu,", (unsigned long long)record.epochUs));
+    }
+    n += emit(out, fragment,
+              snprintf(fragment, sizeof(fragment), "\"uwb\":{\"n_anchors\":%u,\"anchors\":[",
+                       countReportableAnchors(record)));
+
+    // UWB section: averaged distances per anchor (only fresh anchors with valid readings)
+    char macHex[UWB_MAC_HEX_SIZE];
+    bool first = true;
+    for (uint8_t i = 0; i < record.anchors.size(); i++) {
+        const AnchorStats &stats = record.anchors.at(i);
+        if (!isReportableAnchor(stats, record.timestamp)) continue;
+
+        UWBSessionParser::formatMac(stats.macAddress, macHex);
+        n += emit(out, fragment,
+                  snprintf(fragment, sizeof(fragment),
+                           "%s{\"mac_address\":\"%s\",\"average_distance_cm\":%.1f,\"median_distance_cm\":%.1f,"
+                           "\"stddev_cm\":%.1f,\"min_cm\":%u,\"max_cm\":%u,\"measurements\":%lu,"
+                           "\"total_sessions\":%lu,\"age_ms\":%u}",
+                           first ? "" : ",", macHex, stats.meanDistance(), stats.medianDistance(),
+                           sqrtf(stats.variance()), stats.minDistance, stats.maxDistance,
+                           (unsigned long)stats.successCount, (unsigned long)stats.totalCount,
+                           msBefore(record, stats.timestamp)));
+        first = false;
+    }
+
+    n += out.write((const uint8_t *)"]", 1);
+    if (hasPosition(record)) {
+        const PositionEstimate &position = record.position;
+        n += emit(out, fragment,
+                  snprintf(fragment, sizeof(fragment),
+                           ",\"position\":{\"x_cm\":%.1f,\"y_cm\":%.1f,\"confidence\":%.2f,\"n_anchors\":%u,"
+                           "\"age_ms\":%lu}",
+                           position.x, position.y, position.confidence, position.anchors,
+                           (unsigned long)(record.timestamp - position.timestamp)));
+    }
+
+    // RFID section: the full set on keyframes, otherwise the changes against the last published cycle
+    n += emit(out, fragment,
+              snprintf(fragment, sizeof(fragment), "},\"rfid\":{\"tag_count\":%u,%s",
+                       delta ? delta->tagTotal() : record.tagCount, record.suppressed ? "\"suppressed\":true," : ""));
+
+    if (delta) {
+        n += writeDeltaJson(out, fragment, record, *delta);
+        n += out.write((const uint8_t *)"}}", 2);
+        return n;
+    }
+
+    n += out.write((const uint8_t *)"\"tags\":[", 8);
+    for (uint16_t i = 0; i < record.tagCount; i++) {
+        n += writeTagJson(out, fragment, record, record.tags[i], i == 0);
+    }
+
+    n += out.write((const uint8_t *)"]}}", 3);
+    return n;
+}
+
+size_t CycleSerializer::measureJson(const CycleRecord &record, const TagDeltaTracker *delta) {
+    CountingPrint counter;
+    return writeJson(counter, record, delta);
+}
+
+size_t CycleSerializer::writeSampleJson(Print &out, const UwbSample &sample) {
+    char fragment[JSON_FRAGMENT_SIZE];
+    size_t n = emit(out, fragment,
+                    snprintf(fragment, sizeof(fragment), "{\"session\":%lu,\"timestamp\":%lu,\"ranges\":[",
+                             (unsigned long)sample.session, sample.timestamp));
+
+    char macHex[UWB_MAC_HEX_SIZE];
+    for (uint8_t i = 0; i < sample.rangeCount; i++) {
+        UWBSessionParser::formatMac(sample.macAddress[i], macHex);
+        n += emit(out, fragment,
+                  snprintf(fragment, sizeof(fragment), "%s{\"mac_address\":\"%s\",\"distance_cm\":%d}",
+                           i ? "," : "", macHex, sample.distanceCm[i]));
+    }
+
+    n += out.write((const uint8_t *)"]", 1);
+    if (sample.position.valid) {
+        n += emit(out, fragment,
+                  snprintf(fragment, sizeof(fragment),
+                           ",\"position\":{\"x_cm\":%.1f,\"y_cm\":%.1f,\"confidence\":%.2f,\"n_anchors\":%u}",
+                           sample.position.x, sample.position.y, sample.position.confidence,
+                           sample.position.anchors));
+    }
+    n += out.write((const uint8_t *)"}", 1);
+    return n;
+}
+
+size_t CycleSerializer::measureSampleJson(const UwbSample &sample) {
+    CountingPrint counter;
+    return writeSampleJson(counter, sample);
+}
+
+static inline void putU16(uint8_t *p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void putU32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint16_t saturateU16(uint32_t v) {
+    return v > 0xffff ? 0xffff : (uint16_t)v;
+}
+
+// Fixed point: 0.1 cm, saturating at 6553.5 cm
+static inline uint16_t tenthsCm(float cm) {
+    float tenths = cm * 10.0f + 0.5f;
+    return tenths <= 0 ? 0 : tenths >= 65535.0f ? 0xffff : (uint16_t)tenths;
+}
+
+static inline int16_t saturateI16(float v) {
+    v = v < 0 ? v - 0.5f : v + 0.5f;
+    return v <= -32768.0f ? -32768 : v >= 32767.0f ? 32767 : (int16_t)v;
+}
+
+static size_t writeTagBinary(Print &out, const CycleRecord &record, const RFIDTagData &data) {
+    uint8_t tag[CYCLE_FRAME_TAG_ENTRY_SIZE];
+    memcpy(tag, data.epc, RFID_EPC_SIZE);
+    tag[12] = (uint8_t)data.rssi;
+    tag[13] = (uint8_t)data.rssiMin;
+    tag[14] = (uint8_t)data.rssiMax;
+    putU16(tag + 15, data.reads);
+    putU16(tag + 17, msBefore(record, data.firstSeen));
+    putU16(tag + 19, msBefore(record, data.lastSeen));
+    return out.write(tag, sizeof(tag));
+}
+
+size_t CycleSerializer::writeBinary(Print &out, const CycleRecord &record, const TagDeltaTracker *delta) {
+    uint16_t tagEntries = delta ? delta->addedCount() + delta->changedCount() : record.tagCount;
+
+    uint8_t header[CYCLE_FRAME_HEADER_SIZE];
+    header[0] = CYCLE_FRAME_MAGIC0;
+    header[1] = CYCLE_FRAME_MAGIC1;
+    header[2] = CYCLE_FRAME_VERSION;
+    bool position = hasPosition(record);
+    header[3] = CYCLE_FRAME_FLAG_ANCHOR_STATS | CYCLE_FRAME_FLAG_TIMES | (delta ? CYCLE_FRAME_FLAG_DELTA : 0) |
+                (position ? CYCLE_FRAME_FLAG_POSITION : 0) | (record.suppressed ? CYCLE_FRAME_FLAG_SUPPRESSED : 0);
+    putU32(header + 4, record.cycle);
+    putU32(header + 8, (uint32_t)record.timestamp);
+    putU16(header + 12, tagEntries);
+    header[14] = countReportableAnchors(record);
+    header[15] = 0;  // reserved
+    size_t n = out.write(header, sizeof(header));
+
+    if (delta) {
+        uint8_t extension[CYCLE_FRAME_DELTA_SIZE];
+        putU32(extension, delta->baseCycle());
+        putU16(extension + 4, delta->tagTotal());
+        putU16(extension + 6, delta->addedCount());
+        putU16(extension + 8, delta->removedCount());
+        putU16(extension + 10, 0);  // reserved
+        n += out.write(extension, sizeof(extension));
+    }
+
+    if (position) {
+        uint8_t extension[CYCLE_FRAME_POSITION_SIZE];
+        putU16(extension, (uint16_t)saturateI16(record.position.x));
+        putU16(extension + 2, (uint16_t)saturateI16(record.position.y));
+        extension[4] = (uint8_t)(record.position.confidence * 255.0f + 0.5f);
+        extension[5] = record.position.anchors;
+        putU16(extension + 6, saturateU16(record.timestamp - record.position.timestamp));
+        n += out.write(extension, sizeof(extension));
+    }
+
+    uint8_t time[CYCLE_FRAME_TIME_SIZE];
+    putU32(time, (uint32_t)record.epochUs);
+    putU32(time + 4, (uint32_t)(record.epochUs >> 32));
+    n += out.write(time, sizeof(time));
+
+    uint8_t anchor[CYCLE_FRAME_ANCHOR_ENTRY_SIZE];
+    for (uint8_t i = 0; i < record.anchors.size(); i++) {
+        const AnchorStats &stats = record.anchors.at(i);
+        if (!isReportableAnchor(stats, record.timestamp)) continue;
+
+        putU16(anchor, stats.macAddress);
+        putU16(anchor + 2, tenthsCm(stats.meanDistance()));
+        putU16(anchor + 4, saturateU16(stats.successCount));
+        putU16(anchor + 6, saturateU16(stats.totalCount));
+        putU16(anchor + 8, tenthsCm(stats.medianDistance()));
+        putU16(anchor + 10, tenthsCm(sqrtf(stats.variance())));
+        putU16(anchor + 12, stats.minDistance);
+        putU16(anchor + 14, stats.maxDistance);
+        putU16(anchor + 16, msBefore(record, stats.timestamp));
+        n += out.write(anchor, sizeof(anchor));
+    }
+
+    if (!delta) {
+        for (uint16_t i = 0; i < record.tagCount; i++) {
+            n += writeTagBinary(out, record, record.tags[i]);
+        }
+        return n;
+    }
+
+    // Delta: added tags, then changed tags, then the removed EPCs
+    for (uint16_t i = 0; i < delta->addedCount(); i++) {
+        n += writeTagBinary(out, record, record.tags[delta->added(i)]);
+    }
+    for (uint16_t i = 0; i < delta->changedCount(); i++) {
+        n += writeTagBinary(out, record, record.tags[delta->changed(i)]);
+    }
+    for (uint16_t i = 0; i < delta->removedCount(); i++) {
+        n += out.write(delta->removedEpc(i), RFID_EPC_SIZE);
+    }
+    return n;
+}
+
+size_t ChunkedPrint::write(uint8_t c) {
+    if (_used == _size) {
+        flush();
+    }
+    _buffer[_used++] = c;
+    return 1;
+}
+
+size_t ChunkedPrint::write(const uint8_t *data, size_t size) {
+    size_t remaining = size;
+    while (remaining > 0) {
+        if (_used == _size) {
+            flush();
+        }
+        size_t room  = _size - _used;
+        size_t chunk = remaining < room ? remaining : room;
+        memcpy(_buffer + _used, data, chunk);
+        _used += chunk;
+        data += chunk;
+        remaining -= chunk;
+    }
+    return size;
+}
+
+void ChunkedPrint::flush() {
+    if (_used == 0) {
+        return;
+    }
+    size_t accepted = _sink.write(_buffer, _used);
+    if (accepted != _used) {
+        _failed = true;
+    }
+    _written += accepted;
+    _used = 0;
+}
@@ -0,0 +1,226 @@
+#ifndef _CYCLE_SERIALIZER_H_
+#define _CYCLE_SERIALIZER_H_
+
+#include <Arduino.h>
+#include <string.h>
+#include "CYCLE_RECORD.h"
+#include "TAG_DELTA.h"
+
+// Binary cycle frame (little-endian, byte-packed), see FIRMWARE_ARCHITECTURE.md
+#define CYCLE_FRAME_MAGIC0       'O'
+#define CYCLE_FRAME_MAGIC1       'F'
+#define CYCLE_FRAME_VERSION      1
+#define CYCLE_FRAME_HEADER_SIZE  16
+#define CYCLE_FRAME_DELTA_SIZE   12     // base_cycle u32, tag_total u16, added u16, removed u16, reserved u16
+#define CYCLE_FRAME_POSITION_SIZE 8     // x i16 (cm), y i16 (cm), confidence u8 (1/255), anchors u8, age u16 (ms)
+#define CYCLE_FRAME_ANCHOR_SIZE  8      // mac u16, distance u16 (0.1 cm), measurements u16, sessions u16
+#define CYCLE_FRAME_ANCHOR_STATS_SIZE 8 // median u16 (0.1 cm), stddev u16 (0.1 cm), min u16 (cm), max u16 (cm)
+#define CYCLE_FRAME_TAG_SIZE     17     // epc[12], rssi i8, rssi_min i8, rssi_max i8, reads u16
+#define CYCLE_FRAME_TIME_SIZE    8      // epoch_us u64 (0 = not synced)
+#define CYCLE_FRAME_ANCHOR_TIME_SIZE 2  // age_ms u16: last session before timestamp
+#define CYCLE_FRAME_TAG_TIME_SIZE 4     // first_ms u16, last_ms u16: first/last read before timestamp
+#define CYCLE_FRAME_FLAG_DELTA   0x01   // Tags are changes against base_cycle
+#define CYCLE_FRAME_FLAG_POSITION 0x02  // Position extension follows the header (and delta extension)
+#define CYCLE_FRAME_FLAG_ANCHOR_STATS 0x04  // Every anchor entry is followed by its distance statistics
+#define CYCLE_FRAME_FLAG_SUPPRESSED 0x08    // Recently read tags were silenced: absent tags may be present
+#define CYCLE_FRAME_FLAG_TIMES   0x10   // Time extension, and read times after every anchor and tag entry
+
+#define CYCLE_FRAME_ANCHOR_ENTRY_SIZE (CYCLE_FRAME_ANCHOR_SIZE + CYCLE_FRAME_ANCHOR_STATS_SIZE + CYCLE_FRAME_ANCHOR_TIME_SIZE)
+#define CYCLE_FRAME_TAG_ENTRY_SIZE    (CYCLE_FRAME_TAG_SIZE + CYCLE_FRAME_TAG_TIME_SIZE)
+
+// Largest full (non-delta) frame
+#define CYCLE_FRAME_MAX_SIZE                                                                    \
+    (CYCLE_FRAME_HEADER_SIZE + CYCLE_FRAME_POSITION_SIZE + CYCLE_FRAME_TIME_SIZE +               \
+     UWB_MAX_ANCHORS * CYCLE_FRAME_ANCHOR_ENTRY_SIZE + RFID_MAX_TAGS * CYCLE_FRAME_TAG_ENTRY_SIZE)
+
+enum CyclePayloadFormat : uint8_t {
+    CYCLE_PAYLOAD_JSON = 0,
+    CYCLE_PAYLOAD_BINARY
+};
+
+/*
+ Streaming encoders for a CycleRecord: JSON, and a compact binary frame.
+
+ The payload is written straight to a Print (the MQTT client, Serial, ...)
+ with no document tree and no intermediate String. Output is deterministic,
+ so measureJson() - a dry run into a CountingPrint - gives the exact length
+ that PubSubClient::beginPublish() needs up front.
+
+ {"polling_cycle":N,"timestamp":T,"epoch_us":E,
+  "uwb":{"n_anchors":K,"anchors":[{"mac_address":"0x0001","average_distance_cm":245.0,
+                                  "median_distance_cm":244.0,"stddev_cm":3.1,"min_cm":240,
+                                  "max_cm":262,"measurements":9,"total_sessions":10,"age_ms":35}],
+         "position":{"x_cm":412.3,"y_cm":188.0,"confidence":0.82,"n_anchors":4,"age_ms":40}},
+  "rfid":{"tag_count":M,"tags":[{"epc":"e200...","rssi_dbm":-52,"rssi_min":-60,
+                               "rssi_max":-48,"reads":7,"seen_ms":[480,12]}]}}
+
+ timestamp (device millis()) is the cycle's time base; epoch_us, its wall
+ time from SNTP (EPOCH_CLOCK.h), is left out until the clock has synced.
+ Every other time is short and relative to it: an anchor's last session
+ and a fix's age in ms before timestamp, a tag's first and last read as
+ "seen_ms":[first,last] in ms before timestamp.
+
+ "position" is present only while an on-device fix is fresh (POSITION_SOLVER.h).
+ "rfid" carries "suppressed":true after tag_count when the cycle ran with
+ session suppression (INVENTORY_FILTER.h).
+
+ With a TagDeltaTracker the rfid section carries only the changes against
+ the last published cycle; tag_count is still the size of the full set:
+
+  "rfid":{"tag_count":M,"delta":{"base_cycle":B,"added":[{...}],"changed":[{...}],
+                                 "removed":["e200..."]}}
+
+ A UwbSample (high-rate stream) is a single session:
+
+ {"session":S,"timestamp":T,"ranges":[{"mac_address":"0x0001","distance_cm":245}],
+  "position":{"x_cm":412.3,"y_cm":188.0,"confidence":0.82,"n_anchors":4}}
+*/
+class CycleSerializer {
+   public:
+    /*! @brief Write the record as compact JSON.
+        @param delta Changes to publish instead of the full tag set, or NULL for a keyframe.
+        @return Number of bytes produced.*/
+    static size_t writeJson(Print &out, const CycleRecord &record, const TagDeltaTracker *delta = NULL);
+
+    /*! @brief Length writeJson() will produce for this record.*/
+    static size_t measureJson(const CycleRecord &record, const TagDeltaTracker *delta = NULL);
+
+    /*! @brief Write the record as a binary cycle frame (CYCLE_FRAME_VERSION).
+        @param delta Changes to publish instead of the full tag set, or NULL for a keyframe.
+        @return Number of bytes produced.*/
+    static size_t writeBinary(Print &out, const CycleRecord &record, const TagDeltaTracker *delta = NULL);
+
+    /*! @brief Exact length writeBinary() will produce for this record.*/
+    static size_t binaryLength(const CycleRecord &record, const TagDeltaTracker *delta = NULL) {
+        size_t anchors = (size_t)countReportableAnchors(record) * CYCLE_FRAME_ANCHOR_ENTRY_SIZE +
+                         (hasPosition(record) ? CYCLE_FRAME_POSITION_SIZE : 0) + CYCLE_FRAME_TIME_SIZE;
+        if (!delta) {
+            return CYCLE_FRAME_HEADER_SIZE + anchors + (size_t)record.tagCount * CYCLE_FRAME_TAG_ENTRY_SIZE;
+        }
+        return CYCLE_FRAME_HEADER_SIZE + CYCLE_FRAME_DELTA_SIZE + anchors +
+               (size_t)(delta->addedCount() + delta->changedCount()) * CYCLE_FRAME_TAG_ENTRY_SIZE +
+               (size_t)delta->removedCount() * RFID_EPC_SIZE;
+    }
+
+    /*! @brief Write the record in the given format.*/
+    static size_t write(Print &out, const CycleRecord &record, CyclePayloadFormat format,
+                        const TagDeltaTracker *delta = NULL) {
+        return format == CYCLE_PAYLOAD_BINARY ? writeBinary(out, record, delta) : writeJson(out, record, delta);
+    }
+
+    /*! @brief Exact length write() will produce for this record.*/
+    static size_t length(const CycleRecord &record, CyclePayloadFormat format, const TagDeltaTracker *delta = NULL) {
+        return format == CYCLE_PAYLOAD_BINARY ? binaryLength(record, delta) : measureJson(record, delta);
+    }
+
+    /*! @brief Write one session of the UWB stream as compact JSON.
+        @return Number of bytes produced.*/
+    static size_t writeSampleJson(Print &out, const UwbSample &sample);
+
+    /*! @brief Length writeSampleJson() will produce for this sample.*/
+    static size_t measureSampleJson(const UwbSample &sample);
+
+    /*! @brief Anchors that are published: fresh and with at least one distance.*/
+    static bool isReportableAnchor(const AnchorStats &stats, unsigned long now) {
+        return stats.successCount > 0 && AnchorTable::isFresh(stats, now);
+    }
+
+    static uint8_t countReportableAnchors(const CycleRecord &record);
+
+    /*! @brief The record carries a fix that is still fresh when the cycle closed.*/
+    static bool hasPosition(const CycleRecord &record) {
+        return record.position.valid && record.timestamp - record.position.timestamp <= AnchorTable::freshnessMs();
+    }
+};
+
+/*
+ Print that only counts bytes.
+*/
+class CountingPrint : public Print {
+   public:
+    CountingPrint() : _count(0) {}
+
+    size_t write(uint8_t) override {
+        _count++;
+        return 1;
+    }
+
+    size_t write(const uint8_t *, size_t size) override {
+        _count += size;
+        return size;
+    }
+
+    size_t count() const {
+        return _count;
+    }
+
+   private:
+    size_t _count;
+};
+
+/*
+ Print into a fixed buffer; bytes beyond its size are dropped and not counted.
+*/
+class BufferPrint : public Print {
+   public:
+    BufferPrint(uint8_t *buffer, size_t size) : _buffer(buffer), _size(size), _used(0) {}
+
+    size_t write(uint8_t c) override {
+        return write(&c, 1);
+    }
+
+    size_t write(const uint8_t *data, size_t size) override {
+        if (size > _size - _used) {
+            size = _size - _used;
+        }
+        memcpy(_buffer + _used, data, size);
+        _used += size;
+        return size;
+    }
+
+    size_t used() const {
+        return _used;
+    }
+
+   private:
+    uint8_t *_buffer;
+    size_t _size;
+    size_t _used;
+};
+
+/*
+ Coalesces small writes into fixed-size chunks before handing them to the
+ sink. Writing a JSON payload byte by byte to a WiFiClient would issue one
+ lwIP call per byte. The buffer is owned by the caller.
+*/
+class ChunkedPrint : public Print {
+   public:
+    ChunkedPrint(Print &sink, uint8_t *buffer, size_t size)
+        : _sink(sink), _buffer(buffer), _size(size), _used(0), _written(0), _failed(false) {}
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *data, size_t size) override;
+
+    /*! @brief Push any buffered bytes to the sink.*/
+    void flush() override;
+
+    /*! @brief Bytes accepted by the sink so far.*/
+    size_t written() const {
+        return _written;
+    }
+
+    /*! @brief True if the sink ever accepted fewer bytes than offered.*/
+    bool failed() const {
+        return _failed;
+    }
+
+   private:
+    Print &_sink;
+    uint8_t *_buffer;
+    size_t _size;
+    size_t _used;
+    size_t _written;
+    bool _failed;
+};
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef _EPC_HASH_SET_H_
+#define _EPC_HASH_SET_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#define EPC_KEY_SIZE 12  // 96-bit EPC
+
+/*
+ Fixed-capacity open-addressing (linear probing) hash set keyed on a 96-bit EPC.
+ No heap: all slots live inside the object. Each key carries a 16-bit value so
+ callers can map an EPC back to their own storage (e.g. an index into cards[]).
+
+ Capacity must be a power of two and should be at least ~1.5x the number of
+ keys expected per clear() to keep probe chains short.
+
+ clear() is O(1): every slot is stamped with the generation it was written in,
+ and bumping the generation invalidates all of them at once.
+*/
+template <uint16_t Capacity>
+class EpcHashSet {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "EpcHashSet capacity must be a power of two");
+
+   public:
+    static const uint16_t NOT_FOUND = 0xffff;
+
+    EpcHashSet() : _generation(1), _size(0) {
+        memset(_slots, 0, sizeof(_slots));
+    }
+
+    /*! @brief Remove all keys.*/
+    void clear() {
+        _size = 0;
+        if (++_generation == 0) {
+            // Generation counter wrapped - stale stamps could match again
+            memset(_slots, 0, sizeof(_slots));
+            _generation = 1;
+        }
+    }
+
+    uint16_t size() const {
+        return _size;
+    }
+
+    static uint16_t capacity() {
+        return Capacity;
+    }
+
+    /*! @brief Look up an EPC.
+        @return The stored value, or NOT_FOUND.*/
+    uint16_t find(const uint8_t *epc) const {
+        uint16_t i = hash(epc) & (Capacity - 1);
+        for (uint16_t probes = 0; probes < Capacity; probes++) {
+            const Slot &slot = _slots[i];
+            if (slot.generation != _generation) {
+                return NOT_FOUND;
+            }
+            if (memcmp(slot.epc, epc, EPC_KEY_SIZE) == 0) {
+                return slot.value;
+            }
+            i = (i + 1) & (Capacity - 1);
+        }
+        return NOT_FOUND;
+    }
+
+    /*! @brief Insert an EPC if it is not already present.
+        @param existing Receives the value already stored for this EPC, or
+               NOT_FOUND if the key was inserted or the set is full.
+        @return True if the key was newly inserted.*/
+    bool insert(const uint8_t *epc, uint16_t value, uint16_t *existing = NULL) {
+        uint16_t i = hash(epc) & (Capacity - 1);
+        for (uint16_t probes = 0; probes < Capacity; probes++) {
+            Slot &slot = _slots[i];
+            if (slot.generation != _generation) {
+                memcpy(slot.epc, epc, EPC_KEY_SIZE);
+                slot.value      = value;
+                slot.generation = _generation;
+                _size++;
+                if (existing) *existing = NOT_FOUND;
+                return true;
+            }
+            if (memcmp(slot.epc, epc, EPC_KEY_SIZE) == 0) {
+                if (existing) *existing = slot.value;
+                return false;
+            }
+            i = (i + 1) & (Capacity - 1);
+        }
+        if (existing) *existing = NOT_FOUND;
+        return false;
+    }
+
+   private:
+    struct Slot {
+        uint8_t epc[EPC_KEY_SIZE];
+        uint16_t value;
+        uint16_t generation;
+    };
+
+    // Mix all three 32-bit words: serial numbers usually differ only in the
+    // trailing bytes, while company/item prefixes repeat across a whole rack.
+    static uint32_t hash(const uint8_t *epc) {
+        uint32_t w[3];
+        memcpy(w, epc, sizeof(w));
+        uint32_t h = w[0] * 0x9e3779b1u ^ w[1] * 0x85ebca77u ^ w[2] * 0xc2b2ae3du;
+        h ^= h >> 16;
+        h *= 0x7feb352du;
+        h ^= h >> 15;
+        return h;
+    }
+
+    Slot _slots[Capacity];
+    uint16_t _generation;
+    uint16_t _size;
+};
+
+#endif
@@ -0,0 +1,61 @@
+#include "EPOCH_CLOCK.h"
+
+EpochClock::EpochClock()
+    : _mux(portMUX_INITIALIZER_UNLOCKED),
+      _targetOffsetUs(0),
+      _offsetUs(0),
+      _slewedAtUs(0),
+      _lastStampUs(0),
+      _syncs(0),
+      _lastCorrectionMs(0),
+      _stepPending(false) {}
+
+void EpochClock::reset() {
+    portENTER_CRITICAL(&_mux);
+    _targetOffsetUs   = 0;
+    _syncs            = 0;
+    _lastCorrectionMs = 0;
+    _stepPending      = false;
+    portEXIT_CRITICAL(&_mux);
+    _offsetUs    = 0;
+    _slewedAtUs  = 0;
+    _lastStampUs = 0;
+}
+
+void EpochClock::sync(int64_t epochUs, int64_t monotonicUs) {
+    int64_t offset = epochUs - monotonicUs;
+    portENTER_CRITICAL(&_mux);
+    int64_t correction = _syncs > 0 ? offset - _targetOffsetUs : 0;
+    _targetOffsetUs   = offset;
+    if (_syncs == 0 || correction > EPOCH_CLOCK_STEP_US || correction < -EPOCH_CLOCK_STEP_US) {
+        _stepPending = true;
+    }
+    _lastCorrectionMs = (int32_t)(correction / 1000);
+    _syncs++;
+    portEXIT_CRITICAL(&_mux);
+}
+
+uint64_t EpochClock::stamp(int64_t monotonicUs) {
+    portENTER_CRITICAL(&_mux);
+    int64_t target = _targetOffsetUs;
+    bool step      = _stepPending;
+    _stepPending   = false;
+    uint32_t syncs = _syncs;
+    portEXIT_CRITICAL(&_mux);
+    if (syncs == 0) return 0;
+
+    if (step) {
+        _offsetUs = target;
+    } else {
+        // Work the correction in no faster than EPOCH_CLOCK_SLEW_PPM of the time passed
+        int64_t limit = (monotonicUs - _slewedAtUs) * EPOCH_CLOCK_SLEW_PPM / 1000000;
+        int64_t error = target - _offsetUs;
+        _offsetUs += error > limit ? limit : error < -limit ? -limit : error;
+    }
+    _slewedAtUs = monotonicUs;
+
+    uint64_t now = (uint64_t)(monotonicUs + _offsetUs);
+    if (now < _lastStampUs) now = _lastStampUs;  // A backward step holds the clock instead
+    _lastStampUs = now;
+    return now;
+}
@@ -0,0 +1,69 @@
+#ifndef _EPOCH_CLOCK_H_
+#define _EPOCH_CLOCK_H_
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#ifndef EPOCH_CLOCK_SLEW_PPM
+#define EPOCH_CLOCK_SLEW_PPM 500  // Rate at which small sync corrections are worked in (0.5 ms/s)
+#endif
+
+#ifndef EPOCH_CLOCK_STEP_US
+#define EPOCH_CLOCK_STEP_US 1000000LL  // Corrections larger than this are applied at once
+#endif
+
+/*
+ Wall time (microseconds since 1970, UTC) for the monotonic boot clock
+ (esp_timer_get_time(), the clock behind millis()).
+
+ Every SNTP sync hands in one pair: the wall time and the boot clock at
+ that moment. Between syncs wall time is the boot clock plus the last
+ offset, so it never jumps with the system time. A correction below
+ EPOCH_CLOCK_STEP_US is slewed in at EPOCH_CLOCK_SLEW_PPM; a larger one
+ (first sync, long outage) is stepped. Either way stamp() never returns
+ an earlier time than it did before, so records stamped in order stay in
+ order.
+
+ sync() may run in any task (the SNTP callback runs in the lwIP task);
+ stamp() belongs to one task (rfidTask).
+*/
+class EpochClock {
+   public:
+    EpochClock();
+
+    /*! @brief Record a sync: the wall time was epochUs when the boot clock read monotonicUs.*/
+    void sync(int64_t epochUs, int64_t monotonicUs);
+
+    /*! @brief Wall time at monotonicUs (not before the boot clock reading of the last call).
+        @return Microseconds since 1970, 0 before the first sync.*/
+    uint64_t stamp(int64_t monotonicUs);
+
+    /*! @brief Forget every sync; stamp() returns 0 again.*/
+    void reset();
+
+    bool synced() const {
+        return _syncs > 0;
+    }
+
+    /*! @brief Syncs since boot.*/
+    uint32_t syncs() const {
+        return _syncs;
+    }
+
+    /*! @brief Correction the last sync asked for (ms, positive = the clock was behind).*/
+    int32_t lastCorrectionMs() const {
+        return _lastCorrectionMs;
+    }
+
+   private:
+    portMUX_TYPE _mux;
+    int64_t _targetOffsetUs;   // Wall time - boot clock, as of the last sync (under _mux)
+    int64_t _offsetUs;         // Offset in use, slewing towards _targetOffsetUs
+    int64_t _slewedAtUs;       // Boot clock of the last stamp()
+    uint64_t _lastStampUs;
+    volatile uint32_t _syncs;
+    volatile int32_t _lastCorrectionMs;
+    bool _stepPending;         // First sync or a large correction: apply it at once
+};
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef _FRAME_RING_H_
+#define _FRAME_RING_H_
+
+#include <Arduino.h>
+
+/*
+ Ring of variable-length frames over a byte store of fixed capacity.
+
+ Each frame is stored as a u16 length followed by its bytes and never wraps:
+ if it does not fit before the end of the store, a zero length marks the
+ skipped tail and the frame starts again at offset 0. The Store provides
+ read(offset, buffer, size) and write(offset, data, size).
+*/
+template <typename Store>
+class FrameRing {
+   public:
+    FrameRing() : _capacity(0), _head(0), _tail(0), _count(0), _bytes(0) {}
+
+    /*! @brief Empty the ring over a store of the given size.*/
+    void reset(uint32_t capacity) {
+        _capacity = capacity;
+        _head = _tail = 0;
+        _count = 0;
+        _bytes = 0;
+    }
+
+    Store &store() {
+        return _store;
+    }
+
+    uint32_t count() const {
+        return _count;
+    }
+
+    /*! @brief Frame bytes held, excluding length fields.*/
+    uint32_t bytes() const {
+        return _bytes;
+    }
+
+    /*! @brief True if a frame of this length fits in an empty ring.*/
+    bool fits(uint16_t length) const {
+        return length > 0 && (uint32_t)length + 2 <= _capacity;
+    }
+
+    /*! @brief Append a frame.
+        @return False if there is no room; the ring is unchanged.*/
+    bool push(const uint8_t *frame, uint16_t length) {
+        if (!fits(length)) return false;
+        if (_count == 0) {
+            _head = _tail = 0;
+        }
+
+        uint32_t need = (uint32_t)length + 2;
+        uint32_t at;
+        if (_count > 0 && _tail <= _head) {
+            if (_head - _tail < need) return false;  // Wrapped: room is up to the oldest frame
+            at = _tail;
+        } else if (_capacity - _tail >= need) {
+            at = _tail;
+        } else {
+            if (_head < need) return false;
+            if (_capacity - _tail >= 2) {
+                writeLength(_tail, 0);  // Skip marker
+            }
+            at = 0;
+        }
+
+        writeLength(at, length);
+        if (!_store.write(at + 2, frame, length)) return false;
+        _tail = at + need;
+        _count++;
+        _bytes += length;
+        return true;
+    }
+
+    /*! @brief Locate a frame while walking from the oldest one.
+        @param offset In: position from head() or next(); out: the frame's actual start.
+        @return Length of the frame at offset.*/
+    uint16_t lengthAt(uint32_t &offset) {
+        uint16_t length = 0;
+        if (_capacity - offset >= 2) {
+            length = readLength(offset);
+        }
+        if (length == 0) {
+            offset = 0;
+            length = readLength(0);
+        }
+        return length;
+    }
+
+    uint32_t head() const {
+        return _head;
+    }
+
+    static uint32_t next(uint32_t offset, uint16_t length) {
+        return offset + 2 + length;
+    }
+
+    /*! @brief Copy a frame's bytes (offset and length from lengthAt()).*/
+    bool read(uint32_t offset, uint8_t *buffer, uint16_t length) {
+        return _store.read(offset + 2, buffer, length);
+    }
+
+    /*! @brief Drop the oldest frames.*/
+    void pop(uint32_t frames) {
+        while (frames-- > 0 && _count > 0) {
+            uint32_t offset = _head;
+            uint16_t length = lengthAt(offset);
+            _head = next(offset, length);
+            _count--;
+            _bytes -= length;
+        }
+        if (_count == 0) {
+            _head = _tail = 0;
+        }
+    }
+
+   private:
+    void writeLength(uint32_t offset, uint16_t length) {
+        uint8_t field[2] = {(uint8_t)length, (uint8_t)(length >> 8)};
+        _store.write(offset, field, 2);
+    }
+
+    uint16_t readLength(uint32_t offset) {
+        uint8_t field[2] = {0, 0};
+        _store.read(offset, field, 2);
+        return (uint16_t)(field[0] | (field[1] << 8));
+    }
+
+    Store _store;
+    uint32_t _capacity;
+    uint32_t _head;   // Oldest frame
+    uint32_t _tail;   // Next write position
+    uint32_t _count;
+    uint32_t _bytes;
+};
+
+/*
+ Frame store in a RAM buffer (PSRAM when available).
+*/
+class RamFrameStore {
+   public:
+    RamFrameStore() : _buffer(NULL) {}
+
+    void attach(uint8_t *buffer) {
+        _buffer = buffer;
+    }
+
+    const uint8_t *at(uint32_t offset) const {
+        return _buffer + offset;
+    }
+
+    bool read(uint32_t offset, uint8_t *buffer, size_t size) {
+        memcpy(buffer, _buffer + offset, size);
+        return true;
+    }
+
+    bool write(uint32_t offset, const uint8_t *data, size_t size) {
+        memcpy(_buffer + offset, data, size);
+        return true;
+    }
+
+   private:
+    uint8_t *_buffer;
+};
+
+#endif
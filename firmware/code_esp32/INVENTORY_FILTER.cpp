@@ -0,0 +1,93 @@
+#include "INVENTORY_FILTER.h"
+
+#include <string.h>
+
+InventoryFilter::InventoryFilter() {
+    clear();
+}
+
+void InventoryFilter::clear() {
+    memset(_prefix, 0, sizeof(_prefix));
+    memset(_bits, 0, sizeof(_bits));
+    _prefixCount = 0;
+    _suppress    = false;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool isSeparator(char c) {
+    return c == ' ' || c == ',' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool InventoryFilter::parse(const char *text, size_t length) {
+    InventoryFilter next;
+    size_t i = 0;
+    while (i < length) {
+        if (isSeparator(text[i])) {
+            i++;
+            continue;
+        }
+        size_t start = i;
+        while (i < length && !isSeparator(text[i])) {
+            i++;
+        }
+        const char *token = text + start;
+        size_t size       = i - start;
+
+        if (size == 3 && memcmp(token, "OFF", 3) == 0) continue;
+        if (size == 8 && memcmp(token, "SUPPRESS", 8) == 0) {
+            next._suppress = true;
+            continue;
+        }
+
+        if (size > RFID_EPC_SIZE * 2 || next._prefixCount >= RFID_FILTER_MAX_PREFIXES) return false;
+        uint8_t *prefix = next._prefix[next._prefixCount];
+        for (size_t d = 0; d < size; d++) {
+            int value = hexValue(token[d]);
+            if (value < 0) return false;
+            prefix[d / 2] |= d % 2 ? value : value << 4;
+        }
+        next._bits[next._prefixCount++] = size * 4;
+    }
+    *this = next;
+    return true;
+}
+
+// Bits of a and b that agree from the start, up to limit
+static uint8_t sharedBits(const uint8_t *a, const uint8_t *b, uint8_t limit) {
+    uint8_t bits = 0;
+    while (bits < limit) {
+        uint8_t mask = 0x80 >> (bits % 8);
+        if ((a[bits / 8] ^ b[bits / 8]) & mask) break;
+        bits++;
+    }
+    return bits;
+}
+
+bool InventoryFilter::matches(const uint8_t *epc) const {
+    if (_prefixCount == 0) return true;
+    for (uint8_t i = 0; i < _prefixCount; i++) {
+        if (sharedBits(_prefix[i], epc, _bits[i]) == _bits[i]) return true;
+    }
+    return false;
+}
+
+uint8_t InventoryFilter::commonPrefix(uint8_t *mask) const {
+    memset(mask, 0, RFID_EPC_SIZE);
+    if (_prefixCount == 0) return 0;
+
+    uint8_t bits = _bits[0];
+    for (uint8_t i = 1; i < _prefixCount; i++) {
+        bits = sharedBits(_prefix[0], _prefix[i], bits < _bits[i] ? bits : _bits[i]);
+    }
+    memcpy(mask, _prefix[0], (bits + 7) / 8);
+    if (bits % 8) {
+        mask[bits / 8] &= 0xff << (8 - bits % 8);
+    }
+    return bits;
+}
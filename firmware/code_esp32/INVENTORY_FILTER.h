@@ -0,0 +1,75 @@
+#ifndef _INVENTORY_FILTER_H_
+#define _INVENTORY_FILTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "UNIT_UHF_RFID.h"
+
+#ifndef RFID_FILTER_MAX_PREFIXES
+#define RFID_FILTER_MAX_PREFIXES 8  // EPC prefix masks per filter
+#endif
+
+#ifndef RFID_FILTER_REFRESH_CYCLES
+#define RFID_FILTER_REFRESH_CYCLES 10  // With suppression, every Nth cycle still inventories every tag
+#endif
+
+#define RFID_FILTER_SUPPRESS_SESSION 2  // S2: a tag's inventoried flag stays B for seconds after a read
+
+/*
+ Which tags the reader inventories, as pushed on store/production/filter.
+
+ Payload: "OFF" (or empty), or space/comma separated tokens:
+   - a hex EPC prefix of 1-24 digits (4 bits per digit): only tags under one of
+     the prefixes are inventoried. The JRD-100 holds a single Select mask, so
+     the longest prefix shared by all of them is programmed into the module
+     and matches() drops the rest in software.
+   - SUPPRESS: tags that were just read stay silent. Inventory rounds use
+     session S2 with target A; a tag that answers flips to B and sits out the
+     following rounds until its S2 flag decays (seconds, tag dependent), so
+     the slots go to tags that have not been read yet. Every
+     RFID_FILTER_REFRESH_CYCLES-th cycle runs on S0 and reads every tag, which
+     keeps presence current.
+ e.g. "e2003412 e2004455 SUPPRESS".
+
+ Cycles run with suppression carry CycleRecord::suppressed: a tag missing from
+ them may still be present.
+*/
+class InventoryFilter {
+   public:
+    InventoryFilter();
+
+    /*! @brief Replace the filter with a payload.
+        @return False on a malformed payload; the filter is then unchanged.*/
+    bool parse(const char *text, size_t length);
+
+    void clear();
+
+    /*! @brief True if the EPC lies under one of the prefixes (or there are none).*/
+    bool matches(const uint8_t *epc) const;
+
+    /*! @brief Longest prefix shared by all masks, for the hardware Select.
+        @param mask Receives RFID_EPC_SIZE bytes.
+        @return Prefix length in bits, 0 without prefixes (or when they share none).*/
+    uint8_t commonPrefix(uint8_t *mask) const;
+
+    /*! @brief Cycle number runs with session suppression (refresh cycles do not).*/
+    bool suppressesCycle(uint32_t cycle) const {
+        return _suppress && cycle % RFID_FILTER_REFRESH_CYCLES != 0;
+    }
+
+    uint8_t prefixCount() const {
+        return _prefixCount;
+    }
+
+    bool suppress() const {
+        return _suppress;
+    }
+
+   private:
+    uint8_t _prefix[RFID_FILTER_MAX_PREFIXES][RFID_EPC_SIZE];
+    uint8_t _bits[RFID_FILTER_MAX_PREFIXES];
+    uint8_t _prefixCount;
+    bool _suppress;
+};
+
+#endif
@@ -0,0 +1,109 @@
+#include "LZ4_BLOCK.h"
+
+#include <string.h>
+
+#define LZ4_MIN_MATCH     4
+#define LZ4_MFLIMIT       12  // The last match starts at least this far before the end
+#define LZ4_LAST_LITERALS 5   // ... and ends at least this far before it
+#define LZ4_MAX_OFFSET    0xffff
+
+static uint32_t read32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static uint32_t hashOf(uint32_t sequence) {
+    return (sequence * 2654435761u) >> (32 - LZ4_HASH_BITS);
+}
+
+// Bytes a length of at least 15 takes after the token nibble
+static size_t extraLength(size_t n) {
+    return n < 15 ? 0 : (n - 15) / 255 + 1;
+}
+
+static uint8_t *writeLength(uint8_t *out, size_t n) {
+    for (n -= 15; n >= 255; n -= 255) {
+        *out++ = 255;
+    }
+    *out++ = (uint8_t)n;
+    return out;
+}
+
+// One sequence: literals, then a match unless it is the last one (matchLength 0)
+static bool emit(uint8_t *&out, const uint8_t *end, const uint8_t *literals, size_t literalLength, uint16_t offset,
+                 size_t matchLength) {
+    size_t code = matchLength ? matchLength - LZ4_MIN_MATCH : 0;
+    size_t need = 1 + extraLength(literalLength) + literalLength + (matchLength ? 2 + extraLength(code) : 0);
+    if (need > (size_t)(end - out)) {
+        return false;
+    }
+
+    uint8_t *token = out++;
+    *token         = (uint8_t)((literalLength < 15 ? literalLength : 15) << 4);
+    if (literalLength >= 15) {
+        out = writeLength(out, literalLength);
+    }
+    memcpy(out, literals, literalLength);
+    out += literalLength;
+
+    if (matchLength) {
+        *out++ = (uint8_t)offset;
+        *out++ = (uint8_t)(offset >> 8);
+        *token |= (uint8_t)(code < 15 ? code : 15);
+        if (code >= 15) {
+            out = writeLength(out, code);
+        }
+    }
+    return true;
+}
+
+size_t Lz4Block::compress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity, uint16_t *table) {
+    if (length > LZ4_MAX_INPUT) {
+        return 0;
+    }
+
+    uint8_t *out       = dst;
+    const uint8_t *end = dst + capacity;
+    size_t anchor      = 0;
+
+    if (length > LZ4_MFLIMIT) {
+        memset(table, 0, LZ4_HASH_SIZE * sizeof(uint16_t));
+        size_t limit = length - LZ4_MFLIMIT;
+        size_t i     = 1;
+
+        while (i < limit) {
+            uint32_t sequence = read32(src + i);
+            uint32_t h        = hashOf(sequence);
+            size_t candidate  = table[h];
+            table[h]          = (uint16_t)i;
+
+            // Empty slots point at 0, which the comparison rejects unless it really matches
+            if (i - candidate > LZ4_MAX_OFFSET || read32(src + candidate) != sequence) {
+                i++;
+                continue;
+            }
+
+            size_t matchLength = LZ4_MIN_MATCH;
+            while (i + matchLength < length - LZ4_LAST_LITERALS && src[candidate + matchLength] == src[i + matchLength]) {
+                matchLength++;
+            }
+            while (i > anchor && candidate > 0 && src[i - 1] == src[candidate - 1]) {
+                i--;
+                candidate--;
+                matchLength++;
+            }
+
+            if (!emit(out, end, src + anchor, i - anchor, (uint16_t)(i - candidate), matchLength)) {
+                return 0;
+            }
+            i += matchLength;
+            anchor = i;
+        }
+    }
+
+    if (!emit(out, end, src + anchor, length - anchor, 0, 0)) {
+        return 0;
+    }
+    return out - dst;
+}
@@ -0,0 +1,28 @@
+#ifndef _LZ4_BLOCK_H_
+#define _LZ4_BLOCK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define LZ4_HASH_BITS  12
+#define LZ4_HASH_SIZE  (1 << LZ4_HASH_BITS)  // Entries of the caller's match table (u16 each, 8KB)
+#define LZ4_MAX_INPUT  0xffff                // Positions and match offsets are u16
+
+/*
+ Encoder for the LZ4 block format: a sequence of (token, literals, offset,
+ match length) with no frame header or checksum, so any LZ4 block decoder
+ reads it (mqtt_bridge/binary_codec.py has one in pure Python).
+
+ Greedy, one hash probe per position: far from the best ratio, but a pass
+ over a 16KB batch takes well under a millisecond and nothing is allocated.
+ Batches of cycle frames compress mostly on EPCs that recur from one cycle
+ to the next. The match table is the caller's: LZ4_HASH_SIZE u16 entries.
+*/
+class Lz4Block {
+   public:
+    /*! @brief Compress length bytes (at most LZ4_MAX_INPUT) into dst.
+        @return Block length, or 0 if it would not fit in capacity.*/
+    static size_t compress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity, uint16_t *table);
+};
+
+#endif
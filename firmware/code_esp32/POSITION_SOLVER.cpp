@@ -0,0 +1,173 @@
+#include "POSITION_SOLVER.h"
+
+#include <math.h>
+
+AnchorMap::AnchorMap() : _count(0) {}
+
+bool AnchorMap::set(uint16_t mac, float x, float y) {
+    uint8_t i = 0;
+    while (i < _count && _mac[i] != mac) {
+        i++;
+    }
+    if (i == _count) {
+        if (_count >= UWB_MAX_ANCHORS) return false;
+        _count++;
+    }
+    _mac[i] = mac;
+    _x[i]   = x;
+    _y[i]   = y;
+    return true;
+}
+
+void AnchorMap::remove(uint16_t mac) {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_mac[i] == mac) {
+            _count--;
+            _mac[i] = _mac[_count];
+            _x[i]   = _x[_count];
+            _y[i]   = _y[_count];
+            return;
+        }
+    }
+}
+
+bool AnchorMap::find(uint16_t mac, float &x, float &y) const {
+    for (uint8_t i = 0; i < _count; i++) {
+        if (_mac[i] == mac) {
+            x = _x[i];
+            y = _y[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+PositionSolver::PositionSolver() : _x(0), _y(0), _vx(0), _vy(0), _last(0), _tracking(false) {}
+
+float PositionSolver::rangeWeight(const AnchorStats &stats, float distanceCm) {
+    if (stats.totalCount == 0) return 1.0f;
+
+    const float floor2 = POSITION_RANGE_SIGMA_CM * POSITION_RANGE_SIGMA_CM;
+    float variance = stats.variance();
+    if (stats.windowCount >= POSITION_GATE_MIN_WINDOW) {
+        // Spread from the window, never below the clean-link noise
+        float spread = sqrtf(variance > floor2 ? variance : floor2);
+        if (fabsf(distanceCm - stats.medianDistance()) > POSITION_OUTLIER_GATE * spread) return 0;
+    }
+    float rate = (float)stats.successCount / stats.totalCount;
+    return rate * floor2 / (floor2 + variance);
+}
+
+bool PositionSolver::linearSeed(const RangeSet &ranges, float &x, float &y) {
+    // (p - a_i)^2 - d_i^2 = (p - a_0)^2 - d_0^2 is linear in p
+    float x0 = ranges.x[0], y0 = ranges.y[0], d0 = ranges.distance[0];
+    float k0 = x0 * x0 + y0 * y0 - d0 * d0;
+    float a = 0, b = 0, c = 0, gx = 0, gy = 0;
+    for (uint8_t i = 1; i < ranges.count; i++) {
+        float w  = ranges.weight[i];
+        float ax = 2.0f * (ranges.x[i] - x0);
+        float ay = 2.0f * (ranges.y[i] - y0);
+        float r  = ranges.x[i] * ranges.x[i] + ranges.y[i] * ranges.y[i] -
+                  ranges.distance[i] * ranges.distance[i] - k0;
+        a += w * ax * ax;
+        b += w * ax * ay;
+        c += w * ay * ay;
+        gx += w * ax * r;
+        gy += w * ay * r;
+    }
+    float det = a * c - b * b;
+    if (fabsf(det) < 1e-6f * (a * c + 1.0f)) return false;  // Collinear anchors
+    x = (c * gx - b * gy) / det;
+    y = (a * gy - b * gx) / det;
+    return true;
+}
+
+bool PositionSolver::gaussNewton(const RangeSet &ranges, float &x, float &y) {
+    for (uint8_t iteration = 0; iteration < POSITION_GN_ITERATIONS; iteration++) {
+        // Normal equations H * step = -g with residual e_i = |p - a_i| - d_i
+        float a = 0, b = 0, c = 0, gx = 0, gy = 0;
+        for (uint8_t i = 0; i < ranges.count; i++) {
+            float dx    = x - ranges.x[i];
+            float dy    = y - ranges.y[i];
+            float range = sqrtf(dx * dx + dy * dy);
+            if (range < 1e-3f) continue;  // On the anchor: gradient undefined
+            float jx = dx / range;
+            float jy = dy / range;
+            float e  = range - ranges.distance[i];
+            float w  = ranges.weight[i];
+            a += w * jx * jx;
+            b += w * jx * jy;
+            c += w * jy * jy;
+            gx += w * jx * e;
+            gy += w * jy * e;
+        }
+        float det = a * c - b * b;
+        if (fabsf(det) < 1e-6f) return false;
+
+        float stepX = -(c * gx - b * gy) / det;
+        float stepY = -(a * gy - b * gx) / det;
+        x += stepX;
+        y += stepY;
+        if (stepX * stepX + stepY * stepY < POSITION_GN_TOLERANCE_CM * POSITION_GN_TOLERANCE_CM) break;
+    }
+    return isfinite(x) && isfinite(y);
+}
+
+float PositionSolver::meanResidual(const RangeSet &ranges, float x, float y) {
+    float sum = 0, weights = 0;
+    for (uint8_t i = 0; i < ranges.count; i++) {
+        float dx = x - ranges.x[i];
+        float dy = y - ranges.y[i];
+        sum += ranges.weight[i] * fabsf(sqrtf(dx * dx + dy * dy) - ranges.distance[i]);
+        weights += ranges.weight[i];
+    }
+    return weights > 0 ? sum / weights : 0;
+}
+
+bool PositionSolver::solve(const RangeSet &ranges, unsigned long now, PositionEstimate &out) {
+    if (ranges.count < POSITION_MIN_ANCHORS) return false;
+
+    bool continuing = _tracking && now - _last <= POSITION_FILTER_RESET_MS;
+    float x, y;
+    if (continuing) {
+        x = _x;
+        y = _y;
+    } else if (!linearSeed(ranges, x, y)) {
+        return false;
+    }
+
+    if (!gaussNewton(ranges, x, y)) {
+        return false;
+    }
+    float residual = meanResidual(ranges, x, y);
+
+    if (continuing) {
+        float dt = (now - _last) / 1000.0f;
+        float px = _x + _vx * dt;
+        float py = _y + _vy * dt;
+        float rx = x - px;
+        float ry = y - py;
+        _x       = px + POSITION_FILTER_ALPHA * rx;
+        _y       = py + POSITION_FILTER_ALPHA * ry;
+        if (dt > 0) {
+            _vx += POSITION_FILTER_BETA / dt * rx;
+            _vy += POSITION_FILTER_BETA / dt * ry;
+        }
+    } else {
+        _x        = x;
+        _y        = y;
+        _vx       = 0;
+        _vy       = 0;
+        _tracking = true;
+    }
+    _last = now;
+
+    out.x          = _x;
+    out.y          = _y;
+    out.confidence = expf(-residual / POSITION_CONFIDENCE_SCALE_CM);
+    out.speed      = sqrtf(_vx * _vx + _vy * _vy);
+    out.anchors    = ranges.count;
+    out.timestamp  = now;
+    out.valid      = true;
+    return true;
+}
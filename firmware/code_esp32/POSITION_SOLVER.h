@@ -0,0 +1,165 @@
+#ifndef _POSITION_SOLVER_H_
+#define _POSITION_SOLVER_H_
+
+#include <stdint.h>
+#include "ANCHOR_TABLE.h"
+
+#ifndef POSITION_MIN_ANCHORS
+#define POSITION_MIN_ANCHORS 3  // Ranges needed for a fix (two circles intersect twice)
+#endif
+
+#ifndef POSITION_GN_ITERATIONS
+#define POSITION_GN_ITERATIONS 8  // Max Gauss-Newton steps per solve
+#endif
+
+#ifndef POSITION_RANGE_SIGMA_CM
+#define POSITION_RANGE_SIGMA_CM 10.0f  // Range noise of a clean UWB link
+#endif
+
+#ifndef POSITION_OUTLIER_GATE
+#define POSITION_OUTLIER_GATE 3.0f  // Drop ranges this many spreads away from the anchor's median
+#endif
+
+#define POSITION_GATE_MIN_WINDOW     3      // Recent distances an anchor needs before its ranges are gated
+#define POSITION_GN_TOLERANCE_CM     0.5f   // Stop once a step is shorter than this
+#define POSITION_CONFIDENCE_SCALE_CM 50.0f  // Mean residual that maps to confidence 1/e (as the backend)
+
+#ifndef POSITION_FILTER_ALPHA
+#define POSITION_FILTER_ALPHA 0.5f  // Alpha-beta filter: position gain
+#endif
+
+#ifndef POSITION_FILTER_BETA
+#define POSITION_FILTER_BETA 0.1f  // Alpha-beta filter: velocity gain
+#endif
+
+#ifndef POSITION_FILTER_RESET_MS
+#define POSITION_FILTER_RESET_MS 2000  // Restart the track after a gap this long
+#endif
+
+struct PositionEstimate {
+    float x;                        // cm, store coordinates (frame of the anchor map)
+    float y;
+    float confidence;               // 0-1, exp(-mean residual / POSITION_CONFIDENCE_SCALE_CM)
+    float speed;                    // cm/s, filtered track velocity (0 on the first fix of a track)
+    uint8_t anchors;                // Ranges used
+    unsigned long timestamp;        // millis() of the UWB session
+    bool valid;
+};
+
+/*
+ Anchor coordinates keyed by short MAC, pushed over MQTT. Fixed arrays and a
+ linear search: UWB_MAX_ANCHORS is small and lookups happen a few times per
+ session. Not thread safe; the caller guards it.
+*/
+class AnchorMap {
+   public:
+    AnchorMap();
+
+    /*! @brief Add or move an anchor.
+        @return False if the map is full.*/
+    bool set(uint16_t mac, float x, float y);
+
+    void remove(uint16_t mac);
+
+    bool find(uint16_t mac, float &x, float &y) const;
+
+    uint8_t size() const {
+        return _count;
+    }
+
+    /*! @brief Anchor by position, index below size().*/
+    void at(uint8_t index, uint16_t &mac, float &x, float &y) const {
+        mac = _mac[index];
+        x   = _x[index];
+        y   = _y[index];
+    }
+
+   private:
+    uint16_t _mac[UWB_MAX_ANCHORS];
+    float _x[UWB_MAX_ANCHORS];
+    float _y[UWB_MAX_ANCHORS];
+    uint8_t _count;
+};
+
+/*
+ Ranges for one solve, as parallel arrays so the accumulation loops run over
+ contiguous floats.
+*/
+struct RangeSet {
+    float x[UWB_MAX_ANCHORS];
+    float y[UWB_MAX_ANCHORS];
+    float distance[UWB_MAX_ANCHORS];
+    float weight[UWB_MAX_ANCHORS];
+    uint8_t count;
+
+    void clear() {
+        count = 0;
+    }
+
+    bool add(float ax, float ay, float d, float w) {
+        if (count >= UWB_MAX_ANCHORS) return false;
+        x[count]        = ax;
+        y[count]        = ay;
+        distance[count] = d;
+        weight[count]   = w;
+        count++;
+        return true;
+    }
+};
+
+/*
+ 2D position from anchor ranges: weighted least squares solved by
+ Gauss-Newton, then smoothed by an alpha-beta filter.
+
+ The first fix (and every fix after a gap of POSITION_FILTER_RESET_MS) is
+ seeded by the linearized solution the backend uses (range equations minus
+ the first one); later fixes start from the filtered track. The normal
+ equations are 2x2 and solved in closed form, so nothing is allocated.
+*/
+class PositionSolver {
+   public:
+    PositionSolver();
+
+    /*! @brief Solve one session's ranges and update the track.
+        @param now millis() of the session.
+        @return False with fewer than POSITION_MIN_ANCHORS ranges or a degenerate geometry;
+                the track is unchanged.*/
+    bool solve(const RangeSet &ranges, unsigned long now, PositionEstimate &out);
+
+    /*! @brief Weight of one range from its anchor's window statistics: the success rate,
+               scaled down as the distance variance grows past POSITION_RANGE_SIGMA_CM^2.
+        @return 0 if the range is an outlier against the anchor's recent median.*/
+    static float rangeWeight(const AnchorStats &stats, float distanceCm);
+
+    /*! @brief Statistics to weigh a range by: the current cycle's once its window can gate
+               outliers, else the previous cycle's while fresh (the tables swap every cycle).
+        @param current, previous The anchor's entries in either table, or NULL.*/
+    static const AnchorStats *weightStats(const AnchorStats *current, const AnchorStats *previous,
+                                          unsigned long now) {
+        if (current != NULL && current->windowCount >= POSITION_GATE_MIN_WINDOW) return current;
+        if (previous != NULL && previous->windowCount >= POSITION_GATE_MIN_WINDOW &&
+            AnchorTable::isFresh(*previous, now)) {
+            return previous;
+        }
+        return current;
+    }
+
+    /*! @brief Forget the track (anchor map changed).*/
+    void reset() {
+        _tracking = false;
+    }
+
+   private:
+    static bool linearSeed(const RangeSet &ranges, float &x, float &y);
+    static bool gaussNewton(const RangeSet &ranges, float &x, float &y);
+    static float meanResidual(const RangeSet &ranges, float x, float y);
+
+    float _x;
+    float _y;
+    float _vx;  // cm/s
+    float _vy;
+    unsigned long _last;
+    bool _tracking;
+};
+
+#endif
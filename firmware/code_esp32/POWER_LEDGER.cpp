@@ -0,0 +1,60 @@
+#include "POWER_LEDGER.h"
+
+#include <string.h>
+
+PowerLedger::PowerLedger() : _mux(portMUX_INITIALIZER_UNLOCKED), _state(POWER_INVENTORY), _since(0) {
+    memset(_ms, 0, sizeof(_ms));
+}
+
+void PowerLedger::enter(PowerState state, unsigned long now) {
+    portENTER_CRITICAL(&_mux);
+    _ms[_state] += now - _since;
+    _since = now;
+    _state = state;
+    portEXIT_CRITICAL(&_mux);
+}
+
+void PowerLedger::collect(unsigned long now, uint32_t *ms) {
+    portENTER_CRITICAL(&_mux);
+    _ms[_state] += now - _since;
+    _since = now;
+    memcpy(ms, _ms, sizeof(_ms));
+    memset(_ms, 0, sizeof(_ms));
+    portEXIT_CRITICAL(&_mux);
+}
+
+uint16_t PowerLedger::stateMa(PowerState state) {
+    switch (state) {
+        case POWER_INVENTORY:
+            return POWER_MA_INVENTORY;
+        case POWER_REST:
+            return POWER_MA_REST;
+        case POWER_RADIO_SLEEP:
+            return POWER_MA_RADIO_SLEEP;
+        default:
+            return 0;
+    }
+}
+
+const char *PowerLedger::stateName(PowerState state) {
+    switch (state) {
+        case POWER_INVENTORY:
+            return "inventory";
+        case POWER_REST:
+            return "rest";
+        case POWER_RADIO_SLEEP:
+            return "radio_sleep";
+        default:
+            return "unknown";
+    }
+}
+
+uint16_t PowerLedger::meanMa(const uint32_t *ms) {
+    uint64_t charge = 0;  // mA * ms
+    uint64_t total  = 0;
+    for (uint8_t i = 0; i < POWER_STATE_COUNT; i++) {
+        charge += (uint64_t)ms[i] * stateMa((PowerState)i);
+        total += ms[i];
+    }
+    return total ? (uint16_t)((charge + total / 2) / total) : 0;
+}
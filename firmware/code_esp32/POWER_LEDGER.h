@@ -0,0 +1,68 @@
+#ifndef _POWER_LEDGER_H_
+#define _POWER_LEDGER_H_
+
+#include <Arduino.h>
+#include <stdint.h>
+
+// Assumed battery current of the whole cart in each state (mA). Uncalibrated placeholders,
+// not measurements: measure each board once with a bench supply and override them
+// (-DPOWER_MA_INVENTORY=...) before reading the estimate as draw.
+#ifndef POWER_MA_INVENTORY
+#define POWER_MA_INVENTORY 310  // PA on, both cores busy parsing
+#endif
+
+#ifndef POWER_MA_REST
+#define POWER_MA_REST 140  // Inventory stopped, module awake, WiFi in modem sleep
+#endif
+
+#ifndef POWER_MA_RADIO_SLEEP
+#define POWER_MA_RADIO_SLEEP 75  // Module hibernating, light sleep while the UWB line is quiet
+#endif
+
+// Where the RFID side spends its time, set by rfidTask
+enum PowerState : uint8_t {
+    POWER_INVENTORY = 0,  // The module is inventorying (or a blocking poll runs)
+    POWER_REST,           // Between polls or in an adaptive rest, module awake
+    POWER_RADIO_SLEEP,    // Adaptive rest with the module hibernated
+    POWER_STATE_COUNT
+};
+
+/*
+ Time spent in each PowerState, turned into an estimated battery current.
+ There is no current sensor on the cart: each state's draw is an assumed
+ figure (POWER_MA_*), and the report is the time-weighted mean over an
+ interval plus the share of each state, so a change in scheduling shows up
+ as a change in mA the same shift.
+
+ enter() belongs to one task (rfidTask); collect() may run in another.
+*/
+class PowerLedger {
+   public:
+    PowerLedger();
+
+    /*! @brief Switch state at now (ms); the time since the last switch goes to the old state.*/
+    void enter(PowerState state, unsigned long now);
+
+    /*! @brief Milliseconds per state since the last collect() (or boot), then start again.
+        @param ms Receives POWER_STATE_COUNT values.*/
+    void collect(unsigned long now, uint32_t *ms);
+
+    PowerState state() const {
+        return _state;
+    }
+
+    static uint16_t stateMa(PowerState state);
+
+    static const char *stateName(PowerState state);
+
+    /*! @brief Estimated time-weighted mean current of ms (as from collect()), 0 if no time passed.*/
+    static uint16_t meanMa(const uint32_t *ms);
+
+   private:
+    portMUX_TYPE _mux;
+    volatile PowerState _state;
+    unsigned long _since;
+    uint32_t _ms[POWER_STATE_COUNT];
+};
+
+#endif
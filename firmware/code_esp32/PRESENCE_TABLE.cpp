@@ -0,0 +1,380 @@
+#include "PRESENCE_TABLE.h"
+#include "CYCLE_SERIALIZER.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+// One event object: epc, event name, age and cell centre (~110 bytes)
+#define PRESENCE_FRAGMENT_SIZE 160
+
+// Index slots are uint16_t and at most 2/3 of them hold a tag
+#define PRESENCE_MAX_INDEX 32768
+#define PRESENCE_MAX_TAGS_LIMIT (PRESENCE_MAX_INDEX / 3 * 2)
+
+// Cells either side of the cart's that can hold a tag in range
+#define PRESENCE_CELL_REACH ((PRESENCE_RANGE_CM + PRESENCE_CELL_CM - 1) / PRESENCE_CELL_CM)
+
+static size_t emit(Print &out, const char *text, int length) {
+    if (length <= 0) {
+        return 0;
+    }
+    if (length >= PRESENCE_FRAGMENT_SIZE) {
+        length = PRESENCE_FRAGMENT_SIZE - 1;  // snprintf truncated; keep the count consistent with the bytes
+    }
+    return out.write((const uint8_t *)text, (size_t)length);
+}
+
+// As EpcHashSet: serial numbers differ in the trailing bytes, prefixes repeat across a rack
+static uint32_t hashEpc(const uint8_t *epc) {
+    uint32_t w[3];
+    memcpy(w, epc, sizeof(w));
+    uint32_t h = w[0] * 0x9e3779b1u ^ w[1] * 0x85ebca77u ^ w[2] * 0xc2b2ae3du;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    return h;
+}
+
+PresenceTable::PresenceTable()
+    : _entries(NULL),
+      _index(NULL),
+      _cellHeads(NULL),
+      _events(NULL),
+      _capacity(0),
+      _indexSize(0),
+      _cellCount(0),
+      _size(0),
+      _freeHead(NONE),
+      _sweepAt(0),
+      _eventHead(0),
+      _eventCount(0),
+      _droppedEvents(0),
+      _droppedTags(0),
+      _lastCycle(0),
+      _lastEpochUs(0),
+      _started(false) {}
+
+bool PresenceTable::begin(uint16_t maxTags) {
+    bool psram = psramFound();
+    if (!psram && maxTags > PRESENCE_FALLBACK_TAGS) {
+        maxTags = PRESENCE_FALLBACK_TAGS;
+    }
+    if (maxTags > PRESENCE_MAX_TAGS_LIMIT) {
+        maxTags = PRESENCE_MAX_TAGS_LIMIT;
+    }
+    if (maxTags == 0) {
+        return false;
+    }
+
+    uint32_t indexSize = 64;
+    while (indexSize * 2 < (uint32_t)maxTags * 3) {
+        indexSize <<= 1;
+    }
+    uint32_t cellCount = indexSize / 4;
+
+    size_t entryBytes = sizeof(Entry) * maxTags;
+    size_t eventBytes = sizeof(PresenceEvent) * PRESENCE_EVENT_QUEUE;
+    size_t total      = entryBytes + eventBytes + sizeof(uint16_t) * (indexSize + cellCount);
+    uint8_t *memory   = (uint8_t *)(psram ? ps_malloc(total) : malloc(total));
+    if (memory == NULL) {
+        return false;
+    }
+    _entries   = (Entry *)memory;
+    _events    = (PresenceEvent *)(memory + entryBytes);
+    _index     = (uint16_t *)(memory + entryBytes + eventBytes);
+    _cellHeads = _index + indexSize;
+    _capacity  = maxTags;
+    _indexSize = (uint16_t)indexSize;
+    _cellCount = (uint16_t)cellCount;
+
+    memset(_index, 0xff, sizeof(uint16_t) * (indexSize + cellCount));
+    for (uint16_t i = 0; i < _capacity; i++) {
+        Entry &entry   = _entries[i];
+        entry.state    = ENTRY_FREE;
+        entry.cellX    = NO_CELL;
+        entry.cellY    = NO_CELL;
+        entry.cellPrev = NONE;
+        entry.cellNext = i + 1 < _capacity ? i + 1 : NONE;
+    }
+    _freeHead = 0;
+    return true;
+}
+
+void PresenceTable::update(const CycleRecord &record) {
+    if (!enabled()) return;
+
+    unsigned long now  = record.timestamp;
+    unsigned long step = _started ? now - _lastCycle : 0;
+    if (step > PRESENCE_MAX_STEP_MS) {
+        step = PRESENCE_MAX_STEP_MS;
+    }
+    _lastCycle   = now;
+    _lastEpochUs = record.epochUs;
+    _started     = true;
+
+    bool located  = CycleSerializer::hasPosition(record);
+    int16_t cellX = located ? cellOf(record.position.x) : NO_CELL;
+    int16_t cellY = located ? cellOf(record.position.y) : NO_CELL;
+
+    for (uint16_t t = 0; t < record.tagCount; t++) {
+        const uint8_t *epc = record.tags[t].epc;
+        uint16_t i         = find(epc, NULL);
+        if (i == NONE) {
+            i = insert(epc);
+            if (i == NONE) {
+                _droppedTags++;
+                continue;
+            }
+        }
+        Entry &entry   = _entries[i];
+        entry.lastSeen = now;
+        entry.unseenMs = 0;
+        if (entry.seen < PRESENCE_SEEN_MAX) {
+            entry.seen++;
+        }
+        if (located) {
+            link(i, cellX, cellY);
+        }
+        if (entry.state != ENTRY_PRESENT && entry.seen >= PRESENCE_APPEAR_SEEN) {
+            entry.state = ENTRY_PRESENT;
+            pushEvent(entry, PRESENCE_APPEARED, now);
+        }
+    }
+
+    // A suppressed session reports only tags it has not read recently: silence proves nothing
+    if (located && !record.suppressed) {
+        markAbsent(record, step);
+    }
+    sweep(now);
+}
+
+void PresenceTable::markAbsent(const CycleRecord &record, unsigned long step) {
+    const float x      = record.position.x;
+    const float y      = record.position.y;
+    const float range2 = (float)PRESENCE_RANGE_CM * PRESENCE_RANGE_CM;
+    int16_t cartX      = cellOf(x);
+    int16_t cartY      = cellOf(y);
+    unsigned long now  = record.timestamp;
+
+    for (int dy = -PRESENCE_CELL_REACH; dy <= PRESENCE_CELL_REACH; dy++) {
+        for (int dx = -PRESENCE_CELL_REACH; dx <= PRESENCE_CELL_REACH; dx++) {
+            int16_t cellX = (int16_t)(cartX + dx);
+            int16_t cellY = (int16_t)(cartY + dy);
+            float ox      = (float)cellCentreCm(cellX) - x;
+            float oy      = (float)cellCentreCm(cellY) - y;
+            if (ox * ox + oy * oy > range2) continue;
+
+            // Cells sharing the list are skipped by the exact match
+            uint16_t i = _cellHeads[cellHead(cellX, cellY)];
+            while (i != NONE) {
+                Entry &entry  = _entries[i];
+                uint16_t next = entry.cellNext;
+                if (entry.cellX == cellX && entry.cellY == cellY && entry.lastSeen != now) {
+                    entry.seen >>= 1;
+                    if (entry.state == ENTRY_UNCONFIRMED && entry.seen == 0) {
+                        remove(i);  // A stray read, e.g. through the shelf from the next aisle
+                    } else if (entry.state == ENTRY_PRESENT) {
+                        entry.unseenMs += step;
+                        if (entry.unseenMs >= PRESENCE_MISSING_MS) {
+                            entry.state = ENTRY_MISSING;
+                            entry.seen  = 0;  // Back to present only through PRESENCE_APPEAR_SEEN reads
+                            pushEvent(entry, PRESENCE_MISSING, now);
+                        }
+                    }
+                }
+                i = next;
+            }
+        }
+    }
+}
+
+void PresenceTable::sweep(unsigned long now) {
+    for (uint16_t n = 0; n < PRESENCE_SWEEP_TAGS && n < _capacity; n++) {
+        uint16_t i   = _sweepAt;
+        _sweepAt     = _sweepAt + 1 < _capacity ? _sweepAt + 1 : 0;
+        Entry &entry = _entries[i];
+        if ((entry.state == ENTRY_UNCONFIRMED || entry.state == ENTRY_MISSING) &&
+            now - entry.lastSeen > PRESENCE_FORGET_MS) {
+            remove(i);
+        }
+    }
+}
+
+void PresenceTable::pop(uint16_t count) {
+    if (count > _eventCount) {
+        count = _eventCount;
+    }
+    _eventHead = (_eventHead + count) % PRESENCE_EVENT_QUEUE;
+    _eventCount -= count;
+}
+
+int16_t PresenceTable::cellOf(float cm) {
+    float cell = floorf(cm / PRESENCE_CELL_CM);
+    if (cell < -32767.0f) return -32767;  // NO_CELL stays out of reach
+    if (cell > 32767.0f) return 32767;
+    return (int16_t)cell;
+}
+
+uint16_t PresenceTable::home(const uint8_t *epc) const {
+    return (uint16_t)(hashEpc(epc) & (uint32_t)(_indexSize - 1));
+}
+
+uint16_t PresenceTable::cellHead(int16_t cellX, int16_t cellY) const {
+    uint32_t h = (uint16_t)cellX * 0x9e3779b1u ^ (uint16_t)cellY * 0x85ebca77u;
+    h ^= h >> 15;
+    return (uint16_t)(h & (uint32_t)(_cellCount - 1));
+}
+
+uint16_t PresenceTable::find(const uint8_t *epc, uint16_t *slot) const {
+    uint16_t mask = _indexSize - 1;
+    for (uint16_t s = home(epc);; s = (s + 1) & mask) {
+        uint16_t i = _index[s];
+        if (i == NONE) return NONE;  // The index is never full, so a probe always ends
+        if (memcmp(_entries[i].epc, epc, RFID_EPC_SIZE) == 0) {
+            if (slot) *slot = s;
+            return i;
+        }
+    }
+}
+
+uint16_t PresenceTable::insert(const uint8_t *epc) {
+    if (_freeHead == NONE) return NONE;
+
+    uint16_t i   = _freeHead;
+    Entry &entry = _entries[i];
+    _freeHead    = entry.cellNext;
+    memcpy(entry.epc, epc, RFID_EPC_SIZE);
+    entry.lastSeen = 0;
+    entry.unseenMs = 0;
+    entry.cellX    = NO_CELL;
+    entry.cellY    = NO_CELL;
+    entry.cellPrev = NONE;
+    entry.cellNext = NONE;
+    entry.seen     = 0;
+    entry.state    = ENTRY_UNCONFIRMED;
+
+    uint16_t mask = _indexSize - 1;
+    uint16_t s    = home(epc);
+    while (_index[s] != NONE) {
+        s = (s + 1) & mask;
+    }
+    _index[s] = i;
+    _size++;
+    return i;
+}
+
+void PresenceTable::remove(uint16_t index) {
+    Entry &entry = _entries[index];
+    unlink(index);
+
+    // Backward-shift deletion: pull later entries of the probe run into the hole
+    uint16_t mask = _indexSize - 1;
+    uint16_t hole;
+    if (find(entry.epc, &hole) == index) {
+        for (uint16_t s = (hole + 1) & mask; _index[s] != NONE; s = (s + 1) & mask) {
+            uint16_t wanted = home(_entries[_index[s]].epc);
+            // The entry may move back if its home is not in (hole, s] (cyclically)
+            bool stays = hole <= s ? (hole < wanted && wanted <= s) : (hole < wanted || wanted <= s);
+            if (!stays) {
+                _index[hole] = _index[s];
+                hole         = s;
+            }
+        }
+        _index[hole] = NONE;
+    }
+
+    entry.state    = ENTRY_FREE;
+    entry.cellNext = _freeHead;
+    _freeHead      = index;
+    _size--;
+}
+
+void PresenceTable::link(uint16_t index, int16_t cellX, int16_t cellY) {
+    Entry &entry = _entries[index];
+    if (entry.cellX == cellX && entry.cellY == cellY) return;
+
+    unlink(index);
+    uint16_t head  = cellHead(cellX, cellY);
+    entry.cellX    = cellX;
+    entry.cellY    = cellY;
+    entry.cellPrev = NONE;
+    entry.cellNext = _cellHeads[head];
+    if (entry.cellNext != NONE) {
+        _entries[entry.cellNext].cellPrev = index;
+    }
+    _cellHeads[head] = index;
+}
+
+void PresenceTable::unlink(uint16_t index) {
+    Entry &entry = _entries[index];
+    if (entry.cellX == NO_CELL) return;
+
+    if (entry.cellPrev != NONE) {
+        _entries[entry.cellPrev].cellNext = entry.cellNext;
+    } else {
+        _cellHeads[cellHead(entry.cellX, entry.cellY)] = entry.cellNext;
+    }
+    if (entry.cellNext != NONE) {
+        _entries[entry.cellNext].cellPrev = entry.cellPrev;
+    }
+    entry.cellX    = NO_CELL;
+    entry.cellY    = NO_CELL;
+    entry.cellPrev = NONE;
+    entry.cellNext = NONE;
+}
+
+void PresenceTable::pushEvent(const Entry &entry, PresenceEventType type, unsigned long now) {
+    if (_eventCount == PRESENCE_EVENT_QUEUE) {
+        _eventHead = (_eventHead + 1) % PRESENCE_EVENT_QUEUE;
+        _eventCount--;
+        _droppedEvents++;
+    }
+    PresenceEvent &event = _events[(_eventHead + _eventCount) % PRESENCE_EVENT_QUEUE];
+    memcpy(event.epc, entry.epc, RFID_EPC_SIZE);
+    event.timestamp = now;
+    event.cellX     = entry.cellX;
+    event.cellY     = entry.cellY;
+    event.type      = type;
+    _eventCount++;
+}
+
+size_t PresenceTable::writeJson(Print &out, uint16_t count) const {
+    char fragment[PRESENCE_FRAGMENT_SIZE];
+    unsigned long now = _lastCycle;
+    size_t n = emit(out, fragment, snprintf(fragment, sizeof(fragment), "{\"timestamp\":%lu", (unsigned long)now));
+    if (_lastEpochUs) {
+        n += emit(out, fragment,
+                  snprintf(fragment, sizeof(fragment), ",\"epoch_us\":%llu", (unsigned long long)_lastEpochUs));
+    }
+    n += out.write((const uint8_t *)",\"events\":[", 11);
+
+    if (count > _eventCount) {
+        count = _eventCount;
+    }
+    for (uint16_t i = 0; i < count; i++) {
+        const PresenceEvent &e = event(i);
+        char epcHex[RFID_EPC_HEX_SIZE];
+        Unit_UHF_RFID::formatHex(e.epc, RFID_EPC_SIZE, epcHex);
+        int length = snprintf(fragment, sizeof(fragment), "%s{\"epc\":\"%s\",\"event\":\"%s\",\"age_ms\":%lu",
+                              i ? "," : "", epcHex, e.type == PRESENCE_MISSING ? "missing" : "appeared",
+                              (unsigned long)(now - e.timestamp));
+        if (e.cellX != NO_CELL && length > 0 && length < (int)sizeof(fragment)) {
+            length += snprintf(fragment + length, sizeof(fragment) - length, ",\"x_cm\":%ld,\"y_cm\":%ld",
+                               (long)cellCentreCm(e.cellX), (long)cellCentreCm(e.cellY));
+        }
+        if (length > 0 && length < (int)sizeof(fragment)) {
+            length += snprintf(fragment + length, sizeof(fragment) - length, "}");
+        }
+        n += emit(out, fragment, length);
+    }
+
+    n += emit(out, fragment,
+              snprintf(fragment, sizeof(fragment), "],\"dropped\":%lu}", (unsigned long)_droppedEvents));
+    return n;
+}
+
+size_t PresenceTable::measureJson(uint16_t count) const {
+    CountingPrint counter;
+    return writeJson(counter, count);
+}
@@ -0,0 +1,202 @@
+#ifndef _PRESENCE_TABLE_H_
+#define _PRESENCE_TABLE_H_
+
+#include <Arduino.h>
+#include <stdint.h>
+#include "CYCLE_RECORD.h"
+
+#ifndef PRESENCE_FALLBACK_TAGS
+#define PRESENCE_FALLBACK_TAGS 1024  // Table size when the board has no PSRAM
+#endif
+
+#ifndef PRESENCE_CELL_CM
+#define PRESENCE_CELL_CM 50  // Position bucket: a tag is placed in the cell the cart was in when it was read
+#endif
+
+#ifndef PRESENCE_RANGE_CM
+#define PRESENCE_RANGE_CM 150  // A tag's cell this close to the cart is in reading range
+#endif
+
+#ifndef PRESENCE_APPEAR_SEEN
+#define PRESENCE_APPEAR_SEEN 2  // Seen count that makes a new (or missing) tag present
+#endif
+
+#ifndef PRESENCE_MISSING_MS
+#define PRESENCE_MISSING_MS 6000  // Time in range without a read that makes a present tag missing
+#endif
+
+#ifndef PRESENCE_MAX_STEP_MS
+#define PRESENCE_MAX_STEP_MS 1000  // A longer gap between cycles (rest, outage) counts as this much time in range
+#endif
+
+#ifndef PRESENCE_FORGET_MS
+#define PRESENCE_FORGET_MS (30UL * 60UL * 1000UL)  // Unconfirmed and missing tags unseen this long are dropped
+#endif
+
+#ifndef PRESENCE_SWEEP_TAGS
+#define PRESENCE_SWEEP_TAGS 256  // Entries checked for PRESENCE_FORGET_MS per cycle
+#endif
+
+#ifndef PRESENCE_EVENT_QUEUE
+#define PRESENCE_EVENT_QUEUE 512  // Unpublished events; the oldest is dropped when full
+#endif
+
+#define PRESENCE_SEEN_MAX 15
+
+enum PresenceEventType : uint8_t {
+    PRESENCE_APPEARED = 0,  // New tag read PRESENCE_APPEAR_SEEN times, or a missing tag read again
+    PRESENCE_MISSING        // Present tag not read for PRESENCE_MISSING_MS while the cart was in range
+};
+
+struct PresenceEvent {
+    uint8_t epc[RFID_EPC_SIZE];
+    unsigned long timestamp;  // millis(): the cycle that decided it
+    int16_t cellX;            // Tag's cell, PresenceTable::NO_CELL if it was never read with a fix
+    int16_t cellY;
+    PresenceEventType type;
+};
+
+/*
+ Edge-side inventory state: what the reader believes is on the shelves of
+ the zone it is working, so it can publish state changes instead of every
+ read and the backend does not have to infer missing items from raw cycles.
+
+ One entry per EPC: when it was last read, a seen count that climbs with
+ every cycle that reads it and halves with every cycle in range that does
+ not, and the cell (PRESENCE_CELL_CM grid of the store frame) the cart was
+ in when it was last read. A tag goes
+   - unconfirmed -> present: seen count reaches PRESENCE_APPEAR_SEEN (APPEARED);
+     an unconfirmed stray read whose count decays to 0 is dropped silently
+   - present -> missing: in range for PRESENCE_MISSING_MS in total without
+     a single read (MISSING)
+   - missing -> present: seen count reaches PRESENCE_APPEAR_SEEN again (APPEARED)
+ "In range" needs a fresh fix: a tag's cell within PRESENCE_RANGE_CM of the
+ cart. Only cycles without session suppression count, since a suppressed
+ tag stays silent while present (INVENTORY_FILTER.h); without UWB a tag can
+ appear but never go missing.
+
+ Storage is one block (PSRAM when found): the entries, an open-addressing
+ EPC index (linear probing, backward-shift deletion, at most 2/3 full), a
+ hashed grid of cell lists, so a cycle touches its tags and the cells
+ around the cart rather than the whole table, and the event queue.
+
+ Not thread safe; one task (outputTask) owns it.
+*/
+class PresenceTable {
+   public:
+    static const int16_t NO_CELL = INT16_MIN;
+
+    PresenceTable();
+
+    /*! @brief Allocate for maxTags entries (capped at PRESENCE_FALLBACK_TAGS without PSRAM).
+        @return False if the block could not be allocated.*/
+    bool begin(uint16_t maxTags);
+
+    bool enabled() const {
+        return _entries != NULL;
+    }
+
+    /*! @brief Fold one cycle in: its reads, then the absences in range of its fix.*/
+    void update(const CycleRecord &record);
+
+    /*! @brief Tags tracked (any state).*/
+    uint16_t size() const {
+        return _size;
+    }
+
+    uint16_t capacity() const {
+        return _capacity;
+    }
+
+    /*! @brief Events waiting to be published.*/
+    uint16_t pending() const {
+        return _eventCount;
+    }
+
+    /*! @brief The i-th oldest pending event.*/
+    const PresenceEvent &event(uint16_t i) const {
+        return _events[(_eventHead + i) % PRESENCE_EVENT_QUEUE];
+    }
+
+    /*! @brief Discard the count oldest events (published).*/
+    void pop(uint16_t count);
+
+    /*! @brief Events lost to a full queue since boot.*/
+    uint32_t droppedEvents() const {
+        return _droppedEvents;
+    }
+
+    /*! @brief New tags not tracked because the table was full, since boot.*/
+    uint32_t droppedTags() const {
+        return _droppedTags;
+    }
+
+    /*! @brief Cell a position falls in (store frame, cm).*/
+    static int16_t cellOf(float cm);
+
+    /*! @brief Centre of a cell, cm.*/
+    static int32_t cellCentreCm(int16_t cell) {
+        return (int32_t)cell * PRESENCE_CELL_CM + PRESENCE_CELL_CM / 2;
+    }
+
+    /*! @brief Write count pending events, oldest first, as compact JSON:
+        {"timestamp":T,"epoch_us":E,"events":[{"epc":"e200...","event":"appeared","age_ms":0,
+                                               "x_cm":425,"y_cm":175}],"dropped":D}
+        timestamp and epoch_us are those of the last cycle folded in (epoch_us left out until
+        SNTP has synced), age_ms is before timestamp; x_cm/y_cm, the centre of the tag's cell,
+        are left out for a tag never read with a fix. dropped counts events lost since boot.
+        @return Number of bytes produced.*/
+    size_t writeJson(Print &out, uint16_t count) const;
+
+    /*! @brief Length writeJson() will produce.*/
+    size_t measureJson(uint16_t count) const;
+
+   private:
+    static const uint16_t NONE = 0xffff;
+
+    enum EntryState : uint8_t { ENTRY_FREE = 0, ENTRY_UNCONFIRMED, ENTRY_PRESENT, ENTRY_MISSING };
+
+    struct Entry {
+        uint8_t epc[RFID_EPC_SIZE];
+        unsigned long lastSeen;  // millis() of the cycle that last read it
+        uint32_t unseenMs;       // Time in range since the last read
+        int16_t cellX;
+        int16_t cellY;
+        uint16_t cellPrev;       // Neighbours in the cell list, or NONE; next free entry while ENTRY_FREE
+        uint16_t cellNext;
+        uint8_t seen;
+        EntryState state;
+    };
+
+    uint16_t find(const uint8_t *epc, uint16_t *slot) const;
+    uint16_t insert(const uint8_t *epc);
+    void remove(uint16_t index);
+    void link(uint16_t index, int16_t cellX, int16_t cellY);
+    void unlink(uint16_t index);
+    void pushEvent(const Entry &entry, PresenceEventType type, unsigned long now);
+    void markAbsent(const CycleRecord &record, unsigned long step);
+    void sweep(unsigned long now);
+
+    uint16_t home(const uint8_t *epc) const;
+    uint16_t cellHead(int16_t cellX, int16_t cellY) const;
+
+    Entry *_entries;
+    uint16_t *_index;        // _indexSize slots: entry number or NONE
+    uint16_t *_cellHeads;    // _cellCount lists; cells that hash alike share one
+    PresenceEvent *_events;  // PRESENCE_EVENT_QUEUE ring
+    uint16_t _capacity;
+    uint16_t _indexSize;
+    uint16_t _cellCount;
+    uint16_t _size;
+    uint16_t _freeHead;
+    uint16_t _sweepAt;
+    uint16_t _eventHead;
+    uint16_t _eventCount;
+    uint32_t _droppedEvents;
+    uint32_t _droppedTags;
+    unsigned long _lastCycle;
+    uint64_t _lastEpochUs;
+    bool _started;
+};
+
+#endif
@@ -194,7 +194,9 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
         }
 
         if (result == 1) {
-            nextMsgId = 1;
+            if (inflightCount == 0) {
+                nextMsgId = 1;  // Keep ids of unacknowledged publishes unique
+            }
             // Leave room in the buffer for header and variable length field
             uint16_t length = MQTT_MAX_HEADER_SIZE;
             unsigned int j;
@@ -270,7 +272,7 @@ boolean PubSubClient::connect(const char *id, const char *user, const char *pass
                     lastInActivity = millis();
                     pingOutstanding = false;
                     _state = MQTT_CONNECTED;
-                    return true;
+                    return resendInflight();
                 } else {
                     _state = buffer[3];
                 }
@@ -416,6 +418,17 @@ boolean PubSubClient::loop() {
                             callback(topic,payload,len-llen-3-tl);
                         }
                     }
+                } else if (type == MQTTPUBACK) {
+                    msgId = (this->buffer[llen+1]<<8)+this->buffer[llen+2];
+                    for (uint8_t i = 0; i < inflightCount; i++) {
+                        InflightPacket &packet = inflight[(inflightHead + i) % MQTT_MAX_INFLIGHT];
+                        if (packet.msgId == msgId && !packet.acked) {
+                            packet.acked = true;
+                            inflightAcks++;
+                            break;
+                        }
+                    }
+                    releaseAcked();
                 } else if (type == MQTTPINGREQ) {
                     this->buffer[0] = MQTTPINGRESP;
                     this->buffer[1] = 0;
@@ -523,6 +536,47 @@ boolean PubSubClient::publish_P(const char* topic, const uint8_t* payload, unsig
     return (rc == expectedLength);
 }
 
+boolean PubSubClient::publish(const char* topic, const MQTTPayloadSpan* spans, uint8_t count, boolean retained) {
+    return publish(topic, spans, count, 0, retained);
+}
+
+boolean PubSubClient::publish(const char* topic, const MQTTPayloadSpan* spans, uint8_t count, uint8_t qos, boolean retained) {
+    size_t plength = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        plength += spans[i].length;
+    }
+    if (!beginPublish(topic, plength, qos, retained)) {
+        return false;
+    }
+
+    boolean written = true;
+    for (uint8_t i = 0; i < count; i++) {
+        // Keep going after a short write so a QoS 1 copy is still complete
+        written = writeSpan(spans[i].data, spans[i].length) && written;
+    }
+    boolean accepted = endPublish();
+    if (!written) {
+        _state = MQTT_CONNECTION_LOST;
+        _client->stop();
+    }
+    return accepted && (written || qos > 0);
+}
+
+boolean PubSubClient::writeSpan(const uint8_t* data, size_t length) {
+    boolean result = true;
+    while (length > 0) {
+#ifdef MQTT_MAX_TRANSFER_SIZE
+        size_t bytesToWrite = (length > MQTT_MAX_TRANSFER_SIZE)?MQTT_MAX_TRANSFER_SIZE:length;
+#else
+        size_t bytesToWrite = length;
+#endif
+        result = (write(data, bytesToWrite) == bytesToWrite) && result;
+        data += bytesToWrite;
+        length -= bytesToWrite;
+    }
+    return result;
+}
+
 boolean PubSubClient::beginPublish(const char* topic, unsigned int plength, boolean retained) {
     if (connected()) {
         // Send the header and variable length field
@@ -540,20 +594,174 @@ boolean PubSubClient::beginPublish(const char* topic, unsigned int plength, bool
     return false;
 }
 
+boolean PubSubClient::beginPublish(const char* topic, unsigned int plength, uint8_t qos, boolean retained) {
+    if (qos == 0) {
+        return beginPublish(topic, plength, retained);
+    }
+    if (qos > 1 || inflightStreaming || !connected()) {
+        return false;
+    }
+    int32_t offset = reserveInflight(publishLength(topic, plength, qos), true);
+    if (offset < 0) {
+        return false;
+    }
+
+    uint16_t length = MQTT_MAX_HEADER_SIZE;
+    length = writeString(topic,this->buffer,length);
+    nextMsgId++;
+    if (nextMsgId == 0) {
+        nextMsgId = 1;
+    }
+    this->buffer[length++] = (nextMsgId >> 8);
+    this->buffer[length++] = (nextMsgId & 0xFF);
+    uint8_t header = MQTTPUBLISH | MQTTQOS1;
+    if (retained) {
+        header |= 1;
+    }
+    size_t hlen = buildHeader(header, this->buffer, plength+length-MQTT_MAX_HEADER_SIZE);
+
+    InflightPacket &packet = inflight[(inflightHead + inflightCount - 1) % MQTT_MAX_INFLIGHT];
+    packet.msgId = nextMsgId;
+    inflightFill = 0;
+    inflightStreaming = true;
+
+    // The header goes into the window too, so a resend is a plain copy
+    const uint8_t* start = this->buffer+(MQTT_MAX_HEADER_SIZE-hlen);
+    uint16_t headerLength = length-(MQTT_MAX_HEADER_SIZE-hlen);
+    captureInflight(start, headerLength);
+    uint16_t rc = _client->write(start, headerLength);
+    lastOutActivity = millis();
+    if (rc != headerLength) {
+        inflightStreaming = false;
+        dropNewestInflight();
+        return false;
+    }
+    return true;
+}
+
 int PubSubClient::endPublish() {
- return 1;
+    if (!inflightStreaming) {
+        return 1;
+    }
+    inflightStreaming = false;
+
+    uint8_t last = (inflightHead + inflightCount - 1) % MQTT_MAX_INFLIGHT;
+    if (inflightFill != inflight[last].length) {
+        // Payload shorter than announced: the packet cannot be resent, drop it
+        dropNewestInflight();
+        return 0;
+    }
+    return 1;
+}
+
+void PubSubClient::dropNewestInflight() {
+    inflightCount--;
+    inflightTail = inflight[(inflightHead + inflightCount) % MQTT_MAX_INFLIGHT].offset;
+    if (inflightCount == 0) {
+        inflightTail = 0;
+    }
+    releaseAcked();
 }
 
 size_t PubSubClient::write(uint8_t data) {
     lastOutActivity = millis();
+    captureInflight(&data, 1);
     return _client->write(data);
 }
 
 size_t PubSubClient::write(const uint8_t *buffer, size_t size) {
     lastOutActivity = millis();
+    captureInflight(buffer, size);
     return _client->write(buffer,size);
 }
 
+void PubSubClient::captureInflight(const uint8_t* data, size_t size) {
+    if (!inflightStreaming) {
+        return;
+    }
+    const InflightPacket &packet = inflight[(inflightHead + inflightCount - 1) % MQTT_MAX_INFLIGHT];
+    if (size > packet.length - inflightFill) {
+        size = packet.length - inflightFill;
+    }
+    memcpy(inflightBuffer + packet.offset + inflightFill, data, size);
+    inflightFill += size;
+}
+
+uint32_t PubSubClient::publishLength(const char* topic, unsigned int plength, uint8_t qos) {
+    uint32_t remaining = 2 + strnlen(topic, this->bufferSize) + (qos ? 2 : 0) + plength;
+    uint32_t lengthBytes = 1;
+    for (uint32_t len = remaining >> 7; len > 0; len >>= 7) {
+        lengthBytes++;
+    }
+    return 1 + lengthBytes + remaining;
+}
+
+// Find contiguous room for a packet after the newest one (wrapping to offset 0 if
+// needed) and, if commit, append a slot for it. Returns the offset or -1.
+int32_t PubSubClient::reserveInflight(uint32_t length, boolean commit) {
+    if (inflightBuffer == NULL || length > inflightSize || inflightCount == MQTT_MAX_INFLIGHT) {
+        return -1;
+    }
+    uint32_t oldest = inflightCount ? inflight[inflightHead].offset : 0;
+    uint32_t tail = inflightCount ? inflightTail : 0;
+    uint32_t at;
+    if (inflightCount > 0 && tail <= oldest) {
+        if (oldest - tail < length) return -1;
+        at = tail;
+    } else if (inflightSize - tail >= length) {
+        at = tail;
+    } else if (oldest >= length) {
+        at = 0;
+    } else {
+        return -1;
+    }
+
+    if (commit) {
+        InflightPacket &packet = inflight[(inflightHead + inflightCount) % MQTT_MAX_INFLIGHT];
+        packet.msgId = 0;
+        packet.acked = false;
+        packet.offset = at;
+        packet.length = length;
+        inflightCount++;
+        inflightTail = at + length;
+    }
+    return (int32_t)at;
+}
+
+void PubSubClient::releaseAcked() {
+    // Slots are freed oldest first; an out-of-order PUBACK waits for the ones before it
+    while (inflightCount > 0 && inflight[inflightHead].acked) {
+        if (inflightStreaming && inflightCount == 1) {
+            break;
+        }
+        inflightHead = (inflightHead + 1) % MQTT_MAX_INFLIGHT;
+        inflightCount--;
+    }
+    if (inflightCount == 0) {
+        inflightTail = 0;
+    }
+}
+
+boolean PubSubClient::resendInflight() {
+    inflightStreaming = false;
+    for (uint8_t i = 0; i < inflightCount; i++) {
+        InflightPacket &packet = inflight[(inflightHead + i) % MQTT_MAX_INFLIGHT];
+        if (packet.acked) {
+            continue;
+        }
+        uint8_t* data = inflightBuffer + packet.offset;
+        data[0] |= MQTTDUP;
+        if (_client->write(data, packet.length) != packet.length) {
+            _state = MQTT_CONNECTION_LOST;
+            _client->stop();
+            return false;
+        }
+        inflightResends++;
+        lastOutActivity = millis();
+    }
+    return true;
+}
+
 size_t PubSubClient::buildHeader(uint8_t header, uint8_t* buf, uint16_t length) {
     uint8_t lenBuf[4];
     uint8_t llen = 0;
@@ -756,6 +964,41 @@ boolean PubSubClient::setBufferSize(uint16_t size) {
     return (this->buffer != NULL);
 }
 
+PubSubClient& PubSubClient::setInflightBuffer(uint8_t* buffer, uint32_t size) {
+    this->inflightBuffer = buffer;
+    this->inflightSize = buffer ? size : 0;
+    clearInflight();
+    return *this;
+}
+
+boolean PubSubClient::inflightReady(const char* topic, unsigned int plength) {
+    return !inflightStreaming && reserveInflight(publishLength(topic, plength, 1), false) >= 0;
+}
+
+boolean PubSubClient::inflightFits(const char* topic, unsigned int plength) {
+    return inflightBuffer != NULL && publishLength(topic, plength, 1) <= inflightSize;
+}
+
+uint8_t PubSubClient::inflightPending() {
+    return inflightCount;
+}
+
+uint32_t PubSubClient::inflightAcked() {
+    return inflightAcks;
+}
+
+uint32_t PubSubClient::inflightResent() {
+    return inflightResends;
+}
+
+void PubSubClient::clearInflight() {
+    inflightHead = 0;
+    inflightCount = 0;
+    inflightTail = 0;
+    inflightFill = 0;
+    inflightStreaming = false;
+}
+
 uint16_t PubSubClient::getBufferSize() {
     return this->bufferSize;
 }
@@ -36,6 +36,12 @@
 #define MQTT_SOCKET_TIMEOUT 15
 #endif
 
+// MQTT_MAX_INFLIGHT : QoS 1 publishes awaiting PUBACK. Payload copies live in the
+//  buffer given to setInflightBuffer().
+#ifndef MQTT_MAX_INFLIGHT
+#define MQTT_MAX_INFLIGHT 4
+#endif
+
 // MQTT_MAX_TRANSFER_SIZE : limit how much data is passed to the network client
 //  in each write call. Needed for the Arduino Wifi Shield. Leave undefined to
 //  pass the entire MQTT packet in each write call.
@@ -72,6 +78,7 @@
 #define MQTTQOS0        (0 << 1)
 #define MQTTQOS1        (1 << 1)
 #define MQTTQOS2        (2 << 1)
+#define MQTTDUP         (1 << 3)
 
 // Maximum size of fixed header and variable length size header
 #define MQTT_MAX_HEADER_SIZE 5
@@ -83,6 +90,12 @@
 #define MQTT_CALLBACK_SIGNATURE void (*callback)(char*, uint8_t*, unsigned int)
 #endif
 
+// Caller-owned part of a publish payload, written to the network client without staging
+struct MQTTPayloadSpan {
+   const uint8_t* data;
+   size_t length;
+};
+
 #define CHECK_STRING_LENGTH(l,s) if (l+2+strnlen(s, this->bufferSize) > this->bufferSize) {_client->stop();return false;}
 
 class PubSubClient : public Print {
@@ -107,6 +120,31 @@ private:
    // Note: the header is built at the end of the first MQTT_MAX_HEADER_SIZE bytes, so will start
    //       (MQTT_MAX_HEADER_SIZE - <returned size>) bytes into the buffer
    size_t buildHeader(uint8_t header, uint8_t* buf, uint16_t length);
+   // QoS 1 in-flight window: each packet is copied into inflightBuffer (no wrap,
+   // oldest first) and kept until its PUBACK, then resent with DUP after a reconnect
+   struct InflightPacket {
+      uint16_t msgId;
+      boolean acked;
+      uint32_t offset;
+      uint32_t length;
+   };
+   InflightPacket inflight[MQTT_MAX_INFLIGHT];
+   uint8_t inflightHead = 0;
+   uint8_t inflightCount = 0;
+   uint8_t* inflightBuffer = NULL;
+   uint32_t inflightSize = 0;
+   uint32_t inflightTail = 0;
+   uint32_t inflightFill = 0;         // Bytes captured of the packet being streamed
+   boolean inflightStreaming = false; // Between a QoS 1 beginPublish() and endPublish()
+   uint32_t inflightAcks = 0;
+   uint32_t inflightResends = 0;
+   int32_t reserveInflight(uint32_t length, boolean commit);
+   uint32_t publishLength(const char* topic, unsigned int plength, uint8_t qos);
+   void captureInflight(const uint8_t* data, size_t size);
+   void releaseAcked();
+   void dropNewestInflight();
+   boolean writeSpan(const uint8_t* data, size_t length);
+   boolean resendInflight();
    IPAddress ip;
    const char* domain;
    uint16_t port;
@@ -154,6 +192,12 @@ public:
    boolean publish(const char* topic, const uint8_t * payload, unsigned int plength, boolean retained);
    boolean publish_P(const char* topic, const char* payload, boolean retained);
    boolean publish_P(const char* topic, const uint8_t * payload, unsigned int plength, boolean retained);
+   // Scatter/gather publish: the payload is the concatenation of the spans, written in place
+   // (in MQTT_MAX_TRANSFER_SIZE pieces if defined), so the buffer only has to hold the topic.
+   // A short write stops the connection, since the broker is left mid-packet.
+   // At QoS 1 returns true once the packet is held in the in-flight window.
+   boolean publish(const char* topic, const MQTTPayloadSpan* spans, uint8_t count, boolean retained);
+   boolean publish(const char* topic, const MQTTPayloadSpan* spans, uint8_t count, uint8_t qos, boolean retained);
    // Start to publish a message.
    // This API:
    //   beginPublish(...)
@@ -163,14 +207,31 @@ public:
    // a new buffer and held in memory at one time
    // Returns 1 if the message was started successfully, 0 if there was an error
    boolean beginPublish(const char* topic, unsigned int plength, boolean retained);
+   // As above at QoS 0 or 1. A QoS 1 publish takes a window slot and its packet is copied
+   // into the in-flight buffer as it is written; it is released by PUBACK in loop() and
+   // resent (DUP) after the next successful connect(). Returns 0 if the window is full.
+   boolean beginPublish(const char* topic, unsigned int plength, uint8_t qos, boolean retained);
    // Finish off this publish message (started with beginPublish)
    // Returns 1 if the packet was sent successfully, 0 if there was an error
+   // At QoS 1, returns 1 once the whole packet is held in the window (delivery is then
+   // retried by the client even if this connection fails)
    int endPublish();
    // Write a single byte of payload (only to be used with beginPublish/endPublish)
    virtual size_t write(uint8_t);
    // Write size bytes from buffer into the payload (only to be used with beginPublish/endPublish)
    // Returns the number of bytes written
    virtual size_t write(const uint8_t *buffer, size_t size);
+   // QoS 1 window storage, owned by the caller. Without it QoS 1 publishes are refused.
+   PubSubClient& setInflightBuffer(uint8_t* buffer, uint32_t size);
+   // True if a QoS 1 publish of this size would be accepted now
+   boolean inflightReady(const char* topic, unsigned int plength);
+   // True if a QoS 1 publish of this size fits in an empty window
+   boolean inflightFits(const char* topic, unsigned int plength);
+   uint8_t inflightPending();
+   uint32_t inflightAcked();
+   uint32_t inflightResent();
+   // Forget all unacknowledged publishes
+   void clearInflight();
    boolean subscribe(const char* topic);
    boolean subscribe(const char* topic, uint8_t qos);
    boolean unsubscribe(const char* topic);
@@ -0,0 +1,176 @@
+#include "READER_CONFIG.h"
+#include "CYCLE_SERIALIZER.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+// The whole ack fits one fragment (~200 bytes)
+#define READER_CONFIG_FRAGMENT_SIZE 256
+
+// The schema: one row per key, values of 1 or 2 bytes
+struct ConfigField {
+    const char *key;
+    uint8_t offset;
+    uint8_t size;
+    uint16_t min;
+    uint16_t max;
+};
+
+#define CONFIG_FIELD(key, member, min, max) \
+    {key, offsetof(ReaderConfig, member), sizeof(((ReaderConfig *)0)->member), min, max}
+
+static const ConfigField FIELDS[] = {
+    CONFIG_FIELD("poll_count", pollCount, 1, 100),
+    CONFIG_FIELD("window_ms", windowMs, 100, 10000),
+    CONFIG_FIELD("tx_power", txPower, READER_CONFIG_MIN_TX_POWER, 3000),
+    CONFIG_FIELD("uwb_fresh_ms", uwbFreshnessMs, 100, 60000),
+    CONFIG_FIELD("region", region, 1, 4),
+    CONFIG_FIELD("mixer_gain", mixerGain, 0, 6),
+    CONFIG_FIELD("if_gain", ifGain, 0, 7),
+    CONFIG_FIELD("threshold", threshold, 0, 0xffff),
+};
+static const uint8_t FIELD_COUNT = sizeof(FIELDS) / sizeof(FIELDS[0]);
+
+static uint16_t fieldValue(const ReaderConfig &config, const ConfigField &field) {
+    const uint8_t *at = (const uint8_t *)&config + field.offset;
+    return field.size == 1 ? *at : *(const uint16_t *)at;
+}
+
+static void setField(ReaderConfig &config, const ConfigField &field, uint16_t value) {
+    uint8_t *at = (uint8_t *)&config + field.offset;
+    if (field.size == 1) {
+        *at = (uint8_t)value;
+    } else {
+        *(uint16_t *)at = value;
+    }
+}
+
+static bool isSeparator(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// Decimal digits only; false if empty, not a number or above max
+static bool parseNumber(const char *text, size_t size, uint32_t max, uint32_t &value) {
+    if (size == 0 || size > 10) return false;
+    uint64_t number = 0;
+    for (size_t i = 0; i < size; i++) {
+        if (text[i] < '0' || text[i] > '9') return false;
+        number = number * 10 + (text[i] - '0');
+    }
+    if (number > max) return false;
+    value = (uint32_t)number;
+    return true;
+}
+
+ReaderConfigStatus parseReaderConfig(const char *text, size_t length, const ReaderConfig &defaults,
+                                     ReaderConfig &config) {
+    ReaderConfig next = config;
+    bool versioned    = false;
+    uint32_t revision = 0;
+    size_t i          = 0;
+    while (i < length) {
+        if (isSeparator(text[i])) {
+            i++;
+            continue;
+        }
+        size_t start = i;
+        while (i < length && !isSeparator(text[i])) {
+            i++;
+        }
+        const char *token = text + start;
+        size_t size       = i - start;
+
+        if (size == 8 && memcmp(token, "DEFAULTS", 8) == 0) {
+            next = defaults;  // Keys after it apply on top
+            continue;
+        }
+
+        const char *equals = (const char *)memchr(token, '=', size);
+        if (!equals) return CONFIG_BAD_KEY;
+        size_t keySize    = equals - token;
+        const char *value = equals + 1;
+        size_t valueSize  = size - keySize - 1;
+
+        uint32_t number;
+        if (keySize == 1 && token[0] == 'v') {
+            if (!parseNumber(value, valueSize, 0xffff, number) || number != READER_CONFIG_VERSION) {
+                return CONFIG_BAD_VERSION;
+            }
+            versioned = true;
+            continue;
+        }
+        if (keySize == 3 && memcmp(token, "rev", 3) == 0) {
+            if (!parseNumber(value, valueSize, 0xffffffffUL, revision)) return CONFIG_BAD_VALUE;
+            continue;
+        }
+
+        const ConfigField *field = NULL;
+        for (uint8_t f = 0; f < FIELD_COUNT; f++) {
+            if (strlen(FIELDS[f].key) == keySize && memcmp(FIELDS[f].key, token, keySize) == 0) {
+                field = &FIELDS[f];
+                break;
+            }
+        }
+        if (!field) return CONFIG_BAD_KEY;
+        if (!parseNumber(value, valueSize, field->max, number) || number < field->min) return CONFIG_BAD_VALUE;
+        setField(next, *field, (uint16_t)number);
+    }
+
+    if (!versioned) return CONFIG_BAD_VERSION;
+    if (revision == 0) return CONFIG_NO_REVISION;
+    next.revision = revision;
+    config        = next;
+    return CONFIG_APPLIED;
+}
+
+bool readerConfigValid(const ReaderConfig &config) {
+    for (uint8_t f = 0; f < FIELD_COUNT; f++) {
+        uint16_t value = fieldValue(config, FIELDS[f]);
+        if (value < FIELDS[f].min || value > FIELDS[f].max) return false;
+    }
+    return true;
+}
+
+const char *readerConfigStatusName(ReaderConfigStatus status) {
+    switch (status) {
+        case CONFIG_APPLIED:
+            return "applied";
+        case CONFIG_CURRENT:
+            return "current";
+        case CONFIG_FAILED:
+            return "failed";
+        case CONFIG_BAD_VERSION:
+            return "bad_version";
+        case CONFIG_BAD_KEY:
+            return "bad_key";
+        case CONFIG_BAD_VALUE:
+            return "bad_value";
+        case CONFIG_NO_REVISION:
+            return "no_revision";
+        default:
+            return "unknown";
+    }
+}
+
+size_t ReaderConfigAck::writeJson(Print &out) const {
+    char fragment[READER_CONFIG_FRAGMENT_SIZE];
+    int length = snprintf(fragment, sizeof(fragment), "{\"config\":{\"status\":\"%s\",\"request\":%lu,\"v\":%u,\"rev\":%lu",
+                          readerConfigStatusName(status), (unsigned long)request, READER_CONFIG_VERSION,
+                          (unsigned long)config.revision);
+    for (uint8_t f = 0; f < FIELD_COUNT && length > 0 && length < (int)sizeof(fragment); f++) {
+        length += snprintf(fragment + length, sizeof(fragment) - length, ",\"%s\":%u", FIELDS[f].key,
+                           fieldValue(config, FIELDS[f]));
+    }
+    if (length > 0 && length < (int)sizeof(fragment)) {
+        length += snprintf(fragment + length, sizeof(fragment) - length, "}}");
+    }
+    if (length <= 0) return 0;
+    if (length >= (int)sizeof(fragment)) length = sizeof(fragment) - 1;  // Truncated; keep the count consistent
+    return out.write((const uint8_t *)fragment, (size_t)length);
+}
+
+size_t ReaderConfigAck::measureJson() const {
+    CountingPrint counter;
+    return writeJson(counter);
+}
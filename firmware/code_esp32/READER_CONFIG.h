@@ -0,0 +1,97 @@
+#ifndef _READER_CONFIG_H_
+#define _READER_CONFIG_H_
+
+#include <Arduino.h>
+#include <stdint.h>
+
+#define READER_CONFIG_VERSION  1         // Schema version a CONFIG message must name (v=)
+#define READER_CONFIG_NVS_NAMESPACE "optiflow"
+#define READER_CONFIG_NVS_KEY  "cfg_v1"  // Follows the version: a blob of another schema is never read back
+#define READER_CONFIG_MIN_TX_POWER 500   // Lowest tx_power (0.01 dBm); backed-off levels do not go below it
+
+/*
+ The reader parameters that can be changed at run time, so a fleet can run
+ A/B experiments on power, cycle timing and receiver sensitivity without
+ reflashing. The compiled-in defines (RFID_POLLING_COUNT, RFID_MAX_TX_POWER,
+ ...) are the defaults; a config received on store/production/control
+ replaces them field by field.
+
+ Payload: "CONFIG" followed by space separated tokens:
+   - v=<n>: READER_CONFIG_VERSION, required
+   - rev=<n>: revision (1 to 4294967295), required; chosen by the sender and
+     echoed in the ack, so a fleet dashboard can tell which experiment runs where
+   - DEFAULTS: start from the compiled-in values instead of the running ones
+   - <key>=<value> for the keys below; keys left out keep their value
+ e.g. "CONFIG v=1 rev=7 tx_power=2400 window_ms=400". "CONFIG" alone asks
+ for the running config.
+
+   key           field           range       default
+   poll_count    pollCount       1-100       RFID_POLLING_COUNT
+   window_ms     windowMs        100-10000   RFID_CYCLE_WINDOW_MS
+   tx_power      txPower         500-3000    RFID_MAX_TX_POWER (0.01 dBm)
+   uwb_fresh_ms  uwbFreshnessMs  100-60000   UWB_FRESHNESS_MS
+   region        region          1-4         CURRENT_REGION
+   mixer_gain    mixerGain       0-6         RFID_MIXER_GAIN
+   if_gain       ifGain          0-7         RFID_IF_GAIN
+   threshold     threshold       0-65535     RFID_RX_THRESHOLD
+
+ A message is taken whole or not at all: one bad token rejects it and the
+ running config stays.
+*/
+struct ReaderConfig {
+    uint32_t revision;        // 0 = compiled-in defaults
+    uint16_t pollCount;       // Rounds per blocking poll at level 0
+    uint16_t windowMs;        // Cycle window
+    uint16_t txPower;         // Level 0 TX power; the backed-off levels keep their steps below it
+    uint16_t uwbFreshnessMs;  // Anchor entries and fixes older than this are stale
+    uint8_t region;
+    uint8_t mixerGain;        // setReceiverParams()
+    uint8_t ifGain;
+    uint16_t threshold;
+};
+
+enum ReaderConfigStatus : uint8_t {
+    CONFIG_APPLIED = 0,   // Running from the next cycle, saved to NVS
+    CONFIG_CURRENT,       // Answer to a bare "CONFIG"
+    CONFIG_FAILED,        // A module refused a setting; the previous config was put back
+    CONFIG_BAD_VERSION,   // v= missing or not READER_CONFIG_VERSION
+    CONFIG_BAD_KEY,       // Unknown key or token
+    CONFIG_BAD_VALUE,     // Not a number, or out of range
+    CONFIG_NO_REVISION,   // rev= missing or 0
+};
+
+/*! @brief Apply a CONFIG payload (the text after "CONFIG") to config.
+    @param defaults Starting point for DEFAULTS.
+    @return CONFIG_APPLIED when config now holds the new values, an error otherwise (config unchanged).*/
+ReaderConfigStatus parseReaderConfig(const char *text, size_t length, const ReaderConfig &defaults,
+                                     ReaderConfig &config);
+
+/*! @brief True if every field is inside the schema's range (e.g. a blob read back from NVS).*/
+bool readerConfigValid(const ReaderConfig &config);
+
+const char *readerConfigStatusName(ReaderConfigStatus status);
+
+/*
+ Answer to a config message, on TOPIC_STATUS:
+
+ {"config":{"status":"applied","request":7,"v":1,"rev":7,"poll_count":6,"window_ms":400,
+            "tx_power":2400,"uwb_fresh_ms":3000,"region":1,"mixer_gain":6,"if_gain":7,"threshold":432}}
+
+ "request" is the revision an applied or failed message asked for (0 for a
+ query or a rejected message); "rev" and the values that follow are the
+ config now running.
+*/
+struct ReaderConfigAck {
+    ReaderConfigStatus status;
+    uint32_t request;
+    ReaderConfig config;
+
+    /*! @brief Write the ack as compact JSON.
+        @return Number of bytes produced.*/
+    size_t writeJson(Print &out) const;
+
+    /*! @brief Length writeJson() will produce.*/
+    size_t measureJson() const;
+};
+
+#endif
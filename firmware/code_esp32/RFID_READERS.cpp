@@ -0,0 +1,71 @@
+#include "RFID_READERS.h"
+
+#include <math.h>
+
+void AntennaSwitch::begin(const int8_t *pins, uint8_t antennas) {
+    _antennas = antennas < 1 ? 1 : antennas > RFID_MAX_ANTENNAS ? RFID_MAX_ANTENNAS : antennas;
+    for (uint8_t i = 0; i < 2; i++) {
+        _pins[i] = pins[i];
+        if (_pins[i] >= 0) pinMode(_pins[i], OUTPUT);
+    }
+    _current = 1;  // Forces the lines to be driven
+    select(0);
+}
+
+void AntennaSwitch::select(uint8_t antenna) {
+    if (antenna >= _antennas || antenna == _current) return;
+    _current = antenna;
+    for (uint8_t i = 0; i < 2; i++) {
+        if (_pins[i] >= 0) digitalWrite(_pins[i], (antenna >> i) & 1 ? HIGH : LOW);
+    }
+}
+
+void TagMerger::begin(CycleRecord &record) {
+    _record           = &record;
+    _record->tagCount = 0;
+    _index.clear();
+}
+
+void TagMerger::add(const CARD *cards, uint16_t count, const InventoryFilter *filter) {
+    CycleRecord &record = *_record;
+    for (uint16_t i = 0; i < count; i++) {
+        const CARD &card = cards[i];
+        if (filter && !filter->matches(card.epc)) continue;  // Outside the prefixes, past the hardware mask
+
+        uint16_t existing = _index.find(card.epc);
+        if (existing == _index.NOT_FOUND) {
+            if (record.tagCount >= RFID_MAX_TAGS || !_index.insert(card.epc, record.tagCount)) continue;  // Record full
+            uint16_t index   = record.tagCount++;
+            RFIDTagData &tag = record.tags[index];
+            memcpy(tag.epc, card.epc, RFID_EPC_SIZE);
+            tag.rssiMin     = card.rssiMin;
+            tag.rssiMax     = card.rssiMax;
+            tag.firstSeen   = card.firstSeen;
+            tag.lastSeen    = card.lastSeen;
+            tag.sources     = card.sources;
+            _rssiSum[index] = card.rssiSum;
+            _reads[index]   = card.readCount;
+            continue;
+        }
+
+        // Seen by an earlier reader
+        RFIDTagData &tag = record.tags[existing];
+        if (card.rssiMin < tag.rssiMin) tag.rssiMin = card.rssiMin;
+        if (card.rssiMax > tag.rssiMax) tag.rssiMax = card.rssiMax;
+        if ((long)(card.firstSeen - tag.firstSeen) < 0) tag.firstSeen = card.firstSeen;
+        if ((long)(card.lastSeen - tag.lastSeen) > 0) tag.lastSeen = card.lastSeen;
+        tag.sources |= card.sources;
+        _rssiSum[existing] += card.rssiSum;
+        _reads[existing] += card.readCount;
+    }
+}
+
+void TagMerger::finish() {
+    CycleRecord &record = *_record;
+    for (uint16_t i = 0; i < record.tagCount; i++) {
+        RFIDTagData &tag = record.tags[i];
+        tag.rssi      = (int8_t)lroundf((float)_rssiSum[i] / _reads[i]);
+        tag.reads     = _reads[i] > 0xffff ? 0xffff : (uint16_t)_reads[i];
+        tag.timestamp = record.timestamp;
+    }
+}
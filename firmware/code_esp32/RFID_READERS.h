@@ -0,0 +1,109 @@
+#ifndef _RFID_READERS_H_
+#define _RFID_READERS_H_
+
+#include <Arduino.h>
+#include <HardwareSerial.h>
+#include "CYCLE_RECORD.h"
+#include "EPC_HASH_SET.h"
+#include "INVENTORY_FILTER.h"
+#include "UART_CAPTURE.h"
+#include "UART_RX_NOTIFIER.h"
+#include "UNIT_UHF_RFID.h"
+
+#define RFID_MAX_READERS  CAPTURE_MAX_READERS  // Each module has its own capture port
+#define RFID_MAX_ANTENNAS 4                    // Per module: two RF switch select lines
+#define RFID_MAX_SOURCES  8                    // Reader/antenna pairs: bits of RFIDTagData::sources
+
+/*
+ Wiring of one RFID module. A module may sit behind a GPIO-driven RF switch
+ (e.g. SP4T) that puts one of several antennas on its port.
+*/
+struct RfidReaderConfig {
+    HardwareSerial *serial;
+    int8_t rxPin;
+    int8_t txPin;
+    uint8_t antennas;       // Antennas behind the switch, 1 = no switch
+    int8_t switchPins[2];   // Select lines, antenna index in binary (LSB first); -1 = not wired
+};
+
+/*
+ The RF switch in front of one module. With a single antenna select() does nothing.
+*/
+class AntennaSwitch {
+   public:
+    AntennaSwitch() : _antennas(1), _current(0) {
+        _pins[0] = _pins[1] = -1;
+    }
+
+    /*! @brief Drive the select lines and put antenna 0 on the port.*/
+    void begin(const int8_t *pins, uint8_t antennas);
+
+    void select(uint8_t antenna);
+
+    uint8_t antennas() const {
+        return _antennas;
+    }
+
+    uint8_t current() const {
+        return _current;
+    }
+
+   private:
+    int8_t _pins[2];
+    uint8_t _antennas;
+    uint8_t _current;
+};
+
+/*
+ One module as rfidTask drives it: the driver, the UART it reads through
+ (TracePort, for capture and replay), and the antenna switch in front of it.
+ Sources are numbered across all readers, antenna by antenna, so every
+ RFIDTagData::sources bit names one reader/antenna pair.
+*/
+struct RfidReader {
+    Unit_UHF_RFID driver;
+    UartRxNotifier rx;
+    TracePort port;
+    AntennaSwitch antenna;
+    uint8_t firstSource;  // Source of antenna 0
+    uint16_t tagCount;    // Tags in driver.cards this cycle
+
+    /*! @brief Switch antennas; reads from now on are attributed to the new one.*/
+    void selectAntenna(uint8_t index) {
+        antenna.select(index);
+        driver.setSource(firstSource + antenna.current());
+    }
+};
+
+/*
+ Folds the tag sets of several modules into one cycle record. A tag read by
+ more than one reader becomes one entry: reads and RSSI sums add up,
+ min/max and first/last seen widen, sources are OR'ed. Entries follow the
+ order the readers are added in, then first read; past RFID_MAX_TAGS
+ further tags are dropped. With one reader the record is exactly the
+ driver's cards.
+
+ rfidTask calls begin(), add() per reader, finish() once a cycle closes.
+*/
+class TagMerger {
+   public:
+    TagMerger() : _record(NULL) {}
+
+    /*! @brief Start filling record (tag set emptied).*/
+    void begin(CycleRecord &record);
+
+    /*! @brief Merge one reader's cards.
+        @param filter Tags it does not match are skipped; NULL keeps every tag.*/
+    void add(const CARD *cards, uint16_t count, const InventoryFilter *filter);
+
+    /*! @brief Compute the mean RSSI of every entry and stamp it with record.timestamp.*/
+    void finish();
+
+   private:
+    CycleRecord *_record;
+    EpcHashSet<RFID_DEDUP_CAPACITY> _index;
+    int32_t _rssiSum[RFID_MAX_TAGS];
+    uint32_t _reads[RFID_MAX_TAGS];
+};
+
+#endif
@@ -0,0 +1,62 @@
+#include "RFID_SCHEDULER.h"
+
+PollScheduler::PollScheduler(const PollProfile *profiles, uint8_t levels)
+    : _profiles(profiles),
+      _levels(levels < 1 ? 1 : (levels > RFID_SCHED_MAX_LEVELS ? RFID_SCHED_MAX_LEVELS : levels)),
+      _level(0),
+      _quietCycles(0),
+      _cyclesInGeneration(0),
+      _current(0) {}
+
+void PollScheduler::rotate() {
+    _current ^= 1;
+    _seen[_current].clear();
+    _cyclesInGeneration = 0;
+}
+
+uint16_t PollScheduler::observe(const CycleRecord &record) {
+    if (++_cyclesInGeneration > RFID_SCHED_MEMORY_CYCLES) {
+        rotate();
+    }
+
+    uint16_t newTags = 0;
+    uint16_t count   = record.tagCount < RFID_MAX_TAGS ? record.tagCount : RFID_MAX_TAGS;
+    for (uint16_t i = 0; i < count; i++) {
+        const uint8_t *epc = record.tags[i].epc;
+        EpcHashSet<RFID_SCHED_MEMORY_CAPACITY> &current = _seen[_current];
+        if (current.find(epc) != current.NOT_FOUND) continue;
+
+        if (_seen[_current ^ 1].find(epc) == current.NOT_FOUND) {
+            newTags++;
+        }
+        if (current.size() >= RFID_SCHED_MEMORY_CAPACITY * 3 / 4) {
+            rotate();  // Keep probe chains short; the set just retired becomes the older generation
+        }
+        _seen[_current].insert(epc, 0);
+    }
+    return newTags;
+}
+
+const PollProfile &PollScheduler::update(uint16_t newTags, const PositionEstimate &position, unsigned long now) {
+    if (newTags >= RFID_SCHED_CHURN_TAGS || moving(position, now)) {
+        _level       = 0;
+        _quietCycles = 0;
+    } else if (newTags > 0) {
+        _quietCycles = 0;
+    } else if (++_quietCycles >= RFID_SCHED_SETTLE_CYCLES) {
+        _quietCycles = 0;
+        if (_level + 1 < _levels) _level++;
+    }
+    return _profiles[_level];
+}
+
+void PollScheduler::wake() {
+    _level       = 0;
+    _quietCycles = 0;
+}
+
+bool PollScheduler::moving(const PositionEstimate &position, unsigned long now) {
+    // Signed age: the fix may be a few ms newer than now when uwbTask ran in between
+    return position.valid && (long)(now - position.timestamp) <= AnchorTable::freshnessMs() &&
+           position.speed >= RFID_SCHED_MOVING_CM_S;
+}
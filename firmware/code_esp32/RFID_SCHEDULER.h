@@ -0,0 +1,101 @@
+#ifndef _RFID_SCHEDULER_H_
+#define _RFID_SCHEDULER_H_
+
+#include <stdint.h>
+#include "CYCLE_RECORD.h"
+#include "EPC_HASH_SET.h"
+
+#ifndef RFID_SCHED_MOVING_CM_S
+#define RFID_SCHED_MOVING_CM_S 25.0f  // Filtered UWB speed above which the reader counts as walking
+#endif
+
+#ifndef RFID_SCHED_CHURN_TAGS
+#define RFID_SCHED_CHURN_TAGS 2  // New tags in one cycle that mean fresh shelf space
+#endif
+
+#ifndef RFID_SCHED_SETTLE_CYCLES
+#define RFID_SCHED_SETTLE_CYCLES 4  // Quiet cycles before stepping down one level
+#endif
+
+#ifndef RFID_SCHED_MEMORY_CYCLES
+#define RFID_SCHED_MEMORY_CYCLES 20  // A tag unseen for 20-40 cycles counts as new again
+#endif
+
+#ifndef RFID_SCHED_MEMORY_CAPACITY
+#define RFID_SCHED_MEMORY_CAPACITY 512  // EPCs remembered per generation (power of two)
+#endif
+
+#define RFID_SCHED_MAX_LEVELS 8
+
+/*
+ One polling level. Level 0 is the most aggressive.
+*/
+struct PollProfile {
+    uint16_t pollCount;  // Rounds per blocking poll (RFID_STREAMING 0)
+    uint16_t windowMs;   // Cycle length (streaming) or minimum cycle length (blocking)
+    uint16_t idleMs;     // Radio off after the cycle
+    uint16_t txPower;    // 0.01 dB, as Unit_UHF_RFID::setTxPower()
+};
+
+/*
+ Picks the polling level for the next RFID cycle from two signals: the
+ on-device UWB speed and how many tags the last cycle saw for the first time.
+
+ Attack is immediate, decay is slow. Walking, or RFID_SCHED_CHURN_TAGS new
+ tags in one cycle, jumps straight to level 0. Any new tag holds the current
+ level. Only after RFID_SCHED_SETTLE_CYCLES cycles without a new tag does the
+ scheduler step one level down, so a stationary reader reaches the lowest
+ level after levels * RFID_SCHED_SETTLE_CYCLES cycles. Without a fresh fix
+ (no UWB, anchors not mapped) only tag churn drives it.
+
+ "New" means not seen in the last RFID_SCHED_MEMORY_CYCLES cycles: EPCs are
+ remembered in two EpcHashSet generations that rotate every
+ RFID_SCHED_MEMORY_CYCLES cycles (or early, when the current one fills up),
+ so there is no per-tag timestamp to age and nothing is allocated.
+
+ Used by rfidTask only; not thread safe.
+*/
+class PollScheduler {
+   public:
+    /*! @param profiles Levels, most aggressive first. The table must outlive the scheduler.
+        @param levels Number of entries (1 to RFID_SCHED_MAX_LEVELS).*/
+    PollScheduler(const PollProfile *profiles, uint8_t levels);
+
+    /*! @brief Remember the cycle's tags.
+        @return Tags not seen in the last RFID_SCHED_MEMORY_CYCLES cycles.*/
+    uint16_t observe(const CycleRecord &record);
+
+    /*! @brief Pick the level for the next cycle.
+        @param newTags Result of observe() for the cycle just closed.
+        @param position Latest on-device fix.
+        @param now millis().
+        @return Profile to run next.*/
+    const PollProfile &update(uint16_t newTags, const PositionEstimate &position, unsigned long now);
+
+    /*! @brief Jump to level 0 (motion detected while the radio rests).*/
+    void wake();
+
+    /*! @brief The fix is fresh and its filtered speed is at walking pace.*/
+    static bool moving(const PositionEstimate &position, unsigned long now);
+
+    const PollProfile &profile() const {
+        return _profiles[_level];
+    }
+
+    uint8_t level() const {
+        return _level;
+    }
+
+   private:
+    void rotate();
+
+    const PollProfile *_profiles;
+    uint8_t _levels;
+    uint8_t _level;
+    uint8_t _quietCycles;
+    uint16_t _cyclesInGeneration;
+    uint8_t _current;  // Generation receiving inserts; the other one is older
+    EpcHashSet<RFID_SCHED_MEMORY_CAPACITY> _seen[2];
+};
+
+#endif
@@ -0,0 +1,97 @@
+#include "TAG_DELTA.h"
+
+#include <string.h>
+
+TagDeltaTracker::TagDeltaTracker()
+    : _published(0),
+      _publishedCount(0),
+      _addedCount(0),
+      _changedCount(0),
+      _removedCount(0),
+      _carriedCount(0),
+      _tagTotal(0),
+      _baseCycle(0),
+      _sinceKeyframe(0),
+      _valid(false),
+      _keyframeRequested(false) {}
+
+bool TagDeltaTracker::compute(const CycleRecord &record) {
+    _addedCount   = 0;
+    _changedCount = 0;
+    _removedCount = 0;
+    _carriedCount = 0;
+    _tagTotal     = record.tagCount;
+
+    bool keyframeDue = _keyframeRequested || _sinceKeyframe + 1 >= TAG_KEYFRAME_INTERVAL;
+    if (!_valid || (keyframeDue && !record.suppressed)) {
+        // Taken now: a request arriving after this point needs a later keyframe
+        _keyframeRequested = false;
+        return false;
+    }
+
+    const Entry *base = _sets[_published];
+    memset(_seen, 0, _publishedCount * sizeof(_seen[0]));
+
+    for (uint16_t i = 0; i < record.tagCount; i++) {
+        const RFIDTagData &tag = record.tags[i];
+        uint16_t index         = _index.find(tag.epc);
+
+        if (index == EpcHashSet<RFID_DEDUP_CAPACITY>::NOT_FOUND) {
+            _added[_addedCount++] = i;
+            _baseIndex[i]         = index;
+            continue;
+        }
+
+        _seen[index] = true;
+        int diff     = tag.rssi - base[index].rssi;
+        if (diff >= TAG_DELTA_RSSI_THRESHOLD || diff <= -TAG_DELTA_RSSI_THRESHOLD) {
+            _changed[_changedCount++] = i;
+            _baseIndex[i]             = EpcHashSet<RFID_DEDUP_CAPACITY>::NOT_FOUND;
+        } else {
+            _baseIndex[i] = index;  // Receiver keeps the old value
+        }
+    }
+
+    for (uint16_t j = 0; j < _publishedCount; j++) {
+        if (_seen[j]) continue;
+        if (record.suppressed && _tagTotal < RFID_MAX_TAGS) {
+            _carried[_carriedCount++] = j;  // Silenced, not gone
+            _tagTotal++;
+        } else {
+            _removed[_removedCount++] = j;
+        }
+    }
+    return true;
+}
+
+void TagDeltaTracker::commit(const CycleRecord &record, bool keyframe) {
+    const Entry *base = _sets[_published];
+    Entry *next       = _sets[_published ^ 1];
+
+    _index.clear();
+    for (uint16_t i = 0; i < record.tagCount; i++) {
+        const RFIDTagData &tag = record.tags[i];
+        memcpy(next[i].epc, tag.epc, RFID_EPC_SIZE);
+        uint16_t index = keyframe ? EpcHashSet<RFID_DEDUP_CAPACITY>::NOT_FOUND : _baseIndex[i];
+        next[i].rssi   = index == EpcHashSet<RFID_DEDUP_CAPACITY>::NOT_FOUND ? tag.rssi : base[index].rssi;
+        _index.insert(tag.epc, i);
+    }
+    uint16_t count = record.tagCount;
+    if (!keyframe) {
+        for (uint16_t k = 0; k < _carriedCount; k++, count++) {
+            next[count] = base[_carried[k]];
+            _index.insert(next[count].epc, count);
+        }
+    }
+
+    _published ^= 1;
+    _publishedCount = count;
+    _baseCycle      = record.cycle;
+    _valid          = true;
+
+    if (keyframe) {
+        _sinceKeyframe = 0;
+    } else {
+        _sinceKeyframe++;
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef _TAG_DELTA_H_
+#define _TAG_DELTA_H_
+
+#include <stdint.h>
+#include "CYCLE_RECORD.h"
+#include "EPC_HASH_SET.h"
+
+#ifndef TAG_DELTA_RSSI_THRESHOLD
+#define TAG_DELTA_RSSI_THRESHOLD 6  // dB change in mean RSSI that republishes a tag
+#endif
+
+#ifndef TAG_KEYFRAME_INTERVAL
+#define TAG_KEYFRAME_INTERVAL 20  // Publish the full tag set at least every N cycles
+#endif
+
+/*
+ Tracks the tag set the receiver last saw and computes what changed.
+
+ Per cycle the output task calls compute(). If it returns true the cycle can
+ be published as a delta against baseCycle(): tags that are new (added), tags
+ whose mean RSSI moved by TAG_DELTA_RSSI_THRESHOLD or more from the last
+ published value (changed), and EPCs that are gone (removed). If it returns
+ false a keyframe (the full set) is due: there is no baseline yet, the
+ interval expired, or one was requested.
+
+ commit() must be called only after the publish succeeded, so the baseline is
+ always what the receiver has. Unchanged tags keep their last published RSSI,
+ which means slow drift is still reported once it crosses the threshold.
+
+ A suppressed record (CycleRecord::suppressed) only holds the tags that were
+ not silenced, so absence proves nothing: its delta removes no tags and the
+ unseen ones are carried into the new baseline (tagTotal() counts them).
+ Keyframes are held back until the next unsuppressed record.
+*/
+class TagDeltaTracker {
+   public:
+    TagDeltaTracker();
+
+    /*! @brief Diff the record's tags against the last published set.
+        @return True if a delta can be published, false if a keyframe is due (a pending request is taken).*/
+    bool compute(const CycleRecord &record);
+
+    /*! @brief Make the record the new baseline after a successful publish.
+        @param keyframe True if the full set was published, false for the delta from compute().*/
+    void commit(const CycleRecord &record, bool keyframe);
+
+    /*! @brief Force the next publish to be a keyframe (control request, reconnect, failed publish).*/
+    void requestKeyframe() {
+        _keyframeRequested = true;
+    }
+
+    uint32_t baseCycle() const {
+        return _baseCycle;
+    }
+
+    /*! @brief Size of the receiver's set once the delta is applied.*/
+    uint16_t tagTotal() const {
+        return _tagTotal;
+    }
+
+    uint16_t addedCount() const {
+        return _addedCount;
+    }
+
+    /*! @brief Index into record.tags of the i-th added tag.*/
+    uint16_t added(uint16_t i) const {
+        return _added[i];
+    }
+
+    uint16_t changedCount() const {
+        return _changedCount;
+    }
+
+    /*! @brief Index into record.tags of the i-th changed tag.*/
+    uint16_t changed(uint16_t i) const {
+        return _changed[i];
+    }
+
+    uint16_t removedCount() const {
+        return _removedCount;
+    }
+
+    /*! @brief EPC of the i-th removed tag.*/
+    const uint8_t *removedEpc(uint16_t i) const {
+        return _sets[_published][_removed[i]].epc;
+    }
+
+   private:
+    struct Entry {
+        uint8_t epc[RFID_EPC_SIZE];
+        int8_t rssi;  // Last published mean RSSI
+    };
+
+    Entry _sets[2][RFID_MAX_TAGS];                // Published set and the one being built by commit()
+    uint8_t _published;
+    uint16_t _publishedCount;
+    EpcHashSet<RFID_DEDUP_CAPACITY> _index;       // EPC -> index in the published set
+
+    uint16_t _baseIndex[RFID_MAX_TAGS];           // Per record tag: published index, or NOT_FOUND to take the new RSSI
+    bool _seen[RFID_MAX_TAGS];
+    uint16_t _added[RFID_MAX_TAGS];
+    uint16_t _changed[RFID_MAX_TAGS];
+    uint16_t _removed[RFID_MAX_TAGS];
+    uint16_t _carried[RFID_MAX_TAGS];             // Published index of unseen tags kept by a suppressed record
+    uint16_t _addedCount;
+    uint16_t _changedCount;
+    uint16_t _removedCount;
+    uint16_t _carriedCount;
+    uint16_t _tagTotal;
+
+    uint32_t _baseCycle;
+    uint16_t _sinceKeyframe;
+    bool _valid;
+    volatile bool _keyframeRequested;
+};
+
+#endif
@@ -0,0 +1,142 @@
+#include "TELEMETRY.h"
+#include "CYCLE_SERIALIZER.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Largest fragment is one timing entry (~110 bytes)
+#define TELEMETRY_FRAGMENT_SIZE 160
+
+void TimingHistogram::reset() {
+    memset(_buckets, 0, sizeof(_buckets));
+    _count = 0;
+    _maxUs = 0;
+    _sumUs = 0;
+}
+
+void TimingHistogram::record(uint32_t us) {
+    uint8_t bucket = us > 1 ? 31 - __builtin_clz(us) : 0;
+    if (bucket >= TIMING_BUCKETS) bucket = TIMING_BUCKETS - 1;
+    _buckets[bucket]++;
+    _count++;
+    _sumUs += us;
+    if (us > _maxUs) _maxUs = us;
+}
+
+uint32_t TimingHistogram::quantileUs(float q) const {
+    if (_count == 0) return 0;
+    uint32_t rank = (uint32_t)(q * _count + 0.999f);
+    if (rank < 1) rank = 1;
+
+    uint32_t seen = 0;
+    for (uint8_t i = 0; i < TIMING_BUCKETS - 1; i++) {
+        seen += _buckets[i];
+        if (seen >= rank) {
+            uint32_t upper = (2UL << i) - 1;
+            return upper < _maxUs ? upper : _maxUs;
+        }
+    }
+    return _maxUs;
+}
+
+const char *TelemetryReport::timingName(TimingPoint point) {
+    switch (point) {
+        case TIMING_RFID_POLL:
+            return "rfid_poll";
+        case TIMING_UWB_PARSE:
+            return "uwb_parse";
+        case TIMING_ANCHOR_UPDATE:
+            return "anchor_update";
+        case TIMING_POSITION_SOLVE:
+            return "position_solve";
+        case TIMING_SERIALIZE:
+            return "serialize";
+        case TIMING_PUBLISH:
+            return "publish";
+        case TIMING_BATCH_SEAL:
+            return "batch_seal";
+        default:
+            return "unknown";
+    }
+}
+
+static size_t emit(Print &out, const char *text, int length) {
+    if (length <= 0) {
+        return 0;
+    }
+    if (length >= TELEMETRY_FRAGMENT_SIZE) {
+        length = TELEMETRY_FRAGMENT_SIZE - 1;  // snprintf truncated; keep the count consistent with the bytes
+    }
+    return out.write((const uint8_t *)text, (size_t)length);
+}
+
+size_t TelemetryReport::writeJson(Print &out) const {
+    char fragment[TELEMETRY_FRAGMENT_SIZE];
+    size_t n = emit(out, fragment,
+                    snprintf(fragment, sizeof(fragment), "{\"uptime_ms\":%lu,\"interval_ms\":%lu,\"timing_us\":{",
+                             uptimeMs, intervalMs));
+
+    for (uint8_t i = 0; i < TIMING_POINT_COUNT; i++) {
+        const TimingHistogram &h = timing[i];
+        n += emit(out, fragment,
+                  snprintf(fragment, sizeof(fragment),
+                           "%s\"%s\":{\"n\":%lu,\"mean\":%lu,\"p50\":%lu,\"p90\":%lu,\"p99\":%lu,\"max\":%lu}",
+                           i ? "," : "", timingName((TimingPoint)i), (unsigned long)h.count(),
+                           (unsigned long)h.meanUs(), (unsigned long)h.quantileUs(0.50f),
+                           (unsigned long)h.quantileUs(0.90f), (unsigned long)h.quantileUs(0.99f),
+                           (unsigned long)h.maxUs()));
+    }
+
+    n += out.write((const uint8_t *)"},\"tasks\":[", 11);
+    for (uint8_t i = 0; i < taskCount && i < TELEMETRY_MAX_TASKS; i++) {
+        const TaskTelemetry &task = tasks[i];
+        n += emit(out, fragment,
+                  snprintf(fragment, sizeof(fragment), "%s{\"name\":\"%s\",\"stack_free\":%lu", i ? "," : "",
+                           task.name, (unsigned long)task.stackFree));
+        if (task.cpuPermille >= 0) {
+            n += emit(out, fragment,
+                      snprintf(fragment, sizeof(fragment), ",\"cpu_pct\":%.1f", task.cpuPermille / 10.0f));
+        }
+        n += out.write((const uint8_t *)"}", 1);
+    }
+
+    n += emit(out, fragment,
+              snprintf(fragment, sizeof(fragment),
+                       "],\"heap\":{\"free\":%lu,\"min_free\":%lu,\"largest_block\":%lu,\"psram_free\":%lu}",
+                       (unsigned long)heapFree, (unsigned long)heapMinFree, (unsigned long)heapLargestBlock,
+                       (unsigned long)psramFree));
+    n += emit(out, fragment,
+              snprintf(fragment, sizeof(fragment),
+                       ",\"uart\":{\"rfid\":{\"overruns\":%lu,\"errors\":%lu},\"uwb\":{\"overruns\":%lu,\"errors\":%lu}}",
+                       (unsigned long)rfidUartOverruns, (unsigned long)rfidUartErrors,
+                       (unsigned long)uwbUartOverruns, (unsigned long)uwbUartErrors));
+    n += emit(out, fragment,
+              snprintf(fragment, sizeof(fragment),
+                       ",\"counters\":{\"uwb_sessions\":%lu,\"cycles_dropped\":%lu,\"backlog_queued\":%lu,"
+                       "\"backlog_dropped\":%lu,\"publish_failures\":%lu}",
+                       (unsigned long)uwbSessions, (unsigned long)cyclesDropped, (unsigned long)backlogQueued,
+                       (unsigned long)backlogDropped, (unsigned long)publishFailures));
+    n += emit(out, fragment,
+              snprintf(fragment, sizeof(fragment), ",\"clock\":{\"synced\":%s,\"syncs\":%lu,\"correction_ms\":%ld}",
+                       clockSynced ? "true" : "false", (unsigned long)clockSyncs, (long)clockCorrectionMs));
+    n += emit(out, fragment,
+              snprintf(fragment, sizeof(fragment), ",\"power\":{\"save\":%s,\"light_sleep\":%s,\"mean_est_ma\":%u",
+                       powerSave ? "true" : "false", lightSleep ? "true" : "false",
+                       PowerLedger::meanMa(powerStateMs)));
+    for (uint8_t i = 0; i < POWER_STATE_COUNT; i++) {
+        n += emit(out, fragment,
+                  snprintf(fragment, sizeof(fragment), ",\"%s\":{\"ms\":%lu,\"est_ma\":%u}",
+                           PowerLedger::stateName((PowerState)i), (unsigned long)powerStateMs[i],
+                           PowerLedger::stateMa((PowerState)i)));
+    }
+    n += out.write((const uint8_t *)"}", 1);
+    n += emit(out, fragment,
+              snprintf(fragment, sizeof(fragment), ",\"rfid\":{\"poll_level\":%u,\"config_rev\":%lu}}", pollLevel,
+                       (unsigned long)configRevision));
+    return n;
+}
+
+size_t TelemetryReport::measureJson() const {
+    CountingPrint counter;
+    return writeJson(counter);
+}
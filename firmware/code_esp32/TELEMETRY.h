@@ -0,0 +1,132 @@
+#ifndef _TELEMETRY_H_
+#define _TELEMETRY_H_
+
+#include <Arduino.h>
+#include "POWER_LEDGER.h"
+
+#define TIMING_BUCKETS 24  // log2 microsecond buckets; the last one is open-ended (>= ~8.4 s)
+
+#ifndef TELEMETRY_MAX_TASKS
+#define TELEMETRY_MAX_TASKS 4
+#endif
+
+// Timed hot paths, in report order
+enum TimingPoint : uint8_t {
+    TIMING_RFID_POLL = 0,   // pollingMultiple(), or the processStream() work of one streaming cycle
+    TIMING_UWB_PARSE,       // Tokenizing one burst of UART bytes (session handling excluded)
+    TIMING_ANCHOR_UPDATE,   // updateAnchorStatistics() for one session
+    TIMING_POSITION_SOLVE,  // updatePosition() for one session
+    TIMING_SERIALIZE,       // Length dry run of one cycle payload: a full encoder pass without the socket
+    TIMING_PUBLISH,         // QoS window wait, beginPublish() to endPublish() of one cycle payload
+    TIMING_BATCH_SEAL,      // CycleBatcher::seal() of one live batch, LZ4 pass included
+    TIMING_POINT_COUNT
+};
+
+/*
+ Fixed-size latency histogram. Bucket 0 holds 0-1 us, bucket i holds
+ [2^i, 2^(i+1)) us, so recording is a count-leading-zeros and an increment,
+ and quantiles come out within a factor of two (capped at the exact max).
+
+ Not thread safe; the caller guards it.
+*/
+class TimingHistogram {
+   public:
+    TimingHistogram() {
+        reset();
+    }
+
+    void reset();
+
+    void record(uint32_t us);
+
+    uint32_t count() const {
+        return _count;
+    }
+
+    uint32_t maxUs() const {
+        return _maxUs;
+    }
+
+    uint32_t meanUs() const {
+        return _count ? (uint32_t)(_sumUs / _count) : 0;
+    }
+
+    /*! @brief Upper bound of the bucket holding the q-th sample, at most maxUs().
+        @param q 0 to 1.*/
+    uint32_t quantileUs(float q) const;
+
+   private:
+    uint32_t _buckets[TIMING_BUCKETS];
+    uint32_t _count;
+    uint32_t _maxUs;
+    uint64_t _sumUs;
+};
+
+struct TaskTelemetry {
+    const char *name;
+    uint32_t stackFree;   // Bytes of stack never used (high-water mark)
+    int16_t cpuPermille;  // Share of one core since the last report, -1 without FreeRTOS run-time stats
+};
+
+/*
+ One status report on TOPIC_STATUS. Histograms cover the report interval;
+ counters run since boot.
+
+ {"uptime_ms":U,"interval_ms":I,
+  "timing_us":{"rfid_poll":{"n":10,"mean":812,"p50":1023,"p90":1023,"p99":1023,"max":950},
+               "uwb_parse":{...},"anchor_update":{...},"position_solve":{...},
+               "serialize":{...},"publish":{...},"batch_seal":{...}},
+  "tasks":[{"name":"rfid","stack_free":9120,"cpu_pct":3.1}],
+  "heap":{"free":180000,"min_free":150000,"largest_block":110000,"psram_free":7900000},
+  "uart":{"rfid":{"overruns":0,"errors":0},"uwb":{"overruns":0,"errors":0}},
+  "counters":{"uwb_sessions":S,"cycles_dropped":0,"backlog_queued":0,"backlog_dropped":0,
+              "publish_failures":0},
+  "clock":{"synced":true,"syncs":4,"correction_ms":-3},
+  "power":{"save":true,"light_sleep":true,"mean_est_ma":142,
+           "inventory":{"ms":4200,"est_ma":310},"rest":{"ms":800,"est_ma":140},
+           "radio_sleep":{"ms":5000,"est_ma":75}},
+  "rfid":{"poll_level":0,"config_rev":7}}
+
+ "cpu_pct" is present only when the core is built with run-time stats.
+ "power" times cover the interval; "est_ma" is each state's assumed current
+ (POWER_MA_* in POWER_LEDGER.h, not measured), "mean_est_ma" the time-weighted estimate.
+*/
+struct TelemetryReport {
+    unsigned long uptimeMs;
+    unsigned long intervalMs;
+    TimingHistogram timing[TIMING_POINT_COUNT];
+    TaskTelemetry tasks[TELEMETRY_MAX_TASKS];
+    uint8_t taskCount;
+    uint32_t heapFree;
+    uint32_t heapMinFree;       // Lowest free heap since boot
+    uint32_t heapLargestBlock;  // Largest allocatable block right now
+    uint32_t psramFree;
+    uint32_t rfidUartOverruns;  // RX FIFO or ring buffer overflows: bytes lost
+    uint32_t rfidUartErrors;    // Break, framing and parity errors
+    uint32_t uwbUartOverruns;
+    uint32_t uwbUartErrors;
+    uint32_t uwbSessions;
+    uint32_t cyclesDropped;     // CyclePipeline: output side behind
+    uint32_t backlogQueued;
+    uint32_t backlogDropped;
+    uint32_t publishFailures;   // Publishes that failed: cycles and batches (backlogged), presence events, UWB sessions
+    uint8_t pollLevel;
+    uint32_t configRevision;    // ReaderConfig running, 0 = compiled-in defaults
+    bool clockSynced;           // EpochClock: SNTP has set the wall time
+    uint32_t clockSyncs;
+    int32_t clockCorrectionMs;  // Last sync's correction
+    bool powerSave;             // POWER_SAVE build: DFS, modem sleep, module hibernation in long rests
+    bool lightSleep;            // Automatic light sleep accepted by the power manager
+    uint32_t powerStateMs[POWER_STATE_COUNT];  // PowerLedger, this interval
+
+    /*! @brief Write the report as compact JSON.
+        @return Number of bytes produced.*/
+    size_t writeJson(Print &out) const;
+
+    /*! @brief Length writeJson() will produce.*/
+    size_t measureJson() const;
+
+    static const char *timingName(TimingPoint point);
+};
+
+#endif
@@ -0,0 +1,439 @@
+#include "UART_CAPTURE.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Longest text line: "<ms> <port> <hex>\n" for a full record
+#define CAPTURE_LINE_SIZE (10 + 3 + 2 * CAPTURE_CHUNK_SIZE + 1)
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static uint32_t readTime(const uint8_t *record) {
+    return (uint32_t)record[0] | ((uint32_t)record[1] << 8) | ((uint32_t)record[2] << 16) |
+           ((uint32_t)record[3] << 24);
+}
+
+static bool isPort(char port) {
+    return (port >= CAPTURE_PORT_RFID && port < CAPTURE_PORT_RFID + CAPTURE_MAX_READERS) || port == CAPTURE_PORT_UWB;
+}
+
+UartCapture::UartCapture()
+    : _buffer(NULL),
+      _mode(IDLE),
+      _maxSpeed(false),
+      _ports(0),
+      _portsEnded(0),
+      _generation(0),
+      _replays(0),
+      _dropped(0),
+      _lastTime(0),
+      _start(0),
+      _recorded(false),
+      _loadNextPart(UINT32_MAX),
+      _mux(portMUX_INITIALIZER_UNLOCKED) {}
+
+bool UartCapture::begin(uint32_t bytes) {
+    bool psram = psramFound();
+    if (!psram && bytes > CAPTURE_FALLBACK_BYTES) {
+        bytes = CAPTURE_FALLBACK_BYTES;
+    }
+    _buffer = (uint8_t *)(psram ? ps_malloc(bytes) : malloc(bytes));
+    if (_buffer == NULL) {
+        return false;
+    }
+    _ring.store().attach(_buffer);
+    _ring.reset(bytes);
+    return true;
+}
+
+void UartCapture::attachPort() {
+    _ports++;
+}
+
+bool UartCapture::startRecording(const AnchorMap &anchors) {
+    if (!enabled() || _mode == REPLAYING) return false;
+
+    portENTER_CRITICAL(&_mux);
+    _mode = IDLE;
+    portEXIT_CRITICAL(&_mux);
+
+    // No port appends while IDLE, so the ring can be reset outside the critical section
+    _ring.pop(_ring.count());
+    _anchors      = anchors;
+    _dropped      = 0;
+    _lastTime     = 0;
+    _loadNextPart = UINT32_MAX;
+    _generation++;
+
+    portENTER_CRITICAL(&_mux);
+    _start    = millis();
+    _recorded = true;
+    _mode     = RECORDING;
+    portEXIT_CRITICAL(&_mux);
+    return true;
+}
+
+bool UartCapture::startReplay(bool maxSpeed) {
+    if (!enabled() || _mode == RECORDING || _ring.count() == 0) return false;
+
+    portENTER_CRITICAL(&_mux);
+    _maxSpeed   = maxSpeed;
+    _portsEnded = 0;
+    _replays++;
+    _start = millis();
+    _mode  = REPLAYING;
+    portEXIT_CRITICAL(&_mux);
+    return true;
+}
+
+void UartCapture::stop() {
+    portENTER_CRITICAL(&_mux);
+    _mode = IDLE;
+    portEXIT_CRITICAL(&_mux);
+}
+
+bool UartCapture::pushRecord(uint32_t timeMs, char port, const uint8_t *data, uint16_t length) {
+    uint8_t record[CAPTURE_RECORD_HEADER + CAPTURE_CHUNK_SIZE];
+    record[0] = (uint8_t)timeMs;
+    record[1] = (uint8_t)(timeMs >> 8);
+    record[2] = (uint8_t)(timeMs >> 16);
+    record[3] = (uint8_t)(timeMs >> 24);
+    record[4] = (uint8_t)port;
+    memcpy(record + CAPTURE_RECORD_HEADER, data, length);
+
+    uint16_t size = CAPTURE_RECORD_HEADER + length;
+    if (!_ring.fits(size)) return false;
+    while (!_ring.push(record, size)) {
+        _ring.pop(1);  // Oldest first: keep the most recent stretch
+        _dropped++;
+    }
+    _lastTime = timeMs;
+    return true;
+}
+
+void UartCapture::append(char port, const uint8_t *data, uint16_t length) {
+    if (length == 0 || length > CAPTURE_CHUNK_SIZE) return;
+
+    portENTER_CRITICAL(&_mux);
+    if (_mode == RECORDING) {
+        pushRecord(millis() - _start, port, data, length);
+    }
+    portEXIT_CRITICAL(&_mux);
+}
+
+UartCapture::ReplayStep UartCapture::replayNext(Cursor &cursor, char port, uint8_t *buffer, uint16_t &length,
+                                                uint32_t &waitMs) {
+    ReplayStep step = REPLAY_END;
+    bool skipping   = true;
+
+    // A mostly-UWB capture can put hundreds of records between two RFID ones: skip them
+    // CAPTURE_SKIP_RECORDS at a time, so interrupts are masked only briefly on this core
+    while (skipping) {
+        skipping = false;
+        portENTER_CRITICAL(&_mux);
+        if (_mode == REPLAYING) {
+            if (cursor.pass != _replays) {
+                cursor.pass   = _replays;
+                cursor.offset = _ring.head();
+                cursor.index  = 0;
+                cursor.ended  = false;
+            }
+
+            // Skip the other ports' records; each one is passed once per replay
+            uint16_t skipped = 0;
+            while (!cursor.ended && cursor.index < _ring.count()) {
+                uint32_t offset = cursor.offset;
+                uint16_t size   = _ring.lengthAt(offset);
+                const uint8_t *record = _ring.store().at(offset + 2);
+                if ((char)record[4] != port) {
+                    cursor.offset = FrameRing<RamFrameStore>::next(offset, size);
+                    cursor.index++;
+                    if (++skipped >= CAPTURE_SKIP_RECORDS) {
+                        skipping = true;  // Drop the lock; mode and pass are checked again
+                        break;
+                    }
+                    continue;
+                }
+
+                uint32_t elapsed = millis() - _start;
+                uint32_t due     = readTime(record);
+                if (!_maxSpeed && elapsed < due) {
+                    waitMs = due - elapsed;
+                    step   = REPLAY_WAIT;
+                    break;
+                }
+                length = size - CAPTURE_RECORD_HEADER;
+                memcpy(buffer, record + CAPTURE_RECORD_HEADER, length);
+                cursor.offset = FrameRing<RamFrameStore>::next(offset, size);
+                cursor.index++;
+                step = REPLAY_CHUNK;
+                break;
+            }
+
+            if (!skipping && step == REPLAY_END && !cursor.ended) {
+                cursor.ended = true;
+                if (++_portsEnded >= _ports) {
+                    _mode = IDLE;  // Every port is through: back to live input
+                }
+            }
+        }
+        portEXIT_CRITICAL(&_mux);
+    }
+    return step;
+}
+
+// "<ms> <port> <hex>"; longer chunks than a record holds are split
+bool UartCapture::loadLine(const char *line, size_t length) {
+    const char *p   = line;
+    const char *end = line + length;
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p == end) return true;
+
+    if (*p == '#') {
+        unsigned mac;
+        float x, y;
+        char text[64];
+        size_t n = end - p < (ptrdiff_t)sizeof(text) - 1 ? end - p : sizeof(text) - 1;
+        memcpy(text, p, n);
+        text[n] = '\0';
+        if (sscanf(text, "# anchor %x %f %f", &mac, &x, &y) == 3) {
+            _anchors.set((uint16_t)mac, x, y);
+        }
+        return true;
+    }
+
+    uint32_t timeMs = 0;
+    const char *digits = p;
+    while (p < end && *p >= '0' && *p <= '9') {
+        timeMs = timeMs * 10 + (*p++ - '0');
+    }
+    if (p == digits || p == end || *p != ' ') return false;
+    p++;
+    char port = p < end ? *p++ : 0;
+    if (!isPort(port) || p == end || *p != ' ') return false;
+    p++;
+    if (timeMs < _lastTime && _ring.count() > 0) return false;
+
+    uint8_t chunk[CAPTURE_CHUNK_SIZE];
+    uint16_t used = 0;
+    while (p + 1 < end && hexValue(p[0]) >= 0) {
+        int high = hexValue(p[0]);
+        int low  = hexValue(p[1]);
+        if (low < 0) return false;
+        chunk[used++] = (uint8_t)(high << 4 | low);
+        p += 2;
+        if (used == sizeof(chunk)) {
+            pushRecord(timeMs, port, chunk, used);
+            used = 0;
+        }
+    }
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) p++;
+    if (p != end) return false;
+    if (used > 0) pushRecord(timeMs, port, chunk, used);
+    return true;
+}
+
+UartCapture::LoadResult UartCapture::loadPart(const uint8_t *payload, size_t length) {
+    if (!enabled() || _mode != IDLE) return LOAD_REJECTED;
+
+    const char *text = (const char *)payload;
+    const char *end  = text + length;
+    unsigned part;
+    char header[24];
+    const char *eol = (const char *)memchr(text, '\n', length);
+    size_t headerLength = (eol ? eol : end) - text;
+    if (headerLength >= sizeof(header)) return LOAD_REJECTED;
+    memcpy(header, text, headerLength);
+    header[headerLength] = '\0';
+    if (sscanf(header, "# part %u", &part) != 1) return LOAD_REJECTED;
+
+    if (part == 0) {
+        _ring.pop(_ring.count());
+        _anchors      = AnchorMap();
+        _dropped      = 0;
+        _lastTime     = 0;
+        _recorded     = false;
+        _loadNextPart = 0;
+        _generation++;
+    }
+    if (part != _loadNextPart) {
+        _loadNextPart = UINT32_MAX;
+        return LOAD_REJECTED;
+    }
+
+    bool ended = false;
+    for (const char *line = text; line < end;) {
+        const char *next = (const char *)memchr(line, '\n', end - line);
+        if (!next) next = end;
+        if (next - line >= 5 && strncmp(line, "# end", 5) == 0) {
+            ended = true;
+        } else if (!loadLine(line, next - line)) {
+            _loadNextPart = UINT32_MAX;
+            return LOAD_REJECTED;
+        }
+        line = next + 1;
+    }
+
+    if (ended) {
+        _loadNextPart = UINT32_MAX;
+        return LOAD_COMPLETE;
+    }
+    _loadNextPart++;
+    return LOAD_PARTIAL;
+}
+
+void UartCapture::startUpload(Cursor &cursor) const {
+    cursor.pass   = _generation;
+    cursor.offset = _ring.head();
+    cursor.index  = 0;
+    cursor.part   = 0;
+    cursor.ended  = false;
+}
+
+static size_t formatRecord(char *line, uint32_t timeMs, char port, const uint8_t *data, uint16_t length) {
+    static const char digits[] = "0123456789abcdef";
+    size_t n = snprintf(line, CAPTURE_LINE_SIZE, "%lu %c ", (unsigned long)timeMs, port);
+    for (uint16_t i = 0; i < length; i++) {
+        line[n++] = digits[data[i] >> 4];
+        line[n++] = digits[data[i] & 0x0f];
+    }
+    line[n++] = '\n';
+    return n;
+}
+
+size_t UartCapture::writePart(Print &out, Cursor &cursor, size_t maxBytes) {
+    if (cursor.ended || cursor.pass != _generation || _mode == RECORDING) return 0;
+
+    // Formatted a line at a time, one write per line
+    char line[CAPTURE_LINE_SIZE];
+    size_t n       = snprintf(line, sizeof(line), "# part %lu\n", (unsigned long)cursor.part);
+    size_t written = out.write((const uint8_t *)line, n);
+    if (cursor.part == 0) {
+        if (_recorded) {
+            n = snprintf(line, sizeof(line), "# OptiFlow UART trace: device capture from %lu ms uptime", _start);
+        } else {
+            n = snprintf(line, sizeof(line), "# OptiFlow UART trace: loaded over MQTT");
+        }
+        n += snprintf(line + n, sizeof(line) - n, ", %lu chunks, %lu bytes, %lu dropped, %lu ms\n",
+                      (unsigned long)records(), (unsigned long)bytes(), (unsigned long)_dropped,
+                      (unsigned long)_lastTime);
+        written += out.write((const uint8_t *)line, n);
+        for (uint8_t i = 0; i < _anchors.size(); i++) {
+            uint16_t mac;
+            float x, y;
+            _anchors.at(i, mac, x, y);
+            n = snprintf(line, sizeof(line), "# anchor 0x%04x %.1f %.1f\n", mac, x, y);
+            written += out.write((const uint8_t *)line, n);
+        }
+    }
+
+    const size_t endReserve = 16;  // "# end <parts>"
+    uint32_t recordsInPart  = 0;
+    while (cursor.index < _ring.count()) {
+        uint32_t offset = cursor.offset;
+        uint16_t size   = _ring.lengthAt(offset);
+        const uint8_t *record = _ring.store().at(offset + 2);
+        n = formatRecord(line, readTime(record), (char)record[4], record + CAPTURE_RECORD_HEADER,
+                         size - CAPTURE_RECORD_HEADER);
+        if (recordsInPart > 0 && written + n + endReserve > maxBytes) break;
+        written += out.write((const uint8_t *)line, n);
+        cursor.offset = FrameRing<RamFrameStore>::next(offset, size);
+        cursor.index++;
+        recordsInPart++;
+    }
+
+    cursor.part++;
+    if (cursor.index >= _ring.count()) {
+        n = snprintf(line, sizeof(line), "# end %lu\n", (unsigned long)cursor.part);
+        written += out.write((const uint8_t *)line, n);
+        cursor.ended = true;
+    }
+    return written;
+}
+
+TracePort::TracePort()
+    : _port(0), _serial(NULL), _rx(NULL), _capture(NULL), _cursor(), _index(0), _length(0) {}
+
+void TracePort::attach(char port, HardwareSerial *serial, UartRxNotifier *rx, UartCapture *capture) {
+    _port    = port;
+    _serial  = serial;
+    _rx      = rx;
+    _capture = capture;
+    if (_capture) _capture->attachPort();
+}
+
+UartCapture::ReplayStep TracePort::pullReplay(uint32_t &waitMs) {
+    // The module keeps talking; its output is not what the tasks see now
+    while (_serial->available() > 0) {
+        _serial->read(_buffer, sizeof(_buffer));
+    }
+    return _capture->replayNext(_cursor, _port, _buffer, _length, waitMs);
+}
+
+bool TracePort::pull() {
+    _index  = 0;
+    _length = 0;
+    UartCapture::Mode mode = _capture ? _capture->mode() : UartCapture::IDLE;
+    if (mode == UartCapture::REPLAYING) {
+        uint32_t waitMs;
+        if (pullReplay(waitMs) == UartCapture::REPLAY_CHUNK) return true;
+        _length = 0;
+        return false;
+    }
+
+    int available = _serial->available();
+    if (available <= 0) return false;
+    _length = _serial->read(_buffer, available < (int)sizeof(_buffer) ? available : sizeof(_buffer));
+    if (mode == UartCapture::RECORDING) {
+        _capture->append(_port, _buffer, _length);
+    }
+    return _length > 0;
+}
+
+bool TracePort::wait(unsigned long timeoutMs) {
+    TracePort *self = this;
+    return waitAny(&self, 1, timeoutMs);
+}
+
+bool TracePort::waitAny(TracePort *const *ports, uint8_t count, unsigned long timeoutMs) {
+    for (uint8_t i = 0; i < count; i++) {
+        if (ports[i]->_index < ports[i]->_length) return true;
+    }
+
+    UartCapture *capture = ports[0]->_capture;
+    if (capture && capture->mode() == UartCapture::REPLAYING) {
+        uint32_t soonest = timeoutMs;
+        for (uint8_t i = 0; i < count; i++) {
+            TracePort &port = *ports[i];
+            uint32_t waitMs = timeoutMs;
+            port._index  = 0;
+            port._length = 0;
+            UartCapture::ReplayStep step = port.pullReplay(waitMs);
+            if (step == UartCapture::REPLAY_CHUNK) return true;
+            port._length = 0;
+            if (step == UartCapture::REPLAY_WAIT && waitMs < soonest) soonest = waitMs;
+        }
+        vTaskDelay(soonest > 0 ? pdMS_TO_TICKS(soonest) + 1 : 1);  // Round up: wake when the record is due
+    } else {
+        // Arm every port before checking, so an event between the check and the take is not lost
+        bool ready = false;
+        for (uint8_t i = 0; i < count; i++) {
+            ports[i]->_rx->arm();
+            ready = ready || ports[i]->_serial->available() > 0;
+        }
+        if (!ready) ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+        for (uint8_t i = 0; i < count; i++) {
+            ports[i]->_rx->disarm();
+        }
+    }
+
+    for (uint8_t i = 0; i < count; i++) {
+        if (ports[i]->available() > 0) return true;
+    }
+    return false;
+}
@@ -0,0 +1,215 @@
+#ifndef _UART_CAPTURE_H_
+#define _UART_CAPTURE_H_
+
+#include <Arduino.h>
+#include <HardwareSerial.h>
+#include "FRAME_RING.h"
+#include "POSITION_SOLVER.h"
+#include "UART_RX_NOTIFIER.h"
+
+#ifndef CAPTURE_FALLBACK_BYTES
+#define CAPTURE_FALLBACK_BYTES (32UL * 1024UL)  // Ring size when the board has no PSRAM
+#endif
+
+#define CAPTURE_CHUNK_SIZE    128  // Max bytes per record: one TracePort refill
+#define CAPTURE_RECORD_HEADER 5    // u32 ms since the capture started, port
+#define CAPTURE_MAX_READERS   3    // RFID modules: ports R, S, T
+#define CAPTURE_SKIP_RECORDS  16   // Other ports' records a replay cursor skips per hold of the lock
+
+// Port letters, as in the host trace format (firmware/host/UART_TRACE.h)
+#define CAPTURE_PORT_RFID 'R'  // First RFID module; module i is CAPTURE_PORT_RFID + i
+#define CAPTURE_PORT_UWB  'U'
+
+/*
+ Recorded UART input of the reader tasks, in a RAM ring (PSRAM when found).
+
+ Each record is one chunk a TracePort pulled from its UART, stamped with
+ the time since the capture started. When the ring is full the oldest
+ records are dropped, so a capture holds the most recent minutes before it
+ was stopped. The same ring replays into the TracePorts, either at the
+ recorded pace or as fast as the tasks consume it, and comes from a capture
+ or from a trace loaded over MQTT.
+
+ As text the ring is the host trace format ("<ms> <R|U> <hex>" lines, plus
+ "# anchor" lines for the anchor map in effect), cut into parts that each
+ open with "# part <n>", the last one closing with "# end <parts>".
+
+ Modes are changed by one task (outputTask); TracePorts on other tasks
+ append and replay under a short critical section.
+*/
+class UartCapture {
+   public:
+    enum Mode : uint8_t { IDLE, RECORDING, REPLAYING };
+
+    enum ReplayStep { REPLAY_CHUNK, REPLAY_WAIT, REPLAY_END };
+
+    enum LoadResult { LOAD_PARTIAL, LOAD_COMPLETE, LOAD_REJECTED };
+
+    // Place in the ring, oldest record first
+    struct Cursor {
+        uint32_t pass;    // generation() for uploads, replay number for replays
+        uint32_t offset;
+        uint32_t index;   // Records passed
+        uint32_t part;    // Uploads: next part number
+        bool ended;
+    };
+
+    UartCapture();
+
+    /*! @brief Allocate the ring (PSRAM if found, else capped at CAPTURE_FALLBACK_BYTES).
+        @return False if nothing could be allocated; capture and replay stay disabled.*/
+    bool begin(uint32_t bytes);
+
+    bool enabled() const {
+        return _buffer != NULL;
+    }
+
+    Mode mode() const {
+        return _mode;
+    }
+
+    /*! @brief Empty the ring and record every TracePort from now on.
+        @param anchors Map in effect, written into the trace header.*/
+    bool startRecording(const AnchorMap &anchors);
+
+    /*! @brief Feed the ring to the TracePorts in place of their UARTs.
+        @param maxSpeed Deliver every record as soon as it is asked for instead of at its time.
+        Ends by itself once every port has consumed its records.*/
+    bool startReplay(bool maxSpeed);
+
+    /*! @brief Back to live input. The ring is kept.*/
+    void stop();
+
+    /*! @brief Take one MQTT message of a trace (parts as produced by writePart()).
+        Part 0 empties the ring; a part out of sequence or a malformed line rejects the load.*/
+    LoadResult loadPart(const uint8_t *payload, size_t length);
+
+    /*! @brief Changes whenever the ring's contents are replaced.*/
+    uint32_t generation() const {
+        return _generation;
+    }
+
+    /*! @brief Start an upload from the oldest record.*/
+    void startUpload(Cursor &cursor) const;
+
+    /*! @brief Write the next text part of at most maxBytes (at least one record), advancing cursor.
+        @return Bytes written; 0 once the last part is out or the contents changed.*/
+    size_t writePart(Print &out, Cursor &cursor, size_t maxBytes);
+
+    /*! @brief TracePort side: record a chunk (only while RECORDING).*/
+    void append(char port, const uint8_t *data, uint16_t length);
+
+    /*! @brief TracePort side: copy the port's next record into buffer (CAPTURE_CHUNK_SIZE) if it is due.
+        @param waitMs Out, for REPLAY_WAIT: ms until it is.*/
+    ReplayStep replayNext(Cursor &cursor, char port, uint8_t *buffer, uint16_t &length, uint32_t &waitMs);
+
+    /*! @brief Each TracePort attached to the capture counts towards the end of a replay.*/
+    void attachPort();
+
+    uint32_t records() const {
+        return _ring.count();
+    }
+
+    /*! @brief UART bytes held, excluding record headers.*/
+    uint32_t bytes() const {
+        return _ring.bytes() - _ring.count() * CAPTURE_RECORD_HEADER;
+    }
+
+    /*! @brief Records lost to a full ring since the capture started.*/
+    uint32_t dropped() const {
+        return _dropped;
+    }
+
+    /*! @brief Time of the newest record.*/
+    uint32_t durationMs() const {
+        return _lastTime;
+    }
+
+   private:
+    bool pushRecord(uint32_t timeMs, char port, const uint8_t *data, uint16_t length);
+    bool loadLine(const char *line, size_t length);
+
+    FrameRing<RamFrameStore> _ring;
+    uint8_t *_buffer;
+    volatile Mode _mode;
+    bool _maxSpeed;
+    uint8_t _ports;
+    uint8_t _portsEnded;
+    uint32_t _generation;
+    uint32_t _replays;
+    uint32_t _dropped;
+    uint32_t _lastTime;
+    unsigned long _start;        // millis() when recording or replay started
+    bool _recorded;              // Contents are a capture, not a loaded trace
+    uint32_t _loadNextPart;      // UINT32_MAX: no load in progress
+    AnchorMap _anchors;
+    portMUX_TYPE _mux;
+};
+
+/*
+ Stand-in for a UART as seen by its reader task. Live, it pulls what the
+ driver has buffered in chunks of up to CAPTURE_CHUNK_SIZE (one bulk read
+ instead of one driver call per byte) and hands them to the capture while
+ recording. While the capture replays, it serves recorded chunks instead
+ and discards what the module sends. Writes always go to the UART.
+ One task reads a port.
+*/
+class TracePort final : public Stream {
+   public:
+    TracePort();
+
+    /*! @brief Read serial through rx (already attached to it) as the given capture port; capture may be NULL.*/
+    void attach(char port, HardwareSerial *serial, UartRxNotifier *rx, UartCapture *capture);
+
+    int available() override {
+        if (_index < _length || pull()) return _length - _index;
+        return 0;
+    }
+
+    int read() override {
+        if (_index >= _length && !pull()) return -1;
+        return _buffer[_index++];
+    }
+
+    int peek() override {
+        if (_index >= _length && !pull()) return -1;
+        return _buffer[_index];
+    }
+
+    size_t write(uint8_t c) override {
+        return _serial->write(c);
+    }
+
+    size_t write(const uint8_t *data, size_t size) override {
+        return _serial->write(data, size);
+    }
+    using Print::write;
+
+    /*! @brief Block the calling task until bytes are available or timeoutMs elapses.
+        @return True if data is available.*/
+    bool wait(unsigned long timeoutMs);
+
+    /*! @brief wait() on several ports read by the calling task (e.g. one per RFID module), all on one capture.
+        @return True if any of them has data.*/
+    static bool waitAny(TracePort *const *ports, uint8_t count, unsigned long timeoutMs);
+
+    /*! @brief Adapter for Unit_UHF_RFID::setRxWait().*/
+    static void waitCallback(void *context, unsigned long timeoutMs) {
+        static_cast<TracePort *>(context)->wait(timeoutMs);
+    }
+
+   private:
+    bool pull();
+    UartCapture::ReplayStep pullReplay(uint32_t &waitMs);
+
+    char _port;
+    HardwareSerial *_serial;
+    UartRxNotifier *_rx;
+    UartCapture *_capture;
+    UartCapture::Cursor _cursor;
+    uint16_t _index;
+    uint16_t _length;
+    uint8_t _buffer[CAPTURE_CHUNK_SIZE];
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef _UART_RX_NOTIFIER_H_
+#define _UART_RX_NOTIFIER_H_
+
+#include <Arduino.h>
+#include <HardwareSerial.h>
+
+/*
+ Lets a task block until a HardwareSerial has RX data instead of polling it.
+
+ HardwareSerial on arduino-esp32 sits on the ESP-IDF UART driver: bytes are
+ moved into an ISR-filled ring buffer (sized with setRxBufferSize()) and the
+ driver's event task runs the onReceive() callback on RX-FIFO-full and
+ RX-timeout events. The callback just gives a task notification to whichever
+ task is currently inside wait().
+
+ Driver error events are counted for telemetry: overruns (RX FIFO or ring
+ buffer full, bytes lost) separately from line errors (break, framing, parity).
+*/
+class UartRxNotifier {
+   public:
+    UartRxNotifier() : _serial(NULL), _waiter(NULL), _overruns(0), _errors(0) {}
+
+    /*! @brief Hook the serial port's RX events. Call after serial->begin().
+        @param fifoFull RX FIFO fill level (bytes) that raises an event.
+        @param timeoutSymbols Idle time (in byte periods) after which pending bytes raise an event.*/
+    void attach(HardwareSerial *serial, uint8_t fifoFull, uint8_t timeoutSymbols) {
+        _serial = serial;
+        _serial->onReceive([this]() { notify(); }, false);
+        _serial->onReceiveError([this](hardwareSerial_error_t error) { countError(error); });
+        _serial->setRxFIFOFull(fifoFull);
+        _serial->setRxTimeout(timeoutSymbols);
+    }
+
+    /*! @brief Block the calling task until bytes are available or timeoutMs elapses.
+        @return True if data is available.*/
+    bool wait(unsigned long timeoutMs) {
+        // Register before re-checking so an event between the check and the take is not lost
+        _waiter = xTaskGetCurrentTaskHandle();
+        if (_serial->available() <= 0) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeoutMs));
+        }
+        _waiter = NULL;
+        return _serial->available() > 0;
+    }
+
+    /*! @brief Wake the calling task on this port's next RX event, to wait on several ports at once.
+        Check available() after arming, then block on the task notification; disarm() when done.*/
+    void arm() {
+        _waiter = xTaskGetCurrentTaskHandle();
+    }
+
+    void disarm() {
+        _waiter = NULL;
+    }
+
+    /*! @brief Adapter for Unit_UHF_RFID::setRxWait().*/
+    static void waitCallback(void *context, unsigned long timeoutMs) {
+        static_cast<UartRxNotifier *>(context)->wait(timeoutMs);
+    }
+
+    uint32_t overruns() const {
+        return _overruns;
+    }
+
+    uint32_t errors() const {
+        return _errors;
+    }
+
+   private:
+    void notify() {
+        TaskHandle_t waiter = _waiter;
+        if (waiter) {
+            xTaskNotifyGive(waiter);
+        }
+    }
+
+    // Runs on the driver's event task only
+    void countError(hardwareSerial_error_t error) {
+        if (error == UART_FIFO_OVF_ERROR || error == UART_BUFFER_FULL_ERROR) {
+            _overruns++;
+        } else if (error != UART_NO_ERROR) {
+            _errors++;
+        }
+    }
+
+    HardwareSerial *_serial;
+    volatile TaskHandle_t _waiter;
+    volatile uint32_t _overruns;
+    volatile uint32_t _errors;
+};
+
+#endif
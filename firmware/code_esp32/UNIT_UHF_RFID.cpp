@@ -3,7 +3,7 @@
  *
  * SPDX-License-Identifier: MIT
  */
-#include "Unit_UHF_RFID.h"
+#include "UNIT_UHF_RFID.h"
 #include "CMD.h"
 
 String hex2str(uint8_t num) {
@@ -14,49 +14,117 @@ String hex2str(uint8_t num) {
     }
 }
 
+/*! @brief Format raw bytes as lowercase hex into out (size * 2 + 1 chars).*/
+void Unit_UHF_RFID::formatHex(const uint8_t *data, size_t size, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    for (size_t i = 0; i < size; i++) {
+        out[i * 2]     = digits[data[i] >> 4];
+        out[i * 2 + 1] = digits[data[i] & 0x0f];
+    }
+    out[size * 2] = '\0';
+}
+
 /*! @brief Initialize the Unit UHF_RFID.*/
 void Unit_UHF_RFID::begin(HardwareSerial *serial, int baud, uint8_t RX, uint8_t TX, bool debug) {
-    _debug  = debug;
-    _serial = serial;
+    _debug         = debug;
+    _serial        = serial;
+    _input         = serial;
+    _rxIndex       = 0;
+    _rxLength      = 0;
+    _cardCount     = 0;
+    _streaming     = false;
+    _lastFrameTime = 0;
     _serial->begin(baud, SERIAL_8N1, RX, TX);
 }
 
+/*! @brief Let waitMsg() block in callback while the UART is idle instead of busy-waiting.
+    Pass NULL to restore polling.*/
+void Unit_UHF_RFID::setRxWait(RxWaitCallback callback, void *context) {
+    _rxWait        = callback;
+    _rxWaitContext = context;
+}
+
+/*! @brief Read module output from input instead of the serial port, e.g. a UART capture tap.
+    Commands still go out on the serial port given to begin().*/
+void Unit_UHF_RFID::setInput(Stream *input) {
+    _input = input;
+}
+
+/*! @brief Attribute reads from now on to source (0-7), e.g. the antenna in front of the module.
+    Each card collects the bits of every source that read it (CARD::sources).*/
+void Unit_UHF_RFID::setSource(uint8_t source) {
+    _sourceMask = (uint8_t)(1 << (source & 7));
+}
+
 /*! @brief Clear the buffer.*/
 void Unit_UHF_RFID::cleanBuffer() {
-    for (int i = 0; i < 200; i++) {
-        buffer[i] = 0;
-    }
+    memset(buffer, 0, sizeof(buffer));
+    _rxIndex  = 0;
+    _rxLength = 0;
 }
 
 /*! @brief Clear the card's data buffer.*/
 void Unit_UHF_RFID::cleanCardsBuffer() {
-    for (int i = 0; i < 200; i++) {
-        cards[i] = {rssi : 0, pc : {0}, epc : {0}, rssi_str : "", pc_str : "", epc_str : ""};
+    memset(cards, 0, _cardCount * sizeof(CARD));
+    _cardCount = 0;
+    _seen.clear();
+}
+
+/*! @brief Feed one received byte into the frame parser.
+    Frames are delimited by their PL field rather than by the 0x7E end byte,
+    which can legitimately appear inside an EPC.
+    @return True once a complete frame with a valid checksum is in buffer.*/
+bool Unit_UHF_RFID::feedByte(uint8_t b) {
+    if (_rxIndex == 0 && b != 0xbb) {
+        return false;  // Resync on the next header byte
     }
+    buffer[_rxIndex++] = b;
+
+    if (_rxIndex == 5) {
+        _rxLength = ((buffer[3] << 8) | buffer[4]) + RFID_FRAME_OVERHEAD;
+        if (_rxLength > sizeof(buffer)) {
+            _rxIndex = 0;
+            return false;
+        }
+    }
+    if (_rxIndex < 5 || _rxIndex < _rxLength) {
+        return false;
+    }
+
+    uint16_t length = _rxLength;
+    _rxIndex        = 0;
+    _rxLength       = 0;
+
+    uint8_t check = 0;
+    for (uint16_t i = 1; i < length - 2; i++) {
+        check += buffer[i];
+    }
+    return buffer[length - 2] == check && buffer[length - 1] == 0x7e;
+}
+
+/*! @brief Check whether buffer holds a 96-bit EPC tag notification.*/
+bool Unit_UHF_RFID::isTagNotification() {
+    return buffer[1] == 0x02 && buffer[2] == 0x22 && buffer[3] == 0x00 && buffer[4] == RFID_TAG_PARAM_SIZE;
 }
 
 /*! @brief Waiting for a period of time to receive a message
-    @return True if the message is available at the specified time and in the
-   specified range, otherwise false..*/
+    @return True if a valid frame is available at the specified time, otherwise false..*/
 bool Unit_UHF_RFID::waitMsg(unsigned long time) {
     unsigned long start = millis();
-    uint8_t i           = 0;
     cleanBuffer();
-    while (_serial->available() || (millis() - start) < time) {
-        if (_serial->available()) {
-            uint8_t b = _serial->read();
-            buffer[i] = b;
-            i++;
-            if (b == 0x7e) {
-                break;
+    while (_input->available() || (millis() - start) < time) {
+        if (_input->available()) {
+            if (feedByte(_input->read())) {
+                return true;
+            }
+        } else if (_rxWait) {
+            unsigned long elapsed = millis() - start;
+            if (elapsed < time) {
+                _rxWait(_rxWaitContext, time - elapsed);
             }
         }
     }
-    if (buffer[0] == 0xbb && buffer[i - 1] == 0x7e) {
-        return true;
-    } else {
-        return false;
-    }
+    return false;
 }
 
 /*! @brief Send command.*/
@@ -64,74 +132,82 @@ void Unit_UHF_RFID::sendCMD(uint8_t *data, size_t size) {
     _serial->write(data, size);
 }
 
-/*! @brief Filter the received message.*/
-bool Unit_UHF_RFID::filterCardInfo(String epc) {
-    for (int i = 0; i < 200; i++) {
-        if (epc == cards[i].epc_str) {
-            return false;
-        }
-    }
-    return true;
+/*! @brief Fold another read of an already stored tag into its aggregates.*/
+void Unit_UHF_RFID::aggregateCardInfo(CARD *card) {
+    int8_t rssi = (int8_t)buffer[5];
+    if (rssi < card->rssiMin) card->rssiMin = rssi;
+    if (rssi > card->rssiMax) card->rssiMax = rssi;
+    card->rssiSum += rssi;
+    card->lastSeen = millis();
+    card->sources |= _sourceMask;
+    if (card->readCount < 0xffff) card->readCount++;
 }
 
-/*! @brief Svae the card information.*/
-bool Unit_UHF_RFID::saveCardInfo(CARD *card) {
-    String rssi = hex2str(buffer[5]);
-    String pc   = hex2str(buffer[6]) + hex2str(buffer[7]);
-    String epc  = "";
-
-    for (uint8_t i = 8; i < 20; i++) {
-        epc += hex2str(buffer[i]);
-    }
-
-    if (!filterCardInfo(epc)) {
+/*! @brief Svae the card information.
+    @param card Slot for a new EPC, or NULL once cards[] is full.
+    @param count Index the card will occupy if its EPC has not been seen this round.
+    @return False if the EPC is a duplicate (its read is aggregated instead).*/
+bool Unit_UHF_RFID::saveCardInfo(CARD *card, uint16_t count) {
+    uint16_t existing;
+    if (card == NULL) {
+        existing = _seen.find(&buffer[8]);
+        if (existing != _seen.NOT_FOUND) {
+            aggregateCardInfo(&cards[existing]);
+        }
         return false;
     }
-
-    for (uint8_t i = 8; i < 20; i++) {
-        card->epc[i - 8] = buffer[i];
+    if (!_seen.insert(&buffer[8], count, &existing)) {
+        if (existing != _seen.NOT_FOUND) {
+            aggregateCardInfo(&cards[existing]);
+        }
+        return false;
     }
 
+    memcpy(card->epc, &buffer[8], RFID_EPC_SIZE);
     card->rssi  = buffer[5];
     card->pc[0] = buffer[6];
     card->pc[1] = buffer[7];
 
-    card->rssi_str = rssi;
-    card->pc_str   = pc;
-    card->epc_str  = epc;
+    card->readCount = 1;
+    card->rssiMin   = (int8_t)buffer[5];
+    card->rssiMax   = (int8_t)buffer[5];
+    card->rssiSum   = (int8_t)buffer[5];
+    card->firstSeen = millis();
+    card->lastSeen  = card->firstSeen;
+    card->sources   = _sourceMask;
 
     if (_debug) {
-        Serial.println("pc: " + pc);
-        Serial.println("rssi: " + rssi);
-        Serial.println("epc: " + epc);
-        for (uint8_t i = 0; i < 24; i++) {
-            Serial.print(hex2str(buffer[i]));
-        }
-        Serial.println(" ");
+        char hex[(RFID_TAG_PARAM_SIZE + RFID_FRAME_OVERHEAD) * 2 + 1];
+        formatHex(card->pc, sizeof(card->pc), hex);
+        Serial.printf("pc: %s\n", hex);
+        formatHex(&card->rssi, 1, hex);
+        Serial.printf("rssi: %s\n", hex);
+        formatHex(card->epc, RFID_EPC_SIZE, hex);
+        Serial.printf("epc: %s\n", hex);
+        formatHex(buffer, RFID_TAG_PARAM_SIZE + RFID_FRAME_OVERHEAD, hex);
+        Serial.println(hex);
     }
     return true;
 }
 
-uint8_t Unit_UHF_RFID::pollingOnce() {
+uint16_t Unit_UHF_RFID::pollingOnce() {
     cleanCardsBuffer();
     sendCMD((uint8_t *)POLLING_ONCE_CMD, sizeof(POLLING_ONCE_CMD));
-    uint8_t count = 0;
+    uint16_t count = 0;
     while (waitMsg()) {
-        if (buffer[23] == 0x7e) {
-            if (count < 200) {
-                if (saveCardInfo(&cards[count])) {
-                    count++;
-                }
-            } else {
-                return 200;
+        if (isTagNotification()) {
+            // Keep draining once cards[] is full so repeat reads are still aggregated
+            if (saveCardInfo(count < RFID_MAX_CARDS ? &cards[count] : NULL, count)) {
+                count++;
             }
         }
     }
+    _cardCount = count;
     return count;
 }
 
-uint8_t Unit_UHF_RFID::pollingMultiple(uint16_t polling_count) {
-    cleanCardsBuffer();
+/*! @brief Send the multiple polling command for polling_count rounds.*/
+void Unit_UHF_RFID::sendPollingMultiple(uint16_t polling_count) {
     memcpy(buffer, POLLING_MULTIPLE_CMD, sizeof(POLLING_MULTIPLE_CMD));
     buffer[6] = (polling_count >> 8) & 0xff;
     buffer[7] = (polling_count) & 0xff;
@@ -152,22 +228,91 @@ uint8_t Unit_UHF_RFID::pollingMultiple(uint16_t polling_count) {
     }
 
     sendCMD(buffer, sizeof(POLLING_MULTIPLE_CMD));
+}
+
+uint16_t Unit_UHF_RFID::pollingMultiple(uint16_t polling_count) {
+    cleanCardsBuffer();
+    sendPollingMultiple(polling_count);
 
-    uint8_t count = 0;
+    uint16_t count = 0;
     while (waitMsg()) {
-        if (buffer[23] == 0x7e) {
-            if (count < 200) {
-                if (saveCardInfo(&cards[count])) {
-                    count++;
-                }
-            } else {
-                break;
+        if (isTagNotification()) {
+            // Keep draining once cards[] is full so repeat reads are still aggregated
+            if (saveCardInfo(count < RFID_MAX_CARDS ? &cards[count] : NULL, count)) {
+                count++;
             }
         }
     }
+    _cardCount = count;
     return count;
 }
 
+/*! @brief Start an unbounded multiple polling inventory (streaming mode).
+    Tag notifications are then consumed incrementally by processStream().*/
+bool Unit_UHF_RFID::startContinuousPolling() {
+    // Maximum polling count; processStream() re-arms it if the module stops
+    sendPollingMultiple(0xffff);
+
+    cleanCardsBuffer();
+    _rxIndex       = 0;
+    _rxLength      = 0;
+    _streaming     = true;
+    _lastFrameTime = millis();
+    return true;
+}
+
+/*! @brief Stop multiple polling. Tag notifications still in flight are discarded.
+    @return True if the module acknowledged the stop command.*/
+bool Unit_UHF_RFID::stopMultiplePolling() {
+    _streaming = false;
+    sendCMD((uint8_t *)STOP_MULTIPLE_POLLING_CMD, sizeof(STOP_MULTIPLE_POLLING_CMD));
+    while (waitMsg()) {
+        if (buffer[1] == 0x01 && buffer[2] == 0x28) {
+            return buffer[5] == 0x00;
+        }
+    }
+    return false;
+}
+
+/*! @brief Start a new streaming cycle: forget the tags of the previous one.
+    A partially received frame is kept and completes in the new cycle.*/
+void Unit_UHF_RFID::beginStreamCycle() {
+    cleanCardsBuffer();
+}
+
+/*! @brief Parse whatever bytes are available without blocking.
+    @return Number of unique tags stored since beginStreamCycle().*/
+uint16_t Unit_UHF_RFID::processStream() {
+    while (_input->available()) {
+        if (!feedByte(_input->read())) {
+            continue;
+        }
+        _lastFrameTime = millis();
+        if (isTagNotification()) {
+            if (saveCardInfo(_cardCount < RFID_MAX_CARDS ? &cards[_cardCount] : NULL, _cardCount)) {
+                _cardCount++;
+            }
+        }
+    }
+
+    if (_streaming && millis() - _lastFrameTime > RFID_STREAM_REARM_MS) {
+        // Polling count exhausted or the module reset - start it again
+        sendPollingMultiple(0xffff);
+        _rxIndex       = 0;
+        _rxLength      = 0;
+        _lastFrameTime = millis();
+    }
+    return _cardCount;
+}
+
+uint16_t Unit_UHF_RFID::cardCount() {
+    return _cardCount;
+}
+
+bool Unit_UHF_RFID::isStreaming() {
+    return _streaming;
+}
+
 /*! @brief Get hardware version information.*/
 String Unit_UHF_RFID::getVersion() {
     sendCMD((uint8_t *)HARDWARE_VERSION_CMD, sizeof(HARDWARE_VERSION_CMD));
@@ -257,6 +402,78 @@ bool Unit_UHF_RFID::select(uint8_t *epc) {
     }
 }
 
+/*! @brief Finish the command frame in buffer[] (header, command and parameters
+    already in place), send it and wait for the module's answer.
+    @return True if the module answered the command with status 0x00.*/
+bool Unit_UHF_RFID::sendParameterCommand(uint16_t paramLength) {
+    uint8_t command = buffer[2];
+    buffer[3]       = (paramLength >> 8) & 0xff;
+    buffer[4]       = paramLength & 0xff;
+
+    uint8_t check = 0;
+    for (uint16_t i = 1; i < 5 + paramLength; i++) {
+        check += buffer[i];
+    }
+    buffer[5 + paramLength] = check;
+    buffer[6 + paramLength] = 0x7e;
+
+    sendCMD(buffer, paramLength + RFID_FRAME_OVERHEAD);
+    while (waitMsg()) {
+        if (buffer[1] != 0x01) continue;  // Tag notification still in flight
+        if (buffer[2] == command) return buffer[5] == 0x00;
+        if (buffer[2] == 0xff) return false;  // Error frame
+    }
+    return false;
+}
+
+/*! @brief Program the Select command the module sends before inventory rounds.
+    @param target RFID_SEL_TARGET_SL, or 0-3 for the inventoried flag of a session.
+    @param action Gen2 Select action (RFID_SEL_ACTION_MATCH).
+    @param pointerBits First bit of the mask in the memory bank.
+    @param maskBits Mask length, at most 96 bits.
+    @return True if the module accepted the parameters.*/
+bool Unit_UHF_RFID::setSelectParameter(uint8_t target, uint8_t action, uint8_t memBank, uint32_t pointerBits,
+                                       const uint8_t *mask, uint8_t maskBits) {
+    if (maskBits > RFID_EPC_SIZE * 8) return false;
+    uint8_t maskBytes = (maskBits + 7) / 8;
+
+    buffer[0]  = 0xBB;
+    buffer[1]  = 0x00;
+    buffer[2]  = SET_SELECT_PARAMETER_CMD[2];
+    buffer[5]  = (target & 0x07) << 5 | (action & 0x07) << 2 | (memBank & 0x03);
+    buffer[6]  = (pointerBits >> 24) & 0xff;
+    buffer[7]  = (pointerBits >> 16) & 0xff;
+    buffer[8]  = (pointerBits >> 8) & 0xff;
+    buffer[9]  = pointerBits & 0xff;
+    buffer[10] = maskBits;
+    buffer[11] = 0x00;  // Truncate off
+    memcpy(buffer + 12, mask, maskBytes);
+    if (maskBits % 8) {
+        buffer[11 + maskBytes] &= 0xff << (8 - maskBits % 8);  // Bits past the mask are sent as zero
+    }
+    return sendParameterCommand(7 + maskBytes);
+}
+
+/*! @brief When the module sends the programmed Select.
+    @param mode RFID_SELECT_MODE_ALWAYS or RFID_SELECT_MODE_NEVER.*/
+bool Unit_UHF_RFID::setSelectMode(uint8_t mode) {
+    memcpy(buffer, SET_SELECT_MODE_CMD, sizeof(SET_SELECT_MODE_CMD));
+    buffer[5] = mode;
+    return sendParameterCommand(1);
+}
+
+/*! @brief Query parameters of every inventory round (DR 8, FM0, pilot tone).
+    @param sel RFID_QUERY_SEL_ALL or RFID_QUERY_SEL_SL.
+    @param session Gen2 session 0-3. S2/S3 flags persist for seconds after a tag is read.
+    @param target Inventoried flag state that takes part (RFID_QUERY_TARGET_A / _B).*/
+bool Unit_UHF_RFID::setQueryParameters(uint8_t sel, uint8_t session, uint8_t target, uint8_t q) {
+    uint16_t param = 1 << 12 | (sel & 0x03) << 10 | (session & 0x03) << 8 | (target & 0x01) << 7 | (q & 0x0f) << 3;
+    memcpy(buffer, SET_QUERY_PARAMETER_CMD, sizeof(SET_QUERY_PARAMETER_CMD));
+    buffer[5] = (param >> 8) & 0xff;
+    buffer[6] = param & 0xff;
+    return sendParameterCommand(2);
+}
+
 bool Unit_UHF_RFID::writeCard(uint8_t *data, size_t size, uint8_t membank, uint16_t sa, uint32_t access_password) {
     memcpy(buffer, WRITE_STORAGE_CMD, sizeof(WRITE_STORAGE_CMD));
     buffer[5] = (access_password >> 24) & 0xff;
@@ -390,6 +607,31 @@ bool Unit_UHF_RFID::setTxPower(uint16_t db) {
     }
 }
 
+/*! @brief Hibernate the module: PA and baseband off until wake(). Inventory must be stopped.
+    @return True if the module acknowledged.*/
+bool Unit_UHF_RFID::sleep() {
+    sendCMD((uint8_t *)SLEEP_CMD, sizeof(SLEEP_CMD));
+    while (waitMsg()) {
+        if (buffer[1] == 0x01 && buffer[2] == 0x17) {
+            return buffer[5] == 0x00;
+        }
+    }
+    return false;
+}
+
+/*! @brief Wake the module from sleep(). The command that wakes it is lost, so the version
+    request is sent until answered.
+    @return True once the module responds.*/
+bool Unit_UHF_RFID::wake() {
+    for (uint8_t attempt = 0; attempt < RFID_WAKE_ATTEMPTS; attempt++) {
+        sendCMD((uint8_t *)HARDWARE_VERSION_CMD, sizeof(HARDWARE_VERSION_CMD));
+        while (waitMsg()) {
+            if (buffer[1] == 0x01 && buffer[2] == 0x03) return true;
+        }
+    }
+    return false;
+}
+
 /*! @brief Initialize the RFID module and wait for it to respond.*/
 void Unit_UHF_RFID::waitModuleInitialization() {    
     String info = "";
@@ -422,8 +664,8 @@ bool Unit_UHF_RFID::setRegion(uint8_t regionCode) {
     delay(200);
     
     // Clear response buffer
-    while (_serial->available()) {
-        _serial->read();
+    while (_input->available()) {
+        _input->read();
     }
     
     return true;
@@ -444,8 +686,8 @@ bool Unit_UHF_RFID::verifyRegion() {
     unsigned long start = millis();
     
     while (millis() - start < 1000 && idx < 40) {
-        if (_serial->available()) {
-            response[idx++] = _serial->read();
+        if (_input->available()) {
+            response[idx++] = _input->read();
         }
     }
     
@@ -500,8 +742,8 @@ bool Unit_UHF_RFID::setReceiverParams(uint8_t mixer_g, uint8_t if_g, uint16_t th
     setParamsCmd[sizeof(setParamsCmd) - 2] = checksum;
     
     // Clear any old data from the serial buffer
-    while (_serial->available()) {
-        _serial->read();
+    while (_input->available()) {
+        _input->read();
     }
 
     sendCMD(setParamsCmd, sizeof(setParamsCmd));
@@ -512,8 +754,8 @@ bool Unit_UHF_RFID::setReceiverParams(uint8_t mixer_g, uint8_t if_g, uint16_t th
     int responseIdx = 0;
 
     while (millis() - startTime < 500 && responseIdx < sizeof(response)) {
-        if (_serial->available()) {
-            response[responseIdx++] = _serial->read();
+        if (_input->available()) {
+            response[responseIdx++] = _input->read();
         }
     }
 
@@ -534,8 +776,11 @@ void Unit_UHF_RFID::displayTagInfo(uint8_t tagIndex) {
     Serial.printf("Tag #%d:\n", tagIndex + 1);
     Serial.printf("━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━━\n");
     
+    char hex[RFID_EPC_HEX_SIZE];
+
     // EPC - Electronic Product Code (main tag ID)
-    Serial.println("📱 EPC (Tag ID): " + cards[tagIndex].epc_str);
+    formatHex(cards[tagIndex].epc, RFID_EPC_SIZE, hex);
+    Serial.printf("📱 EPC (Tag ID): %s\n", hex);
     
     // RSSI - Received Signal Strength Indicator
     int rssi_dbm = (int8_t)cards[tagIndex].rssi;
@@ -543,7 +788,8 @@ void Unit_UHF_RFID::displayTagInfo(uint8_t tagIndex) {
                   rssi_dbm, getSignalQuality(rssi_dbm).c_str());
     
     // PC - Protocol Control
-    Serial.println("🔧 Protocol Control: " + cards[tagIndex].pc_str);
+    formatHex(cards[tagIndex].pc, sizeof(cards[tagIndex].pc), hex);
+    Serial.printf("🔧 Protocol Control: %s\n", hex);
     
     Serial.println();
 }
@@ -8,6 +8,7 @@
 
 #include <Arduino.h>
 #include "pins_arduino.h"
+#include "EPC_HASH_SET.h"
 
 /*
 
@@ -15,40 +16,124 @@ Header Type Command PL(MSB) PL(LSB) Parameter Checksum End
   BB    00     07     00      01        01       09     7E
                      param length
 
+Tag notification (BB 02 22), PL = 0x0011:
+  BB 02 22 00 11 | RSSI | PC(2) | EPC(12) | CRC(2) | Checksum | 7E
+
 */
 
+#define RFID_EPC_SIZE        12
+#define RFID_EPC_HEX_SIZE    (RFID_EPC_SIZE * 2 + 1)  // Hex digits plus terminator
+#define RFID_FRAME_OVERHEAD  7                        // Header, type, command, PL(2), checksum, end
+#define RFID_TAG_PARAM_SIZE  0x11                     // RSSI + PC + EPC + CRC
+
+// Override both with build flags (e.g. -DRFID_MAX_CARDS=1200 -DRFID_DEDUP_CAPACITY=2048) for dense racks
+#ifndef RFID_MAX_CARDS
+#define RFID_MAX_CARDS 200
+#endif
+
+// Dedup hash set slots - power of two, comfortably above RFID_MAX_CARDS
+#ifndef RFID_DEDUP_CAPACITY
+#define RFID_DEDUP_CAPACITY 512
+#endif
+
+static_assert(RFID_DEDUP_CAPACITY > RFID_MAX_CARDS, "RFID_DEDUP_CAPACITY must exceed RFID_MAX_CARDS");
+
+// Streaming mode: re-issue the multiple polling command if the module has been silent this long
+#ifndef RFID_STREAM_REARM_MS
+#define RFID_STREAM_REARM_MS 2000
+#endif
+
+// sleep()/wake(): the byte that wakes the module is lost, so wake() asks up to this many times
+#ifndef RFID_WAKE_ATTEMPTS
+#define RFID_WAKE_ATTEMPTS 3
+#endif
+
+// Inventory filtering (EPC Gen2 Select and Query flags), see setSelectParameter() / setQueryParameters()
+#define RFID_SEL_TARGET_SL            4     // Select target: the SL flag (0-3 = inventoried flag of S0-S3)
+#define RFID_SEL_ACTION_MATCH         0     // Matching tags assert the target, the others deassert it
+#define RFID_MEMBANK_EPC              1
+#define RFID_EPC_MEMORY_OFFSET_BITS   0x20  // EPC bank: CRC-16 and PC precede the EPC
+#define RFID_SELECT_MODE_ALWAYS       0x00  // Send Select before every inventory round
+#define RFID_SELECT_MODE_NEVER        0x01
+#define RFID_QUERY_SEL_ALL            0     // Query Sel field: every tag takes part
+#define RFID_QUERY_SEL_SL             3     // Only tags with SL asserted
+#define RFID_QUERY_TARGET_A           0
+#define RFID_QUERY_TARGET_B           1
+#define RFID_QUERY_Q                  4     // Initial slot count exponent (module default)
+
+// Tags are kept as raw bytes; format them with formatHex() only when a string is needed.
+// Repeat reads of the same EPC within one polling round are folded into the aggregates.
 struct CARD {
-    uint8_t rssi;
+    uint8_t rssi;                   // RSSI of the first read
     uint8_t pc[2];
-    uint8_t epc[12];
-    String rssi_str;
-    String pc_str;
-    String epc_str;
+    uint8_t epc[RFID_EPC_SIZE];
+    uint16_t readCount;             // Reads of this EPC during the round
+    int8_t rssiMin;                 // dBm
+    int8_t rssiMax;                 // dBm
+    int32_t rssiSum;                // dBm, divide by readCount for the mean
+    unsigned long firstSeen;        // millis() of the first read
+    unsigned long lastSeen;         // millis() of the last read
+    uint8_t sources;                // Bit per source (setSource()) that read the EPC
 };
 
+// Blocks the caller until RX data may be available or timeoutMs elapses
+typedef void (*RxWaitCallback)(void *context, unsigned long timeoutMs);
+
 class Unit_UHF_RFID {
    private:
     HardwareSerial *_serial;
+    Stream *_input;  // Where responses are read from: _serial unless setInput()
+    RxWaitCallback _rxWait = NULL;
+    void *_rxWaitContext   = NULL;
+    uint8_t _sourceMask    = 1;
+    uint16_t _rxIndex;
+    uint16_t _rxLength;
+    uint16_t _cardCount;
+    bool _streaming;
+    unsigned long _lastFrameTime;
     bool waitMsg(unsigned long timerout = 500);
+    bool feedByte(uint8_t b);
+    bool isTagNotification();
     void cleanBuffer();
     void cleanCardsBuffer();
-    bool saveCardInfo(CARD *card);
-    bool filterCardInfo(String epc);
+    bool saveCardInfo(CARD *card, uint16_t count);
+    void aggregateCardInfo(CARD *card);
+    void sendPollingMultiple(uint16_t polling_count);
+    bool sendParameterCommand(uint16_t paramLength);
+    EpcHashSet<RFID_DEDUP_CAPACITY> _seen;
 
    public:
     bool _debug;
     uint8_t buffer[256] = {0};
-    CARD cards[200];
+    CARD cards[RFID_MAX_CARDS];
 
    public:
     void begin(HardwareSerial *serial = &Serial2, int baud = 115200, uint8_t RX = 16, uint8_t TX = 17,
                bool debug = false);
+    void setRxWait(RxWaitCallback callback, void *context);
+    void setInput(Stream *input);
+    void setSource(uint8_t source);
     String getVersion();
     String selectInfo();
-    uint8_t pollingOnce();
-    uint8_t pollingMultiple(uint16_t polling_count);
+    uint16_t pollingOnce();
+    uint16_t pollingMultiple(uint16_t polling_count);
+
+    // Continuous inventory: the module keeps multi-polling and tag notifications are
+    // parsed as they arrive. Stop streaming before issuing any other command.
+    bool startContinuousPolling();
+    bool stopMultiplePolling();
+    void beginStreamCycle();
+    uint16_t processStream();
+    uint16_t cardCount();
+    bool isStreaming();
     bool select(uint8_t *epc);
+    bool setSelectParameter(uint8_t target, uint8_t action, uint8_t memBank, uint32_t pointerBits, const uint8_t *mask,
+                            uint8_t maskBits);
+    bool setSelectMode(uint8_t mode);
+    bool setQueryParameters(uint8_t sel, uint8_t session, uint8_t target, uint8_t q = RFID_QUERY_Q);
     bool setTxPower(uint16_t db);
+    bool sleep();
+    bool wake();
     void sendCMD(uint8_t *data, size_t size);
     bool writeCard(uint8_t *data, size_t size, uint8_t membank, uint16_t sa, uint32_t access_password = 0);
     bool readCard(uint8_t *data, size_t size, uint8_t membank, uint16_t sa, uint32_t access_password = 0);
@@ -64,6 +149,7 @@ class Unit_UHF_RFID {
     void displayTagInfo(uint8_t tagIndex);
     bool readTID(uint8_t tagIndex);
     String getSignalQuality(int rssi);
+    static void formatHex(const uint8_t *data, size_t size, char *out);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,185 @@
+#include "UWB_SESSION_PARSER.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static const char SESSION_HEADER[] = "SESSION_INFO_NTF:";
+static const uint8_t SESSION_HEADER_LENGTH = sizeof(SESSION_HEADER) - 1;
+
+UWBSessionParser::UWBSessionParser() {
+    memset(&_session, 0, sizeof(_session));
+    reset();
+}
+
+void UWBSessionParser::reset() {
+    _state         = SEEK_HEADER;
+    _headerMatch   = 0;
+    _sessionChars  = 0;
+    _inMeasurement = false;
+    _quoted        = false;
+    _keyLength     = 0;
+    _valueLength   = 0;
+}
+
+const char *UWBSessionParser::statusName(UWBStatus status) {
+    switch (status) {
+        case UWB_STATUS_SUCCESS:    return "SUCCESS";
+        case UWB_STATUS_RX_TIMEOUT: return "RX_TIMEOUT";
+        case UWB_STATUS_FAILED:     return "FAILED";
+        default:                    return "UNKNOWN";
+    }
+}
+
+void UWBSessionParser::formatMac(uint16_t mac, char *out) {
+    static const char digits[] = "0123456789abcdef";
+    out[0] = '0';
+    out[1] = 'x';
+    for (uint8_t i = 0; i < 4; i++) {
+        out[2 + i] = digits[(mac >> (12 - 4 * i)) & 0x0f];
+    }
+    out[6] = '\0';
+}
+
+void UWBSessionParser::beginSession() {
+    _session.sessionHandle  = 0;
+    _session.sequenceNumber = 0;
+    _session.blockIndex     = 0;
+    _session.nMeasurements  = 0;
+    _session.valid          = false;
+    _inMeasurement          = false;
+    _quoted                 = false;
+    _keyLength              = 0;
+    _valueLength            = 0;
+    _sessionChars           = 0;
+}
+
+/*! @brief Store the key/value pair that just ended.*/
+void UWBSessionParser::commitField() {
+    _key[_keyLength]     = '\0';
+    _value[_valueLength] = '\0';
+
+    if (_inMeasurement) {
+        if (_session.nMeasurements >= UWB_MAX_MEASUREMENTS) {
+            return;
+        }
+        UWBMeasurement &m = _session.measurements[_session.nMeasurements];
+        if (strcmp(_key, "mac_address") == 0) {
+            m.macAddress = (uint16_t)strtoul(_value, NULL, 16);  // Accepts the 0x prefix
+        } else if (strcmp(_key, "status") == 0) {
+            if (strcmp(_value, "SUCCESS") == 0) {
+                m.status = UWB_STATUS_SUCCESS;
+            } else if (strcmp(_value, "RX_TIMEOUT") == 0) {
+                m.status = UWB_STATUS_RX_TIMEOUT;
+            } else {
+                m.status = UWB_STATUS_FAILED;
+            }
+        } else if (strcmp(_key, "distance[cm]") == 0) {
+            m.distanceCm = (int)strtol(_value, NULL, 10);
+        }
+    } else if (strcmp(_key, "session_handle") == 0) {
+        _session.sessionHandle = strtoul(_value, NULL, 10);
+    } else if (strcmp(_key, "sequence_number") == 0) {
+        _session.sequenceNumber = strtoul(_value, NULL, 10);
+    } else if (strcmp(_key, "block_index") == 0) {
+        _session.blockIndex = strtoul(_value, NULL, 10);
+    }
+    // n_measurements is implied by the number of [...] blocks actually received
+}
+
+/*! @brief Handle a structural character between fields.
+    @return True if it closed the session.*/
+bool UWBSessionParser::handleDelimiter(char c) {
+    if (c == '[') {
+        _inMeasurement = true;
+        if (_session.nMeasurements < UWB_MAX_MEASUREMENTS) {
+            UWBMeasurement &m = _session.measurements[_session.nMeasurements];
+            m.macAddress      = 0;
+            m.status          = UWB_STATUS_UNKNOWN;
+            m.distanceCm      = -1;
+        }
+    } else if (c == ']') {
+        if (_inMeasurement && _session.nMeasurements < UWB_MAX_MEASUREMENTS) {
+            UWBMeasurement &m = _session.measurements[_session.nMeasurements];
+            if (m.status != UWB_STATUS_SUCCESS) {
+                m.distanceCm = -1;
+            }
+            _session.nMeasurements++;
+        }
+        _inMeasurement = false;
+    } else if (c == '}') {
+        _session.valid = true;
+        _state         = SEEK_HEADER;
+        return true;
+    }
+    return false;
+}
+
+bool UWBSessionParser::feed(char c) {
+    // Track the header in every state so a truncated session resynchronizes
+    if (c == SESSION_HEADER[_headerMatch]) {
+        if (++_headerMatch == SESSION_HEADER_LENGTH) {
+            _headerMatch = 0;
+            _state       = EXPECT_BRACE;
+            return false;
+        }
+    } else {
+        _headerMatch = (c == SESSION_HEADER[0]) ? 1 : 0;
+    }
+
+    switch (_state) {
+        case SEEK_HEADER:
+            return false;
+
+        case EXPECT_BRACE:
+            if (c == '{') {
+                beginSession();
+                _state = KEY;
+            }
+            return false;
+
+        case KEY:
+            if (++_sessionChars > UWB_MAX_SESSION_CHARS) {
+                _state = SEEK_HEADER;
+                return false;
+            }
+            if (_keyLength == 0) {
+                // Between fields: whitespace, separators and structure
+                if (c == '[' || c == ']' || c == '}') {
+                    return handleDelimiter(c);
+                }
+                if (c == ' ' || c == ',' || c == ';' || c == '\n' || c == '\r' || c == '\t') {
+                    return false;
+                }
+            }
+            if (c == '=') {
+                _state       = VALUE;
+                _valueLength = 0;
+                _quoted      = false;
+            } else if (_keyLength < UWB_TOKEN_SIZE - 1) {
+                _key[_keyLength++] = c;  // Brackets inside a key, e.g. distance[cm]
+            }
+            return false;
+
+        case VALUE:
+            if (++_sessionChars > UWB_MAX_SESSION_CHARS) {
+                _state = SEEK_HEADER;
+                return false;
+            }
+            if (c == '"') {
+                _quoted = !_quoted;
+                return false;
+            }
+            if (!_quoted && (c == ',' || c == ';' || c == ']' || c == '}' || c == ' ' || c == '\n' ||
+                             c == '\r' || c == '\t')) {
+                commitField();
+                _keyLength = 0;
+                _state     = KEY;
+                return handleDelimiter(c);
+            }
+            if (_valueLength < UWB_TOKEN_SIZE - 1) {
+                _value[_valueLength++] = c;
+            }
+            return false;
+    }
+    return false;
+}
@@ -0,0 +1,88 @@
+#ifndef _UWB_SESSION_PARSER_H_
+#define _UWB_SESSION_PARSER_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*
+ Single-pass tokenizer for DWM3001CDK CLI ranging notifications:
+
+ SESSION_INFO_NTF: {session_handle=1, sequence_number=1, block_index=1, n_measurements=2
+  [mac_address=0x0001, status="SUCCESS", distance[cm]=245];
+  [mac_address=0x0002, status="RX_TIMEOUT", distance[cm]=-1]}
+
+ Bytes are fed one at a time straight from the UART and fields are written
+ into a UWBSession as soon as their value ends. No line is buffered and no
+ String is created; the only scratch space is one key and one value token.
+*/
+
+#define UWB_MAX_MEASUREMENTS  10
+#define UWB_MAX_SESSION_CHARS 2048   // Give up on a session that never closes
+#define UWB_TOKEN_SIZE        24
+#define UWB_MAC_HEX_SIZE      7      // "0x" + 4 hex digits + NUL
+
+enum UWBStatus : uint8_t {
+    UWB_STATUS_UNKNOWN = 0,
+    UWB_STATUS_SUCCESS,
+    UWB_STATUS_RX_TIMEOUT,
+    UWB_STATUS_FAILED  // Any other status reported by the module
+};
+
+struct UWBMeasurement {
+    uint16_t macAddress;            // Short (16-bit) MAC of the anchor
+    UWBStatus status;
+    int distanceCm;                 // -1 unless status is UWB_STATUS_SUCCESS
+};
+
+struct UWBSession {
+    unsigned long timestamp;
+    uint32_t sessionCount;
+    uint32_t sessionHandle;
+    uint32_t sequenceNumber;
+    uint32_t blockIndex;
+    uint8_t nMeasurements;          // Measurements actually parsed
+    UWBMeasurement measurements[UWB_MAX_MEASUREMENTS];
+    bool valid;
+};
+
+class UWBSessionParser {
+   public:
+    UWBSessionParser();
+
+    /*! @brief Feed one received character.
+        @return True when a complete session is available from session().*/
+    bool feed(char c);
+
+    /*! @brief Discard any partially parsed session.*/
+    void reset();
+
+    /*! @brief The last completed session. Valid until the next feed() that returns true.*/
+    const UWBSession &session() const {
+        return _session;
+    }
+
+    static const char *statusName(UWBStatus status);
+
+    /*! @brief Format a short MAC as "0x%04x" into out (UWB_MAC_HEX_SIZE bytes).*/
+    static void formatMac(uint16_t mac, char *out);
+
+   private:
+    enum State : uint8_t { SEEK_HEADER, EXPECT_BRACE, KEY, VALUE };
+
+    void beginSession();
+    bool handleDelimiter(char c);
+    void commitField();
+
+    UWBSession _session;
+    State _state;
+    uint8_t _headerMatch;
+    uint16_t _sessionChars;
+    bool _inMeasurement;
+    bool _quoted;
+    uint8_t _keyLength;
+    uint8_t _valueLength;
+    char _key[UWB_TOKEN_SIZE];
+    char _value[UWB_TOKEN_SIZE];
+};
+
+#endif
@@ -3,7 +3,7 @@
  * FreeRTOS Multi-tasking Implementation
  * 
  * This code combines:
- * - UHF RFID reader (JRD-100 module) - continuous polling
+ * - UHF RFID readers (JRD-100 modules, rfidReaderConfigs[]) - continuous polling, tags merged per cycle
  * - UWB positioning (DWM3001CDK with CLI firmware) - real-time tracking
  * - MQTT publishing - sends JSON data to server
  * 
@@ -22,18 +22,44 @@
  * MQTT Configuration:
  * - Update WiFi SSID/password below
  * - Update MQTT broker IP (your MacBook IP)
- * - Publishes to: store/aisle1
- * - Subscribes to: store/control (START/STOP)
+ * - Publishes to: store/aisle1, store/production/uwb (per-session UWB stream),
+ *   store/production/presence (edge presence events, PRESENCE_EVENTS)
+ * - Subscribes to: store/control (START/STOP/KEYFRAME, CAPTURE/REPLAY, CONFIG), store/production/anchors/+ (anchor coordinates),
+ *   store/production/filter (inventory filter), store/production/trace/load (trace to replay)
  */
 
 #include <WiFi.h>
 #include <PubSubClient.h>
-#include <ArduinoJson.h> // Install library by Bblanchon
 #include <HardwareSerial.h>
 #include <vector>
-#include <map>
 #include <Adafruit_NeoPixel.h>
+#include <esp_sntp.h>
+#include <Preferences.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <driver/uart.h>
 #include "UNIT_UHF_RFID.h"
+#include "RFID_READERS.h"
+#include "UART_RX_NOTIFIER.h"
+#include "UWB_SESSION_PARSER.h"
+#include "ANCHOR_TABLE.h"
+#include "CYCLE_RECORD.h"
+#include "CYCLE_PIPELINE.h"
+#include "BOOT_ARENA.h"
+#include "CYCLE_SERIALIZER.h"
+#include "TAG_DELTA.h"
+#include "CYCLE_BACKLOG.h"
+#include "CYCLE_BATCHER.h"
+#include "CONNECTION_MANAGER.h"
+#include "POSITION_SOLVER.h"
+#include "RFID_SCHEDULER.h"
+#include "INVENTORY_FILTER.h"
+#include "TELEMETRY.h"
+#include "UART_CAPTURE.h"
+#include "EPOCH_CLOCK.h"
+#include "READER_CONFIG.h"
+#include "POWER_LEDGER.h"
+#include "PRESENCE_TABLE.h"
 
 // ============================================
 // CONFIGURATION
@@ -58,31 +84,124 @@ const char* WIFI_SSID = "Oscar";              // Your WiFi name
 const char* WIFI_PASSWORD = "password";        // Your WiFi password
 const char* MQTT_SERVER = "172.20.10.4";       // Your MacBook IP
 const int MQTT_PORT = 1883;
+const char* NTP_SERVER = "pool.ntp.org";       // Wall time for the cycle records (EPOCH_CLOCK.h)
+const char* NTP_SERVER_FALLBACK = "time.google.com";
 
 // MQTT Topics
 const char* TOPIC_DATA = "store/production";   // Main data topic for production hardware
-const char* TOPIC_CONTROL = "store/production/control";   // Control signals (START/STOP)
-const char* TOPIC_STATUS = "store/production/status";     // Status updates
+const char* TOPIC_CONTROL = "store/production/control";   // Control signals (START/STOP/KEYFRAME, CAPTURE/REPLAY, CONFIG)
+const char* TOPIC_STATUS = "store/production/status";     // Periodic telemetry: hot-path timings, tasks, heap, counters; CONFIG acks
+const char* TOPIC_DATA_BIN = "store/production/bin";      // Binary cycle frames (opt-in)
+const char* TOPIC_DATA_BACKLOG = "store/production/backlog"; // Batches of cycles queued while offline
+const char* TOPIC_DATA_BATCH = "store/production/batch";  // Batches of live cycles, LZ4 when smaller (PUBLISH_BATCH)
+const char* TOPIC_ANCHORS = "store/production/anchors/+";  // Retained "x_cm,y_cm" per anchor MAC, empty = removed
+const char* TOPIC_UWB = "store/production/uwb";            // High-rate UWB stream (ranges + position per session)
+const char* TOPIC_FILTER = "store/production/filter";      // Retained inventory filter: EPC prefixes and/or SUPPRESS, "OFF"
+const char* TOPIC_TRACE = "store/production/trace";        // UART capture upload, trace text in parts (UART_CAPTURE.h)
+const char* TOPIC_TRACE_LOAD = "store/production/trace/load"; // Trace to replay, same parts
+const char* TOPIC_PRESENCE = "store/production/presence";  // Edge presence events: appeared / missing (PRESENCE_TABLE.h)
 
-// RFID Configuration
+// RFID Configuration. Power, rounds, window, region and receiver params are the defaults
+// of the run-time config (CONFIG on TOPIC_CONTROL, READER_CONFIG.h); a config saved in NVS wins at boot.
 #define RFID_RX_PIN         6
 #define RFID_TX_PIN         7
 #define RFID_BAUD           115200
+#define RFID_RX_BUFFER_SIZE 1024        // Driver ring buffer (ISR-filled)
+#define RFID_RX_FIFO_FULL   24          // One tag notification frame
 #define RFID_MAX_TX_POWER   3000        // 26.00dB
-#define RFID_POLLING_COUNT  6
-#define RFID_MAX_TAGS       200         // Maximum tags per polling cycle
-#define UWB_MAX_ANCHORS     30          // Circular buffer size
-#define UWB_FRESHNESS_MS    3000        // Data valid for 3 seconds
+#define RFID_POLLING_COUNT  6           // Rounds per blocking poll (RFID_STREAMING 0)
+#define RFID_STREAMING      1           // 1 = continuous inventory, cycles cut by time window
+#define RFID_CYCLE_WINDOW_MS 500        // Cycle length in streaming mode, minimum cycle length in blocking mode
+#define RFID_ADAPTIVE_POLLING 1         // Back off while stationary with a converged tag set (RFID_SCHEDULER.h)
+#define RFID_IDLE_CHECK_MS  50          // Motion check interval while the radio rests between cycles
+#define RFID_MIXER_GAIN     0x06        // setReceiverParams(): 16dB, the maximum
+#define RFID_IF_GAIN        0x07        // 40dB, the maximum
+#define RFID_RX_THRESHOLD   0x01B0      // Demodulator threshold
+// RFID_MAX_TAGS (= RFID_MAX_CARDS, 200) is defined in CYCLE_RECORD.h
+// UWB_MAX_ANCHORS (30) and UWB_FRESHNESS_MS (3000, the run-time config's default) are defined in ANCHOR_TABLE.h
 
-// WiFi Configuration
-#define WIFI_CONNECT_TIMEOUT_MS  20000  // 20 seconds timeout for WiFi connection
-#define WIFI_RETRY_DELAY_MS      5000   // 5 seconds between retry attempts  
+// WiFi/MQTT connection timing (WIFI_CONNECT_TIMEOUT_MS, backoff bounds) is defined in CONNECTION_MANAGER.h
+#define MQTT_CLIENT_ID      "ESP32_RFID_UWB"
 
 // UWB Configuration
+#define UWB_UART_NUM        1
 #define UWB_RX_PIN          18
 #define UWB_TX_PIN          17
 #define UWB_BAUD            115200
 #define UWB_BUFFER_SIZE     2048
+#define UWB_RX_FIFO_FULL    64
+#define UWB_RX_WAIT_MS      100         // Upper bound on a single blocking wait
+
+// On-device positioning (POSITION_SOLVER.h): solved per UWB session on Core 1
+#define POSITION_SOLVER_ENABLED 1
+#define UWB_STREAM_ENABLED      1       // Publish each session on TOPIC_UWB, independent of the RFID cycle
+#define UWB_STREAM_INTERVAL_MS  100     // Max stream rate (10 Hz); newer sessions replace unsent ones
+
+// UART events: wake readers after this many idle byte periods
+#define UART_RX_TIMEOUT_SYMBOLS  2
+
+// Power management for battery carts (POWER_LEDGER.h). POWER_SAVE: CPU frequency scaling,
+// WiFi modem sleep, the JRD-100 hibernated through long adaptive rests, and automatic light
+// sleep while it hibernates and the UWB line is quiet (needs a core built with tickless idle).
+// Opt-in: a wake from light sleep loses the first UWB bytes, and PUBACKs come back later
+#define POWER_SAVE              0
+#define POWER_CPU_MAX_MHZ       240
+#define POWER_CPU_MIN_MHZ       80      // APB stays at 80 MHz, so the UART baud rates hold
+#define POWER_RFID_SLEEP_MIN_MS 1000    // Rests at least this long hibernate the module (adaptive levels 2-3)
+#define POWER_UWB_QUIET_MS      500     // Light sleep only once the UWB line has been silent this long
+#define POWER_UART_WAKE_EDGES   3       // UWB RX edges that end a light sleep (those bytes are lost)
+
+// Cycle handoff (rfidTask -> outputTask)
+#define CYCLE_QUEUE_DEPTH   4           // Preallocated cycle records (~8KB each, boot arena)
+#define CYCLE_DROP_POLICY   CyclePipeline<CycleRecord, CYCLE_QUEUE_DEPTH>::DROP_OLDEST
+#define OUTPUT_IDLE_WAIT_MS 50          // Max sleep between MQTT keepalives when no cycle arrives
+#define CYCLE_ARENA_BYTES   (sizeof(CycleRecord) * CYCLE_QUEUE_DEPTH + sizeof(TagMerger) + 32)  // Plus alignment slack
+
+// Task stacks (bytes). Per-cycle data lives in the boot arena, not on a stack;
+// the status report gives each task's high-water mark (tasks[].stack_free).
+#define RFID_TASK_STACK       8192
+#define UWB_TASK_STACK        6144
+#define OUTPUT_TASK_STACK     10240     // lwIP writes, LittleFS spill, float formatting
+#define CONNECTION_TASK_STACK 8192
+#define CONTROL_COMMAND_SIZE  24        // Longest TOPIC_CONTROL command, plus terminator
+
+// Publishing
+#define PUBLISH_JSON              1             // JSON cycles on TOPIC_DATA
+#define PUBLISH_BINARY            0             // Binary cycle frames on TOPIC_DATA_BIN
+#define PUBLISH_DELTAS            0             // Tag changes only, full keyframe every TAG_KEYFRAME_INTERVAL
+#define PUBLISH_BATCH             0             // Several cycles per publish on TOPIC_DATA_BATCH instead of the above
+#define BATCH_MAX_CYCLES          8             // Publish a batch once this many cycles wait ...
+#define BATCH_MAX_AGE_MS          1000          // ... or its oldest cycle closed this long ago (latency bound)
+#define BATCH_MAX_BYTES           16384         // Frame bytes per batch, uncompressed (PSRAM; at most 65535)
+#define BATCH_COMPRESS            1             // LZ4 the batch when that makes it smaller
+#define MQTT_BUFFER_SIZE          512           // PubSubClient RX buffer: incoming control messages
+#define MQTT_WRITE_CHUNK_SIZE     1024          // Payload bytes handed to WiFiClient per write
+#define MQTT_PUBLISH_QOS          1             // 1 = cycles and backlog batches published at QoS 1
+#define MQTT_INFLIGHT_BYTES       (96UL * 1024UL) // Unacked QoS 1 packets (PSRAM; 16KB without)
+#define MQTT_INFLIGHT_WAIT_MS     (POWER_SAVE ? 400 : 200)  // Max wait for a PUBACK to free the window (modem sleep delays it)
+#define SERIAL_JSON_MIRROR        DEBUG_MODE    // Echo cycle JSON to Serial (debug sink)
+#define SERIAL_MIRROR_INTERVAL_MS 5000          // At most one mirrored cycle per interval
+#define TELEMETRY_INTERVAL_MS     10000         // Status report on TOPIC_STATUS (TELEMETRY.h)
+#define NTP_SYNC_INTERVAL_MS      (15UL * 60UL * 1000UL)  // SNTP resync period once WiFi is up
+
+// UART capture & replay (UART_CAPTURE.h), commanded on TOPIC_CONTROL
+#define CAPTURE_ENABLED           1
+#define CAPTURE_RAM_BYTES         (1024UL * 1024UL)  // PSRAM ring, ~100 s of every port (CAPTURE_FALLBACK_BYTES without PSRAM)
+#define CAPTURE_UPLOAD_PART_BYTES 4096               // Trace text per TOPIC_TRACE message
+
+// Store-and-forward for cycles that could not be published
+#define BACKLOG_ENABLED           1
+#define BACKLOG_RAM_BYTES         (1024UL * 1024UL)  // PSRAM ring (BACKLOG_FALLBACK_BYTES without PSRAM)
+#define BACKLOG_FLASH_BYTES       (512UL * 1024UL)   // LittleFS spill file, 0 = RAM only
+#define BACKLOG_BATCH_BYTES       16384              // Max payload per backlog publish
+#define BACKLOG_BATCH_FRAMES      32                 // Max cycles per backlog publish
+#define BACKLOG_DRAIN_INTERVAL_MS 250                // Min gap between backlog publishes
+
+// Edge presence (PRESENCE_TABLE.h): the reader tracks its zone and publishes state changes on
+// TOPIC_PRESENCE, so the backend stops inferring missing items from every cycle
+#define PRESENCE_EVENTS           0
+#define PRESENCE_MAX_TAGS         10240              // PSRAM table, ~340KB (PRESENCE_FALLBACK_TAGS without PSRAM)
+#define PRESENCE_BATCH_EVENTS     64                 // Max events per publish
 
 // Region Codes for RFID
 #define REGION_CHINA1       0x01        // 920–925 MHz
@@ -95,36 +214,8 @@ const char* TOPIC_STATUS = "store/production/status";     // Status updates
 // DATA STRUCTURES
 // ============================================
 
-struct UWBMeasurement {
-    String macAddress;
-    String status;
-    int distanceCm;
-};
-
-struct UWBSession {
-    unsigned long timestamp;
-    uint32_t sessionCount;
-    uint32_t sessionHandle;
-    uint32_t sequenceNumber;
-    uint32_t blockIndex;
-    uint8_t nMeasurements;
-    UWBMeasurement measurements[10];
-    bool valid;
-};
-
-struct RFIDTagData {
-    String epc;
-    int8_t rssi;
-    unsigned long timestamp;
-};
-
-struct AnchorStats {
-    String macAddress;
-    float totalDistance;
-    uint32_t successCount;
-    uint32_t totalCount;
-    unsigned long timestamp;        // When this entry was last updated
-};
+// UWBMeasurement / UWBSession are defined in UWB_SESSION_PARSER.h
+// RFIDTagData / CycleRecord are defined in CYCLE_RECORD.h
 
 // ============================================
 // GLOBAL OBJECTS & VARIABLES
@@ -133,40 +224,133 @@ struct AnchorStats {
 // WiFi and MQTT
 WiFiClient espClient;
 PubSubClient mqttClient(espClient);
+
+// WiFi/MQTT state machine; runs in connectionTask, hands the client to outputTask while ONLINE
+ConnectionManager connection(mqttClient);
 bool startSignal = false;  // Control flag for publishing
+uint8_t mqttWriteChunk[MQTT_WRITE_CHUNK_SIZE];  // Output task only
 
-// RFID
+// RFID modules (RFID_READERS.h): one driver, UART and capture port each, merged into one record per cycle.
+// A second module needs UART0: build with USB CDC on boot so Serial does not use it.
 HardwareSerial rfidSerial(2);
-Unit_UHF_RFID rfid;
-RFIDTagData currentRfidTags[RFID_MAX_TAGS];
-uint8_t currentRfidTagCount = 0;
-SemaphoreHandle_t rfidMutex;
+// HardwareSerial rfidSerialB(0);
+const RfidReaderConfig rfidReaderConfigs[] = {
+    // serial, rxPin, txPin, antennas, RF switch select pins
+    {&rfidSerial, RFID_RX_PIN, RFID_TX_PIN, 1, {-1, -1}},
+    // {&rfidSerialB, 44, 43, 1, {-1, -1}},  // Second module (bottom shelves)
+};
+const uint8_t RFID_READER_COUNT = sizeof(rfidReaderConfigs) / sizeof(rfidReaderConfigs[0]);
+static_assert(RFID_READER_COUNT >= 1 && RFID_READER_COUNT <= RFID_MAX_READERS, "1 to RFID_MAX_READERS modules");
+RfidReader rfidReaders[RFID_READER_COUNT];  // Each driver reads its TracePort: the UART, or a replayed capture
+TracePort *rfidPorts[RFID_READER_COUNT];    // rfidTask waits on all of them
+TagMerger *tagMerger = NULL;                // rfidTask only; boot arena
 
 // UWB
-HardwareSerial uwbSerial(1);
-String uwbRxBuffer = "";
-String uwbSessionBuffer = "";
-bool inUwbSession = false;
+HardwareSerial uwbSerial(UWB_UART_NUM);
+UartRxNotifier uwbRx;
+TracePort uwbPort;  // uwbTask only
+UWBSessionParser uwbParser;
 uint32_t uwbSessionCount = 0;
-UWBSession latestUwbSession;
-SemaphoreHandle_t uwbMutex;
+UWBSession latestUwbSession;    // Owned by uwbTask
+
+// UWB Statistics per anchor (accumulated during polling cycle), double-buffered:
+// uwbTask fills the active table, rfidTask swaps it out once per cycle
+AnchorTable anchorTables[2];
+volatile uint8_t activeAnchorTable = 0;
+portMUX_TYPE anchorTableMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Position: anchor coordinates from MQTT (outputTask writes), solved in uwbTask, read by rfidTask
+AnchorMap anchorMap;
+portMUX_TYPE anchorMapMux = portMUX_INITIALIZER_UNLOCKED;
+volatile bool anchorMapChanged = false;
+PositionSolver positionSolver;  // uwbTask only
+PositionEstimate latestPosition = {};
+portMUX_TYPE positionMux = portMUX_INITIALIZER_UNLOCKED;
 
-// UWB Statistics per anchor (accumulated during polling cycle)
-std::map<String, AnchorStats> anchorStatsMap;
+// High-rate UWB stream: uwbTask overwrites the latest session, outputTask publishes it
+UwbSample latestUwbSample = {};
+portMUX_TYPE uwbSampleMux = portMUX_INITIALIZER_UNLOCKED;
+
+// Adaptive polling levels, most aggressive first; level 0 is the fixed (RFID_ADAPTIVE_POLLING 0) behaviour.
+// The levels in use are rebuilt from the run-time config: its window, its rounds and power at level 0,
+// the backed-off levels at most as many rounds and the same steps below its power.
+const PollProfile rfidPollDefaults[] = {
+    // pollCount, windowMs, idleMs, txPower
+    {RFID_POLLING_COUNT, RFID_CYCLE_WINDOW_MS, 0, RFID_MAX_TX_POWER},
+    {4, RFID_CYCLE_WINDOW_MS, 250, RFID_MAX_TX_POWER},
+    {3, RFID_CYCLE_WINDOW_MS, 1000, RFID_MAX_TX_POWER - 200},
+    {2, RFID_CYCLE_WINDOW_MS, 2500, RFID_MAX_TX_POWER - 400},
+};
+const uint8_t RFID_POLL_LEVELS = sizeof(rfidPollDefaults) / sizeof(rfidPollDefaults[0]);
+PollProfile rfidPollProfiles[RFID_POLL_LEVELS];  // rfidTask writes between cycles (buildPollProfiles())
+PollScheduler pollScheduler(rfidPollProfiles, RFID_POLL_LEVELS);  // rfidTask only (the status report reads level())
+
+// Run-time reader config (READER_CONFIG.h): parsed in outputTask (TOPIC_CONTROL), applied by rfidTask
+// between cycles, then saved to NVS and acknowledged on TOPIC_STATUS by outputTask
+const ReaderConfig readerConfigDefaults = {
+    0,  // revision
+    RFID_POLLING_COUNT, RFID_CYCLE_WINDOW_MS, RFID_MAX_TX_POWER, UWB_FRESHNESS_MS,
+    CURRENT_REGION, RFID_MIXER_GAIN, RFID_IF_GAIN, RFID_RX_THRESHOLD,
+};
+ReaderConfig readerConfig;   // Running; rfidTask writes it under configMux
+ReaderConfig pendingConfig;
+volatile bool configChanged = false;
+ReaderConfigAck configAck;   // Latest answer; a newer one replaces it unsent
+volatile bool configAckDue = false;
+volatile bool configSaveDue = false;
+portMUX_TYPE configMux = portMUX_INITIALIZER_UNLOCKED;
+Preferences configStore;     // NVS; setup() and outputTask
+
+// Inventory filter: parsed in outputTask (TOPIC_FILTER), programmed by rfidTask between cycles
+InventoryFilter pendingFilter;
+volatile bool filterChanged = false;
+portMUX_TYPE filterMux = portMUX_INITIALIZER_UNLOCKED;
+InventoryFilter inventoryFilter;  // rfidTask only
 
 // RGB LED
 Adafruit_NeoPixel pixels(NUM_PIXELS, LED_PIN, NEO_GRB + NEO_KHZ800);
-SemaphoreHandle_t anchorStatsMutex;
 
-// Cycle synchronization
-volatile uint32_t lastPrintedCycle = 0;
-volatile uint32_t currentCycle = 0;
-SemaphoreHandle_t cycleMutex;
+// Cycle handoff: rfidTask fills records in place, outputTask drains them.
+// The records are carved from the boot arena (PSRAM when found) in setup().
+BootArena cycleArena;
+CyclePipeline<CycleRecord, CYCLE_QUEUE_DEPTH> cyclePipeline(CYCLE_DROP_POLICY);
+
+// Cycles waiting for the connection to return (outputTask only)
+CycleBacklog backlog;
+
+// Live cycles waiting to go out together with PUBLISH_BATCH (outputTask only)
+CycleBatcher cycleBatch;
+
+// Last published tag set (outputTask only; KEYFRAME requests arrive via mqttClient.loop())
+TagDeltaTracker tagDelta;
+
+// What the reader believes is on the shelves around it, and the changes not yet published (outputTask only)
+PresenceTable presenceTable;
+
+// Hot-path timings: recorded by every task, reported and reset by outputTask on TOPIC_STATUS
+TimingHistogram timingHistograms[TIMING_POINT_COUNT];
+portMUX_TYPE telemetryMux = portMUX_INITIALIZER_UNLOCKED;
+uint32_t publishFailures = 0;  // outputTask only
+
+// Wall time: synced by the SNTP callback, read by rfidTask when a cycle closes
+EpochClock epochClock;
+
+// Power: rfidTask books its states and takes the light sleep lock, outputTask reports
+PowerLedger powerLedger;
+esp_pm_lock_handle_t uartAwakeLock = NULL;  // NO_LIGHT_SLEEP, held unless the module hibernates
+bool powerLightSleep = false;               // Automatic light sleep accepted by esp_pm_configure()
+volatile unsigned long uwbLastRxMs = 0;     // uwbTask: last UART data
+
+// UART capture & replay: modes set by outputTask (TOPIC_CONTROL), recorded and replayed by the TracePorts
+UartCapture uartCapture;
+UartCapture::Cursor traceUpload;  // outputTask only
+bool traceUploading = false;
 
 // Task Handles
 TaskHandle_t rfidTaskHandle;
 TaskHandle_t uwbTaskHandle;
 TaskHandle_t outputTaskHandle;
+TaskHandle_t connectionTaskHandle;
 
 // ============================================
 // SETUP
@@ -183,22 +367,87 @@ void setup() {
     
     printWelcomeBanner();
     
-    // Initialize WiFi and MQTT
-    setupWiFi();
+    // WiFi and MQTT: connected in the background by connectionTask
     mqttClient.setServer(MQTT_SERVER, MQTT_PORT);
-    mqttClient.setBufferSize(32768);  // Large buffer for JSON
+    mqttClient.setBufferSize(MQTT_BUFFER_SIZE);  // Topics and control messages; payloads bypass it
     mqttClient.setCallback(mqttCallback);
-    reconnectMQTT();
+    connection.begin(WIFI_SSID, WIFI_PASSWORD, MQTT_CLIENT_ID, onMqttConnected, NULL);
+    
+    // Cycle records for the whole uptime: recycled through the pipeline, never freed
+    CycleRecord *cycleRecords = NULL;
+    if (cycleArena.begin(CYCLE_ARENA_BYTES)) {
+        cycleRecords = cycleArena.create<CycleRecord>(CYCLE_QUEUE_DEPTH);
+        tagMerger = cycleArena.create<TagMerger>();
+    }
+    if (!cycleRecords || !tagMerger) {
+        DEBUG_PRINTLN("✗ Cycle record allocation failed - Halting");
+        while (true) {
+            delay(1000);
+        }
+    }
+    cyclePipeline.begin(cycleRecords);
+    DEBUG_PRINT(cycleArena.inPsram() ? "✓ Cycle records in PSRAM: " : "✓ Cycle records in internal RAM (no PSRAM): ");
+    DEBUG_PRINT(cycleArena.used());
+    DEBUG_PRINTLN(" bytes");
+    
+#if MQTT_PUBLISH_QOS
+    uint32_t inflightBytes = psramFound() ? MQTT_INFLIGHT_BYTES : 16384;
+    uint8_t *inflightBuffer = (uint8_t *)(psramFound() ? ps_malloc(inflightBytes) : malloc(inflightBytes));
+    if (inflightBuffer) {
+        mqttClient.setInflightBuffer(inflightBuffer, inflightBytes);
+    } else {
+        DEBUG_PRINTLN("✗ QoS 1 window allocation failed - Publishing at QoS 0");
+    }
+#endif
     
-    // Create mutexes
-    rfidMutex = xSemaphoreCreateMutex();
-    uwbMutex = xSemaphoreCreateMutex();
-    anchorStatsMutex = xSemaphoreCreateMutex();
-    cycleMutex = xSemaphoreCreateMutex();
+#if BACKLOG_ENABLED
+    if (backlog.begin(BACKLOG_RAM_BYTES, BACKLOG_FLASH_BYTES)) {
+        DEBUG_PRINTLN(psramFound() ? "✓ Backlog in PSRAM" : "✓ Backlog in internal RAM (no PSRAM)");
+    } else {
+        DEBUG_PRINTLN("✗ Backlog allocation failed - Offline cycles will be dropped");
+    }
+#endif
+    
+#if PUBLISH_BATCH
+    if (cycleBatch.begin(BATCH_MAX_BYTES, BATCH_COMPRESS)) {
+        DEBUG_PRINTLN(psramFound() ? "✓ Cycle batch in PSRAM" : "✓ Cycle batch in internal RAM (no PSRAM)");
+    } else {
+        DEBUG_PRINTLN("✗ Cycle batch allocation failed - Publishing every cycle");
+    }
+#endif
+    
+#if PRESENCE_EVENTS
+    if (presenceTable.begin(PRESENCE_MAX_TAGS)) {
+        DEBUG_PRINT(psramFound() ? "✓ Presence table in PSRAM: " : "✓ Presence table in internal RAM (no PSRAM): ");
+        DEBUG_PRINT(presenceTable.capacity());
+        DEBUG_PRINTLN(" tags");
+    } else {
+        DEBUG_PRINTLN("✗ Presence table allocation failed - Presence events disabled");
+    }
+#endif
+    
+#if CAPTURE_ENABLED
+    if (uartCapture.begin(CAPTURE_RAM_BYTES)) {
+        DEBUG_PRINTLN(psramFound() ? "✓ UART capture ring in PSRAM" : "✓ UART capture ring in internal RAM (no PSRAM)");
+    } else {
+        DEBUG_PRINTLN("✗ UART capture allocation failed - Capture and replay disabled");
+    }
+#endif
+    
+    // Run-time config saved by an earlier CONFIG, else the compiled-in defaults
+    readerConfig = readerConfigDefaults;
+    if (loadReaderConfig(readerConfig)) {
+        DEBUG_PRINT("✓ Reader config rev ");
+        DEBUG_PRINT(readerConfig.revision);
+        DEBUG_PRINTLN(" from NVS");
+    }
+    buildPollProfiles(readerConfig);
+    AnchorTable::setFreshnessMs(readerConfig.uwbFreshnessMs);
     
     // Initialize modules
     initializeRFID();
     initializeUWB();
+    initializePower();  // After the UARTs are up: begin() resets the wake-up threshold
     
     // Initialize UWB session
     latestUwbSession.valid = false;
@@ -219,7 +468,7 @@ void setup() {
     xTaskCreatePinnedToCore(
         rfidTask,           // Task function
         "RFID_Task",        // Task name
-        16384,              // Stack size
+        RFID_TASK_STACK,    // Stack size
         NULL,               // Parameters
         2,                  // Priority
         &rfidTaskHandle,    // Task handle
@@ -229,7 +478,7 @@ void setup() {
     xTaskCreatePinnedToCore(
         uwbTask,
         "UWB_Task",
-        16384,
+        UWB_TASK_STACK,
         NULL,
         2,
         &uwbTaskHandle,
@@ -239,13 +488,23 @@ void setup() {
     xTaskCreatePinnedToCore(
         outputTask,
         "Output_Task",
-        16384,
+        OUTPUT_TASK_STACK,
         NULL,
         1,
         &outputTaskHandle,
         0                   // Core 0 - WiFi/Network & MQTT
     );
     
+    xTaskCreatePinnedToCore(
+        connectionTask,
+        "Connection_Task",
+        CONNECTION_TASK_STACK,
+        NULL,
+        1,
+        &connectionTaskHandle,
+        0                   // Core 0 - Blocking connects stay off the Output Task
+    );
+    
     DEBUG_PRINT("Heap after tasks: ");
     DEBUG_PRINTLN(ESP.getFreeHeap());
 }
@@ -256,7 +515,7 @@ void setup() {
 
 void loop() {
     // Check WiFi/MQTT status and update LED
-    if (WiFi.status() != WL_CONNECTED || !mqttClient.connected()) {
+    if (!connection.online()) {
         // Turn LED red if WiFi or MQTT disconnected
         if (!startSignal) {  // Only if not running (START hasn't been received)
             pixels.setPixelColor(0, pixels.Color(0, 255, 0));
@@ -274,8 +533,6 @@ void loop() {
             DEBUG_PRINTLN(cmd);
         }
     }
-    //DEBUG_PRINT("Free heap: ");
-    //DEBUG_PRINTLN(ESP.getFreeHeap());
     vTaskDelay(pdMS_TO_TICKS(200));  // Minimal work - loop() runs on Core 1 by default
 }
 
@@ -285,48 +542,131 @@ void loop() {
 
 /**
  * RFID Task - Continuously polls for tags
- * This is the MASTER CLOCK - signals output task when cycle completes
+ * This is the MASTER CLOCK - publishes a CycleRecord and wakes the output task when a cycle completes
+ * In streaming mode the module inventories non-stop and each cycle is
+ * a profile.windowMs slice of the notification stream.
+ * With RFID_ADAPTIVE_POLLING the PollScheduler picks the next cycle's profile.
+ * Between cycles the module is reprogrammed for a new inventory filter or reader config.
+ * The streaming cycle assembly is mirrored by firmware/host/HOST_PIPELINE.cpp for the host replay.
  */
 void rfidTask(void *parameter) {
+    uint32_t cycleCount = 0;
+    uint16_t txPower = readerConfig.txPower;  // As set by initializeRFID()
+    bool suppressed = false;               // Module is running session suppression
+    
+#if RFID_STREAMING
+    startReaders();
+#endif
     while (true) {
         unsigned long cycleStart = millis();
+        const PollProfile &profile = pollScheduler.profile();
+        powerLedger.enter(POWER_INVENTORY, cycleStart);
         
-        uint8_t tagCount = rfid.pollingMultiple(RFID_POLLING_COUNT);
+        // Fill the producer-owned record in place, every module's tags merged
+        CycleRecord &record = cyclePipeline.record();
+        tagMerger->begin(record);
+        
+#if RFID_STREAMING
+        // Tags stream in as the radios read them; the cycle is cut by time, not by poll completion.
+        // The modules inventory in parallel; switched antennas take turns within the window.
+        for (RfidReader &reader : rfidReaders) {
+            reader.driver.beginStreamCycle();
+            reader.selectAntenna(0);
+        }
+        unsigned long elapsed;
+        uint32_t parseCycles = 0;  // Time spent decoding, not waiting
+        while ((elapsed = millis() - cycleStart) < profile.windowMs) {
+            uint32_t parseStart = ESP.getCycleCount();
+            unsigned long wakeAt = profile.windowMs;
+            for (RfidReader &reader : rfidReaders) {
+                reader.driver.processStream();
+                unsigned long switchAt = rotateAntenna(reader, elapsed, profile.windowMs);
+                if (switchAt < wakeAt) wakeAt = switchAt;
+            }
+            parseCycles += ESP.getCycleCount() - parseStart;
+            // Sleeps until a UART (or a replay) has bytes, or an antenna is due
+            TracePort::waitAny(rfidPorts, RFID_READER_COUNT, wakeAt - elapsed);
+        }
+        uint32_t parseStart = ESP.getCycleCount();
+        for (RfidReader &reader : rfidReaders) {
+            reader.tagCount = reader.driver.processStream();
+            tagMerger->add(reader.driver.cards, reader.tagCount, &inventoryFilter);
+        }
+        recordTiming(TIMING_RFID_POLL, parseCycles + ESP.getCycleCount() - parseStart);
+#else
+        // One module after the other, each antenna for a full poll
+        uint32_t pollStart = ESP.getCycleCount();
+        for (RfidReader &reader : rfidReaders) {
+            reader.tagCount = 0;
+            for (uint8_t antenna = 0; antenna < reader.antenna.antennas(); antenna++) {
+                reader.selectAntenna(antenna);
+                uint16_t tags = reader.driver.pollingMultiple(profile.pollCount);
+                tagMerger->add(reader.driver.cards, tags, &inventoryFilter);
+                reader.tagCount += tags;
+            }
+        }
+        recordTiming(TIMING_RFID_POLL, ESP.getCycleCount() - pollStart);
+        powerLedger.enter(POWER_REST, millis());
         
         // Wait until EITHER:
         // - Minimum time has passed
-        // - UWB has accumulated data
-        const unsigned long MIN_CYCLE_MS = 500;
-        while (millis() - cycleStart < MIN_CYCLE_MS) {
-            // Check if UWB has data
-            bool hasUwbData = false;
-            if (xSemaphoreTake(anchorStatsMutex, pdMS_TO_TICKS(5))) {
-                hasUwbData = !anchorStatsMap.empty();
-                xSemaphoreGive(anchorStatsMutex);
-            }
-            
-            if (hasUwbData) break; // Early exit if data ready
-            
-            vTaskDelay(pdMS_TO_TICKS(50)); // Check every 50ms
+        // - UWB has accumulated data (uwbTask notifies after each anchor table update)
+        unsigned long elapsed = millis() - cycleStart;
+        if (elapsed < profile.windowMs) {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(profile.windowMs - elapsed));
         }
+#endif
         
-        // Increment cycle counter
-        if (xSemaphoreTake(cycleMutex, portMAX_DELAY)) {
-            currentCycle++;
-            xSemaphoreGive(cycleMutex);
+        int64_t closedUs = esp_timer_get_time();  // The monotonic clock behind millis()
+        record.cycle = ++cycleCount;
+        record.timestamp = (unsigned long)(closedUs / 1000);
+        record.epochUs = epochClock.stamp(closedUs);
+        record.suppressed = suppressed;
+        tagMerger->finish();
+        
+        // Close the UWB window: take the table filled during this cycle
+        AnchorTable &anchorSnapshot = swapAnchorTables();
+#if !RFID_STREAMING
+        ulTaskNotifyTake(pdTRUE, 0);  // Updates so far went to the snapshot; the next wait is for the new table
+#endif
+        record.anchors = anchorSnapshot;  // Kept until the next swap: the solver's fallback statistics
+        record.position = currentPosition();
+        
+#if RFID_ADAPTIVE_POLLING
+        // Level for the next cycle, from this cycle's new tags and the speed when it closed
+        pollScheduler.update(pollScheduler.observe(record), record.position, millis());
+#endif
+        
+        cyclePipeline.publish();  // Drops per CYCLE_DROP_POLICY if the output side is behind
+        if (outputTaskHandle) {
+            xTaskNotifyGive(outputTaskHandle);
         }
         
-        // Store tag data quickly
-        if (xSemaphoreTake(rfidMutex, portMAX_DELAY)) {
-            currentRfidTagCount = tagCount;
-            
-            for (uint8_t i = 0; i < tagCount && i < RFID_MAX_TAGS; i++) {
-                currentRfidTags[i].epc = rfid.cards[i].epc_str;
-                currentRfidTags[i].rssi = (int8_t)rfid.cards[i].rssi;
-                currentRfidTags[i].timestamp = millis();
+        // Reconfigure the module for the next cycle; it ignores commands while streaming.
+        // Not during a replay: the trace stands in for the module, and new settings wait for live input.
+        bool replaying = uartCapture.mode() == UartCapture::REPLAYING;
+        bool filterDue = !replaying &&
+                         (takeInventoryFilter() || inventoryFilter.suppressesCycle(cycleCount + 1) != suppressed);
+        ReaderConfig config;
+        bool configDue = !replaying && takeReaderConfig(config);
+#if RFID_ADAPTIVE_POLLING
+        const PollProfile &next = pollScheduler.profile();
+        bool profileDue = !replaying && (next.idleMs > 0 || next.txPower != txPower);
+#else
+        bool profileDue = false;
+#endif
+        if (filterDue || profileDue || configDue) {
+#if RFID_STREAMING
+            for (RfidReader &reader : rfidReaders) {
+                reader.driver.stopMultiplePolling();
             }
-            
-            xSemaphoreGive(rfidMutex);
+#endif
+            if (configDue) applyReaderConfig(config);
+            if (profileDue || configDue) applyPollProfile(txPower);  // Picks up a new tx_power
+            if (filterDue) suppressed = programInventoryFilter(cycleCount + 1);
+#if RFID_STREAMING
+            startReaders();
+#endif
         }
         
         // IMMEDIATELY start next cycle - output task handles printing
@@ -336,25 +676,23 @@ void rfidTask(void *parameter) {
 
 /**
  * UWB Task - Processes UWB data continuously
+ * Blocks on UART RX events; no polling while the line is idle
  */
 void uwbTask(void *parameter) {
     while (true) {
-        while (uwbSerial.available()) {
-            char c = uwbSerial.read();
-            
-            if (c == '\n' || c == '\r') {
-                if (uwbRxBuffer.length() > 0) {
-                    processUWBLine(uwbRxBuffer);
-                    uwbRxBuffer = "";
-                }
-            } else {
-                uwbRxBuffer += c;
-                if (uwbRxBuffer.length() > UWB_BUFFER_SIZE) {
-                    uwbRxBuffer = "";
-                }
+        if (!uwbPort.wait(UWB_RX_WAIT_MS)) continue;
+        uwbLastRxMs = millis();
+        
+        uint32_t burstStart = ESP.getCycleCount();
+        uint32_t sessionCycles = 0;  // Timed on their own
+        while (uwbPort.available()) {
+            if (uwbParser.feed((char)uwbPort.read())) {
+                uint32_t sessionStart = ESP.getCycleCount();
+                handleUWBSession(uwbParser.session());
+                sessionCycles += ESP.getCycleCount() - sessionStart;
             }
         }
-        vTaskDelay(pdMS_TO_TICKS(1)); // Minimal delay for responsiveness
+        recordTiming(TIMING_UWB_PARSE, ESP.getCycleCount() - burstStart - sessionCycles);
     }
 }
 
@@ -370,52 +708,69 @@ void outputTask(void *parameter) {
     DEBUG_PRINTLN(" bytes");
     DEBUG_PRINTLN("===========================\n");
     
+    uint32_t lastDropped = 0;
+    uint32_t lastBacklogDropped = 0;
+    ConnectionManager::State lastState = connection.state();
+    
     while (true) {
-        // WiFi keepalive - reconnect if disconnected
-        if (WiFi.status() != WL_CONNECTED) {
-            DEBUG_PRINTLN("\n[WiFi] Connection lost! Reconnecting...");
-            setupWiFi();
-        }
+        // MQTT keepalive; hands the client back to connectionTask if the session dropped
+        connection.service();
         
-        // MQTT keepalive (runs on Core 0 with WiFi/network stack)
-        if (WiFi.status() == WL_CONNECTED) {
-            reconnectMQTT(); // Non-blocking retry logic
-            
-            if (mqttClient.connected()) {
-                mqttClient.loop();
+        ConnectionManager::State state = connection.state();
+        if (state != lastState) {
+            showConnectionState(state);
+            if (state == ConnectionManager::MQTT_IDLE || state == ConnectionManager::ONLINE) {
+                startTimeSync();  // WiFi is up
             }
+            lastState = state;
         }
         
-        uint32_t cycleToProcess = 0;
-        bool shouldProcess = false;
+        // Drain completed cycles, oldest first
+        CycleRecord *record;
+        while ((record = cyclePipeline.acquire()) != NULL) {
+            // Do all the heavy work here (JSON building + MQTT publishing, or queueing while offline)
+            combineDataFromPollingAndSend(*record);
+            cyclePipeline.release(record);
+        }
         
-        // Check if there's a new cycle to process
-        if (xSemaphoreTake(cycleMutex, pdMS_TO_TICKS(10))) {
-            if (currentCycle > lastPrintedCycle) {
-                cycleToProcess = currentCycle;
-                lastPrintedCycle = currentCycle;
-                shouldProcess = true;
-            }
-            xSemaphoreGive(cycleMutex);
+#if UWB_STREAM_ENABLED
+        publishUwbSample();
+#endif
+#if PRESENCE_EVENTS
+        publishPresenceEvents();
+#endif
+#if PUBLISH_BATCH
+        // A batch that has waited BATCH_MAX_AGE_MS goes out short; offline it moves to the backlog
+        if (cycleBatch.due(millis(), BATCH_MAX_CYCLES, BATCH_MAX_AGE_MS) || (!cycleBatch.empty() && !connection.online())) {
+            publishBatch();
+        }
+#endif
+        publishTelemetry();
+        publishConfigAck();
+        uploadTrace();
+        
+#if BACKLOG_ENABLED
+        // Catch up on queued cycles, only when no live cycle is waiting
+        if (cyclePipeline.pending() == 0) {
+            drainBacklog();
         }
         
-        if (shouldProcess) {
-            if (mqttClient.connected()) {
-                // Do all the heavy work here (JSON building + MQTT publishing)
-                combineDataFromPollingAndSend(cycleToProcess);
-            } else {
-                DEBUG_PRINTLN("[MQTT] Offline - Dropping data cycle to ensure freshness");
-            }
-            
-            // Clear anchor statistics for next cycle
-            // Time-based expiration in updateAnchorStatistics() handles staleness
-            if (xSemaphoreTake(anchorStatsMutex, portMAX_DELAY)) {
-                anchorStatsMap.clear();
-                xSemaphoreGive(anchorStatsMutex);
-            }
+        if (backlog.dropped() != lastBacklogDropped) {
+            DEBUG_PRINT("[BACKLOG] Full - cycles dropped: ");
+            DEBUG_PRINTLN(backlog.dropped());
+            lastBacklogDropped = backlog.dropped();
+        }
+#endif
+        
+        uint32_t dropped = cyclePipeline.dropped();
+        if (dropped != lastDropped) {
+            DEBUG_PRINT("[PIPELINE] Output behind - cycles dropped: ");
+            DEBUG_PRINTLN(dropped);
+            lastDropped = dropped;
         }
         
-        vTaskDelay(pdMS_TO_TICKS(10)); // Check every 10ms
+        // Sleep until rfidTask publishes a cycle, uwbTask a session (or the keepalive interval passes)
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(OUTPUT_IDLE_WAIT_MS));
     }
 }
 
@@ -424,27 +779,78 @@ void outputTask(void *parameter) {
 // ============================================
 
 void initializeRFID() {
-    DEBUG_PRINTLN("\n--- Initializing RFID Module ---");
-    
-    rfid.begin(&rfidSerial, RFID_BAUD, RFID_RX_PIN, RFID_TX_PIN, false);
-    rfid.waitModuleInitialization();
-    rfid.setRegion(CURRENT_REGION);
-    rfid.verifyRegion();
-    
-    // Set receiver gain to maximum for better sensitivity
-    rfid.setReceiverParams(0x06, 0x07, 0x01B0); // Mixer Gain: 16dB, IF Gain: 40dB
-    
-    // Set maximum transmission power
-    if (rfid.setTxPower(RFID_MAX_TX_POWER)) {
-        DEBUG_PRINTLN("✓ TX Power set successfully");
-        DEBUG_PRINT("✓ TX Power: ");
-        DEBUG_PRINT(RFID_MAX_TX_POWER / 100.0);
-        DEBUG_PRINTLN(" dB");
-    } else {
-        DEBUG_PRINTLN("✗ TX Power setting failed!");
+    uint8_t source = 0;  // Sources are numbered across modules, antenna by antenna
+    for (uint8_t i = 0; i < RFID_READER_COUNT; i++) {
+        const RfidReaderConfig &config = rfidReaderConfigs[i];
+        RfidReader &reader = rfidReaders[i];
+        Unit_UHF_RFID &rfid = reader.driver;
+        DEBUG_PRINT("\n--- Initializing RFID Module ");
+        DEBUG_PRINT(i + 1);
+        DEBUG_PRINTLN(" ---");
+        
+        config.serial->setRxBufferSize(RFID_RX_BUFFER_SIZE);  // Must precede begin()
+        rfid.begin(config.serial, RFID_BAUD, config.rxPin, config.txPin, false);
+        reader.rx.attach(config.serial, RFID_RX_FIFO_FULL, UART_RX_TIMEOUT_SYMBOLS);
+        reader.port.attach(CAPTURE_PORT_RFID + i, config.serial, &reader.rx, &uartCapture);
+        rfidPorts[i] = &reader.port;
+        rfid.setInput(&reader.port);
+        rfid.setRxWait(TracePort::waitCallback, &reader.port);
+        
+        uint8_t antennas = config.antennas;
+        if (source + antennas > RFID_MAX_SOURCES) {
+            antennas = source < RFID_MAX_SOURCES ? RFID_MAX_SOURCES - source : 1;
+            DEBUG_PRINTLN("✗ More than RFID_MAX_SOURCES antennas - Extra antennas unused");
+        }
+        reader.antenna.begin(config.switchPins, antennas);
+        reader.firstSource = source;
+        reader.selectAntenna(0);
+        source += reader.antenna.antennas();
+        
+        rfid.waitModuleInitialization();
+        rfid.setRegion(readerConfig.region);
+        rfid.verifyRegion();
+        
+        // Receiver gain (maximum by default, for sensitivity)
+        rfid.setReceiverParams(readerConfig.mixerGain, readerConfig.ifGain, readerConfig.threshold);
+        
+        // Transmission power (maximum by default)
+        if (rfid.setTxPower(readerConfig.txPower)) {
+            DEBUG_PRINTLN("✓ TX Power set successfully");
+            DEBUG_PRINT("✓ TX Power: ");
+            DEBUG_PRINT(readerConfig.txPower / 100.0);
+            DEBUG_PRINTLN(" dB");
+        } else {
+            DEBUG_PRINTLN("✗ TX Power setting failed!");
+        }
+        
+        DEBUG_PRINTLN("✓ RFID Module initialized successfully");
+    }
+}
+
+/**
+ * Start continuous inventory on every module (rfidTask; streaming mode)
+ */
+void startReaders() {
+    for (RfidReader &reader : rfidReaders) {
+        reader.driver.startContinuousPolling();
     }
+}
+
+/**
+ * Give each switched antenna an equal share of the cycle window (streaming mode).
+ * Call right after processStream(), so reads already received count for the antenna that made them.
+ * @return Cycle time (ms) at which the next antenna is due, or windowMs
+ */
+unsigned long rotateAntenna(RfidReader &reader, unsigned long elapsed, unsigned long windowMs) {
+    uint8_t antennas = reader.antenna.antennas();
+    if (antennas == 1) return windowMs;
     
-    DEBUG_PRINTLN("✓ RFID Module initialized successfully");
+    unsigned long share = windowMs / antennas;
+    uint8_t due = elapsed / share < antennas ? elapsed / share : antennas - 1;
+    if (due != reader.antenna.current()) {
+        reader.selectAntenna(due);
+    }
+    return due + 1 < antennas ? (due + 1) * share : windowMs;
 }
 
 // ============================================
@@ -452,155 +858,392 @@ void initializeRFID() {
 // ============================================
 
 /**
- * Print combined RFID + UWB data triggered by RFID polling cycle
- * Also publishes to MQTT if START signal received
- * JSON format matches RFID+UWB_TEST reference exactly
+ * Publish one polling cycle to MQTT if START signal received
+ * JSON on TOPIC_DATA and/or binary frames on TOPIC_DATA_BIN (PUBLISH_JSON / PUBLISH_BINARY),
+ * or batched with other cycles on TOPIC_DATA_BATCH (PUBLISH_BATCH)
+ * While offline, or if the publish fails, the cycle goes to the backlog instead
  */
-void combineDataFromPollingAndSend(uint32_t cycleCount) {
-    unsigned long timestamp = millis();
+void combineDataFromPollingAndSend(const CycleRecord &record) {
+#if SERIAL_JSON_MIRROR
+    mirrorCycleToSerial(record);
+#endif
     
-    // Get RFID data
-    uint8_t tagCount = 0;
-    RFIDTagData tags[RFID_MAX_TAGS];
+    if (!startSignal) return;
     
-    if (xSemaphoreTake(rfidMutex, pdMS_TO_TICKS(10))) {
-        tagCount = currentRfidTagCount;
-        for (uint8_t i = 0; i < tagCount && i < RFID_MAX_TAGS; i++) {
-            tags[i] = currentRfidTags[i];
-        }
-        xSemaphoreGive(rfidMutex);
-    }
+#if PRESENCE_EVENTS
+    // Every cycle counts, online or not: an empty cycle in range is evidence of absence
+    presenceTable.update(record);
+#endif
     
-    // Get anchor statistics (accumulated during polling) - dynamic map
-    std::map<String, AnchorStats> statsMap;
+    // Publish only if we have data
+    if (record.tagCount == 0 && record.anchors.empty()) {
+        DEBUG_PRINTLN("[MQTT] ⊘ No data to publish");
+        return;
+    }
     
-    if (xSemaphoreTake(anchorStatsMutex, pdMS_TO_TICKS(10))) {
-        statsMap = anchorStatsMap;
-        xSemaphoreGive(anchorStatsMutex);
+    if (!connection.online()) {
+#if PUBLISH_BATCH
+        backlogBatch();  // Older than this cycle
+#endif
+        backlogCycle(record);  // Includes cycles produced while reconnecting
+        return;
     }
     
-    // Count only anchors with valid distance readings
-    uint32_t validAnchorCount = 0;
-    for (auto& pair : statsMap) {
-        if (pair.second.successCount > 0) {
-            validAnchorCount++;
-        }
+#if PUBLISH_BATCH
+    if (cycleBatch.enabled()) {
+        batchCycle(record);
+        return;
     }
+#endif
     
-    // Build and print complete JSON (matching RFID+UWB_TEST format exactly)
-    Serial.println("{");
-    Serial.printf("  \"polling_cycle\": %u,\n", cycleCount);
-    Serial.printf("  \"timestamp\": %lu,\n", timestamp);
+    // Delta against the last published set, unless a keyframe is due
+    bool useDelta = PUBLISH_DELTAS && tagDelta.compute(record);
+    const TagDeltaTracker *delta = useDelta ? &tagDelta : NULL;
+    bool published = true;   // Every enabled format went out
+    bool delivered = false;  // At least one did; the bridge consumes only one of them
     
-    // UWB section with averaged distances per anchor (only anchors with valid readings)
-    Serial.println("  \"uwb\": {");
-    Serial.printf("    \"n_anchors\": %u,\n", validAnchorCount);
-    Serial.println("    \"anchors\": [");
+#if PUBLISH_JSON
+    bool jsonSent = publishCycle(TOPIC_DATA, record, CYCLE_PAYLOAD_JSON, delta);
+    published &= jsonSent;
+    delivered |= jsonSent;
+#endif
+#if PUBLISH_BINARY
+    bool binarySent = publishCycle(TOPIC_DATA_BIN, record, CYCLE_PAYLOAD_BINARY, delta);
+    published &= binarySent;
+    delivered |= binarySent;
+#endif
+
+    if (!delivered) {
+        backlogCycle(record);
+    }
+
+#if PUBLISH_DELTAS
+    // The baseline must match what the receiver has; after a miss, resync with a keyframe
+    if (published) {
+        tagDelta.commit(record, !useDelta);
+    } else {
+        tagDelta.requestKeyframe();
+    }
+#endif
+}
+
+/**
+ * Stream one cycle into a single MQTT PUBLISH: the exact length is known up front,
+ * the payload goes out through a chunk buffer (no document, no String)
+ */
+bool publishCycle(const char *topic, const CycleRecord &record, CyclePayloadFormat format, const TagDeltaTracker *delta) {
+    uint32_t serializeStart = ESP.getCycleCount();
+    size_t length = CycleSerializer::length(record, format, delta);
+    uint32_t publishStart = ESP.getCycleCount();
+    recordTiming(TIMING_SERIALIZE, publishStart - serializeStart);
+    bool success = false;
     
-    bool first = true;
-    for (auto& pair : statsMap) {
-        const AnchorStats& stats = pair.second;
+    int qos = publishQos(topic, length);
+    if (qos >= 0 && mqttClient.beginPublish(topic, length, (uint8_t)qos, false)) {
+        ChunkedPrint out(mqttClient, mqttWriteChunk, sizeof(mqttWriteChunk));
+        CycleSerializer::write(out, record, format, delta);
+        out.flush();
+        bool accepted = mqttClient.endPublish();
+        bool streamed = !out.failed() && out.written() == length;
+        // At QoS 1 the client holds the packet and resends it after the reconnect
+        success = accepted && (qos == 1 || streamed);
         
-        // Skip anchors with no successful measurements
-        if (stats.successCount == 0) continue;
-        
-        if (!first) Serial.println(",");
-        first = false;
-        
-        float avgDistance = stats.totalDistance / stats.successCount;
-        
-        Serial.println("      {");
-        Serial.printf("        \"mac_address\": \"0x%s\",\n", stats.macAddress.c_str());
-        Serial.printf("        \"average_distance_cm\": %.1f,\n", avgDistance);
-        Serial.printf("        \"measurements\": %u,\n", stats.successCount);
-        Serial.printf("        \"total_sessions\": %u\n", stats.totalCount);
-        Serial.print("      }");
+        if (!streamed) {
+            // A short write leaves the broker mid-packet; start over on a fresh connection
+            mqttClient.disconnect();
+        }
     }
-    if (validAnchorCount > 0) Serial.println();
+    recordTiming(TIMING_PUBLISH, ESP.getCycleCount() - publishStart);
     
-    Serial.println("    ]");
-    Serial.println("  },");
+    if (success) {
+        DEBUG_PRINT("[MQTT] ✓ Published - Cycle #");
+        DEBUG_PRINT(record.cycle);
+        DEBUG_PRINT(" (");
+        DEBUG_PRINT(record.tagCount);
+        DEBUG_PRINT(delta ? " tags, delta, " : " tags, ");
+        DEBUG_PRINT(CycleSerializer::countReportableAnchors(record));
+        DEBUG_PRINT(" UWB, ");
+        DEBUG_PRINT(length);
+        DEBUG_PRINT(" bytes) -> ");
+        DEBUG_PRINTLN(topic);
+    } else {
+        publishFailures++;
+        DEBUG_PRINT("[MQTT] ✗ Publish failed! -> ");
+        DEBUG_PRINTLN(topic);
+    }
+    return success;
+}
+
+/**
+ * Add a live cycle to the batch (PUBLISH_BATCH). It goes out once BATCH_MAX_CYCLES are waiting or
+ * the cycle would not fit; outputTask publishes a batch that reaches BATCH_MAX_AGE_MS first.
+ */
+void batchCycle(const CycleRecord &record) {
+    if (!cycleBatch.push(record)) {
+        publishBatch();
+        cycleBatch.push(record);  // Always fits an empty batch
+    }
+    if (cycleBatch.due(millis(), BATCH_MAX_CYCLES, BATCH_MAX_AGE_MS)) {
+        publishBatch();
+    }
+}
+
+/**
+ * Publish the waiting cycles as one message on TOPIC_DATA_BATCH, in the backlog batch format
+ * (LZ4-compressed when smaller). Cycles of a batch that does not go out move to the backlog.
+ */
+void publishBatch() {
+    if (cycleBatch.empty()) return;
+    if (!connection.online()) {
+        backlogBatch();
+        return;
+    }
     
-    // RFID section
-    Serial.println("  \"rfid\": {");
-    Serial.printf("    \"tag_count\": %u,\n", tagCount);
-    Serial.println("    \"tags\": [");
+    uint32_t sealStart = ESP.getCycleCount();
+    size_t length = cycleBatch.seal(millis());
+    recordTiming(TIMING_BATCH_SEAL, ESP.getCycleCount() - sealStart);
+    bool success = false;
     
-    for (uint8_t i = 0; i < tagCount; i++) {
-        Serial.println("      {");
-        Serial.printf("        \"epc\": \"%s\",\n", tags[i].epc.c_str());
-        Serial.printf("        \"rssi_dbm\": %d\n", tags[i].rssi);
-        Serial.print("      }");
-        if (i < tagCount - 1) Serial.println(",");
-        else Serial.println();
+    int qos = publishQos(TOPIC_DATA_BATCH, length);
+    if (qos >= 0) {
+        // Already in RAM: one span, written to the socket as it is
+        MQTTPayloadSpan span = {cycleBatch.payload(), length};
+        success = mqttClient.publish(TOPIC_DATA_BATCH, &span, 1, (uint8_t)qos, false);
     }
     
-    Serial.println("    ]");
-    Serial.println("  }");
-    Serial.println("}\n");
+    if (success) {
+        DEBUG_PRINT("[MQTT] ✓ Published batch - ");
+        DEBUG_PRINT(cycleBatch.count());
+        DEBUG_PRINT(" cycles (");
+        DEBUG_PRINT(length);
+        if (cycleBatch.compressed()) {
+            DEBUG_PRINT(" bytes, LZ4 of ");
+            DEBUG_PRINT(cycleBatch.rawBytes());
+        }
+        DEBUG_PRINT(" bytes) -> ");
+        DEBUG_PRINTLN(TOPIC_DATA_BATCH);
+        cycleBatch.clear();
+    } else {
+        publishFailures++;
+        DEBUG_PRINT("[MQTT] ✗ Batch publish failed! -> ");
+        DEBUG_PRINTLN(TOPIC_DATA_BATCH);
+        backlogBatch();
+    }
+}
+
+/**
+ * Move the waiting live cycles to the backlog, oldest first (dropped if the backlog is disabled)
+ */
+void backlogBatch() {
+    if (cycleBatch.empty()) return;
+#if BACKLOG_ENABLED
+    size_t offset = 0;
+    uint16_t length;
+    const uint8_t *frame;
+    while ((frame = cycleBatch.nextFrame(offset, length)) != NULL) {
+        backlog.pushFrame(frame, length);
+    }
+    DEBUG_PRINT("[BACKLOG] Offline - ");
+    DEBUG_PRINT(cycleBatch.count());
+    DEBUG_PRINT(" batched cycles queued (");
+    DEBUG_PRINT(backlog.count());
+    DEBUG_PRINTLN(" waiting)");
+#else
+    DEBUG_PRINTLN("[MQTT] Offline - Dropping batched cycles");
+#endif
+    cycleBatch.clear();
+}
+
+/**
+ * Publish the latest UWB session if it is new and the stream interval has passed.
+ * QoS 0 and never queued: a lost sample is superseded by the next one within ~150ms.
+ */
+void publishUwbSample() {
+    static uint32_t lastSession = 0;
+    static unsigned long lastPublish = 0;
+    static UwbSample sample;  // outputTask only
     
-    // Build JSON document for MQTT (using ArduinoJson for proper serialization)
-    StaticJsonDocument<4096> doc;
+    if (!startSignal || !connection.online()) return;
+    unsigned long now = millis();
+    if (now - lastPublish < UWB_STREAM_INTERVAL_MS) return;
     
-    doc["polling_cycle"] = cycleCount;
-    doc["timestamp"] = timestamp;
+    portENTER_CRITICAL(&uwbSampleMux);
+    bool fresh = latestUwbSample.session != lastSession;
+    if (fresh) {
+        sample = latestUwbSample;
+    }
+    portEXIT_CRITICAL(&uwbSampleMux);
+    if (!fresh) return;
     
-    // UWB section (only anchors with valid readings)
-    JsonObject uwb = doc.createNestedObject("uwb");
-    uwb["n_anchors"] = validAnchorCount;
-    JsonArray anchors = uwb.createNestedArray("anchors");
+    size_t length = CycleSerializer::measureSampleJson(sample);
+    bool success = false;
+    if (mqttClient.beginPublish(TOPIC_UWB, length, false)) {
+        ChunkedPrint out(mqttClient, mqttWriteChunk, sizeof(mqttWriteChunk));
+        CycleSerializer::writeSampleJson(out, sample);
+        out.flush();
+        bool accepted = mqttClient.endPublish();
+        bool streamed = !out.failed() && out.written() == length;
+        success = accepted && streamed;
+        if (!streamed) {
+            mqttClient.disconnect();  // Broker is mid-packet
+        }
+    }
+    if (!success) {
+        publishFailures++;  // Not retried: the next session supersedes it
+    }
+    lastSession = sample.session;
+    lastPublish = now;
+}
+
+/**
+ * Publish pending presence events, oldest first, up to PRESENCE_BATCH_EVENTS per message.
+ * The backend cannot infer them again, so they are popped only once a publish succeeds
+ * (QoS 1 when the window allows) and wait in the table's queue while offline.
+ */
+void publishPresenceEvents() {
+    if (!startSignal || !connection.online() || presenceTable.pending() == 0) return;
     
-    for (auto& pair : statsMap) {
-        const AnchorStats& stats = pair.second;
-        
-        // Skip anchors with no successful measurements
-        if (stats.successCount == 0) continue;
-        
-        JsonObject anchor = anchors.createNestedObject();
-        anchor["mac_address"] = "0x" + stats.macAddress;
-        float avgDistance = stats.totalDistance / stats.successCount;
-        anchor["average_distance_cm"] = avgDistance;
-        anchor["measurements"] = stats.successCount;
-        anchor["total_sessions"] = stats.totalCount;
+    uint16_t count = presenceTable.pending();
+    if (count > PRESENCE_BATCH_EVENTS) {
+        count = PRESENCE_BATCH_EVENTS;
     }
+    size_t length = presenceTable.measureJson(count);
+    bool success = false;
     
-    // RFID section
-    JsonObject rfid_obj = doc.createNestedObject("rfid");
-    rfid_obj["tag_count"] = tagCount;
-    JsonArray tagsArray = rfid_obj.createNestedArray("tags");
+    int qos = publishQos(TOPIC_PRESENCE, length);
+    if (qos >= 0 && mqttClient.beginPublish(TOPIC_PRESENCE, length, (uint8_t)qos, false)) {
+        ChunkedPrint out(mqttClient, mqttWriteChunk, sizeof(mqttWriteChunk));
+        presenceTable.writeJson(out, count);
+        out.flush();
+        bool accepted = mqttClient.endPublish();
+        bool streamed = !out.failed() && out.written() == length;
+        success = accepted && (qos == 1 || streamed);
+        if (!streamed) {
+            mqttClient.disconnect();  // Broker is mid-packet
+        }
+    }
     
-    for (uint8_t i = 0; i < tagCount; i++) {
-        JsonObject tag = tagsArray.createNestedObject();
-        tag["epc"] = tags[i].epc;
-        tag["rssi_dbm"] = tags[i].rssi;
+    if (success) {
+        presenceTable.pop(count);
+        DEBUG_PRINT("[PRESENCE] ✓ Published ");
+        DEBUG_PRINT(count);
+        DEBUG_PRINT(" events (");
+        DEBUG_PRINT(presenceTable.size());
+        DEBUG_PRINTLN(" tags tracked)");
+    } else {
+        publishFailures++;
+        DEBUG_PRINTLN("[PRESENCE] ✗ Publish failed, events kept");
     }
+}
+
+/**
+ * QoS for the next publish: 1 once the in-flight window has room (pumping loop() for
+ * PUBACKs for up to MQTT_INFLIGHT_WAIT_MS), 0 if the payload can never fit the window,
+ * -1 if the window stayed full or the session dropped while waiting
+ */
+int publishQos(const char *topic, size_t length) {
+#if MQTT_PUBLISH_QOS
+    if (!mqttClient.inflightFits(topic, length)) return 0;
     
-    // Publish to MQTT if START signal received and we have data
-    if (startSignal && (tagCount > 0 || !statsMap.empty())) {
-        String payload;
-        serializeJson(doc, payload);
+    unsigned long start = millis();
+    while (!mqttClient.inflightReady(topic, length)) {
+        if (millis() - start >= MQTT_INFLIGHT_WAIT_MS || !mqttClient.loop()) {
+            DEBUG_PRINTLN("[MQTT] ✗ No PUBACK in time, QoS 1 window full");
+            return -1;
+        }
+        vTaskDelay(1);
+    }
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Keep a cycle that could not be published (dropped if the backlog is disabled)
+ */
+void backlogCycle(const CycleRecord &record) {
+#if BACKLOG_ENABLED
+    if (backlog.push(record)) {
+        DEBUG_PRINT("[BACKLOG] Offline - Cycle #");
+        DEBUG_PRINT(record.cycle);
+        DEBUG_PRINT(" queued (");
+        DEBUG_PRINT(backlog.count());
+        DEBUG_PRINTLN(" waiting)");
+        return;
+    }
+#endif
+    DEBUG_PRINTLN("[MQTT] Offline - Dropping data cycle");
+}
+
+/**
+ * Publish the oldest queued cycles as one batch on TOPIC_DATA_BACKLOG,
+ * at most one batch per BACKLOG_DRAIN_INTERVAL_MS so the live stream keeps priority
+ */
+void drainBacklog() {
+    static unsigned long lastDrain = 0;
+    
+    if (!connection.online() || backlog.empty()) return;
+    if (millis() - lastDrain < BACKLOG_DRAIN_INTERVAL_MS) return;
+    lastDrain = millis();
+    
+    size_t length;
+    uint16_t frames = backlog.planBatch(BACKLOG_BATCH_BYTES, BACKLOG_BATCH_FRAMES, length);
+    if (frames == 0) return;
+    
+    bool success = false;
+    int qos = publishQos(TOPIC_DATA_BACKLOG, length);
+    MQTTPayloadSpan spans[CYCLE_BATCH_MAX_SPANS];
+    uint8_t spanCount = backlog.batchSpans(spans, frames, millis());
+    if (qos >= 0 && spanCount > 0) {
+        // RAM batch: written to the socket straight from the ring
+        success = mqttClient.publish(TOPIC_DATA_BACKLOG, spans, spanCount, (uint8_t)qos, false);
+    } else if (qos >= 0 && mqttClient.beginPublish(TOPIC_DATA_BACKLOG, length, (uint8_t)qos, false)) {
+        ChunkedPrint out(mqttClient, mqttWriteChunk, sizeof(mqttWriteChunk));
+        backlog.writeBatch(out, frames, millis());
+        out.flush();
+        bool accepted = mqttClient.endPublish();
+        bool streamed = !out.failed() && out.written() == length;
+        success = accepted && (qos == 1 || streamed);
         
-        bool success = mqttClient.publish(TOPIC_DATA, payload.c_str());
-        if (success) {
-            DEBUG_PRINT("[MQTT] ✓ Published - Cycle #");
-            DEBUG_PRINT(cycleCount);
-            DEBUG_PRINT(" (");
-            DEBUG_PRINT(tagCount);
-            DEBUG_PRINT(" tags, ");
-            DEBUG_PRINT(statsMap.size());
-            DEBUG_PRINTLN(" UWB)");
-        } else {
-            DEBUG_PRINTLN("[MQTT] ✗ Publish failed!");
+        if (!streamed) {
+            mqttClient.disconnect();
         }
-    } else if (startSignal) {
-        DEBUG_PRINTLN("[MQTT] ⊘ No data to publish");
     }
+    
+    if (success) {
+        backlog.pop(frames);
+        DEBUG_PRINT("[BACKLOG] ✓ Sent ");
+        DEBUG_PRINT(frames);
+        DEBUG_PRINT(" cycles (");
+        DEBUG_PRINT(length);
+        DEBUG_PRINT(" bytes), ");
+        DEBUG_PRINT(backlog.count());
+        DEBUG_PRINTLN(" left");
+    } else {
+        DEBUG_PRINTLN("[BACKLOG] ✗ Batch publish failed, will retry");
+    }
+}
+
+/**
+ * Debug sink: echo a cycle's JSON to Serial, at most once per SERIAL_MIRROR_INTERVAL_MS
+ */
+void mirrorCycleToSerial(const CycleRecord &record) {
+    static unsigned long lastMirror = 0;
+    static bool mirrored = false;
+    
+    if (mirrored && record.timestamp - lastMirror < SERIAL_MIRROR_INTERVAL_MS) return;
+    mirrored = true;
+    lastMirror = record.timestamp;
+    
+    CycleSerializer::writeJson(Serial, record);
+    Serial.println();
 }
 
 /**
  * Print combined RFID + UWB data (legacy function, kept for compatibility)
  */
-void printCombinedData(UWBSession &uwbSession) {
+void printCombinedData(UWBSession &uwbSession, const CycleRecord &record) {
     DEBUG_PRINTLN("\n╔════════════════════════════════════════╗");
     DEBUG_PRINT("║  Session #");
     DEBUG_PRINT(uwbSession.sessionCount);
@@ -613,7 +1256,7 @@ void printCombinedData(UWBSession &uwbSession) {
     printUWBData(uwbSession);
     
     // Print RFID tags detected during this period
-    printRFIDData();
+    printRFIDData(record);
     
     DEBUG_PRINTLN("════════════════════════════════════════\n");
 }
@@ -626,7 +1269,7 @@ void printUWBData(UWBSession &session) {
     uint8_t successCount = 0;
     
     for (uint8_t i = 0; i < session.nMeasurements; i++) {
-        if (session.measurements[i].status == "SUCCESS" && 
+        if (session.measurements[i].status == UWB_STATUS_SUCCESS && 
             session.measurements[i].distanceCm > 0) {
             totalDistance += session.measurements[i].distanceCm;
             successCount++;
@@ -646,50 +1289,54 @@ void printUWBData(UWBSession &session) {
     
     // Print individual anchor distances
     DEBUG_PRINTLN("  Anchor Distances:");
+    char macHex[UWB_MAC_HEX_SIZE];
     for (uint8_t i = 0; i < session.nMeasurements; i++) {
-        DEBUG_PRINT("    • 0x");
-        DEBUG_PRINT(session.measurements[i].macAddress);
+        UWBSessionParser::formatMac(session.measurements[i].macAddress, macHex);
+        DEBUG_PRINT("    • ");
+        DEBUG_PRINT(macHex);
         DEBUG_PRINT(": ");
         
-        if (session.measurements[i].status == "SUCCESS") {
+        if (session.measurements[i].status == UWB_STATUS_SUCCESS) {
             DEBUG_PRINT(session.measurements[i].distanceCm);
             DEBUG_PRINTLN(" cm");
         } else {
-            DEBUG_PRINTLN(session.measurements[i].status);
+            DEBUG_PRINTLN(UWBSessionParser::statusName(session.measurements[i].status));
         }
     }
 }
 
-void printRFIDData() {
+void printRFIDData(const CycleRecord &record) {
     DEBUG_PRINTLN("\n[RFID TAGS]");
     
-    uint8_t tagCount = 0;
-    RFIDTagData tags[RFID_MAX_TAGS];
-    
-    // Get RFID data safely
-    if (xSemaphoreTake(rfidMutex, pdMS_TO_TICKS(100))) {
-        tagCount = currentRfidTagCount;
-        for (uint8_t i = 0; i < tagCount && i < RFID_MAX_TAGS; i++) {
-            tags[i] = currentRfidTags[i];
-        }
-        xSemaphoreGive(rfidMutex);
-    }
+    uint16_t tagCount = record.tagCount;
+    const RFIDTagData *tags = record.tags;
     
     if (tagCount > 0) {
         DEBUG_PRINT("  Tags Detected: ");
         DEBUG_PRINTLN(tagCount);
         DEBUG_PRINTLN("");
         
-        for (uint8_t i = 0; i < tagCount; i++) {
+        char epcHex[RFID_EPC_HEX_SIZE];
+        for (uint16_t i = 0; i < tagCount; i++) {
+            Unit_UHF_RFID::formatHex(tags[i].epc, RFID_EPC_SIZE, epcHex);
             DEBUG_PRINT("  Tag #");
             DEBUG_PRINT(i + 1);
             DEBUG_PRINTLN(":");
             DEBUG_PRINT("    EPC:  ");
-            DEBUG_PRINTLN(tags[i].epc);
+            DEBUG_PRINTLN(epcHex);
             DEBUG_PRINT("    RSSI: ");
             DEBUG_PRINT(tags[i].rssi);
             DEBUG_PRINT(" dBm ");
-            DEBUG_PRINTLN(rfid.getSignalQuality(tags[i].rssi));
+            DEBUG_PRINT(rfidReaders[0].driver.getSignalQuality(tags[i].rssi));
+            DEBUG_PRINT(" (");
+            DEBUG_PRINT(tags[i].reads);
+            DEBUG_PRINT(" reads, sources");
+            for (uint8_t source = 0; source < RFID_MAX_SOURCES; source++) {
+                if (!(tags[i].sources & (1 << source))) continue;
+                DEBUG_PRINT(" ");
+                DEBUG_PRINT(source);
+            }
+            DEBUG_PRINTLN(")");
         }
     } else {
         DEBUG_PRINTLN("  No tags detected");
@@ -703,302 +1350,916 @@ void printRFIDData() {
 void initializeUWB() {
     DEBUG_PRINTLN("\n--- Initializing UWB Module ---");
     
+    uwbSerial.setRxBufferSize(UWB_BUFFER_SIZE);  // Must precede begin()
     uwbSerial.begin(UWB_BAUD, SERIAL_8N1, UWB_RX_PIN, UWB_TX_PIN);
+    uwbRx.attach(&uwbSerial, UWB_RX_FIFO_FULL, UART_RX_TIMEOUT_SYMBOLS);
+    uwbPort.attach(CAPTURE_PORT_UWB, &uwbSerial, &uwbRx, &uartCapture);
     delay(500);
     
     DEBUG_PRINTLN("✓ DWM3001CDK UART Ready");
 }
 
-void processUWBLine(String line) {
-    // Detect start of SESSION_INFO_NTF
-    if (line.indexOf("SESSION_INFO_NTF:") != -1) {
-        inUwbSession = true;
-        uwbSessionBuffer = line + "\n";
+/**
+ * Called by the UWB task each time the tokenizer closes a SESSION_INFO_NTF
+ * (mirrored by HostPipeline::handleUWBSession() for the host replay)
+ */
+void handleUWBSession(const UWBSession &session) {
+    uwbSessionCount++;
+    
+    latestUwbSession = session;
+    latestUwbSession.timestamp = millis();
+    latestUwbSession.sessionCount = uwbSessionCount;
+    
+    // Update anchor statistics
+    uint32_t updateStart = ESP.getCycleCount();
+    updateAnchorStatistics(session);
+    recordTiming(TIMING_ANCHOR_UPDATE, ESP.getCycleCount() - updateStart);
+#if !RFID_STREAMING
+    // Ends the blocking cycle's wait once the table holds ranges
+    if (session.valid && rfidTaskHandle) {
+        xTaskNotifyGive(rfidTaskHandle);
+    }
+#endif
+    
+    bool solved = false;
+#if POSITION_SOLVER_ENABLED
+    uint32_t solveStart = ESP.getCycleCount();
+    solved = updatePosition(session);
+    recordTiming(TIMING_POSITION_SOLVE, ESP.getCycleCount() - solveStart);
+#endif
+#if UWB_STREAM_ENABLED
+    storeUwbSample(session, solved);
+#endif
+}
+
+/**
+ * Offer this session to the UWB stream and wake outputTask to publish it
+ */
+void storeUwbSample(const UWBSession &session, bool solved) {
+    if (!session.valid) return;
+    
+    UwbSample sample;
+    sample.session = latestUwbSession.sessionCount;
+    sample.timestamp = latestUwbSession.timestamp;
+    sample.rangeCount = 0;
+    for (uint8_t i = 0; i < session.nMeasurements; i++) {
+        const UWBMeasurement &m = session.measurements[i];
+        if (m.status != UWB_STATUS_SUCCESS || m.distanceCm <= 0) continue;
+        sample.macAddress[sample.rangeCount] = m.macAddress;
+        sample.distanceCm[sample.rangeCount] = m.distanceCm;
+        sample.rangeCount++;
+    }
+    if (sample.rangeCount == 0) return;
+    
+    if (solved) {
+        sample.position = currentPosition();
+    } else {
+        sample.position = PositionEstimate();
+    }
+    
+    portENTER_CRITICAL(&uwbSampleMux);
+    latestUwbSample = sample;
+    portEXIT_CRITICAL(&uwbSampleMux);
+    if (outputTaskHandle) {
+        xTaskNotifyGive(outputTaskHandle);
+    }
+}
+
+/**
+ * Solve the tag position from this session's ranges to anchors with known coordinates.
+ * Each range is weighted by its anchor's success rate and distance variance, because links
+ * that keep timing out or jumping are usually obstructed. The last cycle's anchor entry is
+ * used until this cycle has POSITION_GATE_MIN_WINDOW distances from the anchor.
+ * Ranges far from the anchor's recent median are dropped as multipath (PositionSolver::rangeWeight()).
+ * Returns true if this session produced a new fix.
+ */
+bool updatePosition(const UWBSession &session) {
+    static RangeSet ranges;  // uwbTask only
+    uint16_t macs[UWB_MAX_MEASUREMENTS];
+    if (!session.valid) return false;
+    
+    if (anchorMapChanged) {
+        anchorMapChanged = false;
+        positionSolver.reset();
+    }
+    
+    ranges.clear();
+    portENTER_CRITICAL(&anchorMapMux);
+    for (uint8_t i = 0; i < session.nMeasurements; i++) {
+        const UWBMeasurement &m = session.measurements[i];
+        float x, y;
+        if (m.status != UWB_STATUS_SUCCESS || m.distanceCm <= 0) continue;
+        if (!anchorMap.find(m.macAddress, x, y)) continue;
+        macs[ranges.count] = m.macAddress;
+        ranges.add(x, y, (float)m.distanceCm, 1.0f);
+    }
+    portEXIT_CRITICAL(&anchorMapMux);
+    if (ranges.count < POSITION_MIN_ANCHORS) return false;
+    
+    unsigned long now = millis();
+    portENTER_CRITICAL(&anchorTableMux);
+    const AnchorTable &table = anchorTables[activeAnchorTable];
+    const AnchorTable &previous = anchorTables[activeAnchorTable ^ 1];  // Last cycle's, until the next swap
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < ranges.count; i++) {
+        const AnchorStats *stats = PositionSolver::weightStats(table.find(macs[i]), previous.find(macs[i]), now);
+        float weight = stats ? PositionSolver::rangeWeight(*stats, ranges.distance[i]) : 1.0f;
+        if (weight <= 0) continue;
+        ranges.x[kept] = ranges.x[i];
+        ranges.y[kept] = ranges.y[i];
+        ranges.distance[kept] = ranges.distance[i];
+        ranges.weight[kept] = weight;
+        kept++;
+    }
+    ranges.count = kept;
+    portEXIT_CRITICAL(&anchorTableMux);
+    
+    PositionEstimate estimate;
+    if (!positionSolver.solve(ranges, millis(), estimate)) return false;
+    portENTER_CRITICAL(&positionMux);
+    latestPosition = estimate;
+    portEXIT_CRITICAL(&positionMux);
+    return true;
+}
+
+/**
+ * Put the radio in the scheduler's current profile before the next cycle:
+ * rest profile.idleMs with the radio off, then set its TX power.
+ * With POWER_SAVE a rest of POWER_RFID_SLEEP_MIN_MS or more hibernates the modules,
+ * and the chip may light-sleep while the UWB line is quiet too.
+ * Motion during the rest ends it early and returns to level 0.
+ * The inventory must be stopped.
+ */
+void applyPollProfile(uint16_t &txPower) {
+    unsigned long restStart = millis();
+    uint16_t restMs = pollScheduler.profile().idleMs;
+    bool hibernating = false;
+    if (restMs > 0) {
+        hibernating = POWER_SAVE && restMs >= POWER_RFID_SLEEP_MIN_MS && sleepReaders();
+        powerLedger.enter(hibernating ? POWER_RADIO_SLEEP : POWER_REST, restStart);
+    }
+    while (millis() - restStart < pollScheduler.profile().idleMs) {
+        PositionEstimate position = currentPosition();
+        if (PollScheduler::moving(position, millis())) {
+            pollScheduler.wake();
+            break;
+        }
+        allowLightSleep(hibernating && millis() - uwbLastRxMs >= POWER_UWB_QUIET_MS);
+        vTaskDelay(pdMS_TO_TICKS(RFID_IDLE_CHECK_MS));
+    }
+    allowLightSleep(false);
+    if (hibernating) wakeReaders();
+    
+    uint16_t power = pollScheduler.profile().txPower;
+    if (power != txPower) {
+        bool ok = true;
+        for (RfidReader &reader : rfidReaders) {
+            ok = reader.driver.setTxPower(power) && ok;
+        }
+        if (ok) txPower = power;  // Otherwise every module is set again next time
+    }
+}
+
+/**
+ * Take a filter received since the last cycle (rfidTask)
+ * @return True if the filter changed
+ */
+bool takeInventoryFilter() {
+    if (!filterChanged) return false;
+    portENTER_CRITICAL(&filterMux);
+    inventoryFilter = pendingFilter;
+    filterChanged = false;
+    portEXIT_CRITICAL(&filterMux);
+    return true;
+}
+
+/**
+ * Program Select and Query for inventoryFilter: the prefixes' common part as an
+ * SL mask, and session S2 in suppressed cycles (S0 otherwise).
+ * The inventory must be stopped.
+ * @return True if the cycle runs with suppression
+ */
+bool programInventoryFilter(uint32_t cycle) {
+    bool suppress = inventoryFilter.suppressesCycle(cycle);
+    uint8_t mask[RFID_EPC_SIZE];
+    uint8_t maskBits = inventoryFilter.commonPrefix(mask);
+    
+    bool ok = true;
+    for (RfidReader &reader : rfidReaders) {
+        Unit_UHF_RFID &rfid = reader.driver;
+        bool accepted;
+        if (maskBits > 0) {
+            accepted = rfid.setSelectParameter(RFID_SEL_TARGET_SL, RFID_SEL_ACTION_MATCH, RFID_MEMBANK_EPC,
+                                               RFID_EPC_MEMORY_OFFSET_BITS, mask, maskBits) &&
+                       rfid.setSelectMode(RFID_SELECT_MODE_ALWAYS);
+        } else {
+            accepted = rfid.setSelectMode(RFID_SELECT_MODE_NEVER);
+        }
+        accepted = accepted && rfid.setQueryParameters(maskBits > 0 ? RFID_QUERY_SEL_SL : RFID_QUERY_SEL_ALL,
+                                                       suppress ? RFID_FILTER_SUPPRESS_SESSION : 0,
+                                                       RFID_QUERY_TARGET_A);
+        ok = ok && accepted;
+    }
+    if (!ok) {
+        DEBUG_PRINTLN("[RFID] ✗ Inventory filter not accepted by the module, retrying next cycle");
+        filterChanged = true;  // Reprogram after the next cycle (pendingFilter still holds it)
+        return false;
+    }
+    return suppress;
+}
+
+/**
+ * Copy of the latest fix (invalid until the first solve)
+ */
+PositionEstimate currentPosition() {
+    portENTER_CRITICAL(&positionMux);
+    PositionEstimate position = latestPosition;
+    portEXIT_CRITICAL(&positionMux);
+    return position;
+}
+
+/**
+ * Retained inventory filter (INVENTORY_FILTER.h). A malformed payload keeps the current filter.
+ */
+void handleFilterMessage(const byte *payload, unsigned int length) {
+    InventoryFilter filter;
+    if (!filter.parse((const char *)payload, length)) {
+        DEBUG_PRINTLN("[FILTER] ✗ Malformed filter ignored");
         return;
     }
+    portENTER_CRITICAL(&filterMux);
+    pendingFilter = filter;
+    filterChanged = true;
+    portEXIT_CRITICAL(&filterMux);
     
-    // Accumulate session lines
-    if (inUwbSession) {
-        uwbSessionBuffer += " " + line + "\n";
+    DEBUG_PRINT("[FILTER] Prefixes: ");
+    DEBUG_PRINT(filter.prefixCount());
+    DEBUG_PRINTLN(filter.suppress() ? ", suppressing recently read tags" : "");
+}
+
+/**
+ * Level table for a config: its window at every level, its rounds and power at level 0;
+ * the backed-off levels poll at most as many rounds and keep their steps below its power
+ */
+void buildPollProfiles(const ReaderConfig &config) {
+    for (uint8_t i = 0; i < RFID_POLL_LEVELS; i++) {
+        const PollProfile &base = rfidPollDefaults[i];
+        PollProfile &level = rfidPollProfiles[i];
+        level.pollCount = i == 0 || base.pollCount > config.pollCount ? config.pollCount : base.pollCount;
+        level.windowMs = config.windowMs;
+        level.idleMs = base.idleMs;
+        int32_t power = (int32_t)config.txPower - (rfidPollDefaults[0].txPower - base.txPower);
+        level.txPower = power < READER_CONFIG_MIN_TX_POWER ? READER_CONFIG_MIN_TX_POWER : (uint16_t)power;
+    }
+}
 
-        if (uwbSessionBuffer.length() > UWB_BUFFER_SIZE) {
-            DEBUG_PRINTLN("[UWB] Session buffer overflow!");
-            inUwbSession = false;
-            uwbSessionBuffer = "";
-            return;
+/**
+ * Take a config received since the last cycle (rfidTask)
+ * @return True if there is one
+ */
+bool takeReaderConfig(ReaderConfig &config) {
+    if (!configChanged) return false;
+    portENTER_CRITICAL(&configMux);
+    config = pendingConfig;
+    configChanged = false;
+    portEXIT_CRITICAL(&configMux);
+    return true;
+}
+
+/**
+ * Program region and receiver params where config differs from running (every module).
+ * The inventory must be stopped.
+ * @return False if a module refused a command
+ */
+bool programReaderConfig(const ReaderConfig &config, const ReaderConfig &running) {
+    bool ok = true;
+    for (RfidReader &reader : rfidReaders) {
+        Unit_UHF_RFID &rfid = reader.driver;
+        if (config.region != running.region) {
+            ok = rfid.setRegion(config.region) && ok;
         }
-        
-        // Detect end of session
-        if (line.indexOf("}") != -1) {
-            inUwbSession = false;
-            parseUWBSession();
-            uwbSessionBuffer = "";
+        if (config.mixerGain != running.mixerGain || config.ifGain != running.ifGain ||
+            config.threshold != running.threshold) {
+            ok = rfid.setReceiverParams(config.mixerGain, config.ifGain, config.threshold) && ok;
         }
     }
+    return ok;
 }
 
-void parseUWBSession() {
-    if (xSemaphoreTake(uwbMutex, pdMS_TO_TICKS(100))) {
-        uwbSessionCount++;
-        
-        latestUwbSession.timestamp = millis();
-        latestUwbSession.sessionCount = uwbSessionCount;
-        latestUwbSession.valid = true;
-        
-        // Extract session metadata
-        latestUwbSession.sessionHandle = extractUWBValue("session_handle");
-        latestUwbSession.sequenceNumber = extractUWBValue("sequence_number");
-        latestUwbSession.blockIndex = extractUWBValue("block_index");
-        latestUwbSession.nMeasurements = extractUWBValue("n_measurements");
-        
-        // Parse measurements
-        parseUWBMeasurements();
-        
-        xSemaphoreGive(uwbMutex);
+/**
+ * Switch to a received config between cycles (rfidTask): program the modules, rebuild the
+ * polling levels, set the UWB freshness. If a module refuses, the running config is programmed
+ * back and stays. Either way outputTask acknowledges; an applied config is also saved.
+ * TX power follows with the next applyPollProfile().
+ */
+void applyReaderConfig(const ReaderConfig &config) {
+    bool ok = programReaderConfig(config, readerConfig);
+    if (ok) {
+        buildPollProfiles(config);
+        AnchorTable::setFreshnessMs(config.uwbFreshnessMs);
+    } else {
+        programReaderConfig(readerConfig, config);
+        DEBUG_PRINTLN("[CONFIG] ✗ Refused by the module - Previous config kept");
     }
     
-    // Update anchor statistics
-    updateAnchorStatistics();
+    portENTER_CRITICAL(&configMux);
+    if (ok) readerConfig = config;
+    configAck.status = ok ? CONFIG_APPLIED : CONFIG_FAILED;
+    configAck.request = config.revision;
+    configAck.config = readerConfig;
+    configAckDue = true;
+    configSaveDue = configSaveDue || ok;
+    portEXIT_CRITICAL(&configMux);
 }
 
-uint32_t extractUWBValue(const char* fieldName) {
-    String searchStr = String(fieldName) + "=";
-    int idx = uwbSessionBuffer.indexOf(searchStr);
+/**
+ * TOPIC_CONTROL "CONFIG ..." (READER_CONFIG.h). A valid config goes to rfidTask for the next
+ * cycle gap; a bare "CONFIG" or a rejected one is answered at once with the running values.
+ * Applies on top of a config still waiting for rfidTask, so quick successive messages add up.
+ */
+void handleConfigMessage(const char *text, unsigned int length) {
+    portENTER_CRITICAL(&configMux);
+    ReaderConfig config = configChanged ? pendingConfig : readerConfig;
+    ReaderConfig running = readerConfig;
+    portEXIT_CRITICAL(&configMux);
     
-    if (idx != -1) {
-        int endIdx = uwbSessionBuffer.indexOf(",", idx);
-        if (endIdx == -1) endIdx = uwbSessionBuffer.indexOf("\n", idx);
-        
-        String value = uwbSessionBuffer.substring(idx + searchStr.length(), endIdx);
-        value.trim();
-        return value.toInt();
+    bool query = true;
+    for (unsigned int i = 0; i < length && query; i++) {
+        query = text[i] == ' ';
+    }
+    ReaderConfigStatus status = query ? CONFIG_CURRENT : parseReaderConfig(text, length, readerConfigDefaults, config);
+    
+    portENTER_CRITICAL(&configMux);
+    if (status == CONFIG_APPLIED) {
+        pendingConfig = config;
+        configChanged = true;
+    } else {
+        configAck.status = status;
+        configAck.request = 0;
+        configAck.config = running;
+        configAckDue = true;
+    }
+    portEXIT_CRITICAL(&configMux);
+    
+    if (status == CONFIG_APPLIED) {
+        DEBUG_PRINT("[CONFIG] Rev ");
+        DEBUG_PRINT(config.revision);
+        DEBUG_PRINTLN(" - Applying after this cycle");
+    } else if (status != CONFIG_CURRENT) {
+        DEBUG_PRINT("[CONFIG] ✗ Rejected: ");
+        DEBUG_PRINTLN(readerConfigStatusName(status));
     }
-    return 0;
 }
 
-void parseUWBMeasurements() {
-    int searchStart = 0;
-    uint8_t measIdx = 0;
+/**
+ * Save an applied config to NVS (whether online or not), then answer on TOPIC_STATUS (outputTask).
+ * QoS 0, not retained; an ack that cannot go out waits for the connection.
+ */
+void publishConfigAck() {
+    if (configSaveDue) {
+        portENTER_CRITICAL(&configMux);
+        ReaderConfig config = readerConfig;
+        configSaveDue = false;
+        portEXIT_CRITICAL(&configMux);
+        saveReaderConfig(config);
+    }
     
-    while (measIdx < 10) {
-        int macIdx = uwbSessionBuffer.indexOf("[mac_address=0x", searchStart);
-        if (macIdx == -1) break;
-        
-        int measEnd = uwbSessionBuffer.indexOf("];", macIdx);
-        if (measEnd == -1) measEnd = uwbSessionBuffer.indexOf("]}", macIdx);
-        if (measEnd == -1) break;
-        
-        String measurement = uwbSessionBuffer.substring(macIdx, measEnd + 1);
-        
-        // Extract MAC address
-        int macStart = measurement.indexOf("0x") + 2;
-        latestUwbSession.measurements[measIdx].macAddress = 
-            measurement.substring(macStart, macStart + 4);
-        
-        // Extract status
-        int statusIdx = measurement.indexOf("status=\"");
-        int statusEnd = measurement.indexOf("\"", statusIdx + 8);
-        latestUwbSession.measurements[measIdx].status = 
-            measurement.substring(statusIdx + 8, statusEnd);
-        
-        // Extract distance
-        latestUwbSession.measurements[measIdx].distanceCm = -1;
-        if (latestUwbSession.measurements[measIdx].status == "SUCCESS") {
-            int distIdx = measurement.indexOf("distance[cm]=");
-            if (distIdx != -1) {
-                distIdx += 13;
-                int distEnd = distIdx;
-                while (distEnd < measurement.length() && 
-                       isDigit(measurement.charAt(distEnd))) {
-                    distEnd++;
-                }
-                latestUwbSession.measurements[measIdx].distanceCm = 
-                    measurement.substring(distIdx, distEnd).toInt();
-            }
+    if (!configAckDue || !connection.online()) return;
+    portENTER_CRITICAL(&configMux);
+    ReaderConfigAck ack = configAck;
+    configAckDue = false;
+    portEXIT_CRITICAL(&configMux);
+    
+    size_t length = ack.measureJson();
+    if (mqttClient.beginPublish(TOPIC_STATUS, length, false)) {
+        ChunkedPrint out(mqttClient, mqttWriteChunk, sizeof(mqttWriteChunk));
+        ack.writeJson(out);
+        out.flush();
+        mqttClient.endPublish();
+        if (out.failed() || out.written() != length) {
+            mqttClient.disconnect();  // Broker is mid-packet
         }
-        
-        measIdx++;
-        searchStart = measEnd + 1;
+    } else {
+        configAckDue = true;  // Next pass
     }
 }
 
-void updateAnchorStatistics() {
-    UWBSession session;
-    bool hasData = false;
+/**
+ * Config saved by an earlier CONFIG. A blob of another size, schema version or out of range is ignored.
+ * @return True if config was replaced
+ */
+bool loadReaderConfig(ReaderConfig &config) {
+    ReaderConfig stored;
+    if (!configStore.begin(READER_CONFIG_NVS_NAMESPACE, true)) return false;  // Nothing saved yet
+    bool found = configStore.getBytesLength(READER_CONFIG_NVS_KEY) == sizeof(stored) &&
+                 configStore.getBytes(READER_CONFIG_NVS_KEY, &stored, sizeof(stored)) == sizeof(stored) &&
+                 readerConfigValid(stored);
+    configStore.end();
+    if (found) config = stored;
+    return found;
+}
+
+void saveReaderConfig(const ReaderConfig &config) {
+    bool ok = configStore.begin(READER_CONFIG_NVS_NAMESPACE, false) &&
+              configStore.putBytes(READER_CONFIG_NVS_KEY, &config, sizeof(config)) == sizeof(config);
+    configStore.end();
+    if (!ok) DEBUG_PRINTLN("[CONFIG] ✗ NVS write failed - Config lost at reboot");
+}
+
+/**
+ * Retained anchor coordinates: topic store/production/anchors/<mac>, payload "x_cm,y_cm".
+ * An empty payload removes the anchor.
+ */
+void handleAnchorMessage(const char *macText, const byte *payload, unsigned int length) {
+    char *end;
+    unsigned long mac = strtoul(macText, &end, 16);  // Accepts "0x0001" and "0001"
+    if (end == macText || *end != '\0' || mac > 0xffff) return;
     
-    // Get current UWB session
-    if (xSemaphoreTake(uwbMutex, pdMS_TO_TICKS(10))) {
-        if (latestUwbSession.valid) {
-            session = latestUwbSession;
-            hasData = true;
-        }
-        xSemaphoreGive(uwbMutex);
+    char text[32];
+    if (length >= sizeof(text)) return;
+    memcpy(text, payload, length);
+    text[length] = '\0';
+    
+    float x = 0, y = 0;
+    if (length > 0) {
+        x = strtof(text, &end);
+        if (end == text || *end != ',') return;
+        const char *second = end + 1;
+        y = strtof(second, &end);
+        if (end == second) return;
     }
     
-    if (!hasData) return;
+    portENTER_CRITICAL(&anchorMapMux);
+    bool stored = true;
+    if (length == 0) {
+        anchorMap.remove((uint16_t)mac);
+    } else {
+        stored = anchorMap.set((uint16_t)mac, x, y);
+    }
+    portEXIT_CRITICAL(&anchorMapMux);
+    anchorMapChanged = true;
+    
+    if (!stored) {
+        DEBUG_PRINTLN("[POSITION] ✗ Anchor map full, coordinates ignored");
+    }
+}
+
+void updateAnchorStatistics(const UWBSession &session) {
+    if (!session.valid) return;
     
     unsigned long now = millis();
     
-    // Update anchor statistics using circular buffer with time-based expiration
-    if (xSemaphoreTake(anchorStatsMutex, pdMS_TO_TICKS(100))) {
-        // First pass: Remove stale entries (older than 3 seconds)
-        auto it = anchorStatsMap.begin();
-        while (it != anchorStatsMap.end()) {
-            if (now - it->second.timestamp > UWB_FRESHNESS_MS) {
-                DEBUG_PRINT("[UWB] Removing stale anchor 0x");
-                DEBUG_PRINTLN(it->first);
-                it = anchorStatsMap.erase(it);
-            } else {
-                ++it;
-            }
-        }
-        
-        // Second pass: Update/add measurements
-        for (uint8_t i = 0; i < session.nMeasurements; i++) {
-            String macAddr = session.measurements[i].macAddress;
-            
-            // Check if anchor exists OR if we have space for new anchors
-            bool anchorExists = anchorStatsMap.find(macAddr) != anchorStatsMap.end();
-            bool hasSpace = anchorStatsMap.size() < UWB_MAX_ANCHORS;
-            
-            if (!anchorExists && !hasSpace) {
-                // Buffer full - find and replace oldest entry
-                String oldestMac;
-                unsigned long oldestTime = now;
-                
-                for (auto& pair : anchorStatsMap) {
-                    if (pair.second.timestamp < oldestTime) {
-                        oldestTime = pair.second.timestamp;
-                        oldestMac = pair.first;
-                    }
-                }
-                
-                if (!oldestMac.isEmpty()) {
-                    DEBUG_PRINT("[UWB] Buffer full, replacing oldest anchor 0x");
-                    DEBUG_PRINT(oldestMac);
-                    DEBUG_PRINT(" with 0x");
-                    DEBUG_PRINTLN(macAddr);
-                    anchorStatsMap.erase(oldestMac);
-                    anchorExists = false;
-                    hasSpace = true;
-                }
-            }
-            
-            // Create new anchor stats if needed
-            if (!anchorExists) {
-                AnchorStats newStats;
-                newStats.macAddress = macAddr;
-                newStats.totalDistance = 0;
-                newStats.successCount = 0;
-                newStats.totalCount = 0;
-                newStats.timestamp = now;
-                anchorStatsMap[macAddr] = newStats;
-            }
-            
-            // Update statistics
-            anchorStatsMap[macAddr].totalCount++;
-            anchorStatsMap[macAddr].timestamp = now;  // Update timestamp
-            
-            if (session.measurements[i].status == "SUCCESS" && 
-                session.measurements[i].distanceCm > 0) {
-                anchorStatsMap[macAddr].totalDistance += session.measurements[i].distanceCm;
-                anchorStatsMap[macAddr].successCount++;
-            }
+    // Short critical section: at most UWB_MAX_MEASUREMENTS table updates
+    portENTER_CRITICAL(&anchorTableMux);
+    AnchorTable &table = anchorTables[activeAnchorTable];
+    for (uint8_t i = 0; i < session.nMeasurements; i++) {
+        const UWBMeasurement &m = session.measurements[i];
+        table.record(m.macAddress, m.status == UWB_STATUS_SUCCESS && m.distanceCm > 0, m.distanceCm, now);
+    }
+    portEXIT_CRITICAL(&anchorTableMux);
+}
+
+/**
+ * Hand the table filled during this cycle to the caller and make the other one active, cleared.
+ * The returned table is read-only until the next call: updatePosition() still weighs the first
+ * sessions of the new cycle by it, until their own windows fill.
+ */
+AnchorTable &swapAnchorTables() {
+    portENTER_CRITICAL(&anchorTableMux);
+    uint8_t filled = activeAnchorTable;
+    anchorTables[filled ^ 1].clear();
+    activeAnchorTable = filled ^ 1;
+    portEXIT_CRITICAL(&anchorTableMux);
+    return anchorTables[filled];
+}
+
+// ============================================
+// POWER FUNCTIONS
+// ============================================
+
+/**
+ * POWER_SAVE: frequency scaling with automatic light sleep (DFS only if the core was built
+ * without tickless idle), UWB RX as a wake source, WiFi modem sleep. Call after connection.begin()
+ * and initializeUWB(): uwbSerial.begin() resets the UART, wake-up threshold included.
+ */
+void initializePower() {
+#if POWER_SAVE
+    esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "uart", &uartAwakeLock);
+    esp_pm_lock_acquire(uartAwakeLock);  // Released only while the modules hibernate (allowLightSleep())
+    
+#if ESP_IDF_VERSION_MAJOR >= 5
+    esp_pm_config_t pm = {};
+#else
+    esp_pm_config_esp32s3_t pm = {};
+#endif
+    pm.max_freq_mhz = POWER_CPU_MAX_MHZ;
+    pm.min_freq_mhz = POWER_CPU_MIN_MHZ;
+    pm.light_sleep_enable = true;
+    powerLightSleep = esp_pm_configure(&pm) == ESP_OK;
+    if (!powerLightSleep) {
+        pm.light_sleep_enable = false;
+        esp_pm_configure(&pm);
+    }
+    
+    // UWB data resuming ends a light sleep; the first bytes are lost and the parser resyncs on the next line
+    uart_set_wakeup_threshold(UWB_UART_NUM, POWER_UART_WAKE_EDGES);
+    esp_sleep_enable_uart_wakeup(UWB_UART_NUM);
+    
+    // The radio wakes for every publish and otherwise listens every third beacon (~300 ms),
+    // under one cycle window: control messages and PUBACKs wait at most a cycle
+    WiFi.setSleep(WIFI_PS_MAX_MODEM);
+    
+    DEBUG_PRINT("✓ Power save: ");
+    DEBUG_PRINT(POWER_CPU_MIN_MHZ);
+    DEBUG_PRINT("-");
+    DEBUG_PRINT(POWER_CPU_MAX_MHZ);
+    DEBUG_PRINTLN(powerLightSleep ? " MHz, light sleep" : " MHz, no light sleep (core without tickless idle)");
+#endif
+}
+
+/**
+ * Hibernate every module for a long rest (rfidTask; inventory stopped)
+ * @return True if all of them went to sleep; otherwise they are all woken again
+ */
+bool sleepReaders() {
+    bool ok = true;
+    for (RfidReader &reader : rfidReaders) {
+        ok = reader.driver.sleep() && ok;
+    }
+    if (!ok) wakeReaders();
+    return ok;
+}
+
+void wakeReaders() {
+    for (RfidReader &reader : rfidReaders) {
+        if (!reader.driver.wake()) {
+            DEBUG_PRINTLN("[POWER] ✗ RFID module did not wake - Next command retries");
         }
-        xSemaphoreGive(anchorStatsMutex);
     }
 }
 
+/**
+ * Let the chip light-sleep (release the NO_LIGHT_SLEEP lock) or keep it awake (rfidTask)
+ */
+void allowLightSleep(bool allow) {
+#if POWER_SAVE
+    static bool allowed = false;
+    if (!uartAwakeLock || allow == allowed) return;
+    if (allow) {
+        esp_pm_lock_release(uartAwakeLock);
+    } else {
+        esp_pm_lock_acquire(uartAwakeLock);
+    }
+    allowed = allow;
+#endif
+}
+
 // ============================================
-// WIFI & MQTT FUNCTIONS
+// TELEMETRY FUNCTIONS
 // ============================================
 
-void setupWiFi() {
-    static unsigned long lastAttemptTime = 0;
+/**
+ * Add one hot-path duration, measured with the CPU cycle counter (any task).
+ * Tasks are pinned, so start and end read the same core's counter.
+ */
+void recordTiming(TimingPoint point, uint32_t cycles) {
+    uint32_t us = cycles / ESP.getCpuFreqMHz();
+    portENTER_CRITICAL(&telemetryMux);
+    timingHistograms[point].record(us);
+    portEXIT_CRITICAL(&telemetryMux);
+}
+
+/**
+ * Stack high-water mark and CPU share of each firmware task.
+ * CPU share needs FreeRTOS run-time stats (configGENERATE_RUN_TIME_STATS);
+ * it is the task's run time since the last report over the wall time, i.e. % of one core.
+ */
+void collectTaskTelemetry(TelemetryReport &report) {
+    static const char *const names[] = {"rfid", "uwb", "output", "connection"};
+    TaskHandle_t handles[] = {rfidTaskHandle, uwbTaskHandle, outputTaskHandle, connectionTaskHandle};
+#if configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+    static uint32_t lastRunTime[TELEMETRY_MAX_TASKS];
+    static uint32_t lastTotal = 0;
+    uint32_t total = (uint32_t)portGET_RUN_TIME_COUNTER_VALUE();
+    uint32_t elapsed = total - lastTotal;
+#endif
+    
+    report.taskCount = 0;
+    for (uint8_t i = 0; i < TELEMETRY_MAX_TASKS; i++) {
+        if (!handles[i]) continue;  // NULL would report the calling task
+        TaskTelemetry &task = report.tasks[report.taskCount++];
+        task.name = names[i];
+        task.stackFree = uxTaskGetStackHighWaterMark(handles[i]) * sizeof(StackType_t);
+        task.cpuPermille = -1;
+#if configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+        TaskStatus_t status;
+        vTaskGetInfo(handles[i], &status, pdFALSE, eRunning);  // eRunning: skip the state lookup
+        uint32_t ran = (uint32_t)status.ulRunTimeCounter - lastRunTime[i];
+        lastRunTime[i] = (uint32_t)status.ulRunTimeCounter;
+        if (lastTotal != 0 && elapsed > 0) {
+            uint32_t permille = (uint32_t)((uint64_t)ran * 1000 / elapsed);
+            task.cpuPermille = permille > 1000 ? 1000 : permille;
+        }
+#endif
+    }
+#if configGENERATE_RUN_TIME_STATS && configUSE_TRACE_FACILITY
+    lastTotal = total;
+#endif
+}
+
+/**
+ * Every TELEMETRY_INTERVAL_MS: timings (reset after each report), task stacks and CPU,
+ * heap, UART errors and drop counters on TOPIC_STATUS. QoS 0; published before START too.
+ */
+void publishTelemetry() {
+    static unsigned long lastReport = 0;
+    static TelemetryReport report;  // outputTask only; ~800 bytes, off the stack
+    
     unsigned long now = millis();
+    if (now - lastReport < TELEMETRY_INTERVAL_MS || !connection.online()) return;
+    
+    portENTER_CRITICAL(&telemetryMux);
+    for (uint8_t i = 0; i < TIMING_POINT_COUNT; i++) {
+        report.timing[i] = timingHistograms[i];
+        timingHistograms[i].reset();
+    }
+    portEXIT_CRITICAL(&telemetryMux);
+    
+    report.uptimeMs = now;
+    report.intervalMs = now - lastReport;
+    lastReport = now;
+    collectTaskTelemetry(report);
+    report.heapFree = ESP.getFreeHeap();
+    report.heapMinFree = ESP.getMinFreeHeap();
+    report.heapLargestBlock = ESP.getMaxAllocHeap();
+    report.psramFree = ESP.getFreePsram();
+    report.rfidUartOverruns = 0;
+    report.rfidUartErrors = 0;
+    for (const RfidReader &reader : rfidReaders) {
+        report.rfidUartOverruns += reader.rx.overruns();
+        report.rfidUartErrors += reader.rx.errors();
+    }
+    report.uwbUartOverruns = uwbRx.overruns();
+    report.uwbUartErrors = uwbRx.errors();
+    report.uwbSessions = uwbSessionCount;
+    report.cyclesDropped = cyclePipeline.dropped();
+    report.backlogQueued = backlog.count();
+    report.backlogDropped = backlog.dropped();
+    report.publishFailures = publishFailures;
+    report.pollLevel = pollScheduler.level();
+    report.configRevision = readerConfig.revision;
+    report.clockSynced = epochClock.synced();
+    report.clockSyncs = epochClock.syncs();
+    report.clockCorrectionMs = epochClock.lastCorrectionMs();
+    report.powerSave = POWER_SAVE;
+    report.lightSleep = powerLightSleep;
+    powerLedger.collect(now, report.powerStateMs);
     
-    // Rate limit reconnection attempts
-    if (now - lastAttemptTime < WIFI_RETRY_DELAY_MS) {
+    size_t length = report.measureJson();
+    if (mqttClient.beginPublish(TOPIC_STATUS, length, false)) {
+        ChunkedPrint out(mqttClient, mqttWriteChunk, sizeof(mqttWriteChunk));
+        report.writeJson(out);
+        out.flush();
+        mqttClient.endPublish();
+        if (out.failed() || out.written() != length) {
+            mqttClient.disconnect();  // Broker is mid-packet
+        }
+    }
+}
+
+// ============================================
+// UART CAPTURE FUNCTIONS
+// ============================================
+
+/**
+ * TOPIC_CONTROL: CAPTURE (record from now on), CAPTURE STOP (stop and upload),
+ * CAPTURE UPLOAD (send the ring again), REPLAY / REPLAY MAX (at the recorded pace /
+ * as fast as the tasks take it), REPLAY STOP
+ */
+void handleCaptureCommand(const char *command) {
+    if (!uartCapture.enabled()) {
+        DEBUG_PRINTLN("\n[CAPTURE] ✗ Disabled - No capture ring");
         return;
     }
-    lastAttemptTime = now;
     
-    DEBUG_PRINTLN("\n[WiFi] Connecting...");
-    WiFi.mode(WIFI_STA);
-    WiFi.disconnect();
-    delay(100);
-    WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+    if (strcmp(command, "CAPTURE") == 0) {
+        AnchorMap anchors;
+        portENTER_CRITICAL(&anchorMapMux);
+        anchors = anchorMap;
+        portEXIT_CRITICAL(&anchorMapMux);
+        if (uartCapture.startRecording(anchors)) {
+            DEBUG_PRINTLN("\n[CAPTURE] ● Recording RFID and UWB UART input");
+        } else {
+            DEBUG_PRINTLN("\n[CAPTURE] ✗ Not while replaying - Send REPLAY STOP first");
+        }
+    } else if (strcmp(command, "CAPTURE STOP") == 0) {
+        if (uartCapture.mode() != UartCapture::RECORDING) return;
+        uartCapture.stop();
+        DEBUG_PRINT("\n[CAPTURE] ■ Stopped: ");
+        DEBUG_PRINT(uartCapture.records());
+        DEBUG_PRINT(" chunks, ");
+        DEBUG_PRINT(uartCapture.durationMs());
+        DEBUG_PRINTLN(" ms - Uploading");
+        uartCapture.startUpload(traceUpload);
+        traceUploading = true;
+    } else if (strcmp(command, "CAPTURE UPLOAD") == 0) {
+        if (uartCapture.mode() == UartCapture::RECORDING) return;
+        uartCapture.startUpload(traceUpload);
+        traceUploading = true;
+    } else if (strcmp(command, "REPLAY") == 0 || strcmp(command, "REPLAY MAX") == 0) {
+        bool maxSpeed = strcmp(command, "REPLAY MAX") == 0;
+        if (uartCapture.startReplay(maxSpeed)) {
+            DEBUG_PRINT("\n[CAPTURE] ▶ Replaying ");
+            DEBUG_PRINT(uartCapture.records());
+            DEBUG_PRINTLN(maxSpeed ? " chunks at max speed" : " chunks at 1x");
+        } else {
+            DEBUG_PRINTLN("\n[CAPTURE] ✗ Nothing to replay, or still recording");
+        }
+    } else if (strcmp(command, "REPLAY STOP") == 0) {
+        if (uartCapture.mode() != UartCapture::REPLAYING) return;
+        uartCapture.stop();
+        DEBUG_PRINTLN("\n[CAPTURE] ■ Replay stopped - Live UART input");
+    }
+}
+
+/**
+ * While an upload runs, one part of the ring per call on TOPIC_TRACE (QoS 0;
+ * the receiver spots a lost part by its number and asks for CAPTURE UPLOAD).
+ * A part that could not be sent is sent again on the next call.
+ */
+void uploadTrace() {
+    if (!traceUploading || !connection.online()) return;
     
-    // Non-blocking connection with timeout
-    unsigned long startAttempt = millis();
-    while (WiFi.status() != WL_CONNECTED && 
-           millis() - startAttempt < WIFI_CONNECT_TIMEOUT_MS) {
-        delay(500);
-        DEBUG_PRINT(".");
+    UartCapture::Cursor next = traceUpload;
+    CountingPrint counter;
+    size_t length = uartCapture.writePart(counter, next, CAPTURE_UPLOAD_PART_BYTES);
+    if (length == 0) {
+        traceUploading = false;  // Everything is out, or a new capture or load replaced the ring
+        return;
     }
     
-    if (WiFi.status() == WL_CONNECTED) {
-        DEBUG_PRINTLN("\n[WiFi] ✓ Connected!");
-        DEBUG_PRINT("[WiFi] IP: ");
-        DEBUG_PRINTLN(WiFi.localIP());
-    } else {
-        DEBUG_PRINTLN("\n[WiFi] ✗ Connection timeout!");
-        DEBUG_PRINT("[WiFi] Will retry in ");
-        DEBUG_PRINT(WIFI_RETRY_DELAY_MS / 1000);
-        DEBUG_PRINTLN(" seconds...");
-        
-        // Turn LED red when WiFi disconnected
-        pixels.setPixelColor(0, pixels.Color(0, 255, 0));
-        pixels.show();
+    if (!mqttClient.beginPublish(TOPIC_TRACE, length, false)) return;
+    next = traceUpload;
+    ChunkedPrint out(mqttClient, mqttWriteChunk, sizeof(mqttWriteChunk));
+    uartCapture.writePart(out, next, CAPTURE_UPLOAD_PART_BYTES);
+    out.flush();
+    mqttClient.endPublish();
+    if (out.failed() || out.written() != length) {
+        mqttClient.disconnect();  // Broker is mid-packet
+        return;
+    }
+    
+    traceUpload = next;
+    if (traceUpload.ended) {
+        traceUploading = false;
+        DEBUG_PRINT("[CAPTURE] ✓ Uploaded in ");
+        DEBUG_PRINT(traceUpload.part);
+        DEBUG_PRINTLN(" parts");
     }
 }
 
-void reconnectMQTT() {
-    static unsigned long lastReconnectAttempt = 0;
-    unsigned long now = millis();
+/**
+ * A part of a trace to replay on TOPIC_TRACE_LOAD, in the upload format
+ * (under MQTT_BUFFER_SIZE each). Part 0 replaces the ring; REPLAY once the last part is in.
+ */
+void handleTraceLoadMessage(const byte *payload, unsigned int length) {
+    switch (uartCapture.loadPart(payload, length)) {
+        case UartCapture::LOAD_COMPLETE:
+            DEBUG_PRINT("\n[CAPTURE] ✓ Trace loaded: ");
+            DEBUG_PRINT(uartCapture.records());
+            DEBUG_PRINT(" chunks, ");
+            DEBUG_PRINT(uartCapture.durationMs());
+            DEBUG_PRINTLN(" ms");
+            break;
+        case UartCapture::LOAD_REJECTED:
+            DEBUG_PRINTLN("\n[CAPTURE] ✗ Trace part rejected - Out of sequence, malformed, or recording/replaying");
+            break;
+        case UartCapture::LOAD_PARTIAL:
+            break;
+    }
+}
 
-    if (!mqttClient.connected()) {
-        if (now - lastReconnectAttempt > 2000) {
-            lastReconnectAttempt = now;
-            DEBUG_PRINT("[MQTT] Connecting...");
-            if (mqttClient.connect("ESP32_RFID_UWB")) {
-                DEBUG_PRINTLN(" ✓ Connected!");
-                mqttClient.subscribe(TOPIC_CONTROL);
-                DEBUG_PRINTLN("[MQTT] Subscribed to control topic");
-                
-                // Turn LED green when MQTT connected
-                pixels.setPixelColor(0, pixels.Color(0, 0, 255));
-                pixels.show();
-            } else {
-                DEBUG_PRINT(" ✗ Failed, rc=");
-                DEBUG_PRINTLN(mqttClient.state());
-                
-                // Turn LED red when MQTT disconnected
-                pixels.setPixelColor(0, pixels.Color(0, 255, 0));
-                pixels.show();
-            }
-        }
+// ============================================
+// WIFI & MQTT FUNCTIONS
+// ============================================
+
+/**
+ * Connection task: WiFi association and MQTT connects, with backoff (CONNECTION_MANAGER.h)
+ */
+void connectionTask(void *parameter) {
+    connection.run();
+}
+
+/**
+ * Runs in connectionTask right after an MQTT connect, before outputTask takes the client
+ */
+void onMqttConnected(void *context) {
+    mqttClient.subscribe(TOPIC_CONTROL);
+    mqttClient.subscribe(TOPIC_FILTER);  // Retained, replayed on every connect
+#if CAPTURE_ENABLED
+    mqttClient.subscribe(TOPIC_TRACE_LOAD);
+#endif
+#if POSITION_SOLVER_ENABLED
+    mqttClient.subscribe(TOPIC_ANCHORS);  // Retained, so the map is replayed on every connect
+#endif
+    DEBUG_PRINTLN("[MQTT] ✓ Connected, subscribed to control topic");
+    
+    // The receiver may have lost state while we were away
+    tagDelta.requestKeyframe();
+}
+
+/**
+ * Start SNTP the first time WiFi is up (outputTask). lwIP then resyncs every
+ * NTP_SYNC_INTERVAL_MS on its own, across reconnects.
+ */
+void startTimeSync() {
+    static bool started = false;
+    if (started) return;
+    started = true;
+    sntp_set_sync_interval(NTP_SYNC_INTERVAL_MS);
+    sntp_set_time_sync_notification_cb(onTimeSynced);
+    configTime(0, 0, NTP_SERVER, NTP_SERVER_FALLBACK);  // UTC
+}
+
+/**
+ * SNTP callback (lwIP task): the system time was just set to tv
+ */
+void onTimeSynced(struct timeval *tv) {
+    epochClock.sync((int64_t)tv->tv_sec * 1000000LL + tv->tv_usec, esp_timer_get_time());
+    DEBUG_PRINTLN("[Time] ✓ SNTP synced");
+}
+
+/**
+ * Connection LED and log, from outputTask when the state changes
+ */
+void showConnectionState(ConnectionManager::State state) {
+    switch (state) {
+        case ConnectionManager::ONLINE:
+            DEBUG_PRINT("[MQTT] Online (connect #");
+            DEBUG_PRINT(connection.connects());
+            DEBUG_PRINTLN(")");
+            pixels.setPixelColor(0, pixels.Color(0, 0, 255));
+            break;
+        case ConnectionManager::MQTT_IDLE:
+            DEBUG_PRINT("[WiFi] ✓ Connected, IP: ");
+            DEBUG_PRINTLN(WiFi.localIP());
+            DEBUG_PRINTLN("[MQTT] Offline - Connecting in background, cycles go to the backlog");
+            pixels.setPixelColor(0, pixels.Color(0, 255, 0));
+            break;
+        case ConnectionManager::WIFI_CONNECTING:
+            DEBUG_PRINTLN("[WiFi] Connecting...");
+            pixels.setPixelColor(0, pixels.Color(0, 255, 0));
+            break;
+        case ConnectionManager::WIFI_IDLE:
+            DEBUG_PRINTLN("[WiFi] ✗ Disconnected - Retrying with backoff");
+            pixels.setPixelColor(0, pixels.Color(0, 255, 0));
+            break;
     }
+    pixels.show();
 }
 
 void mqttCallback(char* topic, byte* payload, unsigned int length) {
-    String msg;
-    for (unsigned int i = 0; i < length; i++) {
-        msg += (char)payload[i];
+    size_t anchorsPrefix = strlen(TOPIC_ANCHORS) - 1;  // Without the '+'
+    if (strncmp(topic, TOPIC_ANCHORS, anchorsPrefix) == 0) {
+        handleAnchorMessage(topic + anchorsPrefix, payload, length);
+        return;
+    }
+    if (strcmp(topic, TOPIC_FILTER) == 0) {
+        handleFilterMessage(payload, length);
+        return;
+    }
+    if (strcmp(topic, TOPIC_TRACE_LOAD) == 0) {
+        handleTraceLoadMessage(payload, length);
+        return;
     }
     
-    if (String(topic) == TOPIC_CONTROL) {
-        if (msg == "START") {
-            startSignal = true;
-            pixels.setPixelColor(0, pixels.Color(255, 0, 0));
-            pixels.show();
-            DEBUG_PRINTLN("\n[CONTROL] ▶ START received - Publishing enabled");
-        } else if (msg == "STOP") {
-            startSignal = false;
-            pixels.setPixelColor(0, pixels.Color(0, 0, 255));
-            pixels.show();
-            DEBUG_PRINTLN("\n[CONTROL] ⏸ STOP received - Publishing paused");
-        }
+    if (strcmp(topic, TOPIC_CONTROL) != 0) return;
+    if (length >= 6 && memcmp(payload, "CONFIG", 6) == 0 && (length == 6 || payload[6] == ' ')) {
+        handleConfigMessage((const char *)payload + 6, length - 6);
+        return;
+    }
+    
+    // Control commands are short: compared in a stack buffer, no String per message
+    char msg[CONTROL_COMMAND_SIZE];
+    if (length >= sizeof(msg)) return;
+    memcpy(msg, payload, length);
+    msg[length] = '\0';
+    
+    if (strcmp(msg, "START") == 0) {
+        startSignal = true;
+        pixels.setPixelColor(0, pixels.Color(255, 0, 0));
+        pixels.show();
+        DEBUG_PRINTLN("\n[CONTROL] ▶ START received - Publishing enabled");
+    } else if (strcmp(msg, "STOP") == 0) {
+        startSignal = false;
+        pixels.setPixelColor(0, pixels.Color(0, 0, 255));
+        pixels.show();
+        DEBUG_PRINTLN("\n[CONTROL] ⏸ STOP received - Publishing paused");
+    } else if (strcmp(msg, "KEYFRAME") == 0) {
+        tagDelta.requestKeyframe();
+        DEBUG_PRINTLN("\n[CONTROL] KEYFRAME requested - Next cycle carries the full tag set");
+    } else if (strncmp(msg, "CAPTURE", 7) == 0 || strncmp(msg, "REPLAY", 6) == 0) {
+        handleCaptureCommand(msg);
     }
 }
 
@@ -0,0 +1,170 @@
+#include "HOST_PIPELINE.h"
+#include "HOST_HAL.h"
+
+HostPipeline::HostPipeline(uint32_t windowMs)
+    : _windowMs(windowMs),
+      _cycleStart(0),
+      _cycle(0),
+      _sessions(0),
+      _fixes(0),
+      _tagsPublished(0),
+      _out(NULL),
+      _format(CYCLE_PAYLOAD_JSON),
+      _mirrored(1),
+      _position() {}
+
+void HostPipeline::begin(const UartTrace &trace) {
+    hostSetMillis(0);
+    _clock.reset();
+    _clock.sync(HOST_EPOCH_US, 0);
+    for (uint8_t i = 0; i < UART_TRACE_RFID_READERS; i++) {
+        Reader &reader = _readers[i];
+        reader.serial.clearRx();
+        reader.serial.setRxBufferSize(HOST_RFID_RX_BUFFER_SIZE);
+        reader.rfid.begin(&reader.serial);
+        reader.rfid.setRxWait(hostIdleWait, NULL);
+        reader.rfid.setSource(i);
+        reader.rfid.startContinuousPolling();
+        reader.rfid.beginStreamCycle();
+    }
+
+    _uwbParser.reset();
+    _anchors.clear();
+    _previousAnchors.clear();
+    _anchorMap = AnchorMap();
+    for (const UartTrace::Anchor &anchor : trace.anchors()) {
+        _anchorMap.set(anchor.mac, anchor.x, anchor.y);
+    }
+    _solver.reset();
+    _position      = PositionEstimate();
+    _cycleStart    = 0;
+    _cycle         = 0;
+    _sessions      = 0;
+    _fixes         = 0;
+    _tagsPublished = 0;
+}
+
+void HostPipeline::run(const UartTrace &trace) {
+    begin(trace);
+    for (size_t i = 0; i < trace.size(); i++) {
+        deliver(trace, trace.chunk(i));
+    }
+    hostSetMillis(_cycleStart + _windowMs);
+    closeCycle();
+}
+
+void HostPipeline::deliver(const UartTrace &trace, const UartTrace::Chunk &chunk) {
+    // Close every window that ended before this chunk arrived
+    while (chunk.timeMs >= _cycleStart + _windowMs) {
+        hostSetMillis(_cycleStart + _windowMs);
+        closeCycle();
+    }
+    hostSetMillis(chunk.timeMs);
+
+    const uint8_t *bytes = trace.bytes(chunk);
+    if (chunk.port == UART_TRACE_PORT_RFID) {
+        for (uint8_t i = 0; i < _mirrored; i++) {
+            feedReader(_readers[i], bytes, chunk.length);
+        }
+    } else if (chunk.port != UART_TRACE_PORT_UWB) {
+        feedReader(_readers[chunk.port - UART_TRACE_PORT_RFID], bytes, chunk.length);
+    } else {
+        // uwbTask
+        for (uint32_t i = 0; i < chunk.length; i++) {
+            if (_uwbParser.feed((char)bytes[i])) {
+                handleUWBSession(_uwbParser.session());
+            }
+        }
+    }
+}
+
+// rfidTask: the ports' waitAny() returns, processStream() drains the UART
+void HostPipeline::feedReader(Reader &reader, const uint8_t *bytes, uint32_t length) {
+    for (uint32_t sent = 0; sent < length;) {
+        sent += reader.serial.inject(bytes + sent, length - sent);
+        reader.rfid.processStream();
+    }
+}
+
+// rfidTask, from the end of the stream window to cyclePipeline.publish()
+void HostPipeline::closeCycle() {
+    CycleRecord &record = _record;
+    record.cycle        = ++_cycle;
+    int64_t closedUs    = (int64_t)millis() * 1000;  // esp_timer_get_time() on the device
+    record.timestamp    = (unsigned long)(closedUs / 1000);
+    record.epochUs      = _clock.stamp(closedUs);
+    record.suppressed   = false;
+
+    _merger.begin(record);
+    for (Reader &reader : _readers) {
+        uint16_t tagCount = reader.rfid.processStream();
+        _merger.add(reader.rfid.cards, tagCount, NULL);
+    }
+    _merger.finish();
+
+    record.anchors = _anchors;
+    _previousAnchors = _anchors;  // swapAnchorTables()
+    _anchors.clear();
+    record.position = _position;
+
+    // outputTask: combineDataFromPollingAndSend()
+    if (record.tagCount > 0 || !record.anchors.empty()) {
+        _tagsPublished += record.tagCount;
+        if (_out) {
+            CycleSerializer::write(*_out, record, _format);
+            if (_format == CYCLE_PAYLOAD_JSON) _out->write('\n');
+        }
+    }
+
+    for (Reader &reader : _readers) {
+        reader.rfid.beginStreamCycle();
+    }
+    _cycleStart += _windowMs;
+}
+
+// handleUWBSession() and updateAnchorStatistics()
+void HostPipeline::handleUWBSession(const UWBSession &session) {
+    _sessions++;
+    if (!session.valid) return;
+
+    unsigned long now = millis();
+    for (uint8_t i = 0; i < session.nMeasurements; i++) {
+        const UWBMeasurement &m = session.measurements[i];
+        _anchors.record(m.macAddress, m.status == UWB_STATUS_SUCCESS && m.distanceCm > 0, m.distanceCm, now);
+    }
+
+    if (updatePosition(session)) _fixes++;
+}
+
+bool HostPipeline::updatePosition(const UWBSession &session) {
+    uint16_t macs[UWB_MAX_MEASUREMENTS];
+
+    _ranges.clear();
+    for (uint8_t i = 0; i < session.nMeasurements; i++) {
+        const UWBMeasurement &m = session.measurements[i];
+        float x, y;
+        if (m.status != UWB_STATUS_SUCCESS || m.distanceCm <= 0) continue;
+        if (!_anchorMap.find(m.macAddress, x, y)) continue;
+        macs[_ranges.count] = m.macAddress;
+        _ranges.add(x, y, (float)m.distanceCm, 1.0f);
+    }
+    if (_ranges.count < POSITION_MIN_ANCHORS) return false;
+
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < _ranges.count; i++) {
+        const AnchorStats *stats = PositionSolver::weightStats(_anchors.find(macs[i]), _previousAnchors.find(macs[i]), millis());
+        float weight = stats ? PositionSolver::rangeWeight(*stats, _ranges.distance[i]) : 1.0f;
+        if (weight <= 0) continue;
+        _ranges.x[kept]        = _ranges.x[i];
+        _ranges.y[kept]        = _ranges.y[i];
+        _ranges.distance[kept] = _ranges.distance[i];
+        _ranges.weight[kept]   = weight;
+        kept++;
+    }
+    _ranges.count = kept;
+
+    PositionEstimate estimate;
+    if (!_solver.solve(_ranges, millis(), estimate)) return false;
+    _position = estimate;
+    return true;
+}
@@ -0,0 +1,113 @@
+#ifndef _HOST_PIPELINE_H_
+#define _HOST_PIPELINE_H_
+
+#include <Arduino.h>
+#include "CYCLE_RECORD.h"
+#include "CYCLE_SERIALIZER.h"
+#include "EPOCH_CLOCK.h"
+#include "POSITION_SOLVER.h"
+#include "RFID_READERS.h"
+#include "UART_TRACE.h"
+#include "UNIT_UHF_RFID.h"
+#include "UWB_SESSION_PARSER.h"
+
+#define HOST_RFID_RX_BUFFER_SIZE 1024  // As RFID_RX_BUFFER_SIZE in code_esp32.ino
+#define HOST_CYCLE_WINDOW_MS     500   // As RFID_CYCLE_WINDOW_MS
+#define HOST_POLLING_COUNT       6     // As RFID_POLLING_COUNT
+#define HOST_EPOCH_US            1764680400000000ULL  // Wall time at trace time 0 (2025-12-02T13:00:00Z): SNTP synced
+
+/*
+ The firmware data path in streaming mode, on one thread: rfidTask's cycle
+ assembly, uwbTask's session handling (anchor statistics and the position
+ solve) and the JSON/binary encoding of combineDataFromPollingAndSend(),
+ driven by a UartTrace on the virtual clock.
+
+ The steps mirror code_esp32.ino line for line (the sketch itself cannot
+ be built off-device); every call into a module is the real firmware code.
+ Chunks are delivered at their timestamps, and a cycle closes every
+ windowMs of trace time, so the same trace always yields the same cycles.
+
+ RFID ports R, S and T feed one module each, merged per cycle as rfidTask
+ merges its readers. setMirroredReaders() also hands port R to further
+ modules, as if several antennas covered the same shelf.
+*/
+class HostPipeline {
+   public:
+    explicit HostPipeline(uint32_t windowMs = HOST_CYCLE_WINDOW_MS);
+
+    /*! @brief Rewind to the start of a trace: clock at 0, anchor map from the trace.*/
+    void begin(const UartTrace &trace);
+
+    /*! @brief Replay the whole trace; the last partial window closes too.*/
+    void run(const UartTrace &trace);
+
+    /*! @brief Port R is received by count modules (1-UART_TRACE_RFID_READERS); takes effect at begin().*/
+    void setMirroredReaders(uint8_t count) {
+        _mirrored = count < 1 ? 1 : count > UART_TRACE_RFID_READERS ? UART_TRACE_RFID_READERS : count;
+    }
+
+    /*! @brief Each closed cycle is written here (one payload per line for JSON), or nowhere if NULL.*/
+    void setOutput(Print *out, CyclePayloadFormat format = CYCLE_PAYLOAD_JSON) {
+        _out    = out;
+        _format = format;
+    }
+
+    uint32_t cycles() const {
+        return _cycle;
+    }
+
+    uint32_t sessions() const {
+        return _sessions;
+    }
+
+    uint32_t fixes() const {
+        return _fixes;
+    }
+
+    uint64_t tagsPublished() const {
+        return _tagsPublished;
+    }
+
+    /*! @brief The record of the last closed cycle.*/
+    const CycleRecord &record() const {
+        return _record;
+    }
+
+   private:
+    void deliver(const UartTrace &trace, const UartTrace::Chunk &chunk);
+    void closeCycle();
+    void handleUWBSession(const UWBSession &session);
+    bool updatePosition(const UWBSession &session);
+
+    uint32_t _windowMs;
+    unsigned long _cycleStart;
+    uint32_t _cycle;
+    uint32_t _sessions;
+    uint32_t _fixes;
+    uint64_t _tagsPublished;
+    Print *_out;
+    CyclePayloadFormat _format;
+
+    struct Reader {
+        Reader() : serial(2) {}
+        HardwareSerial serial;
+        Unit_UHF_RFID rfid;
+    };
+
+    void feedReader(Reader &reader, const uint8_t *bytes, uint32_t length);
+
+    uint8_t _mirrored;
+    Reader _readers[UART_TRACE_RFID_READERS];
+    TagMerger _merger;
+    EpochClock _clock;
+    UWBSessionParser _uwbParser;
+    AnchorTable _anchors;
+    AnchorTable _previousAnchors;  // Last cycle's, the solver's fallback statistics
+    AnchorMap _anchorMap;
+    PositionSolver _solver;
+    PositionEstimate _position;
+    RangeSet _ranges;
+    CycleRecord _record;
+};
+
+#endif
@@ -0,0 +1,181 @@
+/*
+ optiflow_replay: run a UART trace through the firmware data path.
+
+   optiflow_replay <trace> [--out <file>] [--expect <golden>] [--binary] [--via-capture] [--readers <n>]
+
+ Prints a summary; with --out writes every published cycle (JSON, one per
+ line, or binary frames back to back with --binary); with --expect fails
+ unless the output matches the golden file byte for byte. --via-capture
+ first passes the trace through the device's UartCapture the way a trace
+ travels over MQTT (loaded in parts, uploaded again) and replays the result.
+ --readers hands the RFID stream to n modules at once (multi-reader merge).
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+#include "HOST_PIPELINE.h"
+#include "UART_CAPTURE.h"
+
+#define HOST_LOAD_PART_BYTES   448   // Fits MQTT_BUFFER_SIZE with the topic and packet header
+#define HOST_UPLOAD_PART_BYTES 4096  // As CAPTURE_UPLOAD_PART_BYTES
+
+// Collects the pipeline output
+class StringPrint : public Print {
+   public:
+    size_t write(uint8_t c) override {
+        text.push_back((char)c);
+        return 1;
+    }
+    size_t write(const uint8_t *data, size_t size) override {
+        text.append((const char *)data, size);
+        return size;
+    }
+
+    std::string text;
+};
+
+static bool readFile(const char *path, std::string &out) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::ostringstream contents;
+    contents << file.rdbuf();
+    out = contents.str();
+    return true;
+}
+
+// First line where two outputs differ (1-based), 0 if they are the same
+static size_t firstDifference(const std::string &a, const std::string &b) {
+    size_t line = 1;
+    for (size_t i = 0; i < a.size() || i < b.size(); i++) {
+        if (i >= a.size() || i >= b.size() || a[i] != b[i]) return line;
+        if (a[i] == '\n') line++;
+    }
+    return 0;
+}
+
+// Trace text -> TOPIC_TRACE_LOAD parts -> UartCapture -> TOPIC_TRACE parts, concatenated
+static bool captureRoundTrip(const std::string &trace, std::string &uploaded) {
+    static UartCapture capture;
+    if (!capture.enabled() && !capture.begin(trace.size() + 65536)) return false;
+
+    std::istringstream lines(trace);
+    std::string line, part;
+    uint32_t parts = 0;
+    UartCapture::LoadResult result = UartCapture::LOAD_PARTIAL;
+    bool more = (bool)std::getline(lines, line);
+    while (more) {
+        part = "# part " + std::to_string(parts) + "\n";
+        do {
+            part += line + "\n";
+            more = (bool)std::getline(lines, line);
+        } while (more && part.size() + line.size() + 1 <= HOST_LOAD_PART_BYTES);
+        if (!more) part += "# end " + std::to_string(parts + 1) + "\n";
+        result = capture.loadPart((const uint8_t *)part.data(), part.size());
+        if (result == UartCapture::LOAD_REJECTED) return false;
+        parts++;
+    }
+    if (result != UartCapture::LOAD_COMPLETE) return false;
+
+    StringPrint out;
+    UartCapture::Cursor cursor;
+    capture.startUpload(cursor);
+    while (capture.writePart(out, cursor, HOST_UPLOAD_PART_BYTES) > 0) {
+    }
+    uploaded = out.text;
+    return true;
+}
+
+static int usage() {
+    fprintf(stderr,
+            "usage: optiflow_replay <trace> [--out <file>] [--expect <golden>] [--binary] [--via-capture] "
+            "[--readers <n>]\n");
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    const char *tracePath  = NULL;
+    const char *outPath    = NULL;
+    const char *expectPath = NULL;
+    CyclePayloadFormat format = CYCLE_PAYLOAD_JSON;
+    bool viaCapture = false;
+    int readers     = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            outPath = argv[++i];
+        } else if (!strcmp(argv[i], "--expect") && i + 1 < argc) {
+            expectPath = argv[++i];
+        } else if (!strcmp(argv[i], "--binary")) {
+            format = CYCLE_PAYLOAD_BINARY;
+        } else if (!strcmp(argv[i], "--via-capture")) {
+            viaCapture = true;
+        } else if (!strcmp(argv[i], "--readers") && i + 1 < argc) {
+            readers = atoi(argv[++i]);
+            if (readers < 1 || readers > UART_TRACE_RFID_READERS) return usage();
+        } else if (argv[i][0] != '-' && !tracePath) {
+            tracePath = argv[i];
+        } else {
+            return usage();
+        }
+    }
+    if (!tracePath) return usage();
+
+    char copyPath[] = "/tmp/optiflow_captureXXXXXX";
+    if (viaCapture) {
+        std::string original, uploaded;
+        int fd = -1;
+        if (!readFile(tracePath, original) || !captureRoundTrip(original, uploaded) || (fd = mkstemp(copyPath)) < 0 ||
+            write(fd, uploaded.data(), uploaded.size()) != (ssize_t)uploaded.size()) {
+            fprintf(stderr, "%s: capture round trip failed\n", tracePath);
+            return 1;
+        }
+        close(fd);
+    }
+
+    UartTrace trace;
+    bool loaded = trace.load(viaCapture ? copyPath : tracePath);
+    if (viaCapture) unlink(copyPath);
+    if (!loaded) {
+        fprintf(stderr, "%s:%zu: cannot read trace%s\n", tracePath, trace.line(), viaCapture ? " (via capture)" : "");
+        return 1;
+    }
+
+    static HostPipeline pipeline;
+    StringPrint output;
+    pipeline.setOutput(&output, format);
+    pipeline.setMirroredReaders((uint8_t)readers);
+    pipeline.run(trace);
+
+    printf("%s: %zu chunks, %u ms, %u cycles, %llu tags, %u UWB sessions, %u fixes\n", tracePath, trace.size(),
+           trace.durationMs(), pipeline.cycles(), (unsigned long long)pipeline.tagsPublished(), pipeline.sessions(),
+           pipeline.fixes());
+
+    if (outPath) {
+        std::ofstream file(outPath, std::ios::binary);
+        file << output.text;
+        if (!file) {
+            fprintf(stderr, "%s: cannot write\n", outPath);
+            return 1;
+        }
+    }
+
+    if (expectPath) {
+        std::string golden;
+        if (!readFile(expectPath, golden)) {
+            fprintf(stderr, "%s: cannot read\n", expectPath);
+            return 1;
+        }
+        size_t line = firstDifference(output.text, golden);
+        if (line) {
+            fprintf(stderr, "%s: output differs from line %zu\n", expectPath, line);
+            return 1;
+        }
+        printf("%s: match\n", expectPath);
+    }
+    return 0;
+}
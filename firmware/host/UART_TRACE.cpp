@@ -0,0 +1,90 @@
+#include "UART_TRACE.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool UartTrace::load(const char *path) {
+    _chunks.clear();
+    _data.clear();
+    _anchors.clear();
+    _line = 0;
+
+    FILE *file = fopen(path, "r");
+    if (!file) return false;
+
+    bool ok = true;
+    uint32_t lastTime = 0;
+    std::vector<char> text(1 << 16);
+    while (ok && fgets(text.data(), text.size(), file)) {
+        _line++;
+        char *p = text.data();
+        while (isspace((unsigned char)*p)) p++;
+        if (*p == '#') {
+            Anchor anchor;
+            unsigned mac;
+            if (sscanf(p, "# anchor %x %f %f", &mac, &anchor.x, &anchor.y) == 3) {
+                anchor.mac = (uint16_t)mac;
+                _anchors.push_back(anchor);
+            }
+            continue;
+        }
+        if (*p == '\0') continue;
+
+        char *end;
+        unsigned long time = strtoul(p, &end, 10);
+        if (end == p || !isspace((unsigned char)*end) || time < lastTime) {
+            ok = false;
+            break;
+        }
+        p = end;
+        while (*p == ' ' || *p == '\t') p++;
+        char port = *p++;
+        bool rfid = port >= UART_TRACE_PORT_RFID && port < UART_TRACE_PORT_RFID + UART_TRACE_RFID_READERS;
+        if ((!rfid && port != UART_TRACE_PORT_UWB) || (*p != ' ' && *p != '\t')) {
+            ok = false;
+            break;
+        }
+        while (*p == ' ' || *p == '\t') p++;
+
+        Chunk chunk = {(uint32_t)time, port, (uint32_t)_data.size(), 0};
+        while (isxdigit((unsigned char)p[0])) {
+            int high = hexValue(p[0]);
+            int low  = hexValue(p[1]);
+            if (low < 0) {
+                ok = false;
+                break;
+            }
+            _data.push_back((uint8_t)(high << 4 | low));
+            p += 2;
+        }
+        while (isspace((unsigned char)*p)) p++;
+        if (!ok || *p != '\0') {
+            ok = false;
+            break;
+        }
+        chunk.length = _data.size() - chunk.offset;
+        _chunks.push_back(chunk);
+        lastTime = time;
+    }
+    fclose(file);
+    return ok;
+}
+
+std::vector<uint8_t> UartTrace::portBytes(char port) const {
+    std::vector<uint8_t> out;
+    for (const Chunk &chunk : _chunks) {
+        if (chunk.port == port) {
+            out.insert(out.end(), bytes(chunk), bytes(chunk) + chunk.length);
+        }
+    }
+    return out;
+}
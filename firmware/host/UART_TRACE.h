@@ -0,0 +1,79 @@
+#ifndef _UART_TRACE_H_
+#define _UART_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#define UART_TRACE_PORT_RFID    'R'  // JRD-100 module
+#define UART_TRACE_PORT_UWB     'U'  // DWM3001CDK CLI
+#define UART_TRACE_RFID_READERS 3    // Further modules are S and T (as CAPTURE_MAX_READERS)
+
+/*
+ A recorded UART session, one received chunk per line:
+
+   # comment
+   # anchor <mac> <x_cm> <y_cm>
+   <ms> <port> <hex bytes>
+
+ ms counts from the start of the capture and never decreases; port is R
+ (RFID; S and T for a second and third module) or U (UWB). Chunks are what one driver event delivered, so their
+ boundaries fall anywhere inside frames and lines, as on the device.
+ Anchor lines carry the anchor map that was retained on the broker during
+ the capture, so the replay can solve positions as the device did.
+*/
+class UartTrace {
+   public:
+    struct Chunk {
+        uint32_t timeMs;
+        char port;
+        uint32_t offset;  // Into data()
+        uint32_t length;
+    };
+
+    struct Anchor {
+        uint16_t mac;
+        float x;  // cm
+        float y;
+    };
+
+    /*! @brief Read a trace file.
+        @return False if it cannot be opened or a line is malformed (line() tells which).*/
+    bool load(const char *path);
+
+    size_t size() const {
+        return _chunks.size();
+    }
+
+    const Chunk &chunk(size_t index) const {
+        return _chunks[index];
+    }
+
+    const uint8_t *bytes(const Chunk &chunk) const {
+        return _data.data() + chunk.offset;
+    }
+
+    const std::vector<Anchor> &anchors() const {
+        return _anchors;
+    }
+
+    /*! @brief Everything one port received, in order.*/
+    std::vector<uint8_t> portBytes(char port) const;
+
+    uint32_t durationMs() const {
+        return _chunks.empty() ? 0 : _chunks.back().timeMs;
+    }
+
+    /*! @brief Line of the first error after a failed load().*/
+    size_t line() const {
+        return _line;
+    }
+
+   private:
+    std::vector<Chunk> _chunks;
+    std::vector<uint8_t> _data;
+    std::vector<Anchor> _anchors;
+    size_t _line = 0;
+};
+
+#endif
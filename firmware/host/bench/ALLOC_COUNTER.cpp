@@ -0,0 +1,46 @@
+#include "ALLOC_COUNTER.h"
+
+#include <stddef.h>
+#include <atomic>
+
+static std::atomic<uint64_t> allocations(0);
+
+uint64_t allocationCount() {
+    return allocations.load(std::memory_order_relaxed);
+}
+
+#if defined(__GLIBC__)
+
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+
+// Interposed for the whole process; glibc's own entry points do the work
+void *malloc(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(pointer, size);
+}
+}
+
+bool allocationCountingSupported() {
+    return true;
+}
+
+#else
+
+bool allocationCountingSupported() {
+    return false;
+}
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef _ALLOC_COUNTER_H_
+#define _ALLOC_COUNTER_H_
+
+#include <stdint.h>
+
+/*
+ Counts heap allocations (malloc, calloc, realloc; operator new goes through
+ malloc) in the benchmark binary, so a hot path can be held to zero
+ allocations per cycle. glibc only; elsewhere the count stays 0 and
+ allocationCountingSupported() is false.
+*/
+
+uint64_t allocationCount();
+
+bool allocationCountingSupported();
+
+#endif
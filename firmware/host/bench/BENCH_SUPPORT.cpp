@@ -0,0 +1,116 @@
+#include "BENCH_SUPPORT.h"
+#include "ALLOC_COUNTER.h"
+#include "HOST_HAL.h"
+#include "HOST_PIPELINE.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+
+#ifndef OPTIFLOW_TRACE
+#define OPTIFLOW_TRACE "traces/shelf_walk.trace"
+#endif
+
+#define BENCH_RFID_ROUND_MS 50  // One inventory round of the shelf walk (generate_trace.py ROUND_MS)
+
+// Tag notifications in a JRD-100 byte stream, by walking the frame lengths
+static uint32_t countTagFrames(const std::vector<uint8_t> &bytes) {
+    uint32_t frames = 0;
+    size_t i = 0;
+    while (i + 5 <= bytes.size()) {
+        if (bytes[i] != 0xbb) {
+            i++;
+            continue;
+        }
+        size_t length = ((bytes[i + 3] << 8) | bytes[i + 4]) + RFID_FRAME_OVERHEAD;
+        if (bytes[i + 1] == 0x02 && bytes[i + 2] == 0x22) frames++;
+        i += length;
+    }
+    return frames;
+}
+
+static void loadCorpus(BenchCorpus &corpus) {
+    const char *path = getenv("OPTIFLOW_TRACE");
+    if (!path) path = OPTIFLOW_TRACE;
+    if (!corpus.trace.load(path)) {
+        fprintf(stderr, "Cannot load trace %s (line %zu)\n", path, corpus.trace.line());
+        exit(1);
+    }
+
+    corpus.rfidBytes = corpus.trace.portBytes(UART_TRACE_PORT_RFID);
+    corpus.uwbBytes  = corpus.trace.portBytes(UART_TRACE_PORT_UWB);
+    corpus.tagFrames = countTagFrames(corpus.rfidBytes);
+
+    for (size_t i = 0; i < corpus.trace.size(); i++) {
+        const UartTrace::Chunk &chunk = corpus.trace.chunk(i);
+        if (chunk.timeMs >= BENCH_RFID_ROUND_MS) break;
+        if (chunk.port != UART_TRACE_PORT_RFID) continue;
+        if (corpus.rfidRound.size() + chunk.length > HOST_RFID_RX_BUFFER_SIZE) break;
+        const uint8_t *bytes = corpus.trace.bytes(chunk);
+        corpus.rfidRound.insert(corpus.rfidRound.end(), bytes, bytes + chunk.length);
+    }
+
+    UWBSessionParser parser;
+    for (uint8_t c : corpus.uwbBytes) {
+        if (parser.feed((char)c)) corpus.sessions.push_back(parser.session());
+    }
+
+    // Replay once, keeping the fullest cycle as the encoders' input
+    static HostPipeline pipeline;
+    pipeline.begin(corpus.trace);
+    corpus.busiestCycle.tagCount = 0;
+    struct Keeper : Print {
+        BenchCorpus *corpus;
+        size_t write(uint8_t) override {
+            if (pipeline.record().tagCount > corpus->busiestCycle.tagCount) corpus->busiestCycle = pipeline.record();
+            return 1;
+        }
+        size_t write(const uint8_t *, size_t size) override {
+            return write((uint8_t)0) ? size : 0;
+        }
+    } keeper;
+    keeper.corpus = &corpus;
+    pipeline.setOutput(&keeper);
+    pipeline.run(corpus.trace);
+    pipeline.setOutput(NULL);
+}
+
+const BenchCorpus &benchCorpus() {
+    static BenchCorpus *corpus = NULL;
+    if (!corpus) {
+        corpus = new BenchCorpus();
+        loadCorpus(*corpus);
+    }
+    return *corpus;
+}
+
+uint64_t LatencySamples::percentile(double q) {
+    if (_ns.empty()) return 0;
+    size_t rank = (size_t)(q * _ns.size() + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > _ns.size()) rank = _ns.size();
+    std::nth_element(_ns.begin(), _ns.begin() + (rank - 1), _ns.end());
+    return _ns[rank - 1];
+}
+
+void reportCounters(benchmark::State &state, LatencySamples &latency, uint64_t allocationsBefore) {
+    uint64_t allocations = allocationCount() - allocationsBefore;
+    state.counters["p50_ns"] = (double)latency.percentile(0.50);
+    state.counters["p90_ns"] = (double)latency.percentile(0.90);
+    state.counters["p99_ns"] = (double)latency.percentile(0.99);
+    if (allocationCountingSupported()) {
+        state.counters["allocs_per_iter"] =
+            benchmark::Counter((double)allocations, benchmark::Counter::kAvgIterations);
+    }
+}
+
+int SinkClient::connect(IPAddress, uint16_t) {
+    return connect((const char *)NULL, 0);
+}
+
+int SinkClient::connect(const char *, uint16_t) {
+    _connected   = true;
+    _replyIndex  = 0;
+    _replyLength = sizeof(_reply);
+    return 1;
+}
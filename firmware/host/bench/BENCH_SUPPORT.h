@@ -0,0 +1,125 @@
+#ifndef _BENCH_SUPPORT_H_
+#define _BENCH_SUPPORT_H_
+
+#include <benchmark/benchmark.h>
+#include <chrono>
+#include <vector>
+
+#include <Client.h>
+#include "CYCLE_RECORD.h"
+#include "UART_TRACE.h"
+#include "UWB_SESSION_PARSER.h"
+
+/*
+ Inputs shared by the benchmarks, decoded once from the replay trace
+ (OPTIFLOW_TRACE, default traces/shelf_walk.trace).
+*/
+struct BenchCorpus {
+    UartTrace trace;
+    std::vector<uint8_t> rfidBytes;
+    std::vector<uint8_t> uwbBytes;
+    std::vector<uint8_t> rfidRound;     // First inventory round, as one blocking poll finds it in the RX buffer
+    uint32_t tagFrames;                 // Tag notifications in rfidBytes
+    std::vector<UWBSession> sessions;   // uwbBytes, parsed
+    CycleRecord busiestCycle;           // Replayed cycle with the most tags
+};
+
+const BenchCorpus &benchCorpus();
+
+/*
+ Per-iteration wall time, preallocated so recording does not allocate.
+ Samples past the capacity are not kept (percentiles then cover the start of the run).
+*/
+class LatencySamples {
+   public:
+    explicit LatencySamples(size_t capacity = 1 << 16) {
+        _ns.reserve(capacity);
+    }
+
+    void add(uint64_t ns) {
+        if (_ns.size() < _ns.capacity()) _ns.push_back(ns);
+    }
+
+    /*! @brief Nearest-rank percentile, q from 0 to 1. Sorts the samples.*/
+    uint64_t percentile(double q);
+
+   private:
+    std::vector<uint64_t> _ns;
+};
+
+class LatencyTimer {
+   public:
+    explicit LatencyTimer(LatencySamples &samples)
+        : _samples(samples), _start(std::chrono::steady_clock::now()) {}
+
+    ~LatencyTimer() {
+        auto elapsed = std::chrono::steady_clock::now() - _start;
+        _samples.add(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+   private:
+    LatencySamples &_samples;
+    std::chrono::steady_clock::time_point _start;
+};
+
+/*! @brief Attach p50/p90/p99 latency and allocations per iteration to the result.
+    @param allocationsBefore allocationCount() just before the timed loop.*/
+void reportCounters(benchmark::State &state, LatencySamples &latency, uint64_t allocationsBefore);
+
+/*
+ Network client that accepts every write, as an idle LAN would, and answers
+ CONNECT with a CONNACK so PubSubClient reaches the connected state.
+*/
+class SinkClient : public Client {
+   public:
+    int connect(IPAddress, uint16_t) override;
+    int connect(const char *, uint16_t) override;
+    uint8_t connected() override {
+        return _connected;
+    }
+    void stop() override {
+        _connected = false;
+    }
+
+    int available() override {
+        return (int)(_replyLength - _replyIndex);
+    }
+    int read() override {
+        return _replyIndex < _replyLength ? _reply[_replyIndex++] : -1;
+    }
+
+    size_t write(uint8_t) override {
+        _written++;
+        return 1;
+    }
+    size_t write(const uint8_t *, size_t size) override {
+        _written += size;
+        return size;
+    }
+
+    uint64_t written() const {
+        return _written;
+    }
+
+   private:
+    bool _connected = false;
+    uint8_t _reply[4] = {0x20, 0x02, 0x00, 0x00};  // CONNACK, accepted
+    size_t _replyIndex = 0;
+    size_t _replyLength = 0;
+    uint64_t _written = 0;
+};
+
+/*
+ Print that only counts bytes, for encoders measured without a sink.
+*/
+class NullPrint : public Print {
+   public:
+    size_t write(uint8_t) override {
+        return 1;
+    }
+    size_t write(const uint8_t *, size_t size) override {
+        return size;
+    }
+};
+
+#endif
@@ -0,0 +1,66 @@
+#include "ALLOC_COUNTER.h"
+#include "BENCH_SUPPORT.h"
+#include "CYCLE_SERIALIZER.h"
+#include "PubSubClient.h"
+
+#define BENCH_WRITE_CHUNK_SIZE 1024                 // As MQTT_WRITE_CHUNK_SIZE
+#define BENCH_TOPIC_DATA       "store/production"  // As TOPIC_DATA
+
+// CycleSerializer on the busiest cycle of the trace, into a sink that drops the bytes
+static void serializeBench(benchmark::State &state, CyclePayloadFormat format) {
+    const CycleRecord &record = benchCorpus().busiestCycle;
+    NullPrint out;
+    size_t length = CycleSerializer::length(record, format);
+
+    LatencySamples latency;
+    uint64_t allocations = allocationCount();
+    for (auto _ : state) {
+        LatencyTimer timer(latency);
+        benchmark::DoNotOptimize(CycleSerializer::write(out, record, format));
+    }
+    reportCounters(state, latency, allocations);
+    state.SetBytesProcessed(state.iterations() * length);
+    state.SetItemsProcessed(state.iterations() * record.tagCount);
+}
+
+static void BM_SerializeJson(benchmark::State &state) {
+    serializeBench(state, CYCLE_PAYLOAD_JSON);
+}
+BENCHMARK(BM_SerializeJson);
+
+static void BM_SerializeBinary(benchmark::State &state) {
+    serializeBench(state, CYCLE_PAYLOAD_BINARY);
+}
+BENCHMARK(BM_SerializeBinary);
+
+// publishCycle() at QoS 0: length pass, streamed publish through ChunkedPrint
+static void BM_PublishCycle(benchmark::State &state) {
+    const CycleRecord &record = benchCorpus().busiestCycle;
+    static uint8_t chunk[BENCH_WRITE_CHUNK_SIZE];
+    SinkClient sink;
+    PubSubClient mqtt(sink);
+    mqtt.setServer("broker", 1883);
+    if (!mqtt.connect("optiflow-bench")) {
+        state.SkipWithError("MQTT connect to the sink failed");
+        return;
+    }
+
+    LatencySamples latency;
+    uint64_t allocations = allocationCount();
+    size_t length = 0;
+    for (auto _ : state) {
+        LatencyTimer timer(latency);
+        length = CycleSerializer::length(record, CYCLE_PAYLOAD_JSON);
+        if (!mqtt.beginPublish(BENCH_TOPIC_DATA, length, (uint8_t)0, false)) {
+            state.SkipWithError("beginPublish failed");
+            break;
+        }
+        ChunkedPrint out(mqtt, chunk, sizeof(chunk));
+        CycleSerializer::write(out, record, CYCLE_PAYLOAD_JSON);
+        out.flush();
+        benchmark::DoNotOptimize(mqtt.endPublish());
+    }
+    reportCounters(state, latency, allocations);
+    state.SetBytesProcessed(state.iterations() * length);
+}
+BENCHMARK(BM_PublishCycle);
@@ -0,0 +1,24 @@
+#include "ALLOC_COUNTER.h"
+#include "BENCH_SUPPORT.h"
+#include "HOST_PIPELINE.h"
+
+// The whole trace through HostPipeline, JSON encoded: every hot path in firmware proportions
+static void BM_ReplayPipeline(benchmark::State &state) {
+    const BenchCorpus &corpus = benchCorpus();
+    static HostPipeline pipeline;
+    NullPrint out;
+    pipeline.setOutput(&out);
+    pipeline.run(corpus.trace);  // First run sizes the buffers
+
+    LatencySamples latency;
+    uint64_t allocations = allocationCount();
+    for (auto _ : state) {
+        LatencyTimer timer(latency);
+        pipeline.run(corpus.trace);
+    }
+    reportCounters(state, latency, allocations);
+    state.SetBytesProcessed(state.iterations() * (corpus.rfidBytes.size() + corpus.uwbBytes.size()));
+    state.SetItemsProcessed(state.iterations() * pipeline.cycles());
+    state.counters["fixes"] = pipeline.fixes();
+}
+BENCHMARK(BM_ReplayPipeline);
@@ -0,0 +1,57 @@
+#include "ALLOC_COUNTER.h"
+#include "BENCH_SUPPORT.h"
+#include "HOST_HAL.h"
+#include "HOST_PIPELINE.h"
+
+// rfidTask in streaming mode: the whole trace's JRD-100 output through processStream()
+static void BM_RfidStreamDecode(benchmark::State &state) {
+    const BenchCorpus &corpus = benchCorpus();
+    HardwareSerial serial(2);
+    Unit_UHF_RFID rfid;
+    serial.setRxBufferSize(HOST_RFID_RX_BUFFER_SIZE);
+    rfid.begin(&serial);
+    rfid.startContinuousPolling();
+
+    LatencySamples latency;
+    uint64_t allocations = allocationCount();
+    for (auto _ : state) {
+        LatencyTimer timer(latency);
+        serial.clearRx();
+        rfid.beginStreamCycle();
+        const uint8_t *bytes = corpus.rfidBytes.data();
+        size_t remaining     = corpus.rfidBytes.size();
+        while (remaining > 0) {
+            size_t sent = serial.inject(bytes, remaining);
+            rfid.processStream();
+            bytes += sent;
+            remaining -= sent;
+        }
+        benchmark::DoNotOptimize(rfid.processStream());
+    }
+    reportCounters(state, latency, allocations);
+    state.SetBytesProcessed(state.iterations() * corpus.rfidBytes.size());
+    state.SetItemsProcessed(state.iterations() * corpus.tagFrames);
+}
+BENCHMARK(BM_RfidStreamDecode);
+
+// rfidTask in blocking mode: one pollingMultiple() round, answered from the RX buffer
+static void BM_RfidPollingMultiple(benchmark::State &state) {
+    const BenchCorpus &corpus = benchCorpus();
+    HardwareSerial serial(2);
+    Unit_UHF_RFID rfid;
+    serial.setRxBufferSize(HOST_RFID_RX_BUFFER_SIZE);
+    rfid.begin(&serial);
+    rfid.setRxWait(hostIdleWait, NULL);
+
+    LatencySamples latency;
+    uint64_t allocations = allocationCount();
+    for (auto _ : state) {
+        LatencyTimer timer(latency);
+        serial.clearRx();
+        serial.inject(corpus.rfidRound.data(), corpus.rfidRound.size());
+        benchmark::DoNotOptimize(rfid.pollingMultiple(HOST_POLLING_COUNT));
+    }
+    reportCounters(state, latency, allocations);
+    state.SetBytesProcessed(state.iterations() * corpus.rfidRound.size());
+}
+BENCHMARK(BM_RfidPollingMultiple);
@@ -0,0 +1,91 @@
+#include "ALLOC_COUNTER.h"
+#include "ANCHOR_TABLE.h"
+#include "BENCH_SUPPORT.h"
+#include "POSITION_SOLVER.h"
+
+// uwbTask: the whole trace's CLI output through the session parser
+static void BM_UwbSessionParse(benchmark::State &state) {
+    const BenchCorpus &corpus = benchCorpus();
+    UWBSessionParser parser;
+
+    LatencySamples latency;
+    uint64_t allocations = allocationCount();
+    for (auto _ : state) {
+        LatencyTimer timer(latency);
+        parser.reset();
+        uint32_t sessions = 0;
+        for (uint8_t c : corpus.uwbBytes) {
+            if (parser.feed((char)c)) sessions++;
+        }
+        benchmark::DoNotOptimize(sessions);
+    }
+    reportCounters(state, latency, allocations);
+    state.SetBytesProcessed(state.iterations() * corpus.uwbBytes.size());
+    state.SetItemsProcessed(state.iterations() * corpus.sessions.size());
+}
+BENCHMARK(BM_UwbSessionParse);
+
+// updateAnchorStatistics(): every measurement of the trace into one cycle's table
+static void BM_AnchorUpdate(benchmark::State &state) {
+    const BenchCorpus &corpus = benchCorpus();
+    AnchorTable table;
+    uint64_t measurements = 0;
+    for (const UWBSession &session : corpus.sessions) measurements += session.nMeasurements;
+
+    LatencySamples latency;
+    uint64_t allocations = allocationCount();
+    for (auto _ : state) {
+        LatencyTimer timer(latency);
+        table.clear();
+        unsigned long now = 0;
+        for (const UWBSession &session : corpus.sessions) {
+            now += 100;
+            for (uint8_t i = 0; i < session.nMeasurements; i++) {
+                const UWBMeasurement &m = session.measurements[i];
+                table.record(m.macAddress, m.status == UWB_STATUS_SUCCESS && m.distanceCm > 0, m.distanceCm, now);
+            }
+        }
+        benchmark::DoNotOptimize(table.size());
+    }
+    reportCounters(state, latency, allocations);
+    state.SetItemsProcessed(state.iterations() * measurements);
+}
+BENCHMARK(BM_AnchorUpdate);
+
+// updatePosition(): one solve per session with enough mapped anchors
+static void BM_PositionSolve(benchmark::State &state) {
+    const BenchCorpus &corpus = benchCorpus();
+    AnchorMap map;
+    for (const UartTrace::Anchor &anchor : corpus.trace.anchors()) map.set(anchor.mac, anchor.x, anchor.y);
+
+    std::vector<RangeSet> solves;
+    for (const UWBSession &session : corpus.sessions) {
+        RangeSet ranges;
+        ranges.clear();
+        for (uint8_t i = 0; i < session.nMeasurements; i++) {
+            const UWBMeasurement &m = session.measurements[i];
+            float x, y;
+            if (m.status != UWB_STATUS_SUCCESS || m.distanceCm <= 0) continue;
+            if (!map.find(m.macAddress, x, y)) continue;
+            ranges.add(x, y, (float)m.distanceCm, 1.0f);
+        }
+        if (ranges.count >= POSITION_MIN_ANCHORS) solves.push_back(ranges);
+    }
+
+    PositionSolver solver;
+    LatencySamples latency;
+    uint64_t allocations = allocationCount();
+    for (auto _ : state) {
+        LatencyTimer timer(latency);
+        solver.reset();
+        unsigned long now = 0;
+        PositionEstimate estimate;
+        for (const RangeSet &ranges : solves) {
+            now += 100;
+            benchmark::DoNotOptimize(solver.solve(ranges, now, estimate));
+        }
+    }
+    reportCounters(state, latency, allocations);
+    state.SetItemsProcessed(state.iterations() * solves.size());
+}
+BENCHMARK(BM_PositionSolve);
@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""
+Run optiflow_bench and fail if a benchmark exceeds its budget in perf_budget.json.
+
+Usage: python3 check_perf_budget.py <optiflow_bench> <perf_budget.json> [--min-time 0.1]
+
+A benchmark in the budget file that did not run is a failure too, so a
+renamed benchmark cannot silently drop out of the check.
+"""
+
+import argparse
+import json
+import subprocess
+import sys
+
+
+def run_benchmarks(binary, min_time):
+    output = subprocess.run([binary, "--benchmark_format=json", "--benchmark_min_time=%g" % min_time],
+                            check=True, stdout=subprocess.PIPE).stdout
+    return {b["name"]: b for b in json.loads(output)["benchmarks"]}
+
+
+def check(results, budget):
+    """Return one message per budget violation."""
+    violations = []
+    for name, limits in sorted(budget.items()):
+        if name.startswith("_"):
+            continue
+        result = results.get(name)
+        if result is None:
+            violations.append("%s: did not run" % name)
+            continue
+        if "error_message" in result:
+            violations.append("%s: %s" % (name, result["error_message"]))
+            continue
+        cpu_ns = result["cpu_time"] * {"ns": 1, "us": 1e3, "ms": 1e6, "s": 1e9}[result["time_unit"]]
+        if cpu_ns > limits["cpu_time_ns"]:
+            violations.append("%s: %.0f ns CPU per iteration, budget %d" % (name, cpu_ns, limits["cpu_time_ns"]))
+        allocs = result.get("allocs_per_iter")
+        if allocs is not None and allocs > limits.get("allocs_per_iter", float("inf")):
+            violations.append("%s: %.2f allocations per iteration, budget %d"
+                              % (name, allocs, limits["allocs_per_iter"]))
+    return violations
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("bench")
+    parser.add_argument("budget")
+    parser.add_argument("--min-time", type=float, default=0.1)
+    args = parser.parse_args()
+
+    with open(args.budget) as f:
+        budget = json.load(f)
+    results = run_benchmarks(args.bench, args.min_time)
+
+    for name in sorted(results):
+        r = results[name]
+        print("%-24s %12.0f %s  p99 %10.0f ns  %s allocs/iter" % (
+            name, r["cpu_time"], r["time_unit"], r.get("p99_ns", 0), r.get("allocs_per_iter", "-")))
+
+    violations = check(results, budget)
+    for v in violations:
+        print("OVER BUDGET " + v, file=sys.stderr)
+    return 1 if violations else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
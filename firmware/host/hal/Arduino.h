@@ -0,0 +1,75 @@
+#ifndef _HOST_ARDUINO_H_
+#define _HOST_ARDUINO_H_
+
+/*
+ Host build of the Arduino core: just enough of arduino-esp32 for the
+ firmware modules to compile unchanged on a PC. Time is virtual (HOST_HAL.h):
+ millis() only moves when the harness or a blocking call advances it, so a
+ replay is deterministic and a 500 ms RFID timeout costs no wall time.
+*/
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "HardwareSerial.h"
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HEX 16
+#define DEC 10
+#define IRAM_ATTR
+#define LOW    0
+#define HIGH   1
+#define OUTPUT 0x03
+#define pgm_read_byte_near(address) (*(const uint8_t *)(address))
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+// GPIO is not modelled: writes go nowhere
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+
+/*
+ ESP32 system calls used by the firmware. The cycle counter runs off the host
+ clock at getCpuFreqMHz(); heap figures are not modelled and read 0.
+*/
+class EspClass {
+   public:
+    uint32_t getCycleCount();
+    uint32_t getCpuFreqMHz() {
+        return 240;
+    }
+    uint32_t getFreeHeap() {
+        return 0;
+    }
+    uint32_t getMinFreeHeap() {
+        return 0;
+    }
+    uint32_t getMaxAllocHeap() {
+        return 0;
+    }
+    uint32_t getFreePsram() {
+        return 0;
+    }
+};
+
+extern EspClass ESP;
+extern HardwareSerial Serial;
+extern HardwareSerial Serial2;
+
+bool psramFound();
+void *ps_malloc(size_t size);
+
+#endif
@@ -0,0 +1,259 @@
+#include "HOST_HAL.h"
+
+#include <Arduino.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <chrono>
+
+static unsigned long virtualMillis = 0;
+static uint32_t pendingNotifications = 0;
+
+EspClass ESP;
+HardwareSerial Serial(0);
+HardwareSerial Serial2(2);
+
+unsigned long hostMillis() {
+    return virtualMillis;
+}
+
+void hostSetMillis(unsigned long ms) {
+    virtualMillis = ms;
+}
+
+void hostAdvanceMillis(unsigned long ms) {
+    virtualMillis += ms;
+}
+
+void hostIdleWait(void *, unsigned long timeoutMs) {
+    hostAdvanceMillis(timeoutMs);
+}
+
+// ---- Arduino core ----
+
+unsigned long millis() {
+    return virtualMillis;
+}
+
+unsigned long micros() {
+    return virtualMillis * 1000UL;
+}
+
+void delay(unsigned long ms) {
+    hostAdvanceMillis(ms);
+}
+
+void yield() {
+    hostAdvanceMillis(1);  // A spin on yield() must still reach its timeout
+}
+
+uint32_t EspClass::getCycleCount() {
+    // Real time, not virtual: this one measures the host CPU
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return (uint32_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() * getCpuFreqMHz() / 1000);
+}
+
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t, uint8_t) {}
+
+// The target board has PSRAM; here it is the heap
+bool psramFound() {
+    return true;
+}
+
+void *ps_malloc(size_t size) {
+    return malloc(size);
+}
+
+// ---- FreeRTOS ----
+
+void vTaskDelay(TickType_t ticks) {
+    hostAdvanceMillis(ticks * portTICK_PERIOD_MS);
+}
+
+TickType_t xTaskGetTickCount() {
+    return (TickType_t)(virtualMillis / portTICK_PERIOD_MS);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return &pendingNotifications;
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t) {
+    return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t) {
+    pendingNotifications++;
+    return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    uint32_t count = pendingNotifications;
+    if (count == 0) {
+        vTaskDelay(ticks);  // Nobody else runs to give one
+        return 0;
+    }
+    pendingNotifications = clearOnExit ? 0 : count - 1;
+    return count;
+}
+
+// ---- String ----
+
+static std::string formatInteger(unsigned long value, bool negative, unsigned char base) {
+    char digits[66];
+    int i = sizeof(digits) - 1;
+    digits[i] = '\0';
+    if (base < 2 || base > 36) base = 10;
+    do {
+        unsigned digit = value % base;
+        digits[--i] = digit < 10 ? '0' + digit : 'a' + digit - 10;
+        value /= base;
+    } while (value);
+    if (negative) digits[--i] = '-';
+    return std::string(digits + i);
+}
+
+String::String(int value, unsigned char base) : String((long)value, base) {}
+
+String::String(unsigned int value, unsigned char base) : String((unsigned long)value, base) {}
+
+String::String(long value, unsigned char base)
+    : _text(base == 10 && value < 0 ? formatInteger(-(unsigned long)value, true, base)
+                                    : formatInteger((unsigned long)value, false, base)) {}
+
+String::String(unsigned long value, unsigned char base) : _text(formatInteger(value, false, base)) {}
+
+String::String(double value, unsigned char decimals) {
+    char text[48];
+    snprintf(text, sizeof(text), "%.*f", decimals, value);
+    _text = text;
+}
+
+void String::trim() {
+    size_t start = _text.find_first_not_of(" \t\r\n");
+    size_t end   = _text.find_last_not_of(" \t\r\n");
+    _text        = start == std::string::npos ? std::string() : _text.substr(start, end - start + 1);
+}
+
+// ---- Print / Stream ----
+
+size_t Print::printf(const char *format, ...) {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    if (length <= 0) return 0;
+    return write((const uint8_t *)text, length < (int)sizeof(text) ? length : sizeof(text) - 1);
+}
+
+size_t Print::print(long value, int base) {
+    return print(String(value, (unsigned char)base));
+}
+
+size_t Print::print(unsigned long value, int base) {
+    return print(String(value, (unsigned char)base));
+}
+
+size_t Print::print(double value, int decimals) {
+    return print(String(value, (unsigned char)decimals));
+}
+
+String Stream::readStringUntil(char terminator) {
+    String text;
+    int c;
+    while ((c = read()) >= 0 && c != terminator) {
+        text += (char)c;
+    }
+    return text;
+}
+
+// ---- HardwareSerial ----
+
+#define HOST_UART_DEFAULT_RX_BUFFER 256  // arduino-esp32 default
+
+HardwareSerial::HardwareSerial(int uartNum)
+    : _uart(uartNum), _rxCapacity(HOST_UART_DEFAULT_RX_BUFFER), _rxHead(0), _rxTail(0), _txBytes(0) {}
+
+void HardwareSerial::begin(unsigned long, uint32_t, int8_t, int8_t) {
+    if (_rx.size() != _rxCapacity) _rx.assign(_rxCapacity, 0);
+    _rxHead = 0;
+    _rxTail = 0;
+}
+
+size_t HardwareSerial::setRxBufferSize(size_t size) {
+    _rxCapacity = size;
+    return size;
+}
+
+void HardwareSerial::onReceive(OnReceiveCb callback, bool) {
+    _onReceive = callback;
+}
+
+void HardwareSerial::onReceiveError(OnReceiveErrorCb callback) {
+    _onReceiveError = callback;
+}
+
+int HardwareSerial::available() {
+    return (int)(_rxTail - _rxHead);
+}
+
+int HardwareSerial::read() {
+    return _rxHead < _rxTail ? _rx[_rxHead++] : -1;
+}
+
+size_t HardwareSerial::read(uint8_t *buffer, size_t size) {
+    size_t count = _rxTail - _rxHead < size ? _rxTail - _rxHead : size;
+    memcpy(buffer, _rx.data() + _rxHead, count);
+    _rxHead += count;
+    return count;
+}
+
+int HardwareSerial::peek() {
+    return _rxHead < _rxTail ? _rx[_rxHead] : -1;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t size) {
+    _txBytes += size;
+#ifdef HOST_SERIAL_STDOUT
+    if (_uart == 0) fwrite(data, 1, size, stdout);
+#else
+    (void)data;
+#endif
+    return size;
+}
+
+void HardwareSerial::compact() {
+    if (_rxHead == 0) return;
+    memmove(_rx.data(), _rx.data() + _rxHead, _rxTail - _rxHead);
+    _rxTail -= _rxHead;
+    _rxHead = 0;
+}
+
+size_t HardwareSerial::inject(const uint8_t *data, size_t size) {
+    if (_rx.empty()) begin(0);
+    if (_rxTail + size > _rx.size()) compact();
+
+    size_t room     = _rx.size() - _rxTail;
+    size_t accepted = size < room ? size : room;
+    memcpy(_rx.data() + _rxTail, data, accepted);
+    _rxTail += accepted;
+
+    if (accepted < size && _onReceiveError) {
+        _onReceiveError(UART_BUFFER_FULL_ERROR);
+    }
+    if (accepted > 0 && _onReceive) {
+        _onReceive();
+    }
+    return accepted;
+}
+
+void HardwareSerial::clearRx() {
+    _rxHead = 0;
+    _rxTail = 0;
+}
@@ -0,0 +1,25 @@
+#ifndef _HOST_HAL_H_
+#define _HOST_HAL_H_
+
+#include <stdint.h>
+
+/*
+ Host-only controls over the HAL.
+
+ The clock is virtual and starts at 0. It moves only through
+ hostAdvanceMillis() / hostSetMillis(), or when firmware code blocks:
+ delay(), vTaskDelay() and an unsatisfied ulTaskNotifyTake() advance it by
+ their timeout, yield() by 1 ms.
+*/
+
+unsigned long hostMillis();
+
+void hostSetMillis(unsigned long ms);
+
+void hostAdvanceMillis(unsigned long ms);
+
+/*! @brief Unit_UHF_RFID::setRxWait() callback: the line stays idle, so the wait
+    just lets timeoutMs of virtual time pass.*/
+void hostIdleWait(void *context, unsigned long timeoutMs);
+
+#endif
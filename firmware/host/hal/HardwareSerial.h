@@ -0,0 +1,92 @@
+#ifndef _HOST_HARDWARESERIAL_H_
+#define _HOST_HARDWARESERIAL_H_
+
+#include <functional>
+#include <vector>
+
+#include "Stream.h"
+
+#define SERIAL_8N1 0x800001c
+
+enum hardwareSerial_error_t {
+    UART_NO_ERROR,
+    UART_BREAK_ERROR,
+    UART_BUFFER_FULL_ERROR,
+    UART_FIFO_OVF_ERROR,
+    UART_FRAME_ERROR,
+    UART_PARITY_ERROR
+};
+
+typedef std::function<void(void)> OnReceiveCb;
+typedef std::function<void(hardwareSerial_error_t)> OnReceiveErrorCb;
+
+/*
+ UART port fed by the harness instead of a pin. inject() plays the role of
+ the driver's ISR: bytes land in an RX buffer of setRxBufferSize() bytes
+ (allocated once, in begin()), overflow is dropped and reported through
+ onReceiveError() like a full ring buffer, and onReceive() fires after each
+ injected chunk. Transmitted bytes are only counted.
+
+ Port 0 (Serial) prints to stdout when HOST_SERIAL_STDOUT is defined and
+ discards otherwise.
+*/
+class HardwareSerial : public Stream {
+   public:
+    explicit HardwareSerial(int uartNum);
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+    void end() {}
+
+    int available() override;
+    int read() override;
+    size_t read(uint8_t *buffer, size_t size);
+    int peek() override;
+
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t *data, size_t size) override;
+    using Print::write;
+
+    void onReceive(OnReceiveCb callback, bool onlyOnTimeout = false);
+    void onReceiveError(OnReceiveErrorCb callback);
+    bool setRxFIFOFull(uint8_t) {
+        return true;
+    }
+    bool setRxTimeout(uint8_t) {
+        return true;
+    }
+    size_t setRxBufferSize(size_t size);
+    size_t setTxBufferSize(size_t size) {
+        return size;
+    }
+
+    operator bool() const {
+        return true;
+    }
+
+    // Host only
+
+    /*! @brief Deliver bytes as if received on the RX pin.
+        @return Bytes accepted; the rest overflowed the RX buffer.*/
+    size_t inject(const uint8_t *data, size_t size);
+
+    /*! @brief Drop everything still unread.*/
+    void clearRx();
+
+    uint64_t txBytes() const {
+        return _txBytes;
+    }
+
+   private:
+    void compact();
+
+    int _uart;
+    std::vector<uint8_t> _rx;
+    size_t _rxCapacity;
+    size_t _rxHead;  // Next byte to read
+    size_t _rxTail;  // One past the last byte received
+    uint64_t _txBytes;
+    OnReceiveCb _onReceive;
+    OnReceiveErrorCb _onReceiveError;
+};
+
+#endif
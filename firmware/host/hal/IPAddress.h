@@ -0,0 +1,19 @@
+#ifndef _HOST_IPADDRESS_H_
+#define _HOST_IPADDRESS_H_
+
+#include <stdint.h>
+
+class IPAddress {
+   public:
+    IPAddress() : _address{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _address{a, b, c, d} {}
+
+    uint8_t operator[](int index) const {
+        return _address[index];
+    }
+
+   private:
+    uint8_t _address[4];
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef _HOST_PRINT_H_
+#define _HOST_PRINT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "WString.h"
+
+class Print {
+   public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+
+    virtual size_t write(const uint8_t *data, size_t size) {
+        size_t n = 0;
+        while (size--) {
+            n += write(*data++);
+        }
+        return n;
+    }
+
+    size_t write(const char *text) {
+        return text ? write((const uint8_t *)text, strlen(text)) : 0;
+    }
+
+    size_t write(const char *data, size_t size) {
+        return write((const uint8_t *)data, size);
+    }
+
+    virtual void flush() {}
+
+    size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    size_t print(const char *text) {
+        return write(text);
+    }
+    size_t print(const String &text) {
+        return write(text.c_str());
+    }
+    size_t print(char c) {
+        return write((uint8_t)c);
+    }
+    size_t print(int value, int base = 10) {
+        return print((long)value, base);
+    }
+    size_t print(unsigned int value, int base = 10) {
+        return print((unsigned long)value, base);
+    }
+    size_t print(long value, int base = 10);
+    size_t print(unsigned long value, int base = 10);
+    size_t print(double value, int decimals = 2);
+
+    size_t println() {
+        return write("\r\n");
+    }
+    template <typename T>
+    size_t println(const T &value) {
+        size_t n = print(value);
+        return n + println();
+    }
+    size_t println(double value, int decimals) {
+        size_t n = print(value, decimals);
+        return n + println();
+    }
+};
+
+#endif
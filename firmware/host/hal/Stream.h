@@ -0,0 +1,17 @@
+#ifndef _HOST_STREAM_H_
+#define _HOST_STREAM_H_
+
+#include "Print.h"
+
+class Stream : public Print {
+   public:
+    virtual int available() = 0;
+    virtual int read()      = 0;
+    virtual int peek() {
+        return -1;
+    }
+
+    String readStringUntil(char terminator);
+};
+
+#endif
@@ -0,0 +1,74 @@
+#ifndef _HOST_WSTRING_H_
+#define _HOST_WSTRING_H_
+
+#include <stdint.h>
+#include <string>
+
+/*
+ Arduino String over std::string. Only the driver's diagnostics use it;
+ none of the replayed paths create one.
+*/
+class String {
+   public:
+    String(const char *text = "") : _text(text ? text : "") {}
+    String(const std::string &text) : _text(text) {}
+    String(char c) : _text(1, c) {}
+    String(int value, unsigned char base = 10);
+    String(unsigned int value, unsigned char base = 10);
+    String(long value, unsigned char base = 10);
+    String(unsigned long value, unsigned char base = 10);
+    String(unsigned char value, unsigned char base = 10) : String((unsigned int)value, base) {}
+    String(double value, unsigned char decimals = 2);
+
+    const char *c_str() const {
+        return _text.c_str();
+    }
+
+    unsigned int length() const {
+        return _text.size();
+    }
+
+    String &operator+=(const String &other) {
+        _text += other._text;
+        return *this;
+    }
+
+    String &operator+=(const char *text) {
+        _text += text;
+        return *this;
+    }
+
+    String &operator+=(char c) {
+        _text += c;
+        return *this;
+    }
+
+    bool operator==(const String &other) const {
+        return _text == other._text;
+    }
+
+    bool operator!=(const String &other) const {
+        return _text != other._text;
+    }
+
+    char operator[](unsigned int index) const {
+        return index < _text.size() ? _text[index] : 0;
+    }
+
+    void trim();
+
+   private:
+    std::string _text;
+};
+
+inline String operator+(const String &a, const String &b) {
+    String result(a);
+    result += b;
+    return result;
+}
+
+inline String operator+(const char *a, const String &b) {
+    return String(a) + b;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#ifndef _HOST_FREERTOS_H_
+#define _HOST_FREERTOS_H_
+
+/*
+ The FreeRTOS subset the firmware uses, on one host thread. Critical
+ sections are real spinlocks; anything that would block advances virtual
+ time instead (HOST_HAL.h), so waits and timeouts resolve immediately.
+*/
+
+#include <stdint.h>
+#include <atomic>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint8_t StackType_t;
+typedef void *TaskHandle_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+#define pdPASS  1
+#define portMAX_DELAY      0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(ms))
+
+#define configGENERATE_RUN_TIME_STATS 0
+#define configUSE_TRACE_FACILITY      0
+
+struct portMUX_TYPE {
+    std::atomic<bool> locked;
+};
+#define portMUX_INITIALIZER_UNLOCKED {false}
+
+inline void portENTER_CRITICAL(portMUX_TYPE *mux) {
+    while (mux->locked.exchange(true, std::memory_order_acquire)) {
+    }
+}
+
+inline void portEXIT_CRITICAL(portMUX_TYPE *mux) {
+    mux->locked.store(false, std::memory_order_release);
+}
+
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount();
+TaskHandle_t xTaskGetCurrentTaskHandle();
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+// Notifications: one pending count shared by the harness thread
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef _HOST_PINS_ARDUINO_H_
+#define _HOST_PINS_ARDUINO_H_
+
+// No pins on the host; UART pin numbers passed to begin() are ignored
+
+#endif
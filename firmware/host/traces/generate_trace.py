@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""
+Synthesize a UART trace (UART_TRACE.h format) of a reader walking along a shelf.
+
+The trace is deterministic for a given seed, so it can back a golden replay
+test. Real captures use the same format and sit next to it in traces/.
+
+The RFID port carries JRD-100 multiple-polling output: tag notifications
+(BB 02 22 ...) for the tags within reach of the reader, "no tag" error frames
+for empty rounds, now and then a frame with a bad checksum or stray bytes.
+The UWB port carries DWM3001CDK SESSION_INFO_NTF blocks at 10 Hz with ranges
+to four anchors, including RX_TIMEOUT measurements. Both byte streams are cut
+into driver-sized chunks timed at 115200 baud.
+
+Usage: python3 generate_trace.py [--seconds 5] [--seed 7] > shelf_walk.trace
+"""
+
+import argparse
+import math
+import random
+
+BYTES_PER_MS = 11.52  # 115200 baud, 8N1
+RFID_CHUNK = 24  # RFID_RX_FIFO_FULL
+UWB_CHUNK = 64  # UWB_RX_FIFO_FULL
+
+ANCHORS = [(0x0001, 0.0, 0.0), (0x0002, 800.0, 0.0), (0x0003, 800.0, 600.0), (0x0004, 0.0, 600.0)]
+SHELF_Y = 40.0
+TAG_COUNT = 120
+READ_RANGE_CM = 130.0
+ROUND_MS = 50
+SESSION_MS = 100
+
+
+def tag_frame(epc, rssi_dbm):
+    """Tag notification: BB 02 22 00 11 RSSI PC(2) EPC(12) CRC(2) checksum 7E."""
+    body = [0x02, 0x22, 0x00, 0x11, rssi_dbm & 0xFF, 0x30, 0x00] + list(epc) + [0x5A, 0xA5]
+    return bytes([0xBB] + body + [sum(body) & 0xFF, 0x7E])
+
+
+NO_TAG_FRAME = bytes([0xBB, 0x01, 0xFF, 0x00, 0x01, 0x15, 0x16, 0x7E])
+
+
+def walker(t_ms, seconds):
+    """Reader position: along the shelf and back, 1 m from it."""
+    span = 700.0
+    phase = (t_ms / (seconds * 1000.0)) * 2.0
+    along = phase if phase <= 1.0 else 2.0 - phase
+    return 50.0 + along * span, SHELF_Y + 100.0
+
+
+def rfid_rounds(rng, seconds, tags):
+    stream = []  # (time_ms, bytes)
+    for t in range(0, seconds * 1000, ROUND_MS):
+        x, y = walker(t, seconds)
+        frames = []
+        for epc, tx in tags:
+            distance = math.hypot(tx - x, SHELF_Y - y)
+            if distance > READ_RANGE_CM or rng.random() > 0.45:
+                continue
+            rssi = int(-40 - 25 * distance / READ_RANGE_CM + rng.uniform(-3, 3))
+            frames.append(tag_frame(epc, rssi))
+        if not frames:
+            frames.append(NO_TAG_FRAME)
+        if rng.random() < 0.03:
+            bad = bytearray(frames[0])
+            bad[-2] ^= 0x40  # Corrupted checksum: dropped by the driver
+            frames.insert(0, bytes(bad))
+        if rng.random() < 0.02:
+            frames.insert(0, bytes([0x00, 0x7E, 0x13]))  # Line noise before a header
+        stream.append((t, b"".join(frames)))
+    return stream
+
+
+def uwb_sessions(rng, seconds):
+    stream = []
+    for n, t in enumerate(range(0, seconds * 1000, SESSION_MS), start=1):
+        x, y = walker(t, seconds)
+        parts = []
+        for mac, ax, ay in ANCHORS:
+            if rng.random() < 0.08:
+                parts.append('[mac_address=0x%04x, status="RX_TIMEOUT", distance[cm]=-1]' % mac)
+                continue
+            distance = math.hypot(ax - x, ay - y) + rng.gauss(0, 6)
+            if rng.random() < 0.03:
+                distance += rng.uniform(80, 200)  # Multipath outlier
+            parts.append('[mac_address=0x%04x, status="SUCCESS", distance[cm]=%d]' % (mac, round(distance)))
+        text = "SESSION_INFO_NTF: {session_handle=1, sequence_number=%d, block_index=%d, n_measurements=%d\r\n" % (
+            n, n, len(parts))
+        text += ";\r\n".join(" " + p for p in parts) + "}\r\n"
+        stream.append((t + 5, text.encode("ascii")))
+    return stream
+
+
+def chunked(stream, size, rng):
+    """Split each burst into driver events: full FIFOs, then the rest on RX timeout.
+    A burst that finds the line still busy goes out after the previous one."""
+    chunks = []
+    line_free = 0.0
+    for start, data in stream:
+        sent = max(float(start), line_free)
+        offset = 0
+        while offset < len(data):
+            length = min(size if rng.random() < 0.8 else rng.randint(1, size), len(data) - offset)
+            sent += length / BYTES_PER_MS
+            chunks.append((int(sent), data[offset:offset + length]))
+            offset += length
+        line_free = sent
+    return chunks
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[1])
+    parser.add_argument("--seconds", type=int, default=5)
+    parser.add_argument("--seed", type=int, default=7)
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    tags = []
+    for i in range(TAG_COUNT):
+        epc = bytes([0xE2, 0x00, 0x34, 0x12, 0x01, 0x3C, 0x00, 0x00, 0x00, 0x00, i >> 8, i & 0xFF])
+        tags.append((epc, 20.0 + i * (760.0 / TAG_COUNT)))
+
+    chunks = [(t, "R", d) for t, d in chunked(rfid_rounds(rng, args.seconds, tags), RFID_CHUNK, rng)]
+    chunks += [(t, "U", d) for t, d in chunked(uwb_sessions(rng, args.seconds), UWB_CHUNK, rng)]
+    chunks.sort(key=lambda c: c[0])  # Stable: each port keeps its byte order
+
+    print("# OptiFlow UART trace: synthetic shelf walk (generate_trace.py --seconds %d --seed %d)"
+          % (args.seconds, args.seed))
+    print("# <ms> <port> <hex bytes>, R = JRD-100, U = DWM3001CDK")
+    for mac, x, y in ANCHORS:
+        print("# anchor 0x%04x %.1f %.1f" % (mac, x, y))
+    for t, port, data in chunks:
+        print("%d %s %s" % (t, port, data.hex()))
+
+
+if __name__ == "__main__":
+    main()
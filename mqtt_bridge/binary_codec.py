@@ -0,0 +1,333 @@
+"""
+Decoder for the firmware's binary cycle frames (topic store/production/bin).
+
+All fields are little-endian and byte-packed:
+
+    header (16 bytes)
+        magic          2s   b"OF"
+        version        u8   1
+        flags          u8   bit 0: delta frame, bit 1: position extension,
+                            bit 2: anchor statistics, bit 3: suppressed cycle,
+                            bit 4: read times
+        polling_cycle  u32
+        timestamp      u32  milliseconds since boot
+        tag_count      u16  tag entries in this frame
+        anchor_count   u8
+        reserved       u8
+    delta extension (12 bytes), delta frames only
+        base_cycle     u32  cycle the changes apply to
+        tag_total      u16  size of the full tag set
+        added_count    u16  first added_count tag entries are new, the rest changed
+        removed_count  u16
+        reserved       u16
+    position extension (8 bytes), if flagged
+        x_cm           i16  on-device fix, store coordinates
+        y_cm           i16
+        confidence     u8   1/255 units
+        n_anchors      u8   ranges used for the fix
+        age_ms         u16  fix age when the cycle closed
+    time extension (8 bytes), if flagged
+        epoch_us       u64  wall time at timestamp (SNTP), 0 = not synced
+    anchor (8 bytes) x anchor_count
+        mac_address    u16
+        distance       u16  0.1 cm units
+        measurements   u16
+        total_sessions u16
+      anchor statistics (8 bytes), after every anchor entry if flagged
+        median         u16  0.1 cm units, last few readings
+        stddev         u16  0.1 cm units, all readings of the cycle
+        min_cm         u16
+        max_cm         u16
+      anchor time (2 bytes), after every anchor entry (and statistics) if flagged
+        age_ms         u16  last session, ms before timestamp
+    tag (17 bytes) x tag_count
+        epc            12s  raw 96-bit EPC
+        rssi_dbm       i8   mean over the cycle
+        rssi_min       i8
+        rssi_max       i8
+        reads          u16
+      tag time (4 bytes), after every tag entry if flagged
+        first_ms       u16  first read, ms before timestamp
+        last_ms        u16  last read, ms before timestamp
+    removed epc (12 bytes) x removed_count, delta frames only
+
+Cycles the firmware could not publish while offline arrive later on
+store/production/backlog, many frames per message; with PUBLISH_BATCH, live
+cycles arrive the same way on store/production/batch:
+
+    batch header (12 bytes)
+        magic          2s   b"OB"
+        version        u8   1
+        flags          u8   bit 0: entries LZ4-compressed
+        frame_count    u16
+        reserved       u16
+        sent_at        u32  device milliseconds since boot at send time
+    raw_length         u32  compressed batches only: bytes of the entries
+    entry x frame_count, or one LZ4 block of them if compressed
+        length         u16
+        frame          length bytes, a full (non-delta) cycle frame
+
+The frame decodes to the same dict shape as the JSON payload on
+store/production, so transform_hardware_to_backend() handles both. Delta
+frames decode to the JSON delta shape ("rfid": {"tag_count", "delta"}), which
+TagStateTracker expands back into a full tag list.
+"""
+
+import struct
+
+FRAME_MAGIC = b"OF"
+FRAME_VERSION = 1
+
+_HEADER = struct.Struct("<2sBBIIHBB")
+_ANCHOR = struct.Struct("<HHHH")
+_ANCHOR_STATS = struct.Struct("<HHHH")
+_DELTA = struct.Struct("<IHHHH")
+_POSITION = struct.Struct("<hhBBH")
+_TAG = struct.Struct("<12sbbbH")
+_TIME = struct.Struct("<Q")
+_ANCHOR_TIME = struct.Struct("<H")
+_TAG_TIME = struct.Struct("<HH")
+_EPC_SIZE = 12
+
+FLAG_DELTA = 0x01
+FLAG_POSITION = 0x02
+FLAG_ANCHOR_STATS = 0x04
+FLAG_SUPPRESSED = 0x08  # Recently read tags were silenced; absent tags may be present
+FLAG_TIMES = 0x10  # Wall time of the cycle, times of the last session and first/last read
+KNOWN_FLAGS = FLAG_DELTA | FLAG_POSITION | FLAG_ANCHOR_STATS | FLAG_SUPPRESSED | FLAG_TIMES
+
+BATCH_MAGIC = b"OB"
+BATCH_VERSION = 1
+
+_BATCH_HEADER = struct.Struct("<2sBBHHI")
+_BATCH_ENTRY = struct.Struct("<H")
+_BATCH_RAW_LENGTH = struct.Struct("<I")
+
+BATCH_FLAG_LZ4 = 0x01  # Entries are one LZ4 block (firmware LZ4_BLOCK.h)
+
+
+class FrameError(ValueError):
+    """Raised when a payload is not a valid binary cycle frame."""
+
+
+def is_binary_frame(payload: bytes) -> bool:
+    """Cheap check used to route payloads before decoding."""
+    return len(payload) >= _HEADER.size and payload[:2] == FRAME_MAGIC
+
+
+def decode_cycle_frame(payload: bytes) -> dict:
+    """Decode one binary cycle frame into the hardware JSON format."""
+    if len(payload) < _HEADER.size:
+        raise FrameError(f"frame too short: {len(payload)} bytes")
+
+    magic, version, flags, cycle, timestamp, tag_count, anchor_count, _ = _HEADER.unpack_from(payload, 0)
+    if magic != FRAME_MAGIC:
+        raise FrameError(f"bad magic {magic!r}")
+    if version != FRAME_VERSION:
+        raise FrameError(f"unsupported frame version {version}")
+    if flags & ~KNOWN_FLAGS:
+        raise FrameError(f"unsupported frame flags 0x{flags & ~KNOWN_FLAGS:02x}")
+
+    offset = _HEADER.size
+    is_delta = bool(flags & FLAG_DELTA)
+    removed_count = 0
+    if is_delta:
+        if len(payload) < _HEADER.size + _DELTA.size:
+            raise FrameError(f"delta frame too short: {len(payload)} bytes")
+        base_cycle, tag_total, added_count, removed_count, _ = _DELTA.unpack_from(payload, offset)
+        offset += _DELTA.size
+        if added_count > tag_count:
+            raise FrameError(f"added_count {added_count} exceeds tag entries {tag_count}")
+
+    position = None
+    if flags & FLAG_POSITION:
+        if len(payload) < offset + _POSITION.size:
+            raise FrameError(f"position frame too short: {len(payload)} bytes")
+        x_cm, y_cm, confidence, n_anchors, age_ms = _POSITION.unpack_from(payload, offset)
+        offset += _POSITION.size
+        position = {
+            "x_cm": float(x_cm),
+            "y_cm": float(y_cm),
+            "confidence": round(confidence / 255.0, 2),
+            "n_anchors": n_anchors,
+            "age_ms": age_ms,
+        }
+
+    has_times = bool(flags & FLAG_TIMES)
+    epoch_us = 0
+    if has_times:
+        if len(payload) < offset + _TIME.size:
+            raise FrameError(f"time frame too short: {len(payload)} bytes")
+        (epoch_us,) = _TIME.unpack_from(payload, offset)
+        offset += _TIME.size
+
+    has_stats = bool(flags & FLAG_ANCHOR_STATS)
+    anchor_size = _ANCHOR.size + (_ANCHOR_STATS.size if has_stats else 0) + (_ANCHOR_TIME.size if has_times else 0)
+    tag_size = _TAG.size + (_TAG_TIME.size if has_times else 0)
+    expected = offset + anchor_count * anchor_size + tag_count * tag_size + removed_count * _EPC_SIZE
+    if len(payload) != expected:
+        raise FrameError(f"length {len(payload)} does not match header (expected {expected})")
+
+    anchors = []
+    for _ in range(anchor_count):
+        mac, distance, measurements, sessions = _ANCHOR.unpack_from(payload, offset)
+        offset += _ANCHOR.size
+        anchor = {
+            "mac_address": f"0x{mac:04x}",
+            "average_distance_cm": distance / 10.0,
+            "measurements": measurements,
+            "total_sessions": sessions,
+        }
+        if has_stats:
+            median, stddev, min_cm, max_cm = _ANCHOR_STATS.unpack_from(payload, offset)
+            offset += _ANCHOR_STATS.size
+            anchor["median_distance_cm"] = median / 10.0
+            anchor["stddev_cm"] = stddev / 10.0
+            anchor["min_cm"] = min_cm
+            anchor["max_cm"] = max_cm
+        if has_times:
+            (anchor["age_ms"],) = _ANCHOR_TIME.unpack_from(payload, offset)
+            offset += _ANCHOR_TIME.size
+        anchors.append(anchor)
+
+    tags = []
+    for _ in range(tag_count):
+        epc, rssi, rssi_min, rssi_max, reads = _TAG.unpack_from(payload, offset)
+        offset += _TAG.size
+        tag = {
+            "epc": epc.hex(),
+            "rssi_dbm": rssi,
+            "rssi_min": rssi_min,
+            "rssi_max": rssi_max,
+            "reads": reads,
+        }
+        if has_times:
+            tag["seen_ms"] = list(_TAG_TIME.unpack_from(payload, offset))
+            offset += _TAG_TIME.size
+        tags.append(tag)
+
+    if is_delta:
+        removed = []
+        for _ in range(removed_count):
+            removed.append(payload[offset:offset + _EPC_SIZE].hex())
+            offset += _EPC_SIZE
+        rfid = {
+            "tag_count": tag_total,
+            "delta": {
+                "base_cycle": base_cycle,
+                "added": tags[:added_count],
+                "changed": tags[added_count:],
+                "removed": removed,
+            },
+        }
+    else:
+        rfid = {"tag_count": tag_count, "tags": tags}
+    if flags & FLAG_SUPPRESSED:
+        rfid = {"tag_count": rfid.pop("tag_count"), "suppressed": True, **rfid}
+
+    uwb = {"n_anchors": anchor_count, "anchors": anchors}
+    if position is not None:
+        uwb["position"] = position
+
+    data = {"polling_cycle": cycle, "timestamp": timestamp}
+    if epoch_us:
+        data["epoch_us"] = epoch_us
+    data["uwb"] = uwb
+    data["rfid"] = rfid
+    return data
+
+
+def lz4_block_decompress(block: bytes, size: int) -> bytes:
+    """
+    Decode one LZ4 block (no frame header) that must expand to exactly size bytes.
+    """
+    out = bytearray()
+    i = 0
+    try:
+        while True:
+            token = block[i]
+            i += 1
+            literals = token >> 4
+            if literals == 15:
+                while True:
+                    literals += block[i]
+                    i += 1
+                    if block[i - 1] != 255:
+                        break
+            if i + literals > len(block):
+                raise FrameError("LZ4 literals run past the block")
+            out += block[i:i + literals]
+            i += literals
+            if i == len(block):
+                break  # The last sequence has no match
+
+            offset = block[i] | (block[i + 1] << 8)
+            i += 2
+            if offset == 0 or offset > len(out):
+                raise FrameError(f"LZ4 match offset {offset} outside the {len(out)} bytes decoded")
+            match = token & 0x0F
+            if match == 15:
+                while True:
+                    match += block[i]
+                    i += 1
+                    if block[i - 1] != 255:
+                        break
+            match += 4
+            start = len(out) - offset
+            if offset >= match:
+                out += out[start:start + match]
+            else:
+                for k in range(match):  # Overlapping copy repeats the last offset bytes
+                    out.append(out[start + k])
+            if len(out) > size:
+                break
+    except IndexError:
+        raise FrameError("LZ4 block truncated") from None
+
+    if len(out) != size:
+        raise FrameError(f"LZ4 block expands to {len(out)} bytes, expected {size}")
+    return bytes(out)
+
+
+def decode_cycle_batch(payload: bytes) -> tuple:
+    """
+    Decode a batch: backlog, or live cycles (LZ4-compressed if flagged).
+
+    Returns (sent_at, cycles): the device time the batch was sent and the
+    decoded cycles, oldest first. A cycle's age at send time is
+    (sent_at - cycle["timestamp"]) milliseconds, modulo 2^32; cycles recorded
+    after SNTP synced also carry their wall time, "epoch_us".
+    """
+    if len(payload) < _BATCH_HEADER.size:
+        raise FrameError(f"batch too short: {len(payload)} bytes")
+
+    magic, version, flags, frame_count, _, sent_at = _BATCH_HEADER.unpack_from(payload, 0)
+    if magic != BATCH_MAGIC:
+        raise FrameError(f"bad batch magic {magic!r}")
+    if version != BATCH_VERSION:
+        raise FrameError(f"unsupported batch version {version}")
+    if flags & ~BATCH_FLAG_LZ4:
+        raise FrameError(f"unsupported batch flags 0x{flags:02x}")
+
+    if flags & BATCH_FLAG_LZ4:
+        if len(payload) < _BATCH_HEADER.size + _BATCH_RAW_LENGTH.size:
+            raise FrameError(f"compressed batch too short: {len(payload)} bytes")
+        (raw_length,) = _BATCH_RAW_LENGTH.unpack_from(payload, _BATCH_HEADER.size)
+        block = payload[_BATCH_HEADER.size + _BATCH_RAW_LENGTH.size:]
+        payload = payload[:_BATCH_HEADER.size] + lz4_block_decompress(block, raw_length)
+
+    offset = _BATCH_HEADER.size
+    cycles = []
+    for _ in range(frame_count):
+        if offset + _BATCH_ENTRY.size > len(payload):
+            raise FrameError(f"batch truncated after {len(cycles)} of {frame_count} frames")
+        (length,) = _BATCH_ENTRY.unpack_from(payload, offset)
+        offset += _BATCH_ENTRY.size
+        if offset + length > len(payload):
+            raise FrameError(f"batch truncated after {len(cycles)} of {frame_count} frames")
+        cycles.append(decode_cycle_frame(payload[offset:offset + length]))
+        offset += length
+
+    if offset != len(payload):
+        raise FrameError(f"{len(payload) - offset} trailing bytes after {frame_count} frames")
+    return sent_at, cycles
@@ -0,0 +1,98 @@
+"""
+Maps the firmware's device time (millis() since boot) to wall time.
+
+The reader publishes two production streams at different rates: RFID cycles
+(store/production, every 0.5-3 s) and single UWB sessions
+(store/production/uwb, 5-10 Hz). Both carry device time. Stamping each
+message with the time it was received would put the two streams on different
+timelines (a large cycle spends longer in transit than a small session), so
+both are mapped through one offset estimated here.
+
+The offset is received_at - device_time. Transit delay only ever makes an
+observed offset larger, so the estimate follows the smallest one seen and may
+creep up by MAX_DRIFT to follow a device crystal that runs slow. A device time
+that goes back by more than MAX_BACKSTEP_MS (reboot, millis() wrap) restarts
+the estimate. A smaller step back is an older message arriving late - a cycle
+of a live batch (PUBLISH_BATCH) after newer UWB sessions - and is mapped with
+the current estimate.
+
+Once the reader's SNTP clock has synced, cycles carry "epoch_us", the wall
+time at their timestamp. sync() then pins the offset to it, so both streams
+get the device's own wall time and transit delay no longer matters.
+"""
+
+from datetime import datetime, timedelta
+from typing import Optional
+
+MAX_DRIFT = 1e-4  # 100 ppm: well above ESP32 crystal tolerance
+MAX_BACKSTEP_MS = 10_000  # Older messages than this arrive late only after a reboot: batch age bound + margin
+
+UNIX_EPOCH = datetime(1970, 1, 1)
+
+
+def from_epoch_us(epoch_us: int) -> datetime:
+    """Naive UTC datetime (as datetime.utcnow()) for microseconds since 1970"""
+    return UNIX_EPOCH + timedelta(microseconds=epoch_us)
+
+
+class DeviceClock:
+    """Wall-time estimate for one reader's millis() clock."""
+
+    def __init__(self):
+        self._offset: Optional[timedelta] = None
+        self._last_device_ms: Optional[int] = None
+        self._synced = False
+
+    @property
+    def synced(self) -> bool:
+        return self._synced
+
+    def reset(self):
+        self._offset = None
+        self._last_device_ms = None
+        self._synced = False
+
+    def sync(self, device_ms: int, epoch_us: int):
+        """
+        The device clock read device_ms at wall time epoch_us (its SNTP time).
+        Replaces the transit-delay estimate until the device reboots.
+        """
+        if self._rebooted(device_ms):
+            self.reset()
+        self._offset = from_epoch_us(epoch_us) - timedelta(milliseconds=device_ms)
+        self._synced = True
+        if self._last_device_ms is None or device_ms > self._last_device_ms:
+            self._last_device_ms = device_ms
+
+    def to_wall(self, device_ms: int, received_at: datetime) -> datetime:
+        """
+        Wall time at which the device clock read device_ms, given the
+        message carrying it arrived at received_at. Never later than received_at,
+        unless the device's own SNTP time is known (sync()).
+        """
+        if self._rebooted(device_ms):
+            self.reset()  # Rebooted (or millis() wrapped): old offset is meaningless
+
+        late = self._last_device_ms is not None and device_ms < self._last_device_ms
+        if self._synced:
+            if not late:
+                self._last_device_ms = device_ms
+            return self._offset + timedelta(milliseconds=device_ms)
+
+        observed = received_at - timedelta(milliseconds=device_ms)
+        if late:
+            # Older than the last message: still a transit observation, but no drift allowance
+            self._offset = min(observed, self._offset)
+            return self._offset + timedelta(milliseconds=device_ms)
+        if self._offset is None:
+            self._offset = observed
+        else:
+            elapsed_ms = device_ms - self._last_device_ms
+            drifted = self._offset + timedelta(milliseconds=elapsed_ms * MAX_DRIFT)
+            self._offset = min(observed, drifted)
+
+        self._last_device_ms = device_ms
+        return self._offset + timedelta(milliseconds=device_ms)
+
+    def _rebooted(self, device_ms: int) -> bool:
+        return self._last_device_ms is not None and device_ms < self._last_device_ms - MAX_BACKSTEP_MS
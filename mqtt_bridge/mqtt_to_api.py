@@ -5,7 +5,12 @@ import sys
 import time
 import requests
 import paho.mqtt.client as mqtt
-from datetime import datetime
+from datetime import datetime, timedelta
+
+from binary_codec import FrameError, decode_cycle_batch, decode_cycle_frame
+from device_clock import DeviceClock, from_epoch_us
+from presence_events import presence_to_backend
+from tag_state import TagStateTracker
 
 # Configuration from environment variables
 MQTT_BROKER_HOST = os.environ.get("MQTT_BROKER", "localhost")
@@ -15,36 +20,73 @@ API_URL = os.environ["API_URL"]
 # Mode-aware topic configuration
 TOPIC_SIMULATION = "store/simulation"
 TOPIC_PRODUCTION = "store/production"
+TOPIC_PRODUCTION_BIN = "store/production/bin"  # Binary cycle frames (see binary_codec.py)
+TOPIC_PRODUCTION_BACKLOG = "store/production/backlog"  # Cycles queued by the firmware while offline
+TOPIC_PRODUCTION_BATCH = "store/production/batch"  # Live cycles, several per message (firmware PUBLISH_BATCH)
+TOPIC_PRODUCTION_CONTROL = "store/production/control"  # START/STOP/KEYFRAME to the firmware
+TOPIC_PRODUCTION_ANCHORS = "store/production/anchors/"  # + MAC: retained "x,y" (cm) for the on-device solver
+TOPIC_PRODUCTION_UWB = "store/production/uwb"  # High-rate UWB stream: one session per message
+TOPIC_PRODUCTION_PRESENCE = "store/production/presence"  # Edge presence events (see presence_events.py)
+
+# Which production encoding to forward ("json", "binary" or "batch"). The firmware can publish
+# several during a migration; the bridge consumes only one so cycles are not stored twice.
+PRODUCTION_FORMAT = os.environ.get("PRODUCTION_FORMAT", "json").lower()
+TOPIC_PRODUCTION_ACTIVE = {
+    "binary": TOPIC_PRODUCTION_BIN,
+    "batch": TOPIC_PRODUCTION_BATCH,
+}.get(PRODUCTION_FORMAT, TOPIC_PRODUCTION)
+
+# Readers built with PRESENCE_EVENTS decide appeared/missing themselves. Cycles are then
+# forwarded with "edge_presence" so the backend does not run its own missing detection on them.
+EDGE_PRESENCE = os.environ.get("EDGE_PRESENCE", "0") == "1"
+
+# Full tag set behind the firmware's delta cycles
+tag_state = TagStateTracker()
+
+# Device time -> wall time, shared by the cycle and UWB streams so they line up
+device_clock = DeviceClock()
 
 # Cache for current system mode
 _cached_mode = None
 _last_mode_check = 0
 MODE_CHECK_INTERVAL = 5  # seconds
 
+# Anchor coordinates last published per MAC, so only changes are sent
+_anchor_payloads = {}
+_last_anchor_sync = 0
+ANCHOR_SYNC_INTERVAL = 30  # seconds
+
 print(f"🔌 MQTT Bridge starting...")
 print(f"   Broker: {MQTT_BROKER_HOST}:{MQTT_BROKER_PORT}")
-print(f"   Mode-aware topics: {TOPIC_SIMULATION}, {TOPIC_PRODUCTION}")
+print(f"   Mode-aware topics: {TOPIC_SIMULATION}, {TOPIC_PRODUCTION_ACTIVE}, {TOPIC_PRODUCTION_BACKLOG}")
+print(f"   Missing detection: {'on the reader (' + TOPIC_PRODUCTION_PRESENCE + ')' if EDGE_PRESENCE else 'backend'}")
 print(f"   API: {API_URL}")
 
 
-def transform_hardware_to_backend(hardware_data: dict) -> dict:
+def transform_hardware_to_backend(hardware_data: dict, captured_at: datetime = None) -> dict:
     """
     Transform hardware JSON format to backend API format.
     
+    captured_at is the wall time of the cycle, if known (see cycle_wall_time());
+    otherwise the cycle is stamped with the time it is received.
+    
     Hardware format:
     {
         "polling_cycle": 1,
         "timestamp": 123456,  # milliseconds since boot
+        "epoch_us": 1764680400123456,  # wall time at timestamp, once the device's SNTP has synced
         "uwb": {
             "n_anchors": 2,
             "anchors": [
-                {"mac_address": "0xABCD", "average_distance_cm": 150.5, "measurements": 3, "total_sessions": 5}
+                {"mac_address": "0xABCD", "average_distance_cm": 150.5, "median_distance_cm": 150.0,
+                 "stddev_cm": 2.1, "min_cm": 147, "max_cm": 155, "measurements": 3, "total_sessions": 5}
             ]
         },
         "rfid": {
             "tag_count": 2,
             "tags": [
-                {"epc": "E200001234567890ABCD", "rssi_dbm": -45, "pc": "3000"}
+                {"epc": "E200001234567890ABCD", "rssi_dbm": -45, "rssi_min": -49, "rssi_max": -42, "reads": 6,
+                 "seen_ms": [480, 12]}  # first/last read, ms before timestamp
             ]
         }
     }
@@ -56,12 +98,13 @@ def transform_hardware_to_backend(hardware_data: dict) -> dict:
             {"product_id": "RFID001", "product_name": "Unknown", "status": "present"}
         ],
         "uwb_measurements": [
-            {"mac_address": "0x0001", "distance_cm": 150.5, "status": "0x01"}
+            {"mac_address": "0x0001", "distance_cm": 150.0, "status": "0x01", "variance_cm2": 4.41}
         ]
     }
     """
     # Generate ISO timestamp
-    timestamp = datetime.utcnow().isoformat() + "Z"
+    captured_at = captured_at or datetime.utcnow()
+    timestamp = captured_at.isoformat() + "Z"
     
     # Transform RFID tags to detections
     detections = []
@@ -70,19 +113,24 @@ def transform_hardware_to_backend(hardware_data: dict) -> dict:
     
     for tag in tags:
         epc = tag.get("epc", "")
-        rssi = tag.get("rssi_dbm", 0)
+        rssi = tag.get("rssi_dbm", 0)  # Mean RSSI over all reads of the tag in this cycle
         
         # Use EPC as product_id (this is the RFID tag identifier)
         # NOTE: We don't send status - if an item is detected, it's implicitly present.
         # The backend's missing detection logic will infer missing items based on
         # what's NOT in this detection list.
-        detections.append({
+        detection = {
             "product_id": epc,
             "product_name": f"Item-{epc[-8:]}" if epc else "Unknown",
             "x_position": None,  # Will be calculated by triangulation
             "y_position": None,
             "rssi_dbm": rssi  # Extra field for signal strength
-        })
+        }
+        seen_ms = tag.get("seen_ms")
+        if seen_ms is not None:
+            detection["first_seen"] = (captured_at - timedelta(milliseconds=seen_ms[0])).isoformat() + "Z"
+            detection["last_seen"] = (captured_at - timedelta(milliseconds=seen_ms[1])).isoformat() + "Z"
+        detections.append(detection)
     
     # Transform UWB anchors to measurements
     uwb_measurements = []
@@ -101,17 +149,203 @@ def transform_hardware_to_backend(hardware_data: dict) -> dict:
             
             # Only include anchors with valid measurements
             if avg_distance is not None and measurements_count > 0:
-                uwb_measurements.append({
+                measurement = {
                     "mac_address": mac,
-                    "distance_cm": avg_distance,
+                    # Median resists multipath outliers; firmware without statistics sends the mean only
+                    "distance_cm": anchor.get("median_distance_cm", avg_distance),
                     "status": "0x01"  # OK status
-                })
+                }
+                if anchor.get("stddev_cm") is not None:
+                    measurement["variance_cm2"] = anchor["stddev_cm"] ** 2
+                uwb_measurements.append(measurement)
     
-    return {
+    packet = {
         "timestamp": timestamp,
         "detections": detections,
         "uwb_measurements": uwb_measurements
     }
+    
+    # Fix solved on the device: the backend stores it instead of trilaterating
+    position = uwb_section.get("position")
+    if position is not None:
+        packet["position"] = {
+            "x": position["x_cm"],
+            "y": position["y_cm"],
+            "confidence": position["confidence"],
+            "num_anchors": position["n_anchors"]
+        }
+    
+    return packet
+
+
+def cycle_wall_time(cycle: dict, received_at: datetime) -> datetime:
+    """
+    Wall time of a live cycle. A cycle with the device's SNTP time ("epoch_us")
+    also syncs the clock that stamps the UWB stream.
+    """
+    if cycle.get("epoch_us"):
+        device_clock.sync(cycle["timestamp"], cycle["epoch_us"])
+    return device_clock.to_wall(cycle["timestamp"], received_at)
+
+
+def uwb_sample_to_backend(sample: dict, captured_at: datetime) -> dict:
+    """
+    Transform one session of the firmware UWB stream to the backend's /data/uwb format.
+    
+    Hardware format:
+    {"session": 42, "timestamp": 123456,
+     "ranges": [{"mac_address": "0x0001", "distance_cm": 245}],
+     "position": {"x_cm": 412.3, "y_cm": 188.0, "confidence": 0.82, "n_anchors": 4}}
+    
+    "position" is present only if the device solved a fix from this session.
+    """
+    packet = {
+        "timestamp": captured_at.isoformat() + "Z",
+        "uwb_measurements": [
+            {"mac_address": r["mac_address"], "distance_cm": r["distance_cm"], "status": "0x01"}
+            for r in sample.get("ranges", [])
+        ]
+    }
+    position = sample.get("position")
+    if position is not None:
+        packet["position"] = {
+            "x": position["x_cm"],
+            "y": position["y_cm"],
+            "confidence": position["confidence"],
+            "num_anchors": position["n_anchors"]
+        }
+    return packet
+
+
+def forward_uwb_sample(payload: bytes, received_at: datetime):
+    """Post one UWB session to the backend; quiet, it arrives several times a second"""
+    sample = json.loads(payload.decode('utf-8'))
+    captured_at = device_clock.to_wall(sample["timestamp"], received_at)
+    response = requests.post(f"{API_URL}/data/uwb", json=uwb_sample_to_backend(sample, captured_at), timeout=2)
+    if response.status_code != 200:
+        print(f"⚠️  API returned status {response.status_code} for UWB session {sample.get('session')}: {response.text}")
+
+
+def forward_presence(payload: bytes, received_at: datetime):
+    """Post a batch of edge presence events to the backend"""
+    message = json.loads(payload.decode('utf-8'))
+    packet = presence_to_backend(message, cycle_wall_time(message, received_at))
+    if message.get("dropped"):
+        print(f"⚠️  Reader dropped {message['dropped']} presence events since boot (queue full)")
+    response = requests.post(f"{API_URL}/data/presence", json=packet, timeout=5)
+    if response.status_code == 200:
+        result = response.json()
+        print(f"✅ Presence events forwarded: {result.get('appeared', 0)} appeared, {result.get('missing', 0)} missing")
+    else:
+        print(f"⚠️  API returned status {response.status_code} for presence events: {response.text}")
+
+
+def backlog_to_backend(payload: bytes, received_at: datetime) -> list:
+    """
+    Expand a firmware backlog batch into backend packets, oldest first.
+    
+    Each cycle's wall time is its SNTP time ("epoch_us") if the device had
+    synced when it was recorded. Otherwise it is recovered from its age on the
+    device clock when the batch was sent: received_at - (sent_at - timestamp).
+    """
+    sent_at, cycles = decode_cycle_batch(payload)
+    packets = []
+    for cycle in cycles:
+        if cycle.get("epoch_us"):
+            captured_at = from_epoch_us(cycle["epoch_us"])
+        else:
+            age_ms = (sent_at - cycle["timestamp"]) & 0xFFFFFFFF
+            captured_at = received_at - timedelta(milliseconds=age_ms)
+        packets.append(transform_hardware_to_backend(cycle, captured_at))
+    return packets
+
+
+def batch_to_backend(payload: bytes, received_at: datetime) -> list:
+    """
+    Expand a batch of live cycles into backend packets, oldest first.
+    
+    The cycles are recent, so they go through the device clock like single
+    cycles, each as if it had arrived when the batch was sent minus its age:
+    received_at - (sent_at - timestamp). Their epoch_us syncs it as usual.
+    """
+    sent_at, cycles = decode_cycle_batch(payload)
+    packets = []
+    for cycle in cycles:
+        age_ms = (sent_at - cycle["timestamp"]) & 0xFFFFFFFF
+        captured_at = cycle_wall_time(cycle, received_at - timedelta(milliseconds=age_ms))
+        packets.append(transform_hardware_to_backend(cycle, captured_at))
+    return packets
+
+
+def post_cycles(packets: list, label: str):
+    """Post expanded cycles to the backend, in order"""
+    stored = 0
+    for packet in packets:
+        packet["edge_presence"] = EDGE_PRESENCE
+        response = requests.post(f"{API_URL}/data", json=packet, timeout=5)
+        if response.status_code == 201:
+            stored += 1
+        else:
+            print(f"⚠️  API returned status {response.status_code}: {response.text}")
+    print(f"✅ {label} forwarded: {stored}/{len(packets)} cycles "
+          f"({packets[0]['timestamp'] if packets else '-'} .. {packets[-1]['timestamp'] if packets else '-'})")
+
+
+def forward_backlog(payload: bytes):
+    """Post every cycle of a backlog batch to the backend, in order"""
+    post_cycles(backlog_to_backend(payload, datetime.utcnow()), "Backlog batch")
+
+
+def forward_batch(payload: bytes, received_at: datetime):
+    """Post every cycle of a live batch to the backend, in order"""
+    post_cycles(batch_to_backend(payload, received_at), "Cycle batch")
+
+
+def anchor_position_messages(anchors: list, published: dict) -> list:
+    """
+    Retained messages that bring the firmware's anchor map in line with the
+    backend's anchors: (topic, payload) for every new or moved active anchor,
+    and an empty payload (clears the retained message) for anchors that were
+    removed or deactivated. Updates published in place.
+    """
+    current = {}
+    for anchor in anchors:
+        if anchor.get("is_active", True):
+            current[anchor["mac_address"]] = f"{anchor['x_position']:.1f},{anchor['y_position']:.1f}"
+    
+    messages = []
+    for mac, payload in current.items():
+        if published.get(mac) != payload:
+            messages.append((TOPIC_PRODUCTION_ANCHORS + mac, payload))
+    for mac in list(published):
+        if mac not in current:
+            messages.append((TOPIC_PRODUCTION_ANCHORS + mac, ""))
+    
+    published.clear()
+    published.update(current)
+    return messages
+
+
+def sync_anchor_positions(client, force: bool = False):
+    """Publish anchor coordinates for the on-device position solver (rate limited)."""
+    global _last_anchor_sync
+    
+    current_time = time.time()
+    if not force and (current_time - _last_anchor_sync) < ANCHOR_SYNC_INTERVAL:
+        return
+    _last_anchor_sync = current_time
+    if force:
+        _anchor_payloads.clear()  # Broker may have lost retained messages; send the full map
+    
+    try:
+        response = requests.get(f"{API_URL}/anchors", timeout=2)
+        if response.status_code != 200:
+            return
+        for topic, payload in anchor_position_messages(response.json(), _anchor_payloads):
+            client.publish(topic, payload, qos=1, retain=True)
+            print(f"📍 Anchor {topic[len(TOPIC_PRODUCTION_ANCHORS):]} -> {payload or 'removed'}")
+    except Exception as e:
+        print(f"⚠️  Anchor sync failed: {e}")
 
 
 def get_system_mode() -> str:
@@ -150,18 +384,35 @@ def on_connect(client, userdata, flags, rc):
         # Subscribe to both simulation and production topics
         # Messages will be filtered based on current mode in on_message
         client.subscribe(TOPIC_SIMULATION)
-        client.subscribe(TOPIC_PRODUCTION)
+        # The reader publishes cycles at QoS 1; subscribe at 1 so the broker keeps it end to end
+        client.subscribe(TOPIC_PRODUCTION_ACTIVE, qos=1)
+        client.subscribe(TOPIC_PRODUCTION_BACKLOG, qos=1)
+        client.subscribe(TOPIC_PRODUCTION_UWB)  # QoS 0: a lost session is superseded by the next
+        client.subscribe(TOPIC_PRODUCTION_PRESENCE, qos=1)  # State changes: not repeated by the reader
         print(f"📡 Subscribed to topic: {TOPIC_SIMULATION}")
-        print(f"📡 Subscribed to topic: {TOPIC_PRODUCTION}")
+        print(f"📡 Subscribed to topic: {TOPIC_PRODUCTION_ACTIVE}")
+        print(f"📡 Subscribed to topic: {TOPIC_PRODUCTION_BACKLOG}")
+        print(f"📡 Subscribed to topic: {TOPIC_PRODUCTION_UWB}")
+        print(f"📡 Subscribed to topic: {TOPIC_PRODUCTION_PRESENCE}")
         print(f"🔍 Mode-aware filtering enabled: Messages filtered by system mode")
+        sync_anchor_positions(client, force=True)
     else:
         print(f"❌ Failed to connect to MQTT broker. Return code: {rc}")
 
 def on_message(client, userdata, msg):
     """Callback when message received from MQTT"""
     try:
+        received_at = datetime.utcnow()
+        
         # Get current system mode
         current_mode = get_system_mode()
+        sync_anchor_positions(client)
+        
+        # High-rate UWB stream: live position only, handled before the per-message logging
+        if msg.topic == TOPIC_PRODUCTION_UWB:
+            if current_mode == "PRODUCTION":
+                forward_uwb_sample(msg.payload, received_at)
+            return
         
         # If in SIMULATION mode and receiving simulation topic messages,
         # check if simulation is actually running
@@ -177,24 +428,51 @@ def on_message(client, userdata, msg):
                 # If can't check status, continue processing (fail-safe)
                 pass
         
-        # Decode and parse the message
-        payload = msg.payload.decode('utf-8')
         print(f"\n📥 Received message on {msg.topic} (System mode: {current_mode})")
         
         # Filter messages based on mode
         if current_mode == "SIMULATION" and msg.topic != TOPIC_SIMULATION:
             print(f"   ⏭️  Skipping {msg.topic} message (system in SIMULATION mode, expecting {TOPIC_SIMULATION})")
             return
-        elif current_mode == "PRODUCTION" and msg.topic != TOPIC_PRODUCTION:
-            print(f"   ⏭️  Skipping {msg.topic} message (system in PRODUCTION mode, expecting {TOPIC_PRODUCTION})")
+        elif current_mode == "PRODUCTION" and msg.topic not in (TOPIC_PRODUCTION_ACTIVE, TOPIC_PRODUCTION_BACKLOG,
+                                                                TOPIC_PRODUCTION_PRESENCE):
+            print(f"   ⏭️  Skipping {msg.topic} message (system in PRODUCTION mode, expecting {TOPIC_PRODUCTION_ACTIVE})")
             return
         
-        data = json.loads(payload)
+        # Edge presence events: applied by the backend as they are
+        if msg.topic == TOPIC_PRODUCTION_PRESENCE:
+            forward_presence(msg.payload, received_at)
+            return
+        
+        # Cycles queued by the firmware during an outage: full sets with their original times
+        if msg.topic == TOPIC_PRODUCTION_BACKLOG:
+            forward_backlog(msg.payload)
+            return
+        
+        # Live cycles batched by the firmware: full sets, possibly LZ4-compressed
+        if msg.topic == TOPIC_PRODUCTION_BATCH:
+            forward_batch(msg.payload, received_at)
+            return
+        
+        # Decode and parse the message
+        if msg.topic == TOPIC_PRODUCTION_BIN:
+            data = decode_cycle_frame(msg.payload)  # Same dict shape as the JSON payload
+        else:
+            data = json.loads(msg.payload.decode('utf-8'))
         
         # Check if this is hardware format and transform if needed
         if is_hardware_format(data):
             print(f"   📟 Hardware format detected (polling_cycle: {data.get('polling_cycle', '?')})")
             
+            # Expand delta cycles to the full tag set; resync with a keyframe if one was missed
+            is_delta = "delta" in data.get("rfid", {})
+            if not tag_state.apply(data):
+                print(f"   ⏭️  Dropping delta cycle (no matching base cycle), requesting keyframe")
+                client.publish(TOPIC_PRODUCTION_CONTROL, "KEYFRAME")
+                return
+            if is_delta:
+                print(f"   🔁 Delta expanded to {data['rfid']['tag_count']} tags")
+            
             # Log raw hardware data
             rfid_count = data.get("rfid", {}).get("tag_count", 0)
             uwb_section = data.get("uwb", {})
@@ -202,8 +480,9 @@ def on_message(client, userdata, msg):
             print(f"   🏷️  RFID tags: {rfid_count}")
             print(f"   📏 UWB anchors: {uwb_count}")
             
-            # Transform to backend format
-            data = transform_hardware_to_backend(data)
+            # Transform to backend format, on the same timeline as the UWB stream
+            data = transform_hardware_to_backend(data, cycle_wall_time(data, received_at))
+            data["edge_presence"] = EDGE_PRESENCE
             print(f"   ✅ Transformed to backend format")
             print(f"      Detections: {len(data['detections'])}")
             print(f"      UWB measurements: {len(data['uwb_measurements'])}")
@@ -231,6 +510,9 @@ def on_message(client, userdata, msg):
     except json.JSONDecodeError as e:
         print(f"❌ Invalid JSON received: {e}")
         print(f"   Raw payload: {msg.payload[:200]}")
+    except FrameError as e:
+        print(f"❌ Invalid binary frame received: {e}")
+        print(f"   Raw payload: {msg.payload[:64].hex()}")
     except requests.exceptions.RequestException as e:
         print(f"❌ Failed to forward data to API: {e}")
     except Exception as e:
@@ -0,0 +1,52 @@
+"""
+Edge presence events (firmware/code_esp32/PRESENCE_TABLE.h).
+
+With PRESENCE_EVENTS the reader keeps the presence state of its zone itself
+and publishes only the changes on store/production/presence:
+
+    {"timestamp": 123456, "epoch_us": 1764680400123456,
+     "events": [{"epc": "e200...", "event": "appeared", "age_ms": 0, "x_cm": 425, "y_cm": 175},
+                {"epc": "e200...", "event": "missing", "age_ms": 500}],
+     "dropped": 0}
+
+"timestamp" is device millis() of the last cycle folded in, "epoch_us" its
+wall time once the device has synced. Each event happened age_ms before it;
+x_cm/y_cm is the centre of the cell the tag was last read in, absent if it
+was never read with a fix. "dropped" counts events the reader lost to a
+full queue since boot.
+
+The backend takes the events on /data/presence and applies them as they
+are, instead of running its missing-item detection on every cycle.
+"""
+
+from datetime import datetime, timedelta
+
+EVENT_TYPES = ("appeared", "missing")
+
+
+def presence_to_backend(message: dict, captured_at: datetime) -> dict:
+    """
+    Transform one presence message to the backend's /data/presence format.
+    captured_at is the wall time of the message's "timestamp"; unknown event
+    types are skipped.
+
+    Backend format:
+    {"events": [{"product_id": "E200...", "event": "appeared", "timestamp": "2025-12-02T13:00:00Z",
+                 "x_position": 425.0, "y_position": 175.0}],
+     "dropped": 0}
+    """
+    events = []
+    for event in message.get("events", []):
+        if event.get("event") not in EVENT_TYPES or not event.get("epc"):
+            continue
+        at = captured_at - timedelta(milliseconds=event.get("age_ms", 0))
+        entry = {
+            "product_id": event["epc"],
+            "event": event["event"],
+            "timestamp": at.isoformat() + "Z",
+        }
+        if event.get("x_cm") is not None and event.get("y_cm") is not None:
+            entry["x_position"] = float(event["x_cm"])
+            entry["y_position"] = float(event["y_cm"])
+        events.append(entry)
+    return {"events": events, "dropped": message.get("dropped", 0)}
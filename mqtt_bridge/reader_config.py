@@ -0,0 +1,132 @@
+"""
+Run-time reader config (firmware/code_esp32/READER_CONFIG.h).
+
+A "CONFIG v=<version> rev=<n> key=value ..." message on store/production/control
+changes reader parameters between two cycles, without reflashing. The reader
+saves an applied config to NVS and answers on store/production/status:
+
+    {"config":{"status":"applied","request":7,"v":1,"rev":7,"poll_count":6,...}}
+
+The schema below mirrors the firmware's; a message is checked against it
+before it goes out, since the reader rejects it whole for one bad key.
+
+Usage:
+    python reader_config.py get                                  # print the running config
+    python reader_config.py set 7 tx_power=2400 window_ms=400    # revision 7, two fields changed
+    python reader_config.py set 8 --defaults                     # back to the compiled-in values
+"""
+
+import argparse
+import json
+import os
+import sys
+import time
+from typing import Dict, Optional
+
+TOPIC_CONTROL = "store/production/control"
+TOPIC_STATUS = "store/production/status"
+
+VERSION = 1
+
+# key: (min, max), as READER_CONFIG.cpp FIELDS
+SCHEMA = {
+    "poll_count": (1, 100),
+    "window_ms": (100, 10000),
+    "tx_power": (500, 3000),
+    "uwb_fresh_ms": (100, 60000),
+    "region": (1, 4),
+    "mixer_gain": (0, 6),
+    "if_gain": (0, 7),
+    "threshold": (0, 0xFFFF),
+}
+
+
+def config_message(revision: int, values: Optional[Dict[str, int]] = None, defaults: bool = False) -> str:
+    """
+    CONFIG payload for one revision. With defaults the reader starts from its
+    compiled-in values; keys in values apply on top either way.
+    """
+    if not 1 <= revision <= 0xFFFFFFFF:
+        raise ValueError(f"Revision out of range: {revision}")
+    tokens = ["CONFIG", f"v={VERSION}", f"rev={revision}"]
+    if defaults:
+        tokens.append("DEFAULTS")
+    for key, value in (values or {}).items():
+        if key not in SCHEMA:
+            raise ValueError(f"Unknown config key: {key}")
+        low, high = SCHEMA[key]
+        if not isinstance(value, int) or not low <= value <= high:
+            raise ValueError(f"{key} must be an integer in {low}-{high}, got {value!r}")
+        tokens.append(f"{key}={value}")
+    return " ".join(tokens)
+
+
+def parse_ack(payload) -> Optional[dict]:
+    """The "config" object of a TOPIC_STATUS message, or None for telemetry reports."""
+    try:
+        message = json.loads(payload)
+    except (TypeError, ValueError):
+        return None
+    if not isinstance(message, dict) or not isinstance(message.get("config"), dict):
+        return None
+    return message["config"]
+
+
+def _connect():
+    import paho.mqtt.client as mqtt
+
+    client = mqtt.Client(client_id=f"optiflow-config-{os.getpid()}")
+    client.connect(os.environ.get("MQTT_BROKER", "localhost"), int(os.environ.get("MQTT_PORT", "1883")), 60)
+    return client
+
+
+def request(message: str, timeout: float) -> int:
+    """Send a CONFIG message and print the reader's answer."""
+    acks = []
+    client = _connect()
+
+    def on_message(_client, _userdata, msg):
+        ack = parse_ack(msg.payload)
+        if ack is not None:
+            acks.append(ack)
+
+    client.on_message = on_message
+    client.subscribe(TOPIC_STATUS)
+    client.loop_start()
+    client.publish(TOPIC_CONTROL, message, qos=1).wait_for_publish()
+    deadline = time.time() + timeout
+    while not acks and time.time() < deadline:
+        time.sleep(0.1)
+    client.loop_stop()
+    client.disconnect()
+
+    if not acks:
+        print(f"❌ No answer within {timeout:.0f} s")
+        return 1
+    ack = acks[0]
+    print(json.dumps(ack, indent=2))
+    return 0 if ack.get("status") in ("applied", "current") else 1
+
+
+def main(argv=None) -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--timeout", type=float, default=10)
+    commands = parser.add_subparsers(dest="command", required=True)
+    commands.add_parser("get", help="Print the running config")
+    set_parser = commands.add_parser("set", help="Send a new config revision")
+    set_parser.add_argument("revision", type=int)
+    set_parser.add_argument("values", nargs="*", metavar="key=value")
+    set_parser.add_argument("--defaults", action="store_true", help="Start from the compiled-in values")
+    args = parser.parse_args(argv)
+
+    if args.command == "get":
+        return request("CONFIG", args.timeout)
+    values = {}
+    for item in args.values:
+        key, _, value = item.partition("=")
+        values[key] = int(value)
+    return request(config_message(args.revision, values, args.defaults), args.timeout)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,96 @@
+"""
+Reconstructs full tag sets from the firmware's incremental (delta) cycles.
+
+With PUBLISH_DELTAS enabled the firmware sends the full tag list only on
+keyframes. Other cycles carry "rfid": {"tag_count", "delta": {"base_cycle",
+"added", "changed", "removed"}} relative to the previous published cycle.
+The backend still expects every cycle to list all tags that were seen (it
+infers missing items from absence), so the bridge expands deltas here.
+
+A delta is applied only if its base_cycle is the last cycle this tracker
+accepted. Otherwise a message was lost (or the bridge restarted) and the
+caller should ask the firmware for a keyframe.
+
+Cycles flagged "suppressed" ran with the reader's inventory filter silencing
+recently read tags, so a tag missing from them has not left. Their deltas
+remove nothing, and their full lists are merged into the stored set instead
+of replacing it.
+
+A tag's read times ("seen_ms", relative to its cycle's timestamp) are only
+kept on tags the message itself carries; carried-over tags lose them.
+"""
+
+from typing import Dict, Optional
+
+
+def _carried_over(tag: dict) -> dict:
+    """A tag not in this message: its read times belong to an earlier cycle"""
+    if "seen_ms" not in tag:
+        return tag
+    return {key: value for key, value in tag.items() if key != "seen_ms"}
+
+
+class TagStateTracker:
+    """Current tag set of one reader, keyed by EPC."""
+
+    def __init__(self):
+        self._tags: Dict[str, dict] = {}
+        self._cycle: Optional[int] = None
+
+    @property
+    def last_cycle(self) -> Optional[int]:
+        """Polling cycle of the last keyframe or delta applied, None before the first keyframe."""
+        return self._cycle
+
+    def reset(self):
+        """Forget the current set; the next delta will be rejected until a keyframe arrives."""
+        self._tags.clear()
+        self._cycle = None
+
+    def apply(self, data: dict) -> bool:
+        """
+        Bring a hardware-format cycle up to date.
+
+        Keyframes replace the stored set (suppressed ones are merged into it).
+        Deltas are merged into it and the message's "rfid" section is
+        rewritten in place to the full {"tag_count", "tags"} form.
+
+        Returns False if the delta cannot be applied (no baseline, its
+        base_cycle is not the last applied cycle, or the result does not match
+        the firmware's tag_count). The stored set is then dropped so only a
+        keyframe is accepted next.
+        """
+        rfid = data.get("rfid", {})
+        delta = rfid.get("delta")
+
+        if delta is None:
+            tags = {tag["epc"]: tag for tag in rfid.get("tags", [])}
+            self._cycle = data.get("polling_cycle")
+            if not rfid.get("suppressed"):
+                self._tags = tags
+                return True
+            self._tags = {epc: _carried_over(tag) for epc, tag in self._tags.items()}
+            self._tags.update(tags)
+            merged = list(self._tags.values())
+            data["rfid"] = {"tag_count": len(merged), "tags": merged}
+            return True
+
+        if self._cycle is None or delta.get("base_cycle") != self._cycle:
+            self.reset()
+            return False
+
+        self._tags = {epc: _carried_over(tag) for epc, tag in self._tags.items()}
+        for epc in delta.get("removed", []):
+            self._tags.pop(epc, None)
+        for tag in delta.get("added", []):
+            self._tags[tag["epc"]] = tag
+        for tag in delta.get("changed", []):
+            self._tags[tag["epc"]] = tag
+        if len(self._tags) != rfid.get("tag_count", len(self._tags)):
+            self.reset()  # Diverged from the firmware's set
+            return False
+        self._cycle = data.get("polling_cycle")
+
+        tags = list(self._tags.values())
+        data["rfid"] = {"tag_count": len(tags), "tags": tags}
+        return True
@@ -0,0 +1,190 @@
+"""
+UART traces to and from the firmware's capture ring (firmware/code_esp32/UART_CAPTURE.h).
+
+The reader records what its RFID and UWB UARTs deliver and, on CAPTURE STOP
+or CAPTURE UPLOAD, publishes it on store/production/trace as host trace text
+("<ms> <R|U> <hex>" lines, firmware/host/UART_TRACE.h) cut into parts. The
+same parts, sent to store/production/trace/load, load a trace for REPLAY.
+
+Every part opens with "# part <n>"; the last one carries "# end <parts>".
+Uploads go out at QoS 0, so a lost part shows up as a gap in the numbers.
+
+Usage:
+    python trace_capture.py fetch out.trace [--timeout 60]   # CAPTURE UPLOAD and save the trace
+    python trace_capture.py load in.trace                    # send a trace for REPLAY / REPLAY MAX
+"""
+
+import argparse
+import os
+import re
+import sys
+import time
+from typing import List, Optional
+
+TOPIC_CONTROL = "store/production/control"
+TOPIC_TRACE = "store/production/trace"
+TOPIC_TRACE_LOAD = "store/production/trace/load"
+
+# The firmware takes incoming messages into a 512-byte buffer (MQTT_BUFFER_SIZE),
+# topic and packet header included
+LOAD_PART_BYTES = 448
+
+_PART = re.compile(r"# part (\d+)")
+_END = re.compile(r"# end (\d+)")
+
+
+class TraceGapError(ValueError):
+    """An upload part is missing or out of order."""
+
+
+class TraceAssembler:
+    """Joins the parts of one upload back into the trace text."""
+
+    def __init__(self):
+        self.reset()
+
+    def reset(self):
+        self._parts: List[str] = []
+        self._total: Optional[int] = None
+
+    @property
+    def complete(self) -> bool:
+        return self._total is not None and len(self._parts) == self._total
+
+    def feed(self, payload) -> bool:
+        """
+        Add one TOPIC_TRACE message. Returns True once the last part is in.
+        Part 0 starts a new upload; any other part must follow the previous one.
+        """
+        text = payload.decode("ascii") if isinstance(payload, (bytes, bytearray)) else payload
+        header, _, body = text.partition("\n")
+        match = _PART.fullmatch(header.strip())
+        if not match:
+            raise ValueError(f"Not a trace part: {header[:40]!r}")
+
+        number = int(match.group(1))
+        if number == 0:
+            self.reset()
+        elif self.complete or number != len(self._parts):
+            expected = len(self._parts)
+            self.reset()
+            raise TraceGapError(f"Got part {number}, expected {expected}")
+
+        lines = []
+        for line in body.splitlines():
+            end = _END.fullmatch(line.strip())
+            if end:
+                self._total = int(end.group(1))
+            else:
+                lines.append(line)
+        self._parts.append("".join(line + "\n" for line in lines))
+
+        if self._total is not None and self._total != len(self._parts):
+            total = self._total
+            self.reset()
+            raise TraceGapError(f"Upload ended after {total} parts, received {number + 1}")
+        return self.complete
+
+    def text(self) -> str:
+        """The trace, once complete."""
+        if not self.complete:
+            raise ValueError("Upload incomplete")
+        return "".join(self._parts)
+
+
+def load_messages(trace: str, max_bytes: int = LOAD_PART_BYTES) -> List[bytes]:
+    """
+    Cut trace text into TOPIC_TRACE_LOAD messages of at most max_bytes
+    (a longer line gets a part of its own). Comments other than "# anchor" are dropped.
+    """
+    lines = [
+        line.strip()
+        for line in trace.splitlines()
+        if line.strip() and (not line.lstrip().startswith("#") or line.lstrip().startswith("# anchor"))
+    ]
+
+    messages: List[bytes] = []
+    index = 0
+    while index < len(lines) or not messages:
+        part = f"# part {len(messages)}\n"
+        start = index
+        while index < len(lines):
+            line = lines[index] + "\n"
+            if index > start and len(part) + len(line) > max_bytes:
+                break
+            part += line
+            index += 1
+        if index >= len(lines):
+            part += f"# end {len(messages) + 1}\n"
+        messages.append(part.encode("ascii"))
+    return messages
+
+
+def _connect():
+    import paho.mqtt.client as mqtt
+
+    client = mqtt.Client(client_id=f"optiflow-trace-{os.getpid()}")
+    client.connect(os.environ.get("MQTT_BROKER", "localhost"), int(os.environ.get("MQTT_PORT", "1883")), 60)
+    return client
+
+
+def fetch(path: str, timeout: float) -> int:
+    assembler = TraceAssembler()
+    client = _connect()
+
+    def on_message(_client, _userdata, msg):
+        try:
+            assembler.feed(msg.payload)
+        except ValueError as e:
+            print(f"⚠️  {e} - requesting the upload again")
+            client.publish(TOPIC_CONTROL, "CAPTURE UPLOAD")
+
+    client.on_message = on_message
+    client.subscribe(TOPIC_TRACE)
+    client.publish(TOPIC_CONTROL, "CAPTURE UPLOAD")
+    client.loop_start()
+    deadline = time.time() + timeout
+    while not assembler.complete and time.time() < deadline:
+        time.sleep(0.1)
+    client.loop_stop()
+    client.disconnect()
+
+    if not assembler.complete:
+        print(f"❌ No complete trace within {timeout:.0f} s")
+        return 1
+    with open(path, "w") as f:
+        f.write(assembler.text())
+    print(f"✅ Trace saved to {path}")
+    return 0
+
+
+def load(path: str) -> int:
+    with open(path) as f:
+        messages = load_messages(f.read())
+    client = _connect()
+    client.loop_start()
+    for message in messages:
+        client.publish(TOPIC_TRACE_LOAD, message, qos=1).wait_for_publish()
+    client.loop_stop()
+    client.disconnect()
+    print(f"✅ Sent {path} in {len(messages)} parts - send REPLAY or REPLAY MAX to play it")
+    return 0
+
+
+def main(argv=None) -> int:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+    fetch_parser = commands.add_parser("fetch", help="Request the capture and save it")
+    fetch_parser.add_argument("path")
+    fetch_parser.add_argument("--timeout", type=float, default=60)
+    load_parser = commands.add_parser("load", help="Send a trace to the reader for replay")
+    load_parser.add_argument("path")
+    args = parser.parse_args(argv)
+
+    if args.command == "fetch":
+        return fetch(args.path, args.timeout)
+    return load(args.path)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,316 @@
+#!/usr/bin/env python3
+"""
+Unit tests for the MQTT bridge binary cycle frame decoder
+Checks the decoder against a frame produced by the firmware encoder
+
+Run with: pytest tests/unit/test_binary_codec.py -v
+Or: pytest -m unit
+"""
+
+import pytest
+import struct
+import sys
+from pathlib import Path
+
+# Add mqtt_bridge to path
+bridge_path = Path(__file__).parent.parent.parent / "mqtt_bridge"
+sys.path.insert(0, str(bridge_path))
+
+from binary_codec import FrameError, decode_cycle_batch, decode_cycle_frame, is_binary_frame, lz4_block_decompress
+
+# CycleSerializer::writeBinary() output for: cycle 7, timestamp 123456,
+# anchors 0x0001 (245 + 246 cm) and 0x0002 (1000 cm), 0x1a2b without a distance,
+# and two tags
+FIRMWARE_FRAME = bytes.fromhex(
+    "4f4601000700000040e20100020002000100970902000200020010270100010"
+    "0e2000017220b0123456789abccc4d00700000102030405060708090a0bbab9bb2c01"
+)
+
+# CycleSerializer::writeJson() output for the same record
+FIRMWARE_JSON = {
+    "polling_cycle": 7,
+    "timestamp": 123456,
+    "uwb": {
+        "n_anchors": 2,
+        "anchors": [
+            {"mac_address": "0x0001", "average_distance_cm": 245.5, "measurements": 2, "total_sessions": 2},
+            {"mac_address": "0x0002", "average_distance_cm": 1000.0, "measurements": 1, "total_sessions": 1},
+        ],
+    },
+    "rfid": {
+        "tag_count": 2,
+        "tags": [
+            {"epc": "e2000017220b0123456789ab", "rssi_dbm": -52, "rssi_min": -60, "rssi_max": -48, "reads": 7},
+            {"epc": "000102030405060708090a0b", "rssi_dbm": -70, "rssi_min": -71, "rssi_max": -69, "reads": 300},
+        ],
+    },
+}
+
+
+# writeBinary() with a TagDeltaTracker: cycle 2 against cycle 1, tag ...04 added,
+# ...02 changed, ...03 removed, three tags in total
+FIRMWARE_DELTA_FRAME = bytes.fromhex(
+    "4f46010102000000d00700000200000001000000030001000100000000000000000000000000"
+    "0004d8d7d90300000000000000000000000002bebdbf0300000000000000000000000003"
+)
+
+FIRMWARE_DELTA_JSON = {
+    "polling_cycle": 2,
+    "timestamp": 2000,
+    "uwb": {"n_anchors": 0, "anchors": []},
+    "rfid": {
+        "tag_count": 3,
+        "delta": {
+            "base_cycle": 1,
+            "added": [
+                {"epc": "000000000000000000000004", "rssi_dbm": -40, "rssi_min": -41, "rssi_max": -39, "reads": 3},
+            ],
+            "changed": [
+                {"epc": "000000000000000000000002", "rssi_dbm": -66, "rssi_min": -67, "rssi_max": -65, "reads": 3},
+            ],
+            "removed": ["000000000000000000000003"],
+        },
+    },
+}
+
+# FIRMWARE_FRAME's record with an on-device fix: (412.3, -18.6) cm, confidence 0.82,
+# 4 anchors, solved 40 ms before the cycle closed
+FIRMWARE_POSITION_FRAME = bytes.fromhex(
+    "4f4601020700000040e20100020002009c01edffd10428000100970902000200020010270100010"
+    "0e2000017220b0123456789abccc4d00700000102030405060708090a0bbab9bb2c01"
+)
+
+# FIRMWARE_FRAME's record as sent with per-anchor distance statistics (flag bit 2)
+FIRMWARE_STATS_FRAME = bytes.fromhex(
+    "4f4601040700000040e2010002000200010097090200020097090700f500f600020010270100010010270000e803e803"
+    "e2000017220b0123456789abccc4d00700000102030405060708090a0bbab9bb2c01"
+)
+
+# FIRMWARE_STATS_FRAME's record as sent after SNTP synced (flag bit 4): wall time
+# 1764680400123456 us, anchor sessions 35 and 156 ms before the timestamp, tag reads
+# 476..16 ms and 0..0 ms before it
+FIRMWARE_TIMES_FRAME = bytes.fromhex(
+    "4f4601140700000040e2010002000200403664acf7440600"
+    "010097090200020097090700f500f6002300"
+    "020010270100010010270000e803e8039c00"
+    "e2000017220b0123456789abccc4d00700dc011000"
+    "000102030405060708090a0bbab9bb2c0100000000"
+)
+
+# CycleBacklog::writeBatch() output: the FIRMWARE_FRAME cycle and an empty cycle 8
+# (timestamp 123956), sent at device time 133956
+FIRMWARE_BATCH = bytes.fromhex(
+    "4f42010002000000440b0200"
+    "4200" + FIRMWARE_FRAME.hex() +
+    "10004f4601000800000034e4010000000000"
+)
+
+EPC_A0 = "e2000017220b0123456789a0"
+
+# CycleBatcher::seal() output with BATCH_COMPRESS: cycles 1..3 (timestamps 1000, 1500, 2000),
+# each with tags ...a0, ...a1, ...a2 (-50 dBm, 5 reads), sent at 2500; 267 bytes of entries
+FIRMWARE_LZ4_BATCH = bytes.fromhex(
+    "4f42010103000000c40900000b010000"
+    "f60157004f46011401000000e803000003000100f101e2000017220b0123456789a0cec4d8051a000715001fa115"
+    "000115a215000259006f02000000dc0559004000aa002fd007590035500000000000"
+)
+
+
+@pytest.mark.unit
+class TestDecodeCycleFrame:
+    """Unit tests for decode_cycle_frame"""
+
+    def test_decodes_firmware_frame_like_json(self):
+        """A binary frame should decode to the same dict as the JSON payload"""
+        assert decode_cycle_frame(FIRMWARE_FRAME) == FIRMWARE_JSON
+
+    def test_is_binary_frame(self):
+        """Frames are recognised by magic, JSON is not"""
+        assert is_binary_frame(FIRMWARE_FRAME)
+        assert not is_binary_frame(b'{"polling_cycle": 1}')
+
+    def test_empty_cycle(self):
+        """A header-only frame has no anchors and no tags"""
+        frame = struct.pack("<2sBBIIHBB", b"OF", 1, 0, 3, 1000, 0, 0, 0)
+        data = decode_cycle_frame(frame)
+        assert data["rfid"] == {"tag_count": 0, "tags": []}
+        assert data["uwb"] == {"n_anchors": 0, "anchors": []}
+
+    def test_rejects_bad_magic(self):
+        """Should reject payloads that are not cycle frames"""
+        with pytest.raises(FrameError):
+            decode_cycle_frame(b"XX" + FIRMWARE_FRAME[2:])
+
+    def test_rejects_unknown_version(self):
+        """Should reject frames from a newer encoder"""
+        with pytest.raises(FrameError):
+            decode_cycle_frame(FIRMWARE_FRAME[:2] + b"\x02" + FIRMWARE_FRAME[3:])
+
+    def test_rejects_unknown_flags(self):
+        """Flags from a newer firmware are reported, not read as a length mismatch"""
+        flagged = bytearray(FIRMWARE_FRAME)
+        flagged[3] |= 0x20
+        with pytest.raises(FrameError, match="flags 0x20"):
+            decode_cycle_frame(bytes(flagged))
+
+    def test_rejects_truncated_frame(self):
+        """Length must match the counts in the header"""
+        with pytest.raises(FrameError):
+            decode_cycle_frame(FIRMWARE_FRAME[:-1])
+        with pytest.raises(FrameError):
+            decode_cycle_frame(FIRMWARE_FRAME[:10])
+
+    def test_decodes_delta_frame_like_json(self):
+        """A delta frame should decode to the same dict as the JSON delta payload"""
+        assert decode_cycle_frame(FIRMWARE_DELTA_FRAME) == FIRMWARE_DELTA_JSON
+
+    def test_rejects_truncated_delta_frame(self):
+        """Removed EPCs are part of the expected length"""
+        with pytest.raises(FrameError):
+            decode_cycle_frame(FIRMWARE_DELTA_FRAME[:-12])
+        with pytest.raises(FrameError):
+            decode_cycle_frame(FIRMWARE_DELTA_FRAME[:20])
+
+    def test_decodes_position_extension(self):
+        """The fix is rounded to whole cm and lands under uwb.position"""
+        data = decode_cycle_frame(FIRMWARE_POSITION_FRAME)
+        assert data["uwb"]["position"] == {
+            "x_cm": 412.0, "y_cm": -19.0, "confidence": 0.82, "n_anchors": 4, "age_ms": 40,
+        }
+        data["uwb"].pop("position")
+        assert data == FIRMWARE_JSON
+
+    def test_decodes_anchor_statistics(self):
+        """Statistics entries decode into the JSON anchor fields"""
+        data = decode_cycle_frame(FIRMWARE_STATS_FRAME)
+        first, second = data["uwb"]["anchors"]
+        assert first == {"mac_address": "0x0001", "average_distance_cm": 245.5, "median_distance_cm": 245.5,
+                         "stddev_cm": 0.7, "min_cm": 245, "max_cm": 246, "measurements": 2, "total_sessions": 2}
+        assert second["median_distance_cm"] == 1000.0
+        assert second["stddev_cm"] == 0.0
+        assert data["rfid"] == FIRMWARE_JSON["rfid"]
+
+    def test_rejects_frame_without_statistics_flag(self):
+        """Statistics entries change the anchor size, so the flag must match the length"""
+        with pytest.raises(FrameError):
+            decode_cycle_frame(FIRMWARE_STATS_FRAME[:3] + b"\x00" + FIRMWARE_STATS_FRAME[4:])
+
+    def test_decodes_suppressed_flag(self):
+        """A cycle run with session suppression says so in its rfid section"""
+        data = decode_cycle_frame(FIRMWARE_STATS_FRAME[:3] + b"\x0c" + FIRMWARE_STATS_FRAME[4:])
+        assert data["rfid"]["suppressed"] is True
+        data["rfid"].pop("suppressed")
+        assert data["rfid"] == FIRMWARE_JSON["rfid"]
+        assert "suppressed" not in decode_cycle_frame(FIRMWARE_STATS_FRAME)["rfid"]
+
+    def test_decodes_read_times(self):
+        """The time extension gives the wall time, anchor ages and tag read times, as in the JSON"""
+        data = decode_cycle_frame(FIRMWARE_TIMES_FRAME)
+        assert data["epoch_us"] == 1764680400123456
+        assert list(data) == ["polling_cycle", "timestamp", "epoch_us", "uwb", "rfid"]
+        assert [anchor["age_ms"] for anchor in data["uwb"]["anchors"]] == [35, 156]
+        assert [tag["seen_ms"] for tag in data["rfid"]["tags"]] == [[476, 16], [0, 0]]
+        for tag in data["rfid"]["tags"]:
+            tag.pop("seen_ms")
+        assert data["rfid"] == FIRMWARE_JSON["rfid"]
+
+    def test_unsynced_clock_has_no_epoch(self):
+        """epoch_us 0 means the device has no wall time yet"""
+        frame = FIRMWARE_TIMES_FRAME[:16] + bytes(8) + FIRMWARE_TIMES_FRAME[24:]
+        data = decode_cycle_frame(frame)
+        assert "epoch_us" not in data
+        assert data["rfid"]["tags"][0]["seen_ms"] == [476, 16]
+
+    def test_rejects_truncated_time_frame(self):
+        """The time extension and the per-entry times are part of the expected length"""
+        with pytest.raises(FrameError):
+            decode_cycle_frame(FIRMWARE_TIMES_FRAME[:-4])
+        with pytest.raises(FrameError):
+            decode_cycle_frame(FIRMWARE_TIMES_FRAME[:20])
+        with pytest.raises(FrameError):
+            decode_cycle_frame(FIRMWARE_TIMES_FRAME[:3] + b"\x04" + FIRMWARE_TIMES_FRAME[4:])
+
+    def test_rejects_truncated_position_frame(self):
+        """The extension is part of the expected length"""
+        with pytest.raises(FrameError):
+            decode_cycle_frame(FIRMWARE_POSITION_FRAME[:-1])
+        with pytest.raises(FrameError):
+            decode_cycle_frame(FIRMWARE_POSITION_FRAME[:20])
+
+
+@pytest.mark.unit
+class TestDecodeCycleBatch:
+    """Unit tests for decode_cycle_batch"""
+
+    def test_decodes_firmware_batch(self):
+        """Frames come back oldest first, with the device send time"""
+        sent_at, cycles = decode_cycle_batch(FIRMWARE_BATCH)
+        assert sent_at == 133956
+        assert len(cycles) == 2
+        assert cycles[0] == FIRMWARE_JSON
+        assert cycles[1]["polling_cycle"] == 8
+        assert sent_at - cycles[1]["timestamp"] == 10000
+
+    def test_rejects_bad_batch_magic(self):
+        """A single cycle frame is not a batch"""
+        with pytest.raises(FrameError):
+            decode_cycle_batch(FIRMWARE_FRAME)
+
+    def test_rejects_truncated_batch(self):
+        """Every announced frame must be present, with nothing trailing"""
+        with pytest.raises(FrameError):
+            decode_cycle_batch(FIRMWARE_BATCH[:-1])
+        with pytest.raises(FrameError):
+            decode_cycle_batch(FIRMWARE_BATCH + b"\x00")
+
+    def test_decodes_compressed_batch(self):
+        """An LZ4 batch expands to its frames, in order"""
+        sent_at, cycles = decode_cycle_batch(FIRMWARE_LZ4_BATCH)
+        assert sent_at == 2500
+        assert [c["polling_cycle"] for c in cycles] == [1, 2, 3]
+        assert [c["timestamp"] for c in cycles] == [1000, 1500, 2000]
+        for cycle in cycles:
+            tags = cycle["rfid"]["tags"]
+            assert [t["epc"] for t in tags] == [EPC_A0[:-1] + d for d in "012"]
+            assert all(t["rssi_dbm"] == -50 and t["reads"] == 5 for t in tags)
+
+    def test_compressed_matches_uncompressed(self):
+        """The flag only changes the encoding of the entries"""
+        raw = bytearray(FIRMWARE_LZ4_BATCH[:12])
+        raw[3] = 0
+        raw += lz4_block_decompress(FIRMWARE_LZ4_BATCH[16:], 267)
+        assert decode_cycle_batch(bytes(raw)) == decode_cycle_batch(FIRMWARE_LZ4_BATCH)
+
+    def test_rejects_corrupt_compressed_batch(self):
+        """A block that is cut short or expands to the wrong length is not a batch"""
+        with pytest.raises(FrameError):
+            decode_cycle_batch(FIRMWARE_LZ4_BATCH[:-3])
+        wrong_length = FIRMWARE_LZ4_BATCH[:12] + struct.pack("<I", 268) + FIRMWARE_LZ4_BATCH[16:]
+        with pytest.raises(FrameError):
+            decode_cycle_batch(wrong_length)
+
+    def test_rejects_unknown_batch_flags(self):
+        """Flags from a newer firmware are not guessed at"""
+        flagged = bytearray(FIRMWARE_BATCH)
+        flagged[3] = 0x02
+        with pytest.raises(FrameError):
+            decode_cycle_batch(bytes(flagged))
+
+
+@pytest.mark.unit
+class TestLz4BlockDecompress:
+    """Unit tests for lz4_block_decompress"""
+
+    def test_literals_only(self):
+        """A block of a single sequence is its literals"""
+        assert lz4_block_decompress(b"\x50hello", 5) == b"hello"
+
+    def test_overlapping_match(self):
+        """A match may overlap the bytes it copies (run-length)"""
+        # 1 literal "a", then offset 1, match 4 + 5 = 9, then 0 trailing literals
+        assert lz4_block_decompress(b"\x15a\x01\x00\x00", 10) == b"a" * 10
+
+    def test_rejects_offset_before_start(self):
+        """A match cannot reach back past the decoded bytes"""
+        with pytest.raises(FrameError):
+            lz4_block_decompress(b"\x10a\x02\x00\x00", 5)
@@ -0,0 +1,108 @@
+#!/usr/bin/env python3
+"""
+Unit tests for the MQTT bridge device clock
+Tests mapping of firmware millis() timestamps to a common wall-time timeline
+
+Run with: pytest tests/unit/test_device_clock.py -v
+Or: pytest -m unit
+"""
+
+import pytest
+import sys
+from datetime import datetime, timedelta
+from pathlib import Path
+
+# Add mqtt_bridge to path
+bridge_path = Path(__file__).parent.parent.parent / "mqtt_bridge"
+sys.path.insert(0, str(bridge_path))
+
+from device_clock import DeviceClock, from_epoch_us
+
+
+BOOT = datetime(2025, 12, 2, 13, 0, 0)
+
+
+def ms(value):
+    return timedelta(milliseconds=value)
+
+
+@pytest.mark.unit
+class TestDeviceClock:
+    """Unit tests for DeviceClock"""
+
+    def test_first_message_maps_to_receive_time(self):
+        """With one observation the transit delay is unknown"""
+        clock = DeviceClock()
+        assert clock.to_wall(5000, BOOT + ms(5040)) == BOOT + ms(5040)
+
+    def test_follows_fastest_transit(self):
+        """A later message with less delay improves the estimate for every stream"""
+        clock = DeviceClock()
+        clock.to_wall(5000, BOOT + ms(5300))       # Large cycle, slow in transit
+        clock.to_wall(5100, BOOT + ms(5110))       # Small UWB session
+        assert abs(clock.to_wall(6000, BOOT + ms(6400)) - (BOOT + ms(6010))) < ms(1)
+
+    def test_never_later_than_receive_time(self):
+        """Mapped times do not run ahead of the message that carried them"""
+        clock = DeviceClock()
+        clock.to_wall(1000, BOOT + ms(1200))
+        for device_ms in range(1100, 3000, 100):
+            received = BOOT + ms(device_ms + 5)
+            assert clock.to_wall(device_ms, received) <= received
+
+    def test_streams_line_up(self):
+        """A cycle and a session taken at the same device time get the same wall time"""
+        clock = DeviceClock()
+        clock.to_wall(10000, BOOT + ms(10005))
+        session = clock.to_wall(12000, BOOT + ms(12008))
+        cycle = clock.to_wall(12000, BOOT + ms(12250))
+        assert session == cycle
+
+    def test_tracks_slow_device_clock(self):
+        """The offset may grow by the drift allowance when the device runs slow"""
+        clock = DeviceClock()
+        clock.to_wall(0, BOOT)
+        # After 1000s of device time, wall time is 50ms ahead (50 ppm slow crystal)
+        mapped = clock.to_wall(1_000_000, BOOT + ms(1_000_050))
+        assert mapped == BOOT + ms(1_000_050)
+
+    def test_reboot_restarts_estimate(self):
+        """Device time going backwards means a new boot"""
+        clock = DeviceClock()
+        clock.to_wall(900000, BOOT + ms(900000))
+        reboot = BOOT + timedelta(hours=1)
+        assert clock.to_wall(2000, reboot + ms(2000)) == reboot + ms(2000)
+
+    def test_late_batch_keeps_estimate(self):
+        """Batched cycles older than the UWB sessions already seen are not a reboot"""
+        clock = DeviceClock()
+        clock.to_wall(10000, BOOT + ms(10005))          # UWB sessions, fast in transit
+        clock.to_wall(10900, BOOT + ms(10905))
+        # Batch sent at 11000 and received at 11050: cycles taken at 10000 and 10500
+        for device_ms in (10000, 10500):
+            mapped = clock.to_wall(device_ms, BOOT + ms(11050) - ms(11000 - device_ms))
+            assert abs(mapped - (BOOT + ms(device_ms + 5))) < ms(1)
+        # The next session still maps with the offset of the fastest transit
+        assert abs(clock.to_wall(11100, BOOT + ms(11140)) - (BOOT + ms(11105))) < ms(1)
+
+    def test_sync_uses_device_wall_time(self):
+        """With the device's SNTP time the mapping no longer depends on transit delay"""
+        clock = DeviceClock()
+        clock.to_wall(5000, BOOT + ms(5300))
+        epoch_us = int((BOOT + ms(6000) - datetime(1970, 1, 1)) / timedelta(microseconds=1))
+        clock.sync(6000, epoch_us)
+        assert clock.synced
+        assert clock.to_wall(6000, BOOT + ms(6400)) == BOOT + ms(6000)
+        assert clock.to_wall(6100, BOOT + ms(6105)) == BOOT + ms(6100)  # UWB session on the same timeline
+
+    def test_reboot_forgets_sync(self):
+        """A new boot falls back to the estimate until the next synced cycle"""
+        clock = DeviceClock()
+        clock.sync(900000, int((BOOT - datetime(1970, 1, 1)) / timedelta(microseconds=1)))
+        reboot = BOOT + timedelta(hours=1)
+        assert clock.to_wall(2000, reboot + ms(2000)) == reboot + ms(2000)
+        assert not clock.synced
+
+    def test_from_epoch_us(self):
+        """Epoch microseconds map to naive UTC"""
+        assert from_epoch_us(1764680400123456) == datetime(2025, 12, 2, 13, 0, 0, 123456)
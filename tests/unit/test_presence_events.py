@@ -0,0 +1,77 @@
+#!/usr/bin/env python3
+"""
+Unit tests for the MQTT bridge presence event transform
+Tests turning edge presence messages (firmware PRESENCE_TABLE.h) into /data/presence packets
+
+Run with: pytest tests/unit/test_presence_events.py -v
+Or: pytest -m unit
+"""
+
+import pytest
+import sys
+from datetime import datetime
+from pathlib import Path
+
+# Add mqtt_bridge to path
+bridge_path = Path(__file__).parent.parent.parent / "mqtt_bridge"
+sys.path.insert(0, str(bridge_path))
+
+from presence_events import presence_to_backend
+
+
+CAPTURED_AT = datetime(2025, 12, 2, 13, 0, 0)
+EPC = "e2000017221101441890abcd"
+
+
+@pytest.mark.unit
+class TestPresenceToBackend:
+    """Unit tests for presence_to_backend"""
+
+    def test_appeared_with_cell(self):
+        """An event read with a fix carries the cell centre as the item position"""
+        message = {"timestamp": 123456, "events": [
+            {"epc": EPC, "event": "appeared", "age_ms": 0, "x_cm": 425, "y_cm": 175}
+        ], "dropped": 0}
+        packet = presence_to_backend(message, CAPTURED_AT)
+        assert packet["events"] == [{
+            "product_id": EPC,
+            "event": "appeared",
+            "timestamp": "2025-12-02T13:00:00Z",
+            "x_position": 425.0,
+            "y_position": 175.0,
+        }]
+
+    def test_missing_without_cell(self):
+        """A tag never read with a fix has no position"""
+        message = {"timestamp": 123456, "events": [{"epc": EPC, "event": "missing", "age_ms": 0}]}
+        event = presence_to_backend(message, CAPTURED_AT)["events"][0]
+        assert event["event"] == "missing"
+        assert "x_position" not in event and "y_position" not in event
+
+    def test_age_moves_the_event_back(self):
+        """age_ms is before the message timestamp"""
+        message = {"timestamp": 123456, "events": [{"epc": EPC, "event": "missing", "age_ms": 1500}]}
+        event = presence_to_backend(message, CAPTURED_AT)["events"][0]
+        assert event["timestamp"] == "2025-12-02T12:59:58.500000Z"
+
+    def test_events_keep_their_order(self):
+        """The reader publishes oldest first; a later event for the same tag wins"""
+        message = {"timestamp": 1000, "events": [
+            {"epc": EPC, "event": "missing", "age_ms": 500},
+            {"epc": EPC, "event": "appeared", "age_ms": 0, "x_cm": 25, "y_cm": 25},
+        ]}
+        events = presence_to_backend(message, CAPTURED_AT)["events"]
+        assert [e["event"] for e in events] == ["missing", "appeared"]
+
+    def test_unknown_events_skipped(self):
+        """Event types from a newer firmware, or without an EPC, are not forwarded"""
+        message = {"timestamp": 1000, "events": [
+            {"epc": EPC, "event": "moved", "age_ms": 0},
+            {"event": "appeared", "age_ms": 0},
+        ]}
+        assert presence_to_backend(message, CAPTURED_AT)["events"] == []
+
+    def test_dropped_passed_on(self):
+        """Events lost on the reader are reported to the backend"""
+        packet = presence_to_backend({"timestamp": 1000, "events": [], "dropped": 7}, CAPTURED_AT)
+        assert packet == {"events": [], "dropped": 7}
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""
+Unit tests for the MQTT bridge reader config helpers
+Tests building CONFIG messages and reading their acks (firmware READER_CONFIG.h)
+
+Run with: pytest tests/unit/test_reader_config.py -v
+Or: pytest -m unit
+"""
+
+import re
+import pytest
+import sys
+from pathlib import Path
+
+# Add mqtt_bridge to path
+bridge_path = Path(__file__).parent.parent.parent / "mqtt_bridge"
+sys.path.insert(0, str(bridge_path))
+
+from reader_config import SCHEMA, VERSION, config_message, parse_ack
+
+FIRMWARE_DIR = Path(__file__).parent.parent.parent / "firmware" / "code_esp32"
+
+
+@pytest.mark.unit
+class TestConfigMessage:
+    """Unit tests for config_message"""
+
+    def test_version_and_revision_lead(self):
+        """Every message names the schema version and its revision"""
+        assert config_message(7, {"tx_power": 2400, "window_ms": 400}) == (
+            f"CONFIG v={VERSION} rev=7 tx_power=2400 window_ms=400"
+        )
+
+    def test_defaults_token(self):
+        """DEFAULTS comes before the keys so they apply on top"""
+        assert config_message(8, {"poll_count": 3}, defaults=True) == f"CONFIG v={VERSION} rev=8 DEFAULTS poll_count=3"
+
+    def test_rejects_unknown_key(self):
+        """The reader would reject the whole message"""
+        with pytest.raises(ValueError):
+            config_message(1, {"tx_powr": 2400})
+
+    def test_rejects_out_of_range(self):
+        """Values outside the schema never go out"""
+        with pytest.raises(ValueError):
+            config_message(1, {"tx_power": 3100})
+        with pytest.raises(ValueError):
+            config_message(1, {"mixer_gain": -1})
+
+    def test_rejects_revision_zero(self):
+        """Revision 0 stands for the compiled-in defaults"""
+        with pytest.raises(ValueError):
+            config_message(0, {})
+
+    def test_schema_matches_firmware(self):
+        """The bridge checks against the same keys and ranges the firmware does"""
+        source = (FIRMWARE_DIR / "READER_CONFIG.cpp").read_text()
+        header = (FIRMWARE_DIR / "READER_CONFIG.h").read_text()
+        constants = dict(re.findall(r"#define (\w+)\s+(\d+)", header))
+        fields = {}
+        for key, low, high in re.findall(r'CONFIG_FIELD\("(\w+)", \w+, (\w+), (\w+)\)', source):
+            fields[key] = tuple(int(constants.get(v, v), 0) for v in (low, high))
+        assert fields == SCHEMA
+        assert int(constants["READER_CONFIG_VERSION"]) == VERSION
+
+
+@pytest.mark.unit
+class TestParseAck:
+    """Unit tests for parse_ack"""
+
+    def test_config_ack(self):
+        """The config object comes back as a dict"""
+        payload = b'{"config":{"status":"applied","request":7,"v":1,"rev":7,"tx_power":2400}}'
+        ack = parse_ack(payload)
+        assert ack["status"] == "applied"
+        assert ack["rev"] == 7
+
+    def test_telemetry_is_not_an_ack(self):
+        """Status reports share the topic"""
+        assert parse_ack(b'{"uptime_ms":1000,"rfid":{"poll_level":0,"config_rev":7}}') is None
+
+    def test_malformed_payload(self):
+        """Anything that is not JSON is ignored"""
+        assert parse_ack(b"\x00\x01") is None
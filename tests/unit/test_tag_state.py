@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""
+Unit tests for the MQTT bridge tag state tracker
+Tests expansion of firmware delta cycles back into full tag sets
+
+Run with: pytest tests/unit/test_tag_state.py -v
+Or: pytest -m unit
+"""
+
+import pytest
+import sys
+from pathlib import Path
+
+# Add mqtt_bridge to path
+bridge_path = Path(__file__).parent.parent.parent / "mqtt_bridge"
+sys.path.insert(0, str(bridge_path))
+
+from tag_state import TagStateTracker
+
+
+def tag(epc, rssi=-50):
+    return {"epc": epc, "rssi_dbm": rssi, "rssi_min": rssi - 2, "rssi_max": rssi + 2, "reads": 4}
+
+
+def keyframe(cycle, tags):
+    return {"polling_cycle": cycle, "timestamp": cycle * 1000,
+            "rfid": {"tag_count": len(tags), "tags": tags}}
+
+
+def delta(cycle, base, total, added=(), changed=(), removed=()):
+    return {"polling_cycle": cycle, "timestamp": cycle * 1000,
+            "rfid": {"tag_count": total, "delta": {"base_cycle": base, "added": list(added),
+                                                   "changed": list(changed), "removed": list(removed)}}}
+
+
+@pytest.mark.unit
+class TestTagStateTracker:
+    """Unit tests for TagStateTracker"""
+
+    def test_keyframe_passes_through(self):
+        """Keyframes are left unchanged and become the baseline"""
+        tracker = TagStateTracker()
+        data = keyframe(1, [tag("aa"), tag("bb")])
+        assert tracker.apply(data)
+        assert data["rfid"]["tags"] == [tag("aa"), tag("bb")]
+        assert tracker.last_cycle == 1
+
+    def test_delta_expands_to_full_set(self):
+        """Added, changed and removed entries are merged into the stored set"""
+        tracker = TagStateTracker()
+        tracker.apply(keyframe(1, [tag("aa"), tag("bb"), tag("cc")]))
+
+        data = delta(2, 1, 3, added=[tag("dd", -40)], changed=[tag("bb", -66)], removed=["cc"])
+        assert tracker.apply(data)
+
+        tags = {t["epc"]: t for t in data["rfid"]["tags"]}
+        assert data["rfid"]["tag_count"] == 3
+        assert set(tags) == {"aa", "bb", "dd"}
+        assert tags["aa"] == tag("aa")          # Unchanged: last published value
+        assert tags["bb"]["rssi_dbm"] == -66
+        assert "delta" not in data["rfid"]
+
+    def test_deltas_chain(self):
+        """Each delta must build on the previous one"""
+        tracker = TagStateTracker()
+        tracker.apply(keyframe(1, [tag("aa")]))
+        assert tracker.apply(delta(2, 1, 2, added=[tag("bb")]))
+        data = delta(3, 2, 1, removed=["aa"])
+        assert tracker.apply(data)
+        assert data["rfid"]["tags"] == [tag("bb")]
+
+    def test_rejects_delta_without_keyframe(self):
+        """A delta before any keyframe cannot be expanded"""
+        tracker = TagStateTracker()
+        assert not tracker.apply(delta(5, 4, 1, added=[tag("aa")]))
+
+    def test_rejects_delta_after_missed_cycle(self):
+        """A gap in the chain drops the state until the next keyframe"""
+        tracker = TagStateTracker()
+        tracker.apply(keyframe(1, [tag("aa")]))
+        assert not tracker.apply(delta(3, 2, 1))
+        assert tracker.last_cycle is None
+        assert not tracker.apply(delta(4, 3, 1))
+
+        assert tracker.apply(keyframe(5, [tag("aa")]))
+        assert tracker.apply(delta(6, 5, 1))
+
+    def test_rejects_delta_with_wrong_total(self):
+        """The expanded set must match the firmware's tag_count"""
+        tracker = TagStateTracker()
+        tracker.apply(keyframe(1, [tag("aa"), tag("bb")]))
+        assert not tracker.apply(delta(2, 1, 3, added=[tag("cc")], removed=["aa"]))
+        assert tracker.last_cycle is None
+
+    def test_suppressed_keyframe_merges(self):
+        """Tags silenced by the inventory filter stay in the set"""
+        tracker = TagStateTracker()
+        tracker.apply(keyframe(1, [tag("aa"), tag("bb")]))
+
+        data = keyframe(2, [tag("bb", -60), tag("cc")])
+        data["rfid"]["suppressed"] = True
+        assert tracker.apply(data)
+
+        tags = {t["epc"]: t for t in data["rfid"]["tags"]}
+        assert data["rfid"]["tag_count"] == 3
+        assert set(tags) == {"aa", "bb", "cc"}
+        assert tags["bb"]["rssi_dbm"] == -60
+        assert "suppressed" not in data["rfid"]
+
+    def test_full_keyframe_after_suppressed_replaces(self):
+        """The next unsuppressed cycle drops tags that really left"""
+        tracker = TagStateTracker()
+        tracker.apply(keyframe(1, [tag("aa"), tag("bb")]))
+        suppressed = keyframe(2, [tag("cc")])
+        suppressed["rfid"]["suppressed"] = True
+        tracker.apply(suppressed)
+
+        assert tracker.apply(keyframe(3, [tag("bb")]))
+        assert tracker.apply(delta(4, 3, 1))
+
+    def test_carried_over_tags_lose_read_times(self):
+        """Read times are relative to the cycle that carried the tag"""
+        tracker = TagStateTracker()
+        seen = dict(tag("aa"), seen_ms=[400, 20])
+        tracker.apply(keyframe(1, [seen, dict(tag("bb"), seen_ms=[300, 10])]))
+        data = delta(2, 1, 2, changed=[dict(tag("bb", -60), seen_ms=[200, 5])])
+        assert tracker.apply(data)
+        tags = {t["epc"]: t for t in data["rfid"]["tags"]}
+        assert "seen_ms" not in tags["aa"]
+        assert tags["bb"]["seen_ms"] == [200, 5]
+        assert seen["seen_ms"] == [400, 20]  # The caller's keyframe is not modified
@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+"""
+Unit tests for the MQTT bridge UART trace helpers
+Tests joining capture uploads and cutting traces into load messages (firmware UART_CAPTURE.h)
+
+Run with: pytest tests/unit/test_trace_capture.py -v
+Or: pytest -m unit
+"""
+
+import pytest
+import sys
+from pathlib import Path
+
+# Add mqtt_bridge to path
+bridge_path = Path(__file__).parent.parent.parent / "mqtt_bridge"
+sys.path.insert(0, str(bridge_path))
+
+from trace_capture import TraceAssembler, TraceGapError, load_messages
+
+
+TRACE = (
+    "# anchor 0x0001 0.0 0.0\n"
+    "# anchor 0x0002 800.0 0.0\n"
+    "0 R bb0122000d\n"
+    "12 U 4d41433a\n"
+    "50 R bb0222001100\n"
+)
+
+
+def upload(*bodies):
+    """Parts as the firmware's writePart() frames them"""
+    parts = [f"# part {i}\n{body}" for i, body in enumerate(bodies)]
+    parts[-1] += f"# end {len(parts)}\n"
+    return [part.encode("ascii") for part in parts]
+
+
+@pytest.mark.unit
+class TestTraceAssembler:
+    """Unit tests for TraceAssembler"""
+
+    def test_joins_parts_in_order(self):
+        """The trace is the part bodies back to back, framing removed"""
+        assembler = TraceAssembler()
+        parts = upload("# OptiFlow UART trace: loaded over MQTT\n0 R bb01\n", "12 U 4d41\n")
+        assert assembler.feed(parts[0]) is False
+        assert assembler.feed(parts[1]) is True
+        assert assembler.text() == "# OptiFlow UART trace: loaded over MQTT\n0 R bb01\n12 U 4d41\n"
+
+    def test_missing_part_is_a_gap(self):
+        """QoS 0 can lose a part; the numbers show it"""
+        assembler = TraceAssembler()
+        parts = upload("0 R bb01\n", "12 U 4d41\n", "20 R bb02\n")
+        assembler.feed(parts[0])
+        with pytest.raises(TraceGapError):
+            assembler.feed(parts[2])
+        assert not assembler.complete
+
+    def test_lost_last_parts_detected_by_end(self):
+        """An end marker naming more parts than arrived rejects the upload"""
+        assembler = TraceAssembler()
+        with pytest.raises(TraceGapError):
+            assembler.feed(b"# part 0\n0 R bb01\n# end 2\n")
+
+    def test_part_zero_restarts(self):
+        """A repeated upload (CAPTURE UPLOAD) replaces a broken one"""
+        assembler = TraceAssembler()
+        first = upload("0 R bb01\n", "12 U 4d41\n")
+        assembler.feed(first[0])
+        second = upload("5 R cc\n")
+        assert assembler.feed(second[0]) is True
+        assert assembler.text() == "5 R cc\n"
+
+    def test_text_before_complete_raises(self):
+        """An incomplete upload has no trace"""
+        assembler = TraceAssembler()
+        assembler.feed(upload("0 R bb01\n", "12 U 4d41\n")[0])
+        with pytest.raises(ValueError):
+            assembler.text()
+
+    def test_rejects_non_part(self):
+        """Only framed parts are accepted"""
+        with pytest.raises(ValueError):
+            TraceAssembler().feed(b"0 R bb01\n")
+
+
+@pytest.mark.unit
+class TestLoadMessages:
+    """Unit tests for load_messages"""
+
+    def test_messages_respect_size_limit(self):
+        """Every message fits the firmware's MQTT buffer"""
+        trace = "".join(f"{i * 10} R {'ab' * 60}\n" for i in range(40))
+        messages = load_messages(trace, max_bytes=448)
+        assert len(messages) > 1
+        assert all(len(message) <= 448 for message in messages)
+
+    def test_framing(self):
+        """Parts are numbered from 0 and only the last carries the end marker"""
+        trace = "".join(f"{i * 10} R {'ab' * 60}\n" for i in range(10))
+        messages = [m.decode("ascii") for m in load_messages(trace, max_bytes=300)]
+        for i, message in enumerate(messages):
+            assert message.startswith(f"# part {i}\n")
+            assert ("# end" in message) == (i == len(messages) - 1)
+        assert messages[-1].endswith(f"# end {len(messages)}\n")
+
+    def test_keeps_anchors_drops_comments(self):
+        """Anchor lines carry the map; other comments are not sent"""
+        messages = load_messages("# shelf walk\n" + TRACE)
+        text = b"".join(messages).decode("ascii")
+        assert "# shelf walk" not in text
+        assert "# anchor 0x0002 800.0 0.0" in text
+
+    def test_round_trip_through_assembler(self):
+        """Load messages use the same framing as uploads"""
+        trace = TRACE * 20
+        assembler = TraceAssembler()
+        messages = load_messages(trace, max_bytes=200)
+        for message in messages:
+            assembler.feed(message)
+        assert assembler.text() == trace
+
+    def test_empty_trace_is_one_part(self):
+        """Loading nothing still clears the ring and completes"""
+        assert load_messages("") == [b"# part 0\n# end 1\n"]
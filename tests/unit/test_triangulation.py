@@ -138,6 +138,31 @@ class TestTriangulationService:
         
         assert conf_4 > conf_2
     
+    def test_weights_discount_noisy_anchor(self):
+        """A distance with a large variance pulls the fix less than clean ones"""
+        # Tag at (500, 400); anchor 3 reads 150 cm long (multipath)
+        measurements = [
+            (0, 0, 640.3),
+            (1000, 0, 640.3),
+            (1000, 800, 790.3),
+            (0, 800, 640.3),
+        ]
+        weights = [self.service.range_weight(v) for v in (4.0, 4.0, 2500.0, 4.0)]
+        
+        x_u, y_u, _ = self.service.calculate_position(measurements)
+        x_w, y_w, _ = self.service.calculate_position(measurements, weights)
+        
+        error_unweighted = ((x_u - 500) ** 2 + (y_u - 400) ** 2) ** 0.5
+        error_weighted = ((x_w - 500) ** 2 + (y_w - 400) ** 2) ** 0.5
+        assert error_weighted < error_unweighted / 2
+    
+    def test_range_weight(self):
+        """Clean links weigh ~1, missing statistics weigh exactly 1"""
+        assert self.service.range_weight(None) == 1.0
+        assert self.service.range_weight(0.0) == 1.0
+        assert self.service.range_weight(100.0) == pytest.approx(0.5)
+        assert self.service.range_weight(2500.0) < 0.05
+    
     def test_position_bounds(self):
         """Calculated position should be within reasonable bounds"""
         measurements = [